@@ -0,0 +1,268 @@
+// Name: autotune.c
+// Description: Calibrates the automatic backend choice and the transpose
+//              block size on this machine, and writes a tuning profile
+//              (see polyfit_tune.h) that the library loads at startup.
+//
+// Usage:   autotune [profile] [maxPointCount]
+//
+// The transpose block size is swept first, on the OpenMP backend at
+// the largest size.  Then for each size class - point counts 2^10,
+// 2^13, ... up to maxPointCount (default 2^22), by coefficient counts
+// 3, 6, 12 and 24 - every backend is timed on 1, 2, 4, ... threads up
+// to the CPU count (or POLYFIT_THREADS), and the fastest is recorded.
+// The last class of each coefficient count also covers all larger
+// fits.  The profile goes to POLYFIT_TUNE_DEFAULT_FILE unless another
+// name is given.
+
+#include <limits.h>     // INT_MAX
+#include <stdio.h>
+#include <stdlib.h>     // malloc(), strtol()
+
+#include "polyfit_ex.h"
+#include "polyfit_pool.h"
+#include "polyfit_sums.h"
+#include "polyfit_synth.h"
+#include "polyfit_tune.h"
+#include "polyfit_workspace.h"
+
+// Largest point count swept by default.
+#define DEFAULT_MAX_POINTS      (1 << 22)
+
+// Smallest point count swept, and the factor between sizes.
+#define MIN_POINTS              (1 << 10)
+#define POINT_STEP              (8)
+
+// Matrix backends are skipped where their workspace would
+// be larger than this.
+#define MAX_WORKSPACE_BYTES     ((size_t) 1 << 29)
+
+// Each configuration is run at least MIN_RUNS times and for
+// at least MIN_SECONDS, and its fastest run is kept.
+#define MIN_RUNS                (3)
+#define MAX_RUNS                (1000)
+#define MIN_SECONDS             (0.05)
+
+// More threads have to be this much faster to be chosen, so
+// timing noise doesn't pick them.
+#define THREAD_MARGIN           (0.95)
+
+// Coefficient counts swept.
+static const int coefficientCounts[] = { 3, 6, 12, POLYFIT_MAX_COEFFICIENTS };
+#define COEFFICIENT_CLASS_COUNT ((int) (sizeof( coefficientCounts ) / sizeof( coefficientCounts[0] )))
+
+// Transpose block sizes swept.
+static const int blockSizes[] = { 8, 16, 32, 64, 128, 256 };
+#define BLOCK_SIZE_COUNT        ((int) (sizeof( blockSizes ) / sizeof( blockSizes[0] )))
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static int      nextThreadCount( int threadCount, int maxThreads );
+static double   timeFit( int pointCount, double *xValues, double *yValues, int coefficientCount,
+                         polyfit_backend_t backend, int threadCount );
+static int      tuneBlockSize( int pointCount, double *xValues, double *yValues, int maxThreads, polyfit_tune_t *pProfile );
+
+
+//--------------------------------------------------------
+// main()
+// Runs the sweeps and writes the profile.
+//--------------------------------------------------------
+int main( int argc, char *argv[] )
+{
+    const char *fileName = (argc > 1) ? argv[1] : POLYFIT_TUNE_DEFAULT_FILE;
+    long maxPointCount = (argc > 2) ? strtol( argv[2], NULL, 10 ) : DEFAULT_MAX_POINTS;
+
+    if( (argc > 3) || (maxPointCount < MIN_POINTS) || (maxPointCount > INT_MAX) )
+    {
+        fprintf( stderr, "Usage: %s [profile] [maxPointCount >= %d]\n", argv[0], MIN_POINTS );
+        return 1;
+    }
+
+    double *xValues = (double *) malloc( maxPointCount * sizeof( double ) );
+    double *yValues = (double *) malloc( maxPointCount * sizeof( double ) );
+    if( (NULL == xValues) || (NULL == yValues) )
+    {
+        fprintf( stderr, "Unable to allocate %ld points\n", maxPointCount );
+        return 1;
+    }
+
+    // A noisy quadratic over [-1, 1), the same on every run.
+    polyfit_synth_t synth;
+    polyfit_synth_defaults( &synth );
+    synth.pointCount = maxPointCount;
+    synth.degree = 2;
+    polyfit_synth_generate( &synth, xValues, yValues, NULL );
+
+    // Measure from the built-in profile, not one loaded at startup.
+    polyfit_tune_t profile;
+    polyfit_tune_defaults( &profile );
+    polyfit_tune_set( &profile );
+
+    int maxThreads = polyfit_pool_default_size();
+    int largestPointCount = MIN_POINTS;
+    while( (long) largestPointCount * POINT_STEP <= maxPointCount )
+    {
+        largestPointCount *= POINT_STEP;
+    }
+
+    if( 0 != tuneBlockSize( largestPointCount, xValues, yValues, maxThreads, &profile ) )
+    {
+        fprintf( stderr, "Unable to time the transpose block sizes\n" );
+        return 1;
+    }
+    polyfit_tune_set( &profile );
+    fprintf( stderr, "blockSize %d\n", profile.blockSize );
+
+    profile.parallelPoints = INT_MAX;
+    for( int k = 0; k < COEFFICIENT_CLASS_COUNT; k++ )
+    {
+        int coefficientCount = coefficientCounts[k];
+
+        for( long classPoints = MIN_POINTS; classPoints <= largestPointCount; classPoints *= POINT_STEP )
+        {
+            int pointCount = (int) classPoints;
+            polyfit_tune_class_t best = { pointCount, coefficientCount, POLYFIT_BACKEND_SERIAL, 1 };
+            double bestSeconds = -1.0;
+
+            for( int b = POLYFIT_BACKEND_SERIAL; b < POLYFIT_BACKEND_COUNT; b++ )
+            {
+                for( int threadCount = 1; threadCount <= maxThreads; threadCount = nextThreadCount( threadCount, maxThreads ) )
+                {
+                    if( (POLYFIT_BACKEND_SERIAL == b) && (threadCount > 1) )
+                    {
+                        break;
+                    }
+                    if( (POLYFIT_BACKEND_SIMD != b) &&
+                        (polyfit_workspace_bytes( pointCount, coefficientCount, threadCount ) > MAX_WORKSPACE_BYTES) )
+                    {
+                        break;
+                    }
+
+                    double seconds = timeFit( pointCount, xValues, yValues, coefficientCount, (polyfit_backend_t) b, threadCount );
+                    double target = (threadCount > best.threadCount) ? THREAD_MARGIN * bestSeconds : bestSeconds;
+                    if( (seconds >= 0.0) && ((bestSeconds < 0.0) || (seconds < target)) )
+                    {
+                        bestSeconds = seconds;
+                        best.backend = (polyfit_backend_t) b;
+                        best.threadCount = threadCount;
+                    }
+                }
+            }
+
+            if( bestSeconds < 0.0 )
+            {
+                continue;
+            }
+            if( classPoints * POINT_STEP > largestPointCount )
+            {
+                best.maxPointCount = INT_MAX;
+            }
+            if( (best.threadCount > 1) && (pointCount < profile.parallelPoints) )
+            {
+                profile.parallelPoints = pointCount;
+            }
+            profile.classes[ profile.classCount++ ] = best;
+
+            fprintf( stderr, "%9d points %2d coefficients: %-8s %3d threads %12.6f s\n", pointCount, coefficientCount,
+                     polyfit_backend_name( best.backend ), best.threadCount, bestSeconds );
+        }
+    }
+
+    int rVal = polyfit_tune_save( fileName, &profile );
+    if( 0 != rVal )
+    {
+        fprintf( stderr, "Unable to write %s (error = %d)\n", fileName, rVal );
+        return 1;
+    }
+    fprintf( stderr, "Wrote %s\n", fileName );
+
+    free( xValues );
+    free( yValues );
+    return 0;
+}
+
+//--------------------------------------------------------
+// nextThreadCount()
+// Steps through 1, 2, 4, ... and ends on maxThreads.
+//--------------------------------------------------------
+static int nextThreadCount( int threadCount, int maxThreads )
+{
+    if( (threadCount < maxThreads) && (2 * threadCount > maxThreads) )
+    {
+        return maxThreads;
+    }
+    return 2 * threadCount;
+}
+
+//--------------------------------------------------------
+// timeFit()
+// Returns the fastest time of one fit on a backend and
+// thread count, or -1 if the fit fails.  A singular fit
+// still does all the work being timed.
+//--------------------------------------------------------
+static double timeFit( int pointCount, double *xValues, double *yValues, int coefficientCount,
+                       polyfit_backend_t backend, int threadCount )
+{
+    double coefficients[ POLYFIT_MAX_COEFFICIENTS ];
+    polyfit_options_t options;
+    polyfit_result_t result;
+    double bestSeconds = -1.0;
+    double totalSeconds = 0.0;
+
+    polyfit_options_defaults( &options );
+    options.backend = backend;
+    options.threadCount = threadCount;
+
+    // The first run warms the caches and starts the threads.
+    int rVal = polyfit_ex( pointCount, xValues, yValues, coefficientCount, coefficients, &options, &result );
+    if( (0 != rVal) && (-4 != rVal) )
+    {
+        return -1.0;
+    }
+
+    for( int run = 0; (run < MIN_RUNS) || ((totalSeconds < MIN_SECONDS) && (run < MAX_RUNS)); run++ )
+    {
+        polyfit_ex( pointCount, xValues, yValues, coefficientCount, coefficients, &options, &result );
+        totalSeconds += result.seconds;
+        if( (bestSeconds < 0.0) || (result.seconds < bestSeconds) )
+        {
+            bestSeconds = result.seconds;
+        }
+    }
+    return bestSeconds;
+}
+
+//--------------------------------------------------------
+// tuneBlockSize()
+// Sets pProfile->blockSize to the fastest transpose block
+// size for the OpenMP backend on all threads.
+//
+// Returns 0 if success, -1 if no block size could be timed.
+//--------------------------------------------------------
+static int tuneBlockSize( int pointCount, double *xValues, double *yValues, int maxThreads, polyfit_tune_t *pProfile )
+{
+    int coefficientCount = coefficientCounts[1];
+    double bestSeconds = -1.0;
+
+    while( polyfit_workspace_bytes( pointCount, coefficientCount, maxThreads ) > MAX_WORKSPACE_BYTES )
+    {
+        pointCount /= POINT_STEP;
+    }
+
+    for( int i = 0; i < BLOCK_SIZE_COUNT; i++ )
+    {
+        polyfit_tune_t trial = *pProfile;
+        trial.blockSize = blockSizes[i];
+        polyfit_tune_set( &trial );
+
+        double seconds = timeFit( pointCount, xValues, yValues, coefficientCount, POLYFIT_BACKEND_OPENMP, maxThreads );
+        if( (seconds >= 0.0) && ((bestSeconds < 0.0) || (seconds < bestSeconds)) )
+        {
+            bestSeconds = seconds;
+            pProfile->blockSize = blockSizes[i];
+        }
+    }
+    return (bestSeconds < 0.0) ? -1 : 0;
+}
@@ -0,0 +1,705 @@
+// Name: bench.c
+// Description: Benchmarks every backend on synthetic datasets (see
+//              polyfit_synth.h) across thread counts, and writes the
+//              results as CSV or JSON.
+//
+// Usage:   bench [options]
+//      -n sizes        point counts, comma separated, K/M suffixes allowed
+//                      (default 10K,100K,1M,10M; 10K .. 100M)
+//      -k count        coefficients fitted (default 5; 1 .. 24)
+//      -d degree       degree of the generating polynomial (default k - 1)
+//      -b backends     comma separated (default serial,openmp,pthreads,simd)
+//      -p precisions   double, mixed or both, comma separated (default double)
+//      -t threads      most threads (default polyfit_pool_default_size())
+//      -w warmups      untimed runs per configuration (default 2)
+//      -r repeats      timed runs per configuration (default 10)
+//      -s seed         dataset seed (default 1)
+//      -e noise        noise standard deviation (default 0.01)
+//      -x fraction     share of outliers (default 0)
+//      -m megabytes    skip matrix backends needing more workspace (default 4096)
+//      -f csv|json     output format (default csv)
+//      -o file         output file (default stdout)
+//      -R              roofline report instead of the scaling one
+//
+// Each backend is run on 1, 2, 4, ... threads up to the maximum; the
+// serial backend only on 1.  Mixed precision runs on the openmp
+// backend alone, as the float fit alone (no refinement) with the
+// dataset's x range given, so it is timed as a caller who wants
+// speed would use it; its coefficient error shows what that costs.
+// The matrix backends reuse one workspace per configuration, so
+// allocation isn't timed.  Speedup and parallel
+// efficiency are against the same backend's median on 1 thread;
+// throughput is points per second at the median.  Progress goes to
+// stderr.
+//
+// With -R the machine's bandwidth and peak FLOP rate are measured on
+// each thread count first (see polyfit_roofline.h), and each phase of
+// every configuration is reported with its arithmetic intensity,
+// achieved GB/s and GFLOP/s, and percentage of its roofline bound.
+// Bytes and flops are the ones the fits model in polyfit_stats_t:
+// logical traffic, so a phase over 100% is being served from cache.
+
+#include <math.h>       // fabs()
+#include <stdbool.h>    // bool
+#include <stdio.h>
+#include <stdlib.h>     // malloc(), strtod(), strtol(), strtoull()
+#include <string.h>     // strcmp(), strtok()
+#include <unistd.h>     // getopt()
+
+#include "polyfit_ex.h"
+#include "polyfit_pool.h"
+#include "polyfit_roofline.h"
+#include "polyfit_stats.h"
+#include "polyfit_sums.h"
+#include "polyfit_synth.h"
+#include "polyfit_workspace.h"
+
+// Most point counts one run takes.
+#define MAX_SIZES           (16)
+
+// Point counts accepted.
+#define MIN_POINTS          (10000L)
+#define MAX_POINTS          (100000000L)
+
+// Longest -b, -n or -p argument.
+#define LIST_SIZE           (256)
+
+typedef enum
+{
+    FORMAT_CSV = 0,
+    FORMAT_JSON
+} OutputFormat;
+
+// Everything the command line sets.
+typedef struct
+{
+    long                sizes[ MAX_SIZES ];
+    int                 sizeCount;
+    int                 coefficientCount;
+    bool                isBackendUsed[ POLYFIT_BACKEND_COUNT ];
+    bool                isPrecisionUsed[ POLYFIT_PRECISION_COUNT ];
+    int                 maxThreads;
+    int                 warmupCount;
+    int                 repeatCount;
+    size_t              maxWorkspaceBytes;
+    OutputFormat        format;
+    const char          *outputName;
+    bool                isRoofline;
+    polyfit_synth_t     synth;
+} BenchConfig;
+
+// Measurements of one backend, size and thread count.
+typedef struct
+{
+    long                pointCount;
+    polyfit_backend_t   backend;
+    polyfit_precision_t precision;
+    int                 threadCount;
+    int                 status;         // Last polyfit_ex() result, or 1 if skipped.
+    polyfit_stats_summary_t summary;    // Of POLYFIT_PHASE_TOTAL, in nanoseconds.
+    double              speedup;
+    double              efficiency;
+    double              pointsPerSecond;
+    double              coefficientError;   // Largest distance from the generating polynomial.
+    double              phaseSeconds[ POLYFIT_PHASE_COUNT ];    // Median of each phase.
+    long long           phaseBytes[ POLYFIT_PHASE_COUNT ];
+    long long           phaseFlops[ POLYFIT_PHASE_COUNT ];
+    const polyfit_roofline_t *pRoofline;    // Machine peaks on threadCount threads, for -R.
+} BenchRow;
+
+// Names of the precisions, for -p and the output.
+static const char *precisionNames[ POLYFIT_PRECISION_COUNT ] = { "double", "mixed" };
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static int      parseArguments( int argc, char *argv[], BenchConfig *pConfig );
+static int      parseSizes( const char *list, BenchConfig *pConfig );
+static int      parseBackends( const char *list, BenchConfig *pConfig );
+static int      parsePrecisions( const char *list, BenchConfig *pConfig );
+static int      nextThreadCount( int threadCount, int maxThreads );
+static void     runConfiguration( const BenchConfig *pConfig, double *xValues, double *yValues,
+                                  const double *trueCoefficients, BenchRow *pRow );
+static void     writeHeader( FILE *pFile, const BenchConfig *pConfig );
+static void     writeRow( FILE *pFile, const BenchConfig *pConfig, const BenchRow *pRow, bool isFirst );
+static void     writeRooflineRow( FILE *pFile, const BenchConfig *pConfig, const BenchRow *pRow, bool isFirst );
+static void     writeFooter( FILE *pFile, const BenchConfig *pConfig );
+
+
+//--------------------------------------------------------
+// main()
+// Generates the largest dataset once and benchmarks every
+// size on its prefix.
+//--------------------------------------------------------
+int main( int argc, char *argv[] )
+{
+    BenchConfig config;
+    double trueCoefficients[ POLYFIT_SYNTH_MAX_DEGREE + 1 ];
+    polyfit_roofline_t *pRooflines = NULL;
+
+    if( 0 != parseArguments( argc, argv, &config ) )
+    {
+        fprintf( stderr, "Usage: %s [-n sizes] [-k coefficients] [-d degree] [-b backends] [-p precisions]\n"
+                         "       [-t threads] [-w warmups] [-r repeats] [-s seed] [-e noise] [-x outlierFraction]\n"
+                         "       [-m workspaceMB] [-f csv|json] [-o file] [-R]\n", argv[0] );
+        return 1;
+    }
+
+    // Indexed by thread count, measured before the data
+    // takes up memory.
+    if( config.isRoofline )
+    {
+        pRooflines = (polyfit_roofline_t *) calloc( config.maxThreads + 1, sizeof( polyfit_roofline_t ) );
+        if( NULL == pRooflines )
+        {
+            fprintf( stderr, "Unable to allocate the roofline table\n" );
+            return 1;
+        }
+        for( int threadCount = 1; threadCount <= config.maxThreads; threadCount = nextThreadCount( threadCount, config.maxThreads ) )
+        {
+            if( 0 != polyfit_roofline_measure( threadCount, &pRooflines[ threadCount ] ) )
+            {
+                fprintf( stderr, "Unable to measure the roofline\n" );
+                return 1;
+            }
+            fprintf( stderr, "%3d threads: %8.2f GB/s, %8.2f GFLOP/s peak (%s)\n", threadCount,
+                     pRooflines[ threadCount ].bandwidth / 1e9, pRooflines[ threadCount ].peakFlops / 1e9,
+                     polyfit_simd_name( pRooflines[ threadCount ].isa ) );
+        }
+    }
+
+    long maxPointCount = 0;
+    for( int i = 0; i < config.sizeCount; i++ )
+    {
+        if( config.sizes[i] > maxPointCount )
+        {
+            maxPointCount = config.sizes[i];
+        }
+    }
+
+    double *xValues = (double *) malloc( maxPointCount * sizeof( double ) );
+    double *yValues = (double *) malloc( maxPointCount * sizeof( double ) );
+    if( (NULL == xValues) || (NULL == yValues) )
+    {
+        fprintf( stderr, "Unable to allocate %ld points\n", maxPointCount );
+        return 1;
+    }
+
+    config.synth.pointCount = maxPointCount;
+    if( 0 != polyfit_synth_generate( &config.synth, xValues, yValues, trueCoefficients ) )
+    {
+        fprintf( stderr, "Unable to generate the dataset\n" );
+        return 1;
+    }
+
+    FILE *pFile = stdout;
+    if( NULL != config.outputName )
+    {
+        pFile = fopen( config.outputName, "w" );
+        if( NULL == pFile )
+        {
+            fprintf( stderr, "Unable to write %s\n", config.outputName );
+            return 1;
+        }
+    }
+
+    writeHeader( pFile, &config );
+    bool isFirst = true;
+    for( int i = 0; i < config.sizeCount; i++ )
+    {
+        for( int b = POLYFIT_BACKEND_SERIAL; b < POLYFIT_BACKEND_COUNT; b++ )
+        {
+            for( int precision = POLYFIT_PRECISION_DOUBLE; precision < POLYFIT_PRECISION_COUNT; precision++ )
+            {
+                double baseSeconds = -1.0;
+
+                if( !config.isBackendUsed[b] || !config.isPrecisionUsed[ precision ] ||
+                    ((POLYFIT_PRECISION_MIXED == precision) && (POLYFIT_BACKEND_OPENMP != b)) )
+                {
+                    continue;
+                }
+                for( int threadCount = 1; threadCount <= config.maxThreads; threadCount = nextThreadCount( threadCount, config.maxThreads ) )
+                {
+                    BenchRow row;
+
+                    if( (POLYFIT_BACKEND_SERIAL == b) && (threadCount > 1) )
+                    {
+                        break;
+                    }
+
+                    row.pointCount = config.sizes[i];
+                    row.backend = (polyfit_backend_t) b;
+                    row.precision = (polyfit_precision_t) precision;
+                    row.threadCount = threadCount;
+                    row.pRoofline = (NULL != pRooflines) ? &pRooflines[ threadCount ] : NULL;
+                    runConfiguration( &config, xValues, yValues, trueCoefficients, &row );
+
+                    double seconds = row.summary.p50 / 1e9;
+                    if( (0 == row.status) && (1 == threadCount) )
+                    {
+                        baseSeconds = seconds;
+                    }
+                    if( (0 == row.status) && (seconds > 0.0) )
+                    {
+                        row.pointsPerSecond = row.pointCount / seconds;
+                        if( baseSeconds > 0.0 )
+                        {
+                            row.speedup = baseSeconds / seconds;
+                            row.efficiency = row.speedup / threadCount;
+                        }
+                    }
+
+                    if( config.isRoofline )
+                    {
+                        writeRooflineRow( pFile, &config, &row, isFirst );
+                    }
+                    else
+                    {
+                        writeRow( pFile, &config, &row, isFirst );
+                    }
+                    isFirst = false;
+                    fprintf( stderr, "%10ld %-8s %-6s %3d threads: %12.6f s  status %d\n", row.pointCount,
+                             polyfit_backend_name( row.backend ), precisionNames[ row.precision ], threadCount,
+                             seconds, row.status );
+                }
+            }
+        }
+    }
+    writeFooter( pFile, &config );
+
+    if( stdout != pFile )
+    {
+        fclose( pFile );
+    }
+    free( pRooflines );
+    free( xValues );
+    free( yValues );
+    return 0;
+}
+
+//--------------------------------------------------------
+// parseArguments()
+// Fills pConfig from the defaults and the command line.
+//
+// Returns 0 if success, -2 if an argument is invalid.
+//--------------------------------------------------------
+static int parseArguments( int argc, char *argv[], BenchConfig *pConfig )
+{
+    int degree = -1;
+    int option;
+
+    memset( pConfig, 0, sizeof( *pConfig ) );
+    parseSizes( "10K,100K,1M,10M", pConfig );
+    parseBackends( "serial,openmp,pthreads,simd", pConfig );
+    parsePrecisions( "double", pConfig );
+    pConfig->coefficientCount = 5;
+    pConfig->maxThreads = polyfit_pool_default_size();
+    pConfig->warmupCount = 2;
+    pConfig->repeatCount = 10;
+    pConfig->maxWorkspaceBytes = (size_t) 4096 << 20;
+    pConfig->format = FORMAT_CSV;
+    polyfit_synth_defaults( &pConfig->synth );
+
+    while( -1 != (option = getopt( argc, argv, "n:k:d:b:p:t:w:r:s:e:x:m:f:o:R" )) )
+    {
+        int rVal = 0;
+
+        switch( option )
+        {
+        case 'n':   rVal = parseSizes( optarg, pConfig );                           break;
+        case 'k':   pConfig->coefficientCount = (int) strtol( optarg, NULL, 10 );   break;
+        case 'd':   degree = (int) strtol( optarg, NULL, 10 );                      break;
+        case 'b':   rVal = parseBackends( optarg, pConfig );                        break;
+        case 'p':   rVal = parsePrecisions( optarg, pConfig );                      break;
+        case 't':   pConfig->maxThreads = (int) strtol( optarg, NULL, 10 );         break;
+        case 'w':   pConfig->warmupCount = (int) strtol( optarg, NULL, 10 );        break;
+        case 'r':   pConfig->repeatCount = (int) strtol( optarg, NULL, 10 );        break;
+        case 's':   pConfig->synth.seed = strtoull( optarg, NULL, 10 );             break;
+        case 'e':   pConfig->synth.noise = strtod( optarg, NULL );                  break;
+        case 'x':   pConfig->synth.outlierFraction = strtod( optarg, NULL );        break;
+        case 'm':   pConfig->maxWorkspaceBytes = (size_t) strtol( optarg, NULL, 10 ) << 20;  break;
+        case 'o':   pConfig->outputName = optarg;                                   break;
+        case 'R':   pConfig->isRoofline = true;                                     break;
+        case 'f':
+            if( 0 == strcmp( optarg, "csv" ) )
+            {
+                pConfig->format = FORMAT_CSV;
+            }
+            else if( 0 == strcmp( optarg, "json" ) )
+            {
+                pConfig->format = FORMAT_JSON;
+            }
+            else
+            {
+                rVal = -2;
+            }
+            break;
+        default:
+            rVal = -2;
+            break;
+        }
+        if( 0 != rVal )
+        {
+            return -2;
+        }
+    }
+
+    pConfig->synth.degree = (degree >= 0) ? degree : pConfig->coefficientCount - 1;
+    if( (optind != argc) || (pConfig->coefficientCount < 1) ||
+        (pConfig->coefficientCount > POLYFIT_MAX_COEFFICIENTS) || (pConfig->maxThreads < 1) ||
+        (pConfig->warmupCount < 0) || (pConfig->repeatCount < 1) ||
+        (pConfig->synth.degree > POLYFIT_SYNTH_MAX_DEGREE) )
+    {
+        return -2;
+    }
+    return 0;
+}
+
+//--------------------------------------------------------
+// parseSizes()
+// Reads a list like "10K,2.5M,100000" into pConfig->sizes.
+//
+// Returns 0 if success, -2 if a size is out of range.
+//--------------------------------------------------------
+static int parseSizes( const char *list, BenchConfig *pConfig )
+{
+    char buffer[ LIST_SIZE ];
+
+    snprintf( buffer, sizeof( buffer ), "%s", list );
+    pConfig->sizeCount = 0;
+    for( char *pItem = strtok( buffer, "," ); NULL != pItem; pItem = strtok( NULL, "," ) )
+    {
+        char *pEnd;
+        double size = strtod( pItem, &pEnd );
+
+        if( ('k' == *pEnd) || ('K' == *pEnd) )
+        {
+            size *= 1e3;
+            pEnd++;
+        }
+        else if( ('m' == *pEnd) || ('M' == *pEnd) )
+        {
+            size *= 1e6;
+            pEnd++;
+        }
+
+        if( ('\0' != *pEnd) || (size < MIN_POINTS) || (size > MAX_POINTS) || (pConfig->sizeCount >= MAX_SIZES) )
+        {
+            return -2;
+        }
+        pConfig->sizes[ pConfig->sizeCount++ ] = (long) size;
+    }
+    return (pConfig->sizeCount > 0) ? 0 : -2;
+}
+
+//--------------------------------------------------------
+// parseBackends()
+// Reads a list like "openmp,simd" into
+// pConfig->isBackendUsed.
+//
+// Returns 0 if success, -2 if a name isn't a backend.
+//--------------------------------------------------------
+static int parseBackends( const char *list, BenchConfig *pConfig )
+{
+    char buffer[ LIST_SIZE ];
+    bool isAny = false;
+
+    snprintf( buffer, sizeof( buffer ), "%s", list );
+    memset( pConfig->isBackendUsed, 0, sizeof( pConfig->isBackendUsed ) );
+    for( char *pItem = strtok( buffer, "," ); NULL != pItem; pItem = strtok( NULL, "," ) )
+    {
+        bool isFound = false;
+        for( int b = POLYFIT_BACKEND_SERIAL; b < POLYFIT_BACKEND_COUNT; b++ )
+        {
+            if( 0 == strcmp( pItem, polyfit_backend_name( (polyfit_backend_t) b ) ) )
+            {
+                pConfig->isBackendUsed[b] = true;
+                isFound = true;
+            }
+        }
+        if( !isFound )
+        {
+            return -2;
+        }
+        isAny = true;
+    }
+    return isAny ? 0 : -2;
+}
+
+//--------------------------------------------------------
+// parsePrecisions()
+// Reads a list like "double,mixed" into
+// pConfig->isPrecisionUsed.
+//
+// Returns 0 if success, -2 if a name isn't a precision.
+//--------------------------------------------------------
+static int parsePrecisions( const char *list, BenchConfig *pConfig )
+{
+    char buffer[ LIST_SIZE ];
+    bool isAny = false;
+
+    snprintf( buffer, sizeof( buffer ), "%s", list );
+    memset( pConfig->isPrecisionUsed, 0, sizeof( pConfig->isPrecisionUsed ) );
+    for( char *pItem = strtok( buffer, "," ); NULL != pItem; pItem = strtok( NULL, "," ) )
+    {
+        bool isFound = false;
+        for( int p = POLYFIT_PRECISION_DOUBLE; p < POLYFIT_PRECISION_COUNT; p++ )
+        {
+            if( 0 == strcmp( pItem, precisionNames[p] ) )
+            {
+                pConfig->isPrecisionUsed[p] = true;
+                isFound = true;
+            }
+        }
+        if( !isFound )
+        {
+            return -2;
+        }
+        isAny = true;
+    }
+    return isAny ? 0 : -2;
+}
+
+//--------------------------------------------------------
+// nextThreadCount()
+// Steps through 1, 2, 4, ... and ends on maxThreads.
+//--------------------------------------------------------
+static int nextThreadCount( int threadCount, int maxThreads )
+{
+    if( (threadCount < maxThreads) && (2 * threadCount > maxThreads) )
+    {
+        return maxThreads;
+    }
+    return 2 * threadCount;
+}
+
+//--------------------------------------------------------
+// runConfiguration()
+// Times one backend, size and thread count, and fills in
+// pRow's status, summary and coefficient error.  A matrix
+// backend whose workspace would be too large is skipped
+// with status 1.  The mixed fit needs no workspace.
+//--------------------------------------------------------
+static void runConfiguration( const BenchConfig *pConfig, double *xValues, double *yValues,
+                              const double *trueCoefficients, BenchRow *pRow )
+{
+    double coefficients[ POLYFIT_MAX_COEFFICIENTS ];
+    polyfit_options_t options;
+    polyfit_result_t result;
+    polyfit_stats_collector_t collector;
+    polyfit_workspace_t *pWorkspace = NULL;
+    int pointCount = (int) pRow->pointCount;
+    int coefficientCount = pConfig->coefficientCount;
+
+    memset( &pRow->summary, 0, sizeof( pRow->summary ) );
+    memset( pRow->phaseSeconds, 0, sizeof( pRow->phaseSeconds ) );
+    memset( pRow->phaseBytes, 0, sizeof( pRow->phaseBytes ) );
+    memset( pRow->phaseFlops, 0, sizeof( pRow->phaseFlops ) );
+    pRow->status = 0;
+    pRow->speedup = 0.0;
+    pRow->efficiency = 0.0;
+    pRow->pointsPerSecond = 0.0;
+    pRow->coefficientError = 0.0;
+
+    if( (POLYFIT_PRECISION_DOUBLE == pRow->precision) && (POLYFIT_BACKEND_SIMD != pRow->backend) )
+    {
+        if( polyfit_workspace_bytes( pointCount, coefficientCount, pRow->threadCount ) > pConfig->maxWorkspaceBytes )
+        {
+            pRow->status = 1;
+            return;
+        }
+        pWorkspace = polyfit_workspace_create( pointCount, coefficientCount, pRow->threadCount );
+        if( NULL == pWorkspace )
+        {
+            pRow->status = -3;
+            return;
+        }
+    }
+
+    polyfit_options_defaults( &options );
+    options.backend = pRow->backend;
+    options.threadCount = pRow->threadCount;
+    options.pWorkspace = pWorkspace;
+    options.precision = pRow->precision;
+    options.xMin = pConfig->synth.xMin;
+    options.xMax = pConfig->synth.xMax;
+    polyfit_stats_collector_init( &collector );
+
+    for( int run = 0; (run < pConfig->warmupCount + pConfig->repeatCount) && (0 == pRow->status); run++ )
+    {
+        pRow->status = polyfit_ex( pointCount, xValues, yValues, coefficientCount, coefficients, &options, &result );
+        if( (0 == pRow->status) && (run >= pConfig->warmupCount) )
+        {
+            polyfit_stats_collector_add( &collector, &result.stats );
+        }
+    }
+
+    if( 0 == pRow->status )
+    {
+        polyfit_stats_collector_summary( &collector, POLYFIT_PHASE_TOTAL, &pRow->summary );
+
+        // The work per phase is the same on every run.
+        for( int p = 0; p < POLYFIT_PHASE_COUNT; p++ )
+        {
+            polyfit_stats_summary_t phaseSummary;
+            if( 0 == polyfit_stats_collector_summary( &collector, (polyfit_phase_t) p, &phaseSummary ) )
+            {
+                pRow->phaseSeconds[p] = phaseSummary.p50 / 1e9;
+            }
+            pRow->phaseBytes[p] = result.stats.bytes[p];
+            pRow->phaseFlops[p] = result.stats.flops[p];
+        }
+
+        // Compare like powers; the fit may have more or fewer
+        // than the generating polynomial.
+        int degree = pConfig->synth.degree;
+        for( int p = 0; (p < coefficientCount) || (p <= degree); p++ )
+        {
+            double fitted = (p < coefficientCount) ? coefficients[ coefficientCount - 1 - p ] : 0.0;
+            double expected = (p <= degree) ? trueCoefficients[ degree - p ] : 0.0;
+            if( fabs( fitted - expected ) > pRow->coefficientError )
+            {
+                pRow->coefficientError = fabs( fitted - expected );
+            }
+        }
+    }
+
+    polyfit_stats_collector_free( &collector );
+    polyfit_workspace_destroy( pWorkspace );
+}
+
+//--------------------------------------------------------
+// writeHeader()
+// Starts the output: the CSV column names, or the JSON
+// settings object.
+//--------------------------------------------------------
+static void writeHeader( FILE *pFile, const BenchConfig *pConfig )
+{
+    if( (FORMAT_CSV == pConfig->format) && pConfig->isRoofline )
+    {
+        fprintf( pFile, "points,coefficients,backend,precision,threads,status,phase,median_s,bytes,flops,intensity,"
+                        "gb_per_s,gflop_per_s,bandwidth_gb_per_s,peak_gflop_per_s,roof_gflop_per_s,percent_of_roof\n" );
+        return;
+    }
+    if( FORMAT_CSV == pConfig->format )
+    {
+        fprintf( pFile, "points,coefficients,backend,precision,threads,status,runs,min_s,median_s,mean_s,p99_s,"
+                        "speedup,efficiency,points_per_s,coefficient_error\n" );
+        return;
+    }
+
+    fprintf( pFile, "{\n  \"seed\": %llu,\n  \"degree\": %d,\n  \"noise\": %g,\n  \"outlierFraction\": %g,\n"
+                    "  \"coefficients\": %d,\n  \"warmups\": %d,\n  \"repeats\": %d,\n  \"results\": [\n",
+             pConfig->synth.seed, pConfig->synth.degree, pConfig->synth.noise, pConfig->synth.outlierFraction,
+             pConfig->coefficientCount, pConfig->warmupCount, pConfig->repeatCount );
+}
+
+//--------------------------------------------------------
+// writeRow()
+// Writes one configuration's results.
+//--------------------------------------------------------
+static void writeRow( FILE *pFile, const BenchConfig *pConfig, const BenchRow *pRow, bool isFirst )
+{
+    const polyfit_stats_summary_t *pSummary = &pRow->summary;
+
+    if( FORMAT_CSV == pConfig->format )
+    {
+        fprintf( pFile, "%ld,%d,%s,%s,%d,%d,%ld,%.9f,%.9f,%.9f,%.9f,%.4f,%.4f,%.6g,%.3g\n",
+                 pRow->pointCount, pConfig->coefficientCount, polyfit_backend_name( pRow->backend ),
+                 precisionNames[ pRow->precision ], pRow->threadCount, pRow->status, pSummary->sampleCount,
+                 pSummary->minimum / 1e9, pSummary->p50 / 1e9, pSummary->mean / 1e9, pSummary->p99 / 1e9,
+                 pRow->speedup, pRow->efficiency, pRow->pointsPerSecond, pRow->coefficientError );
+        return;
+    }
+
+    fprintf( pFile, "%s    { \"points\": %ld, \"backend\": \"%s\", \"precision\": \"%s\", \"threads\": %d,\n"
+                    "      \"status\": %d, \"runs\": %ld,"
+                    "      \"min_s\": %.9f, \"median_s\": %.9f, \"mean_s\": %.9f, \"p99_s\": %.9f,\n"
+                    "      \"speedup\": %.4f, \"efficiency\": %.4f, \"points_per_s\": %.6g, \"coefficient_error\": %.3g }",
+             isFirst ? "" : ",\n", pRow->pointCount, polyfit_backend_name( pRow->backend ),
+             precisionNames[ pRow->precision ], pRow->threadCount, pRow->status, pSummary->sampleCount,
+             pSummary->minimum / 1e9, pSummary->p50 / 1e9, pSummary->mean / 1e9, pSummary->p99 / 1e9,
+             pRow->speedup, pRow->efficiency, pRow->pointsPerSecond, pRow->coefficientError );
+}
+
+//--------------------------------------------------------
+// writeRooflineRow()
+// Writes each phase of one configuration against the
+// roofline: a CSV line per phase, or a JSON object with a
+// phases array.  Phases the backend doesn't have are left
+// out.
+//--------------------------------------------------------
+static void writeRooflineRow( FILE *pFile, const BenchConfig *pConfig, const BenchRow *pRow, bool isFirst )
+{
+    const polyfit_roofline_t *pRoofline = pRow->pRoofline;
+    bool isFirstPhase = true;
+
+    if( FORMAT_JSON == pConfig->format )
+    {
+        fprintf( pFile, "%s    { \"points\": %ld, \"backend\": \"%s\", \"precision\": \"%s\", \"threads\": %d,\n"
+                        "      \"status\": %d, \"bandwidth_gb_per_s\": %.3f, \"peak_gflop_per_s\": %.3f, \"phases\": [",
+                 isFirst ? "" : ",\n", pRow->pointCount, polyfit_backend_name( pRow->backend ),
+                 precisionNames[ pRow->precision ], pRow->threadCount, pRow->status, pRoofline->bandwidth / 1e9, pRoofline->peakFlops / 1e9 );
+    }
+
+    for( int p = 0; p < POLYFIT_PHASE_COUNT; p++ )
+    {
+        double seconds = pRow->phaseSeconds[p];
+        long long byteCount = pRow->phaseBytes[p];
+        long long flopCount = pRow->phaseFlops[p];
+
+        if( (0 != pRow->status) || ((0 == byteCount) && (0 == flopCount)) )
+        {
+            continue;
+        }
+
+        double intensity = (byteCount > 0) ? (double) flopCount / byteCount : 0.0;
+        double gbPerSecond = (seconds > 0.0) ? byteCount / seconds / 1e9 : 0.0;
+        double gflopPerSecond = (seconds > 0.0) ? flopCount / seconds / 1e9 : 0.0;
+        double roof = (flopCount > 0) ? polyfit_roofline_bound( pRoofline, intensity ) / 1e9 : 0.0;
+        double percent = polyfit_roofline_percent( pRoofline, seconds, byteCount, flopCount );
+
+        if( FORMAT_CSV == pConfig->format )
+        {
+            fprintf( pFile, "%ld,%d,%s,%s,%d,%d,%s,%.9f,%lld,%lld,%.4f,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f\n",
+                     pRow->pointCount, pConfig->coefficientCount, polyfit_backend_name( pRow->backend ),
+                     precisionNames[ pRow->precision ], pRow->threadCount, pRow->status, polyfit_phase_name( (polyfit_phase_t) p ),
+                     seconds, byteCount, flopCount, intensity, gbPerSecond, gflopPerSecond,
+                     pRoofline->bandwidth / 1e9, pRoofline->peakFlops / 1e9, roof, percent );
+        }
+        else
+        {
+            fprintf( pFile, "%s\n        { \"phase\": \"%s\", \"median_s\": %.9f, \"bytes\": %lld, \"flops\": %lld,"
+                            " \"intensity\": %.4f,\n          \"gb_per_s\": %.3f, \"gflop_per_s\": %.3f,"
+                            " \"roof_gflop_per_s\": %.3f, \"percent_of_roof\": %.1f }",
+                     isFirstPhase ? "" : ",", polyfit_phase_name( (polyfit_phase_t) p ), seconds, byteCount, flopCount,
+                     intensity, gbPerSecond, gflopPerSecond, roof, percent );
+        }
+        isFirstPhase = false;
+    }
+
+    if( FORMAT_JSON == pConfig->format )
+    {
+        fprintf( pFile, "%s] }", isFirstPhase ? "" : "\n      " );
+    }
+    else if( 0 != pRow->status )
+    {
+        fprintf( pFile, "%ld,%d,%s,%s,%d,%d,,,,,,,,,,,\n", pRow->pointCount, pConfig->coefficientCount,
+                 polyfit_backend_name( pRow->backend ), precisionNames[ pRow->precision ], pRow->threadCount,
+                 pRow->status );
+    }
+}
+
+//--------------------------------------------------------
+// writeFooter()
+// Closes the JSON document.
+//--------------------------------------------------------
+static void writeFooter( FILE *pFile, const BenchConfig *pConfig )
+{
+    if( FORMAT_JSON == pConfig->format )
+    {
+        fprintf( pFile, "\n  ]\n}\n" );
+    }
+}
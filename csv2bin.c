@@ -0,0 +1,71 @@
+// Name: csv2bin.c
+// Description: Converts an "x,y" CSV file to a binary dataset file
+//              (see polyfit_bin.h), so fits can skip parsing.
+//
+// Usage:   csv2bin input.csv [output.pfb]
+//
+// The output name defaults to the input name with its extension
+// replaced by ".pfb".
+
+#include <stdio.h>
+#include <string.h>
+
+#include "polyfit_bin.h"
+#include "polyfit_csv.h"
+
+// Longest output file name built from the input name.
+#define OUTPUT_NAME_SIZE    (1024)
+
+//--------------------------------------------------------
+// main()
+// Loads the CSV file and writes the dataset file.
+//--------------------------------------------------------
+int main( int argc, char *argv[] )
+{
+    char outputName[ OUTPUT_NAME_SIZE ];
+
+    if( (argc < 2) || (argc > 3) )
+    {
+        fprintf( stderr, "Usage: %s input.csv [output%s]\n", argv[0], POLYFIT_BIN_EXTENSION );
+        return 1;
+    }
+
+    if( 3 == argc )
+    {
+        snprintf( outputName, sizeof( outputName ), "%s", argv[2] );
+    }
+    else
+    {
+        const char *pDot = strrchr( argv[1], '.' );
+        const char *pSlash = strrchr( argv[1], '/' );
+        int stemLength = ((NULL != pDot) && ((NULL == pSlash) || (pDot > pSlash))) ?
+                         (int) (pDot - argv[1]) : (int) strlen( argv[1] );
+        snprintf( outputName, sizeof( outputName ), "%.*s%s", stemLength, argv[1], POLYFIT_BIN_EXTENSION );
+    }
+
+    polyfit_csv_t csv;
+    int rVal = polyfit_csv_load( argv[1], &csv );
+    if( 0 != rVal )
+    {
+        fprintf( stderr, "Unable to load %s (error = %d)\n", argv[1], rVal );
+        return 1;
+    }
+    if( csv.malformedCount > 0 )
+    {
+        fprintf( stderr, "%s: skipped %ld malformed line(s)\n", argv[1], csv.malformedCount );
+    }
+
+    long pointCount = csv.pointCount;
+    rVal = polyfit_bin_write( outputName, csv.pointCount, csv.xValues, csv.yValues,
+                              ('\0' == csv.xName[0]) ? NULL : csv.xName,
+                              ('\0' == csv.yName[0]) ? NULL : csv.yName );
+    polyfit_csv_free( &csv );
+    if( 0 != rVal )
+    {
+        fprintf( stderr, "Unable to write %s (error = %d)\n", outputName, rVal );
+        return 1;
+    }
+
+    printf( "Wrote %ld points to %s\n", pointCount, outputName );
+    return 0;
+}
@@ -26,23 +26,25 @@
 // SOFTWARE.
 //------------------------------------------------------------------------------------
 
-#include <math.h>       // pow()
 #include <stdbool.h>    // bool
 #include <stdio.h>      // printf()
 #include <stdlib.h>     // calloc()
 #include <string.h>     // strlen()
 
 #include "openMP_polyfit.h"
+#include "polyfit_ex.h"
+#include "polyfit_perf.h"
+#include "polyfit_sums.h"
+#include "polyfit_simd.h"
+#include "polyfit_solve.h"
+#include "polyfit_tune.h"
+#include "polyfit_workspace.h"
 #include <omp.h>
 
 #include <math.h>
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
-//timing
-#include <time.h>
 
-//block initialiation
-int blockSize = 32;
 // Define SHOW_MATRIX to display intermediate matrix values:
 // #define SHOW_MATRIX 1
 
@@ -54,6 +56,10 @@ typedef struct matrix_s
 	double *pContents;
 } matrix_t;
 
+// MACRO to round a per-thread partial result up to whole
+// 64-byte cache lines, so threads don't share lines.
+#define PARTIAL_SIZE( count )  ((((count) + 7) / 8) * 8)
+
 // MACRO to access a value with a matrix.
 #define MATRIX_VALUE_PTR( pA, row, col )  (&(((pA)->pContents)[ (row * (pA)->cols) + col]))
 
@@ -72,13 +78,18 @@ typedef struct matrix_s
 // Private Function Prototypes
 //------------------------------------------------
 
-static matrix_t *   createMatrix( int rows, int cols );
-static void         destroyMatrix( matrix_t *pMat );
+static int          fitMatrices( polyfit_workspace_t *pWorkspace, int pointCount, double *xValues, double *yValues,
+                                 int coefficientCount, double *coefficientResults, polyfit_stats_t *pStats );
+static matrix_t *   createMatrix( polyfit_workspace_t *pWorkspace, int rows, int cols );
+static double *     createPartials( polyfit_workspace_t *pWorkspace, int partialSize );
 #ifdef SHOW_MATRIX
 static void         reallyShowMatrix( matrix_t *pMat );
 #endif  // SHOW_MATRIX
-static matrix_t *   createTranspose( matrix_t *pMat );
-static matrix_t *   createProduct( matrix_t *pLeft, matrix_t *pRight );
+static matrix_t *   createTranspose( polyfit_workspace_t *pWorkspace, matrix_t *pMat );
+static matrix_t *   createProduct( polyfit_workspace_t *pWorkspace, matrix_t *pLeft, matrix_t *pRight );
+static matrix_t *   createHankelProduct( polyfit_workspace_t *pWorkspace, matrix_t *pMatAT );
+static void         setHankelDiagonal( matrix_t *pMat, int s, double value );
+static void         treeMergePartials( double *pPartials, int partialSize, int t, int nt );
 //void blockPow(matrix_t *pMatA, double *xValues, int pointCount, int degree, int coefficientCount);
 
 
@@ -109,18 +120,28 @@ static matrix_t *   createProduct( matrix_t *pLeft, matrix_t *pRight );
 //          -1 if passed a NULL pointer,
 //          -2 if (pointCount < coefficientCount),
 //          -3 if unable to allocate memory,
-//          -4 if unable to solve equations.
+//          -4 if the equations are numerically singular.
 //--------------------------------------------------------
 //int polyfit( int pointCount, point_t pointArray[],  int coeffCount, double coeffArray[] )
 int openmp_polyfit( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults )
 {
-    struct timespec s_fill, e_fill, s_mult, e_mult, s_trans, e_trans, s_gauss, e_gauss;
-    double elapsed_time;
-    int rVal = 0;
-    int degree = coefficientCount - 1;
+    polyfit_options_t options;
+
+    polyfit_options_defaults( &options );
+    options.backend = POLYFIT_BACKEND_OPENMP;
+    return polyfit_ex( pointCount, xValues, yValues, coefficientCount, coefficientResults, &options, NULL );
+}
 
+//--------------------------------------------------------
+// openmp_polyfit_ws()
+// openmp_polyfit() with its matrices taken from a
+// workspace, and given back before it returns.
+//--------------------------------------------------------
+int openmp_polyfit_ws( polyfit_workspace_t *pWorkspace, int pointCount, double *xValues, double *yValues,
+                       int coefficientCount, double *coefficientResults, polyfit_stats_t *pStats )
+{
     // Check that the input pointers aren't null.
-    if( (NULL == xValues) || (NULL == yValues) || (NULL == coefficientResults) )
+    if( (NULL == pWorkspace) || (NULL == xValues) || (NULL == yValues) || (NULL == coefficientResults) )
     {
         return -1;
     }
@@ -130,157 +151,99 @@ int openmp_polyfit( int pointCount, double *xValues, double *yValues, int coeffi
         return -2;
     }
 
-    // printf( "pointCount = %d:", pointCount );
-
-    // for( i = 0; i < pointCount; i++ )
-    // {
-    //     printf( " ( %f, %f )", xValues[i], yValues[i] );
-    // }
-    // printf( "\n");
-
-    // printf( "coefficientCount = %d\n", coefficientCount );
+    size_t mark = polyfit_workspace_mark( pWorkspace );
+    int rVal = fitMatrices( pWorkspace, pointCount, xValues, yValues, coefficientCount, coefficientResults, pStats );
+    polyfit_workspace_release( pWorkspace, mark );
+    return rVal;
+}
 
-    // Make the A matrix:
-    
-    matrix_t *pMatA = createMatrix( pointCount, coefficientCount );
-    if( NULL == pMatA)
-    {
-        return -3;
-    }
-    
+//--------------------------------------------------------
+// openmp_polyfit_stream()
+// Single-pass fit: each thread folds a contiguous slice
+// of the points into its own sums, which are then merged.
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -2 if (pointCount < coefficientCount) or
+//             coefficientCount is out of range,
+//          -3 if unable to allocate memory,
+//          -4 if the equations are numerically singular.
+//--------------------------------------------------------
+int openmp_polyfit_stream( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults )
+{
+    polyfit_sums_t sums;
 
-    clock_gettime(CLOCK_MONOTONIC, &s_fill);
-    #pragma omp parallel for 
-    for( int r = 0; r < pointCount; r++)
+    if( (NULL == xValues) || (NULL == yValues) || (NULL == coefficientResults) )
     {
-        for( int c = 0; c < coefficientCount; c++)
-        {
-            *(MATRIX_VALUE_PTR(pMatA, r, c)) = pow((xValues[r]), (double) (degree -c));
-        }
+        return -1;
     }
-    clock_gettime(CLOCK_MONOTONIC, &e_fill);
-    elapsed_time = (e_fill.tv_sec - s_fill.tv_sec) +
-                       (e_fill.tv_nsec - s_fill.tv_nsec) / 1e9;
-    printf("Execution time of fill (A): %f seconds\n", elapsed_time);
-	
-    //showMatrix( pMatA );
-
-    // Make the b matrix
-    matrix_t *pMatB = createMatrix( pointCount, 1);
-    if( NULL == pMatB )
+    if( pointCount < coefficientCount )
     {
-        return -3;
+        return -2;
     }
-
-    #pragma omp parallel for 
-    for( int r = 0; r < pointCount; r++)
+    if( 0 != polyfit_sums_init( &sums, coefficientCount ) )
     {
-        *(MATRIX_VALUE_PTR(pMatB, r, 0)) = yValues[r];
+        return -2;
     }
 
-    clock_gettime(CLOCK_MONOTONIC, &s_trans);
-    // Make the transpose of matrix A
-    matrix_t * pMatAT = createTranspose( pMatA );
-    if( NULL == pMatAT )
+    int maxThreads = omp_get_max_threads();
+    polyfit_sums_t *pPartials = (polyfit_sums_t *) calloc( maxThreads, sizeof( polyfit_sums_t ) );
+    if( NULL == pPartials )
     {
         return -3;
     }
-    clock_gettime(CLOCK_MONOTONIC, &e_trans);
-    elapsed_time = (e_trans.tv_sec - s_trans.tv_sec) +
-                       (e_trans.tv_nsec - s_trans.tv_nsec) / 1e9;
-    printf("Execution time of trans (A): %f seconds\n", elapsed_time);
-	
-    //showMatrix( pMatAT );
 
-    clock_gettime(CLOCK_MONOTONIC, &s_mult);
-    // Make the product of matrices AT and A:
-    matrix_t *pMatATA = createProduct( pMatAT, pMatA );
-    if( NULL == pMatATA )
+    int numThreads = 1;
+    #pragma omp parallel
     {
-        return -3;
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        long start = ((long) pointCount * t) / nt;
+        long end = ((long) pointCount * (t + 1)) / nt;
+
+        #pragma omp single
+        numThreads = nt;
+
+        polyfit_sums_init( &pPartials[t], coefficientCount );
+        polyfit_sums_add( &pPartials[t], (int) (end - start), &xValues[start], &yValues[start] );
     }
-    clock_gettime(CLOCK_MONOTONIC, &e_mult);
-    elapsed_time = (e_mult.tv_sec - s_mult.tv_sec) +
-                       (e_mult.tv_nsec - s_mult.tv_nsec) / 1e9;
-    printf("Execution time of mult (A): %f seconds\n", elapsed_time);
-    //showMatrix( pMatATA );
 
-    // Make the product of matrices AT and b:
-    matrix_t *pMatATB = createProduct( pMatAT, pMatB );
-    if( NULL == pMatATB )
+    for( int t = 0; t < numThreads; t++ )
     {
-        return -3;
+        polyfit_sums_merge( &sums, &pPartials[t] );
     }
+    free( pPartials );
 
-    //showMatrix( pMatATB );
-
-    clock_gettime(CLOCK_MONOTONIC, &s_gauss);
-    // Now we need to solve the system of linear equations,
-    // (AT)Ax = (AT)b for "x", the coefficients of the polynomial.
-
-    for( int c = 0; c < pMatATA->cols; c++ )
-    {
-        int pr = c;     // pr is the pivot row.
-        double prVal = *MATRIX_VALUE_PTR(pMatATA, pr, c);
-        // If it's zero, we can't solve the equations.
-        if( 0.0 == prVal )
-        {
-            // printf( "Unable to solve equations, pr = %d, c = %d.\n", pr, c );
-            //showMatrix( pMatATA );
-            rVal = -4;
-            break;
-        }
-        for( int r = 0; r < pMatATA->rows; r++)
-        {
-            if( r != pr )
-            {
-                double targetRowVal = *MATRIX_VALUE_PTR(pMatATA, r, c);
-                double factor = targetRowVal / prVal;
-                for( int c2 = 0; c2 < pMatATA->cols; c2++ )
-                {
-                    *MATRIX_VALUE_PTR(pMatATA, r, c2) -=  *MATRIX_VALUE_PTR(pMatATA, pr, c2) * factor; 
-                    // printf( "c = %d, pr = %d, r = %d, c2=%d, targetRowVal = %f, prVal = %f, factor = %f.\n",
-                    //         c, pr, r, c2, targetRowVal, prVal, factor );
+    return polyfit_sums_solve( &sums, coefficientResults );
+}
 
-                    // showMatrix( pMatATA );
-                   
-                }
-                *MATRIX_VALUE_PTR(pMatATB, r, 0) -=  *MATRIX_VALUE_PTR(pMatATB, pr, 0) * factor;
+//--------------------------------------------------------
+// openmp_polyfit_thread_ids()
+// Has every thread of a parallel region report its own
+// id.  The runtime keeps the same threads for teams of
+// the same size, so later regions run on them too.
+//--------------------------------------------------------
+int openmp_polyfit_thread_ids( int *threadIds, int maxThreads )
+{
+    int idCount = 0;
 
-                //showMatrix( pMatATB );
-            }
-        }
-    }
-    for( int c = 0; c < pMatATA->cols; c++ )
+    if( NULL == threadIds )
     {
-        int pr = c;
-        // now, pr is the pivot row.
-        double prVal = *MATRIX_VALUE_PTR(pMatATA, pr, c);
-        *MATRIX_VALUE_PTR(pMatATA, pr, c) /= prVal;
-        *MATRIX_VALUE_PTR(pMatATB, pr, 0) /= prVal;
+        return -1;
     }
-    clock_gettime(CLOCK_MONOTONIC, &e_gauss);
-    elapsed_time = (e_gauss.tv_sec - s_gauss.tv_sec) +
-                       (e_gauss.tv_nsec - s_gauss.tv_nsec) / 1e9;
-    printf("Execution time of gauss (A): %f seconds\n", elapsed_time);
-	
-    //showMatrix( pMatATA );
 
-    //showMatrix( pMatATB );
-
-    for( int i = 0; i < coefficientCount; i++)
+    #pragma omp parallel
     {
-        coefficientResults[i] = *MATRIX_VALUE_PTR(pMatATB, i, 0);
-    }
-
-    
-    destroyMatrix( pMatATB );
-    destroyMatrix( pMatATA );
-    destroyMatrix( pMatAT );
+        int thread = omp_get_thread_num();
+        if( thread < maxThreads )
+        {
+            threadIds[ thread ] = polyfit_perf_thread_id();
+        }
 
-    destroyMatrix( pMatA );
-    destroyMatrix( pMatB );
-    return rVal;
+        #pragma omp single
+        idCount = (omp_get_num_threads() < maxThreads) ? omp_get_num_threads() : maxThreads;
+    }
+    return (idCount > 0) ? idCount : 0;
 }
 
 //--------------------------------------------------------
@@ -353,22 +316,131 @@ static void reallyShowMatrix( matrix_t *pMat )
 }
 #endif  // SHOW_MATRIX
 
+//--------------------------------------------------------
+// fitMatrices()
+// The body of openmp_polyfit_ws(): fills A and b, forms
+// the products and solves.  Nothing it takes from the
+// workspace needs to be given back individually.
+//--------------------------------------------------------
+static int fitMatrices( polyfit_workspace_t *pWorkspace, int pointCount, double *xValues, double *yValues,
+                        int coefficientCount, double *coefficientResults, polyfit_stats_t *pStats )
+{
+    long long pointBytes = (long long) pointCount * sizeof( double );
+    int rVal = 0;
+
+    // printf( "pointCount = %d:", pointCount );
+
+    // for( i = 0; i < pointCount; i++ )
+    // {
+    //     printf( " ( %f, %f )", xValues[i], yValues[i] );
+    // }
+    // printf( "\n");
+
+    // printf( "coefficientCount = %d\n", coefficientCount );
+
+    // Make the A matrix:
+    
+    matrix_t *pMatA = createMatrix( pWorkspace, pointCount, coefficientCount );
+    if( NULL == pMatA)
+    {
+        return -3;
+    }
+    
+
+    POLYFIT_STATS_BEGIN( pStats, POLYFIT_PHASE_FILL );
+    // Column c holds x^(degree - c); built by multiplication, not pow().
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        int rStart = (int) (((long) pointCount * t) / nt);
+        int rEnd = (int) (((long) pointCount * (t + 1)) / nt);
+        polyfit_simd()->fillPowers( rEnd - rStart, &xValues[rStart], coefficientCount, MATRIX_VALUE_PTR(pMatA, rStart, 0) );
+    }
+	
+    //showMatrix( pMatA );
+
+    // Make the b matrix
+    matrix_t *pMatB = createMatrix( pWorkspace, pointCount, 1);
+    if( NULL == pMatB )
+    {
+        return -3;
+    }
+
+    #pragma omp parallel for 
+    for( int r = 0; r < pointCount; r++)
+    {
+        *(MATRIX_VALUE_PTR(pMatB, r, 0)) = yValues[r];
+    }
+    // Reads x and y, writes A and b; k-1 multiplies a point.
+    POLYFIT_STATS_END( pStats, POLYFIT_PHASE_FILL, pointBytes * (coefficientCount + 3),
+                       (long long) pointCount * (coefficientCount - 1) );
+
+    POLYFIT_STATS_BEGIN( pStats, POLYFIT_PHASE_TRANSPOSE );
+    // Make the transpose of matrix A
+    matrix_t * pMatAT = createTranspose( pWorkspace, pMatA );
+    if( NULL == pMatAT )
+    {
+        return -3;
+    }
+    POLYFIT_STATS_END( pStats, POLYFIT_PHASE_TRANSPOSE, 2 * pointBytes * coefficientCount, 0 );
+	
+    //showMatrix( pMatAT );
+
+    POLYFIT_STATS_BEGIN( pStats, POLYFIT_PHASE_PRODUCT );
+    // Make the product of matrices AT and A:
+    matrix_t *pMatATA = createHankelProduct( pWorkspace, pMatAT );
+    if( NULL == pMatATA )
+    {
+        return -3;
+    }
+    //showMatrix( pMatATA );
+
+    // Make the product of matrices AT and b:
+    matrix_t *pMatATB = createProduct( pWorkspace, pMatAT, pMatB );
+    if( NULL == pMatATB )
+    {
+        return -3;
+    }
+
+    // 2k-1 dot products for (AT)A and k for (AT)b, each
+    // reading two rows of length pointCount.
+    POLYFIT_STATS_END( pStats, POLYFIT_PHASE_PRODUCT, 2 * pointBytes * (3 * coefficientCount - 1),
+                       2 * (long long) pointCount * (3 * coefficientCount - 1) );
+
+    //showMatrix( pMatATB );
+
+    POLYFIT_STATS_BEGIN( pStats, POLYFIT_PHASE_SOLVE );
+    // Now we need to solve the system of linear equations,
+    // (AT)Ax = (AT)b for "x", the coefficients of the polynomial.
+    // (AT)A is symmetric positive definite, so Cholesky is used
+    // and only its upper triangle is read.
+    rVal = polyfit_solve_normal( coefficientCount, pMatATA->pContents, pMatATB->pContents, coefficientResults );
+    // Cholesky, then the two triangular solves.
+    long long solveFlops = (long long) coefficientCount * coefficientCount * (coefficientCount + 6) / 3;
+    POLYFIT_STATS_END( pStats, POLYFIT_PHASE_SOLVE, (long long) coefficientCount * (coefficientCount + 2) * sizeof( double ),
+                       solveFlops );
+
+    return rVal;
+}
+
+
 //--------------------------------------------------------
 // createTranspose()
 // Returns the transpose of a matrix, or NULL.
-//
-// The caller must free both the allocated matrix
-// and its contents array.
 //--------------------------------------------------------
-static matrix_t * createTranspose( matrix_t *pMat )
+static matrix_t * createTranspose( polyfit_workspace_t *pWorkspace, matrix_t *pMat )
 {
-    matrix_t *rVal = (matrix_t *) calloc(1, sizeof(matrix_t));
-    rVal->pContents = (double *) calloc( pMat->rows * pMat->cols, sizeof( double ));
-    rVal->cols = pMat->rows;
-    rVal->rows = pMat->cols;
+    matrix_t *rVal = createMatrix( pWorkspace, pMat->cols, pMat->rows );
+    if( NULL == rVal )
+    {
+        return NULL;
+    }
     int r, c;
     int num_threads;
 
+    // Measured per machine by the autotune tool.
+    int blockSize = polyfit_tune()->blockSize;
 	
     int numBlocksRow = (pMat->rows + blockSize - 1) / blockSize;
     int numBlocksCol = (pMat->cols + blockSize - 1) / blockSize;
@@ -394,10 +466,11 @@ static matrix_t * createTranspose( matrix_t *pMat )
 // createProduct()
 // Returns the product of two matrices, or NULL.
 //
-// The caller must free both the allocated product matrix
-// and its contents array.
+// The inner dimension (the points, for (AT)A and (AT)b) is
+// split among the threads, so every thread does an equal
+// share of the work however small the product matrix is.
 //--------------------------------------------------------
-static matrix_t * createProduct( matrix_t *pLeft, matrix_t *pRight )
+static matrix_t * createProduct( polyfit_workspace_t *pWorkspace, matrix_t *pLeft, matrix_t *pRight )
 {
     matrix_t *rVal = NULL;
     if( (NULL == pLeft) || (NULL == pRight) || (pLeft->cols != pRight->rows) )
@@ -407,31 +480,52 @@ static matrix_t * createProduct( matrix_t *pLeft, matrix_t *pRight )
     else
     {
         // Allocate the product matrix.
-        rVal = (matrix_t *) calloc(1, sizeof(matrix_t));
-        rVal->rows = pLeft->rows;
-        rVal->cols = pRight->cols;
-        rVal->pContents = (double *) calloc( rVal->rows * rVal->cols, sizeof( double ));
-
+        rVal = createMatrix( pWorkspace, pLeft->rows, pRight->cols );
+        if( NULL == rVal )
+        {
+            return NULL;
+        }
 
-	int i, j, k;
-        double sum;
-	    
-        // Initialize the product matrix contents:
-        // product[i,j] = sum{k = 0 .. (pLeft->cols - 1)} (pLeft[i,k] * pRight[ k, j])
-        #pragma omp parallel for collapse(2) private(i, j, k) reduction(+:sum) 
+        int resultSize = rVal->rows * rVal->cols;
+        int partialSize = PARTIAL_SIZE( resultSize );
+        double *pPartials = createPartials( pWorkspace, partialSize );
+        if( NULL == pPartials )
+        {
+            return NULL;
+        }
 
-        for( i = 0; i < rVal->rows; i++)
+        #pragma omp parallel
         {
-            for( j = 0; j < rVal->cols; j++)
-            { 
-		sum = 0.0;
-                for( k = 0; k < pLeft->cols; k++) 
+            int t = omp_get_thread_num();
+            int nt = omp_get_num_threads();
+            int kStart = (int) (((long) pLeft->cols * t) / nt);
+            int kEnd = (int) (((long) pLeft->cols * (t + 1)) / nt);
+            double *pPartial = &pPartials[ t * partialSize ];
+
+            // product[i,j] = sum{k} (pLeft[i,k] * pRight[ k, j]), over this thread's k.
+            for( int i = 0; i < rVal->rows; i++)
+            {
+                if( 1 == pRight->cols )
+                {
+                    // A column vector is contiguous: use the vector dot product.
+                    pPartial[i] = polyfit_simd()->dot( kEnd - kStart, MATRIX_VALUE_PTR(pLeft, i, kStart), &pRight->pContents[kStart] );
+                    continue;
+                }
+                for( int j = 0; j < rVal->cols; j++)
                 {
-                    sum += (*MATRIX_VALUE_PTR(pLeft, i, k)) * (*MATRIX_VALUE_PTR(pRight, k, j));
+                    double sum = 0.0;
+                    for( int k = kStart; k < kEnd; k++)
+                    {
+                        sum += (*MATRIX_VALUE_PTR(pLeft, i, k)) * (*MATRIX_VALUE_PTR(pRight, k, j));
+                    }
+                    pPartial[ (i * rVal->cols) + j ] = sum;
                 }
-		*MATRIX_VALUE_PTR(rVal, i, j) = sum;
             }
+
+            treeMergePartials( pPartials, partialSize, t, nt );
         }
+
+        memcpy( rVal->pContents, pPartials, resultSize * sizeof( double ));
     }    
        
     return rVal;
@@ -451,36 +545,115 @@ void blockPow(matrix_t *pMatA, double *xValues, int pointCount, int degree, int
 }
 */
 //--------------------------------------------------------
-// destroyMatrix()
-// Frees both the allocated matrix and its contents array.
+// createHankelProduct()
+// Returns (AT)A for a Vandermonde matrix A, given AT, or NULL.
+//
+// (AT)A[i,j] is the sum of x^(2*degree - i - j), so it only
+// depends on i + j.  Just the 2k-1 distinct entries are
+// computed, each as the dot product of two rows of AT, and
+// then copied along their anti-diagonals.
+//--------------------------------------------------------
+static matrix_t * createHankelProduct( polyfit_workspace_t *pWorkspace, matrix_t *pMatAT )
+{
+    int k = pMatAT->rows;
+    int sumCount = 2 * k - 1;
+    matrix_t *rVal = createMatrix( pWorkspace, k, k );
+    if( NULL == rVal )
+    {
+        return NULL;
+    }
+    memset( rVal->pContents, 0, k * k * sizeof( double ) );
+
+    int partialSize = PARTIAL_SIZE( sumCount );
+    double *pPartials = createPartials( pWorkspace, partialSize );
+    if( NULL == pPartials )
+    {
+        return NULL;
+    }
+
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        int nStart = (int) (((long) pMatAT->cols * t) / nt);
+        int nEnd = (int) (((long) pMatAT->cols * (t + 1)) / nt);
+        double *pPartial = &pPartials[ t * partialSize ];
+
+        for( int s = 0; s < sumCount; s++ )
+        {
+            // Any rows i, j with i + j == s give the same sum.
+            int i = s / 2;
+            int j = s - i;
+            double *pRowI = MATRIX_VALUE_PTR(pMatAT, i, 0);
+            double *pRowJ = MATRIX_VALUE_PTR(pMatAT, j, 0);
+            pPartial[s] = polyfit_simd()->dot( nEnd - nStart, &pRowI[nStart], &pRowJ[nStart] );
+        }
+
+        treeMergePartials( pPartials, partialSize, t, nt );
+    }
+
+    for( int s = 0; s < sumCount; s++ )
+    {
+        setHankelDiagonal( rVal, s, pPartials[s] );
+    }
+    return rVal;
+}
+
+//--------------------------------------------------------
+// treeMergePartials()
+// Called by every thread of a parallel region once its
+// partial result is complete.  Partials are added pairwise
+// in log2(threads) rounds, leaving the total in partial 0.
 //--------------------------------------------------------
-static void destroyMatrix( matrix_t *pMat )
+static void treeMergePartials( double *pPartials, int partialSize, int t, int nt )
 {
-    if(NULL != pMat)
+    for( int stride = 1; stride < nt; stride *= 2 )
     {
-        if(NULL != pMat->pContents)
+        #pragma omp barrier
+        if( (0 == (t % (2 * stride))) && (t + stride < nt) )
         {
-            free(pMat->pContents);
+            double *pDest = &pPartials[ t * partialSize ];
+            double *pSrc = &pPartials[ (t + stride) * partialSize ];
+            for( int i = 0; i < partialSize; i++ )
+            {
+                pDest[i] += pSrc[i];
+            }
         }
-        free( pMat );
+    }
+}
+
+//--------------------------------------------------------
+// setHankelDiagonal()
+// Stores value in every element (r, c) of a square matrix
+// with r + c == s and r <= c.  The solver only reads the
+// upper triangle, so the lower one is left unformed.
+//--------------------------------------------------------
+static void setHankelDiagonal( matrix_t *pMat, int s, double value )
+{
+    int k = pMat->rows;
+    int rFirst = (s < k) ? 0 : (s - k + 1);
+    int rLast = s / 2;
+    for( int r = rFirst; r <= rLast; r++ )
+    {
+        *MATRIX_VALUE_PTR(pMat, r, (s - r)) = value;
     }
 }
 
 //--------------------------------------------------------
 // createMatrix()
-// Allocates the matrix and clears its contents array.
+// Takes the matrix and its contents array from the
+// workspace.  The contents are not cleared.
 //--------------------------------------------------------
-static matrix_t *createMatrix( int rows, int cols )
+static matrix_t *createMatrix( polyfit_workspace_t *pWorkspace, int rows, int cols )
 {
-    matrix_t *rVal = (matrix_t *) calloc(1, sizeof(matrix_t));
+    matrix_t *rVal = (matrix_t *) polyfit_workspace_alloc( pWorkspace, sizeof(matrix_t) );
     if(NULL != rVal)
     {
         rVal->rows = rows;
         rVal->cols = cols;
-        rVal->pContents = (double *) calloc( rows * cols, sizeof( double ));
+        rVal->pContents = (double *) polyfit_workspace_alloc( pWorkspace, (size_t) rows * cols * sizeof( double ));
         if(NULL == rVal->pContents)
         {
-            free( rVal );
             rVal = NULL;
         }
     }
@@ -488,4 +661,18 @@ static matrix_t *createMatrix( int rows, int cols )
     return rVal;
 }
 
- 
+//--------------------------------------------------------
+// createPartials()
+// Takes one cleared partial result of partialSize doubles
+// per thread from the workspace, or returns NULL.
+//--------------------------------------------------------
+static double *createPartials( polyfit_workspace_t *pWorkspace, int partialSize )
+{
+    size_t byteCount = (size_t) omp_get_max_threads() * partialSize * sizeof( double );
+    double *pPartials = (double *) polyfit_workspace_alloc( pWorkspace, byteCount );
+    if( NULL != pPartials )
+    {
+        memset( pPartials, 0, byteCount );
+    }
+    return pPartials;
+}
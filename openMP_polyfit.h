@@ -1,6 +1,9 @@
 #ifndef OPENMP_POLYFIT_H
 #define OPENMP_POLYFIT_H
 
+#include "polyfit_stats.h"
+#include "polyfit_workspace.h"
+
 
 //------------------------------------------------
 // Function Prototypes
@@ -9,12 +12,50 @@
 //--------------------------------------------------------
 // polyfit()
 // Computes polynomial coefficients that best fit a set
-// of input points.
+// of input points.  Runs polyfit_ex() on
+// POLYFIT_BACKEND_OPENMP.
 //
 // Returns 0 if success.
 //--------------------------------------------------------
 int openmp_polyfit( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults );
 
+//--------------------------------------------------------
+// openmp_polyfit_ws()
+// Same as openmp_polyfit(), but takes its scratch matrices
+// from pWorkspace instead of the heap.  A workspace from
+// polyfit_workspace_create( maxPointCount,
+// maxCoefficientCount, omp_get_max_threads() ) covers any
+// fit up to that size.
+//
+// pStats, if not NULL, is filled with the time and bytes
+// of each phase.
+//
+// Returns 0 if success, or the polyfit() error codes; -3
+// means the workspace is too small.
+//--------------------------------------------------------
+int openmp_polyfit_ws( polyfit_workspace_t *pWorkspace, int pointCount, double *xValues, double *yValues,
+                       int coefficientCount, double *coefficientResults, polyfit_stats_t *pStats );
+
+//--------------------------------------------------------
+// openmp_polyfit_stream()
+// Single-pass variant of openmp_polyfit() that accumulates
+// (AT)A and (AT)b directly instead of building A.
+//
+// Returns 0 if success.
+//--------------------------------------------------------
+int openmp_polyfit_stream( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults );
+
+//--------------------------------------------------------
+// openmp_polyfit_thread_ids()
+// Fills threadIds with the kernel thread id of each
+// thread of the calling thread's OpenMP team, in thread
+// number order, for polyfit_perf_attach().
+//
+// Returns the number of ids written, at most maxThreads,
+// or -1 if passed a NULL pointer.
+//--------------------------------------------------------
+int openmp_polyfit_thread_ids( int *threadIds, int maxThreads );
+
 //--------------------------------------------------------
 // polyToString()
 // Produces a string representation of a polynomial from
@@ -26,17 +26,18 @@
 // SOFTWARE.
 //------------------------------------------------------------------------------------
 
-#include <math.h>       // pow()
 #include <stdbool.h>    // bool
 #include <stdio.h>      // printf()
-#include <stdlib.h>     // calloc()
+#include <stdlib.h>     // NULL
 #include <string.h>     // strlen()
 
 #include "polyfit.h"
+#include "polyfit_ex.h"
+#include "polyfit_simd.h"
+#include "polyfit_solve.h"
+#include "polyfit_workspace.h"
 #include <omp.h>
 
-#include <time.h>
-
 // Define SHOW_MATRIX to display intermediate matrix values:
 // #define SHOW_MATRIX 1
 
@@ -66,13 +67,16 @@ typedef struct matrix_s
 // Private Function Prototypes
 //------------------------------------------------
 
-static matrix_t *   createMatrix( int rows, int cols );
-static void         destroyMatrix( matrix_t *pMat );
+static int          fitMatrices( polyfit_workspace_t *pWorkspace, int pointCount, double *xValues, double *yValues,
+                                 int coefficientCount, double *coefficientResults, polyfit_stats_t *pStats );
+static matrix_t *   createMatrix( polyfit_workspace_t *pWorkspace, int rows, int cols );
 #ifdef SHOW_MATRIX
 static void         reallyShowMatrix( matrix_t *pMat );
 #endif  // SHOW_MATRIX
-static matrix_t *   createTranspose( matrix_t *pMat );
-static matrix_t *   createProduct( matrix_t *pLeft, matrix_t *pRight );
+static matrix_t *   createTranspose( polyfit_workspace_t *pWorkspace, matrix_t *pMat );
+static matrix_t *   createProduct( polyfit_workspace_t *pWorkspace, matrix_t *pLeft, matrix_t *pRight );
+static matrix_t *   createHankelProduct( polyfit_workspace_t *pWorkspace, matrix_t *pMatAT );
+static void         setHankelDiagonal( matrix_t *pMat, int s, double value );
 
 
 //=========================================================
@@ -102,18 +106,28 @@ static matrix_t *   createProduct( matrix_t *pLeft, matrix_t *pRight );
 //          -1 if passed a NULL pointer,
 //          -2 if (pointCount < coefficientCount),
 //          -3 if unable to allocate memory,
-//          -4 if unable to solve equations.
+//          -4 if the equations are numerically singular.
 //--------------------------------------------------------
 //int polyfit( int pointCount, point_t pointArray[],  int coeffCount, double coeffArray[] )
 int polyfit( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults )
 {
-    struct timespec s_fill, e_fill, s_mult, e_mult, s_trans, e_trans, s_gauss, e_gauss;
-    double elapsed_time;
-    int rVal = 0;
-    int degree = coefficientCount - 1;
+    polyfit_options_t options;
+
+    polyfit_options_defaults( &options );
+    options.backend = POLYFIT_BACKEND_SERIAL;
+    return polyfit_ex( pointCount, xValues, yValues, coefficientCount, coefficientResults, &options, NULL );
+}
 
+//--------------------------------------------------------
+// polyfit_ws()
+// polyfit() with its matrices taken from a workspace, and
+// given back before it returns.
+//--------------------------------------------------------
+int polyfit_ws( polyfit_workspace_t *pWorkspace, int pointCount, double *xValues, double *yValues,
+                int coefficientCount, double *coefficientResults, polyfit_stats_t *pStats )
+{
     // Check that the input pointers aren't null.
-    if( (NULL == xValues) || (NULL == yValues) || (NULL == coefficientResults) )
+    if( (NULL == pWorkspace) || (NULL == xValues) || (NULL == yValues) || (NULL == coefficientResults) )
     {
         return -1;
     }
@@ -123,152 +137,9 @@ int polyfit( int pointCount, double *xValues, double *yValues, int coefficientCo
         return -2;
     }
 
-    // printf( "pointCount = %d:", pointCount );
-
-    // for( i = 0; i < pointCount; i++ )
-    // {
-    //     printf( " ( %f, %f )", xValues[i], yValues[i] );
-    // }
-    // printf( "\n");
-
-    // printf( "coefficientCount = %d\n", coefficientCount );
-
-    // Make the A matrix:
-    matrix_t *pMatA = createMatrix( pointCount, coefficientCount );
-    if( NULL == pMatA)
-    {
-        return -3;
-    }
-
-    clock_gettime(CLOCK_MONOTONIC, &s_fill);
-    for( int r = 0; r < pointCount; r++)
-    {
-        for( int c = 0; c < coefficientCount; c++)
-        {
-            *(MATRIX_VALUE_PTR(pMatA, r, c)) = pow((xValues[r]), (double) (degree -c));
-        }
-    }
-    clock_gettime(CLOCK_MONOTONIC, &e_fill);
-    elapsed_time = (e_fill.tv_sec - s_fill.tv_sec) +
-                       (e_fill.tv_nsec - s_fill.tv_nsec) / 1e9;
-    printf("Execution time of fill (A): %f seconds\n", elapsed_time);
-    showMatrix( pMatA );
-
-    // Make the b matrix
-    matrix_t *pMatB = createMatrix( pointCount, 1);
-    if( NULL == pMatB )
-    {
-        return -3;
-    }
-
-    for( int r = 0; r < pointCount; r++)
-    {
-        *(MATRIX_VALUE_PTR(pMatB, r, 0)) = yValues[r];
-    }
-
-    clock_gettime(CLOCK_MONOTONIC, &s_trans);
-    // Make the transpose of matrix A
-    matrix_t * pMatAT = createTranspose( pMatA );
-    if( NULL == pMatAT )
-    {
-        return -3;
-    }
-
-    clock_gettime(CLOCK_MONOTONIC, &e_trans);
-    elapsed_time = (e_trans.tv_sec - s_trans.tv_sec) +
-                       (e_trans.tv_nsec - s_trans.tv_nsec) / 1e9;
-    printf("Execution time of trans (A): %f seconds\n", elapsed_time);
-	
-    showMatrix( pMatAT );
-
-    // Make the product of matrices AT and A:
-    matrix_t *pMatATA = createProduct( pMatAT, pMatA );
-    if( NULL == pMatATA )
-    {
-        return -3;
-    }
-
-     showMatrix( pMatATA );
-
-    clock_gettime(CLOCK_MONOTONIC, &s_mult);
-    // Make the product of matrices AT and b:
-    matrix_t *pMatATB = createProduct( pMatAT, pMatB );
-    if( NULL == pMatATB )
-    {
-        return -3;
-    }
-    clock_gettime(CLOCK_MONOTONIC, &e_mult);
-    elapsed_time = (e_mult.tv_sec - s_mult.tv_sec) +
-                       (e_mult.tv_nsec - s_mult.tv_nsec) / 1e9;
-    printf("Execution time of mult (A): %f seconds\n", elapsed_time);
-    
-    showMatrix( pMatATB );
-    
-    // Now we need to solve the system of linear equations,
-    // (AT)Ax = (AT)b for "x", the coefficients of the polynomial.
-    clock_gettime(CLOCK_MONOTONIC, &s_gauss);
-    for( int c = 0; c < pMatATA->cols; c++ )
-    {
-        int pr = c;     // pr is the pivot row.
-        double prVal = *MATRIX_VALUE_PTR(pMatATA, pr, c);
-        // If it's zero, we can't solve the equations.
-        if( 0.0 == prVal )
-        {
-            // printf( "Unable to solve equations, pr = %d, c = %d.\n", pr, c );
-            showMatrix( pMatATA );
-            rVal = -4;
-            break;
-        }
-        for( int r = 0; r < pMatATA->rows; r++)
-        {
-            if( r != pr )
-            {
-                double targetRowVal = *MATRIX_VALUE_PTR(pMatATA, r, c);
-                double factor = targetRowVal / prVal;
-                for( int c2 = 0; c2 < pMatATA->cols; c2++ )
-                {
-                    *MATRIX_VALUE_PTR(pMatATA, r, c2) -=  *MATRIX_VALUE_PTR(pMatATA, pr, c2) * factor; 
-                    // printf( "c = %d, pr = %d, r = %d, c2=%d, targetRowVal = %f, prVal = %f, factor = %f.\n",
-                    //         c, pr, r, c2, targetRowVal, prVal, factor );
-
-                    // showMatrix( pMatATA );
-                   
-                }
-                *MATRIX_VALUE_PTR(pMatATB, r, 0) -=  *MATRIX_VALUE_PTR(pMatATB, pr, 0) * factor;
-
-                showMatrix( pMatATB );
-            }
-        }
-    }
-    for( int c = 0; c < pMatATA->cols; c++ )
-    {
-        int pr = c;
-        // now, pr is the pivot row.
-        double prVal = *MATRIX_VALUE_PTR(pMatATA, pr, c);
-        *MATRIX_VALUE_PTR(pMatATA, pr, c) /= prVal;
-        *MATRIX_VALUE_PTR(pMatATB, pr, 0) /= prVal;
-    }
-    clock_gettime(CLOCK_MONOTONIC, &e_gauss);
-    elapsed_time = (e_gauss.tv_sec - s_gauss.tv_sec) +
-                       (e_gauss.tv_nsec - s_gauss.tv_nsec) / 1e9;
-    printf("Execution time of gauss (A): %f seconds\n", elapsed_time);
-    
-    showMatrix( pMatATA );
-
-    showMatrix( pMatATB );
-
-    for( int i = 0; i < coefficientCount; i++)
-    {
-        coefficientResults[i] = *MATRIX_VALUE_PTR(pMatATB, i, 0);
-    }
-
-    
-    destroyMatrix( pMatATB );
-    destroyMatrix( pMatATA );
-    destroyMatrix( pMatAT );
-
-    destroyMatrix( pMatA );
-    destroyMatrix( pMatB );
+    size_t mark = polyfit_workspace_mark( pWorkspace );
+    int rVal = fitMatrices( pWorkspace, pointCount, xValues, yValues, coefficientCount, coefficientResults, pStats );
+    polyfit_workspace_release( pWorkspace, mark );
     return rVal;
 }
 
@@ -342,19 +213,116 @@ static void reallyShowMatrix( matrix_t *pMat )
 }
 #endif  // SHOW_MATRIX
 
+//--------------------------------------------------------
+// fitMatrices()
+// The body of polyfit_ws(): fills A and b, forms the
+// products and solves.  Nothing it takes from the
+// workspace needs to be given back individually.
+//--------------------------------------------------------
+static int fitMatrices( polyfit_workspace_t *pWorkspace, int pointCount, double *xValues, double *yValues,
+                        int coefficientCount, double *coefficientResults, polyfit_stats_t *pStats )
+{
+    long long pointBytes = (long long) pointCount * sizeof( double );
+    int rVal = 0;
+
+    // printf( "pointCount = %d:", pointCount );
+
+    // for( i = 0; i < pointCount; i++ )
+    // {
+    //     printf( " ( %f, %f )", xValues[i], yValues[i] );
+    // }
+    // printf( "\n");
+
+    // printf( "coefficientCount = %d\n", coefficientCount );
+
+    // Make the A matrix:
+    matrix_t *pMatA = createMatrix( pWorkspace, pointCount, coefficientCount );
+    if( NULL == pMatA)
+    {
+        return -3;
+    }
+
+    POLYFIT_STATS_BEGIN( pStats, POLYFIT_PHASE_FILL );
+    // Column c holds x^(degree - c); built by multiplication, not pow().
+    polyfit_simd()->fillPowers( pointCount, xValues, coefficientCount, pMatA->pContents );
+    showMatrix( pMatA );
+
+    // Make the b matrix
+    matrix_t *pMatB = createMatrix( pWorkspace, pointCount, 1);
+    if( NULL == pMatB )
+    {
+        return -3;
+    }
+
+    for( int r = 0; r < pointCount; r++)
+    {
+        *(MATRIX_VALUE_PTR(pMatB, r, 0)) = yValues[r];
+    }
+    // Reads x and y, writes A and b; k-1 multiplies a point.
+    POLYFIT_STATS_END( pStats, POLYFIT_PHASE_FILL, pointBytes * (coefficientCount + 3),
+                       (long long) pointCount * (coefficientCount - 1) );
+
+    POLYFIT_STATS_BEGIN( pStats, POLYFIT_PHASE_TRANSPOSE );
+    // Make the transpose of matrix A
+    matrix_t * pMatAT = createTranspose( pWorkspace, pMatA );
+    if( NULL == pMatAT )
+    {
+        return -3;
+    }
+
+    POLYFIT_STATS_END( pStats, POLYFIT_PHASE_TRANSPOSE, 2 * pointBytes * coefficientCount, 0 );
+	
+    showMatrix( pMatAT );
+
+    POLYFIT_STATS_BEGIN( pStats, POLYFIT_PHASE_PRODUCT );
+    // Make the product of matrices AT and A:
+    matrix_t *pMatATA = createHankelProduct( pWorkspace, pMatAT );
+    if( NULL == pMatATA )
+    {
+        return -3;
+    }
+
+     showMatrix( pMatATA );
+
+    // Make the product of matrices AT and b:
+    matrix_t *pMatATB = createProduct( pWorkspace, pMatAT, pMatB );
+    if( NULL == pMatATB )
+    {
+        return -3;
+    }
+    // 2k-1 dot products for (AT)A and k for (AT)b, each
+    // reading two rows of length pointCount.
+    POLYFIT_STATS_END( pStats, POLYFIT_PHASE_PRODUCT, 2 * pointBytes * (3 * coefficientCount - 1),
+                       2 * (long long) pointCount * (3 * coefficientCount - 1) );
+    
+    showMatrix( pMatATB );
+    
+    POLYFIT_STATS_BEGIN( pStats, POLYFIT_PHASE_SOLVE );
+    // Now we need to solve the system of linear equations,
+    // (AT)Ax = (AT)b for "x", the coefficients of the polynomial.
+    // (AT)A is symmetric positive definite, so Cholesky is used
+    // and only its upper triangle is read.
+    rVal = polyfit_solve_normal( coefficientCount, pMatATA->pContents, pMatATB->pContents, coefficientResults );
+    // Cholesky, then the two triangular solves.
+    long long solveFlops = (long long) coefficientCount * coefficientCount * (coefficientCount + 6) / 3;
+    POLYFIT_STATS_END( pStats, POLYFIT_PHASE_SOLVE, (long long) coefficientCount * (coefficientCount + 2) * sizeof( double ),
+                       solveFlops );
+
+    return rVal;
+}
+
 //--------------------------------------------------------
 // createTranspose()
 // Returns the transpose of a matrix, or NULL.
-//
-// The caller must free both the allocated matrix
-// and its contents array.
 //--------------------------------------------------------
-static matrix_t * createTranspose( matrix_t *pMat )
+static matrix_t * createTranspose( polyfit_workspace_t *pWorkspace, matrix_t *pMat )
 {
-    matrix_t *rVal = (matrix_t *) calloc(1, sizeof(matrix_t));
-    rVal->pContents = (double *) calloc( pMat->rows * pMat->cols, sizeof( double ));
-    rVal->cols = pMat->rows;
-    rVal->rows = pMat->cols;
+    matrix_t *rVal = createMatrix( pWorkspace, pMat->cols, pMat->rows );
+    if( NULL == rVal )
+    {
+        return NULL;
+    }
+
     for( int r = 0; r < rVal->rows; r++ )
     {
         for( int c = 0; c < rVal->cols; c++ )
@@ -368,11 +336,8 @@ static matrix_t * createTranspose( matrix_t *pMat )
 //--------------------------------------------------------
 // createProduct()
 // Returns the product of two matrices, or NULL.
-//
-// The caller must free both the allocated product matrix
-// and its contents array.
 //--------------------------------------------------------
-static matrix_t * createProduct( matrix_t *pLeft, matrix_t *pRight )
+static matrix_t * createProduct( polyfit_workspace_t *pWorkspace, matrix_t *pLeft, matrix_t *pRight )
 {
     matrix_t *rVal = NULL;
     if( (NULL == pLeft) || (NULL == pRight) || (pLeft->cols != pRight->rows) )
@@ -382,22 +347,30 @@ static matrix_t * createProduct( matrix_t *pLeft, matrix_t *pRight )
     else
     {
         // Allocate the product matrix.
-        rVal = (matrix_t *) calloc(1, sizeof(matrix_t));
-        rVal->rows = pLeft->rows;
-        rVal->cols = pRight->cols;
-        rVal->pContents = (double *) calloc( rVal->rows * rVal->cols, sizeof( double ));
+        rVal = createMatrix( pWorkspace, pLeft->rows, pRight->cols );
+        if( NULL == rVal )
+        {
+            return NULL;
+        }
 
         // Initialize the product matrix contents:
         // product[i,j] = sum{k = 0 .. (pLeft->cols - 1)} (pLeft[i,k] * pRight[ k, j])
         for( int i = 0; i < rVal->rows; i++)
         {
+            if( 1 == pRight->cols )
+            {
+                // A column vector is contiguous: use the vector dot product.
+                *MATRIX_VALUE_PTR(rVal, i, 0) = polyfit_simd()->dot( pLeft->cols, MATRIX_VALUE_PTR(pLeft, i, 0), pRight->pContents );
+                continue;
+            }
             for( int j = 0; j < rVal->cols; j++ )
             {
+                double sum = 0.0;
                 for( int k = 0; k < pLeft->cols; k++)
                 {
-                    *MATRIX_VALUE_PTR(rVal, i, j) +=
-                        (*MATRIX_VALUE_PTR(pLeft, i, k)) * (*MATRIX_VALUE_PTR(pRight, k, j));
+                    sum += (*MATRIX_VALUE_PTR(pLeft, i, k)) * (*MATRIX_VALUE_PTR(pRight, k, j));
                 }
+                *MATRIX_VALUE_PTR(rVal, i, j) = sum;
             }
         }
     }    
@@ -406,41 +379,71 @@ static matrix_t * createProduct( matrix_t *pLeft, matrix_t *pRight )
 }
 
 //--------------------------------------------------------
-// destroyMatrix()
-// Frees both the allocated matrix and its contents array.
+// createHankelProduct()
+// Returns (AT)A for a Vandermonde matrix A, given AT, or NULL.
+//
+// (AT)A[i,j] is the sum of x^(2*degree - i - j), so it only
+// depends on i + j.  Just the 2k-1 distinct entries are
+// computed, each as the dot product of two rows of AT, and
+// then copied along their anti-diagonals.
 //--------------------------------------------------------
-static void destroyMatrix( matrix_t *pMat )
+static matrix_t * createHankelProduct( polyfit_workspace_t *pWorkspace, matrix_t *pMatAT )
 {
-    if(NULL != pMat)
+    int k = pMatAT->rows;
+    matrix_t *rVal = createMatrix( pWorkspace, k, k );
+    if( NULL == rVal )
     {
-        if(NULL != pMat->pContents)
-        {
-            free(pMat->pContents);
-        }
-        free( pMat );
+        return NULL;
+    }
+    memset( rVal->pContents, 0, k * k * sizeof( double ) );
+
+    for( int s = 0; s < 2 * k - 1; s++ )
+    {
+        // Any rows i, j with i + j == s give the same sum.
+        int i = s / 2;
+        int j = s - i;
+        double *pRowI = MATRIX_VALUE_PTR(pMatAT, i, 0);
+        double *pRowJ = MATRIX_VALUE_PTR(pMatAT, j, 0);
+        setHankelDiagonal( rVal, s, polyfit_simd()->dot( pMatAT->cols, pRowI, pRowJ ) );
+    }
+    return rVal;
+}
+
+//--------------------------------------------------------
+// setHankelDiagonal()
+// Stores value in every element (r, c) of a square matrix
+// with r + c == s and r <= c.  The solver only reads the
+// upper triangle, so the lower one is left unformed.
+//--------------------------------------------------------
+static void setHankelDiagonal( matrix_t *pMat, int s, double value )
+{
+    int k = pMat->rows;
+    int rFirst = (s < k) ? 0 : (s - k + 1);
+    int rLast = s / 2;
+    for( int r = rFirst; r <= rLast; r++ )
+    {
+        *MATRIX_VALUE_PTR(pMat, r, (s - r)) = value;
     }
 }
 
 //--------------------------------------------------------
 // createMatrix()
-// Allocates the matrix and clears its contents array.
+// Takes the matrix and its contents array from the
+// workspace.  The contents are not cleared.
 //--------------------------------------------------------
-static matrix_t *createMatrix( int rows, int cols )
+static matrix_t *createMatrix( polyfit_workspace_t *pWorkspace, int rows, int cols )
 {
-    matrix_t *rVal = (matrix_t *) calloc(1, sizeof(matrix_t));
+    matrix_t *rVal = (matrix_t *) polyfit_workspace_alloc( pWorkspace, sizeof(matrix_t) );
     if(NULL != rVal)
     {
         rVal->rows = rows;
         rVal->cols = cols;
-        rVal->pContents = (double *) calloc( rows * cols, sizeof( double ));
+        rVal->pContents = (double *) polyfit_workspace_alloc( pWorkspace, (size_t) rows * cols * sizeof( double ));
         if(NULL == rVal->pContents)
         {
-            free( rVal );
             rVal = NULL;
         }
     }
 
     return rVal;
 }
-
- 
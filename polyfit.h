@@ -30,6 +30,9 @@
 #ifndef POLYFIT_H
 #define POLYFIT_H
 
+#include "polyfit_stats.h"
+#include "polyfit_workspace.h"
+
 
 //------------------------------------------------
 // Function Prototypes
@@ -38,12 +41,29 @@
 //--------------------------------------------------------
 // polyfit()
 // Computes polynomial coefficients that best fit a set
-// of input points.
+// of input points.  Runs polyfit_ex() on
+// POLYFIT_BACKEND_SERIAL.
 //
 // Returns 0 if success.
 //--------------------------------------------------------
 int polyfit( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults );
 
+//--------------------------------------------------------
+// polyfit_ws()
+// Same as polyfit(), but takes its scratch matrices from
+// pWorkspace instead of the heap.  A workspace from
+// polyfit_workspace_create( maxPointCount,
+// maxCoefficientCount, 1 ) covers any fit up to that size.
+//
+// pStats, if not NULL, is filled with the time and bytes
+// of each phase.
+//
+// Returns 0 if success, or the polyfit() error codes; -3
+// means the workspace is too small.
+//--------------------------------------------------------
+int polyfit_ws( polyfit_workspace_t *pWorkspace, int pointCount, double *xValues, double *yValues,
+                int coefficientCount, double *coefficientResults, polyfit_stats_t *pStats );
+
 //--------------------------------------------------------
 // polyToString()
 // Produces a string representation of a polynomial from
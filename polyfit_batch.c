@@ -0,0 +1,328 @@
+// Name: polyfit_batch.c
+// Description: Batched MLS fitting of many small series, with the
+//              normal equations of POLYFIT_BATCH_LANES series solved
+//              across vector lanes.
+
+#include <float.h>      // DBL_EPSILON
+#include <limits.h>     // INT_MAX
+#include <stdio.h>      // NULL
+#include <string.h>     // memset()
+
+#include "polyfit_batch.h"
+#include "polyfit_simd.h"
+#include "polyfit_sums.h"
+#include <omp.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#define POLYFIT_BATCH_X86 1
+#endif  // __x86_64__ || __i386__
+
+#define MAX_SUMS    POLYFIT_POWER_SUM_COUNT( POLYFIT_MAX_COEFFICIENTS )
+
+// One double, or one lane mask, per series of a group.  GCC
+// vector types, so one expression of these is compiled to
+// whatever vectors the function's target has: one AVX-512
+// register, two AVX2 or four SSE2 ones.
+typedef double Lanes __attribute__(( vector_size( POLYFIT_BATCH_LANES * sizeof( double ) ) ));
+typedef long long LaneMask __attribute__(( vector_size( POLYFIT_BATCH_LANES * sizeof( long long ) ) ));
+
+// Normal equations of one group, structure-of-arrays: element
+// (row, col) of every series' (AT)A is ata[row * n + col].
+typedef struct
+{
+    Lanes   ata[ POLYFIT_MAX_COEFFICIENTS * POLYFIT_MAX_COEFFICIENTS ];
+    Lanes   atb[ POLYFIT_MAX_COEFFICIENTS ];
+    Lanes   x[ POLYFIT_MAX_COEFFICIENTS ];
+    LaneMask singular;          // -1 in the lanes whose system is singular.
+} BatchGroup;
+
+// Group solver of one ISA level.
+typedef void (*SolveGroup)( int n, BatchGroup *pGroup );
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static int          checkStarts( int seriesCount, const long *seriesStarts );
+static SolveGroup   selectSolver( void );
+static void         loadGroup( int firstSeries, int seriesCount, const long *seriesStarts,
+                               const double *xValues, const double *yValues, int coefficientCount,
+                               BatchGroup *pGroup, int *statuses );
+static void         solveGroupGeneric( int n, BatchGroup *pGroup );
+#ifdef POLYFIT_BATCH_X86
+static void         solveGroupAvx2( int n, BatchGroup *pGroup );
+static void         solveGroupAvx512( int n, BatchGroup *pGroup );
+#endif  // POLYFIT_BATCH_X86
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_batch()
+// Groups are handed out dynamically, as series lengths
+// vary.  Each thread keeps one BatchGroup on its stack, so
+// nothing is allocated per series.
+//--------------------------------------------------------
+int polyfit_batch( int seriesCount, const long *seriesStarts, const double *xValues, const double *yValues,
+                   int coefficientCount, int threadCount, double *coefficientResults, int *seriesResults )
+{
+    if( (NULL == seriesStarts) || (NULL == xValues) || (NULL == yValues) || (NULL == coefficientResults) )
+    {
+        return -1;
+    }
+    if( (coefficientCount < 1) || (coefficientCount > POLYFIT_MAX_COEFFICIENTS) ||
+        (0 != checkStarts( seriesCount, seriesStarts )) )
+    {
+        return -2;
+    }
+
+    SolveGroup solveGroup = selectSolver();
+    int groupCount = (seriesCount + POLYFIT_BATCH_LANES - 1) / POLYFIT_BATCH_LANES;
+    int k = coefficientCount;
+    int failCount = 0;
+
+    if( threadCount < 1 )
+    {
+        threadCount = omp_get_max_threads();
+    }
+
+    #pragma omp parallel for schedule( dynamic ) num_threads( threadCount ) reduction( + : failCount )
+    for( int g = 0; g < groupCount; g++ )
+    {
+        BatchGroup group;
+        int statuses[ POLYFIT_BATCH_LANES ];
+        int first = g * POLYFIT_BATCH_LANES;
+        int laneCount = (seriesCount - first < POLYFIT_BATCH_LANES) ? (seriesCount - first) : POLYFIT_BATCH_LANES;
+
+        loadGroup( first, laneCount, seriesStarts, xValues, yValues, k, &group, statuses );
+        solveGroup( k, &group );
+
+        for( int lane = 0; lane < laneCount; lane++ )
+        {
+            double *pResult = &coefficientResults[ (size_t) (first + lane) * k ];
+
+            if( (0 == statuses[ lane ]) && (0 != group.singular[ lane ]) )
+            {
+                statuses[ lane ] = -4;
+            }
+            for( int i = 0; i < k; i++ )
+            {
+                pResult[i] = (0 == statuses[ lane ]) ? group.x[i][ lane ] : 0.0;
+            }
+            if( NULL != seriesResults )
+            {
+                seriesResults[ first + lane ] = statuses[ lane ];
+            }
+            failCount += (0 != statuses[ lane ]) ? 1 : 0;
+        }
+    }
+    return failCount;
+}
+
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// checkStarts()
+// Returns 0 if seriesStarts describes seriesCount usable
+// series, or -2.
+//--------------------------------------------------------
+static int checkStarts( int seriesCount, const long *seriesStarts )
+{
+    if( (seriesCount < 0) || (seriesStarts[0] < 0) )
+    {
+        return -2;
+    }
+    for( int s = 0; s < seriesCount; s++ )
+    {
+        long length = seriesStarts[ s + 1 ] - seriesStarts[s];
+        if( (length < 0) || (length > INT_MAX) )
+        {
+            return -2;
+        }
+    }
+    return 0;
+}
+
+//--------------------------------------------------------
+// selectSolver()
+// Returns the group solver for the ISA level polyfit_simd()
+// selected, so POLYFIT_ISA applies here too.
+//--------------------------------------------------------
+static SolveGroup selectSolver( void )
+{
+#ifdef POLYFIT_BATCH_X86
+    polyfit_isa_t isa = polyfit_simd()->isa;
+
+    if( isa >= POLYFIT_ISA_AVX512 )
+    {
+        return solveGroupAvx512;
+    }
+    if( isa >= POLYFIT_ISA_AVX2 )
+    {
+        return solveGroupAvx2;
+    }
+#endif  // POLYFIT_BATCH_X86
+    return solveGroupGeneric;
+}
+
+//--------------------------------------------------------
+// loadGroup()
+// Accumulates the power sums of seriesCount series from
+// firstSeries, and spreads each into its lane of the
+// group's (AT)A and (AT)b.  A lane without a series, or
+// whose series is too short, gets the identity, so it
+// solves harmlessly; statuses[] says which lanes count.
+//--------------------------------------------------------
+static void loadGroup( int firstSeries, int seriesCount, const long *seriesStarts,
+                       const double *xValues, const double *yValues, int coefficientCount,
+                       BatchGroup *pGroup, int *statuses )
+{
+    const polyfit_simd_kernels_t *pKernels = polyfit_simd();
+    int k = coefficientCount;
+    int degree = k - 1;
+
+    for( int lane = 0; lane < POLYFIT_BATCH_LANES; lane++ )
+    {
+        double sumX[ MAX_SUMS ];
+        double sumXY[ POLYFIT_MAX_COEFFICIENTS ];
+        int s = firstSeries + lane;
+        long start = (lane < seriesCount) ? seriesStarts[s] : 0;
+        int length = (lane < seriesCount) ? (int) (seriesStarts[ s + 1 ] - start) : 0;
+
+        statuses[ lane ] = (length < k) ? -2 : 0;
+        if( 0 != statuses[ lane ] )
+        {
+            for( int i = 0; i < k; i++ )
+            {
+                for( int j = 0; j < k; j++ )
+                {
+                    pGroup->ata[ i * k + j ][ lane ] = (i == j) ? 1.0 : 0.0;
+                }
+                pGroup->atb[i][ lane ] = 0.0;
+            }
+            continue;
+        }
+
+        // Hankel structure, as in polyfit_sums_build().
+        memset( sumX, 0, POLYFIT_POWER_SUM_COUNT( k ) * sizeof( double ) );
+        memset( sumXY, 0, k * sizeof( double ) );
+        pKernels->powerSums( length, &xValues[ start ], &yValues[ start ], k, sumX, sumXY );
+        for( int i = 0; i < k; i++ )
+        {
+            for( int j = 0; j < k; j++ )
+            {
+                pGroup->ata[ i * k + j ][ lane ] = sumX[ 2 * degree - i - j ];
+            }
+            pGroup->atb[i][ lane ] = sumXY[ degree - i ];
+        }
+    }
+}
+
+//--------------------------------------------------------
+// solveLanes()
+// LDLT solve of every lane's n x n system at once:
+// (AT)A = (UT)DU with unit upper triangular U, which is
+// Cholesky without the square roots polyfit_solve_normal()
+// would need per lane.  U overwrites the upper triangle of
+// ata.  A lane whose pivot isn't above the rounding error
+// of its diagonal (zero, negative or NaN included), the
+// polyfit_solve_normal() test, is marked singular; its
+// division results are discarded.
+//
+// Inlined into each target's solveGroup, so it is compiled
+// once per ISA level.
+//--------------------------------------------------------
+static inline __attribute__(( always_inline )) void solveLanes( int n, BatchGroup *pGroup )
+{
+    Lanes *ata = pGroup->ata;
+    Lanes d[ POLYFIT_MAX_COEFFICIENTS ];
+    LaneMask singular = { 0 };
+    double limit = n * DBL_EPSILON;
+
+    for( int j = 0; j < n; j++ )
+    {
+        Lanes pivot = ata[ j * n + j ];
+        Lanes bound = limit * pivot;
+        for( int k = 0; k < j; k++ )
+        {
+            pivot -= ata[ k * n + j ] * ata[ k * n + j ] * d[k];
+        }
+        // Not "pivot <= bound", so NaN lanes are caught.
+        singular |= (LaneMask) ~(pivot > bound);
+
+        d[j] = pivot;
+        for( int c = j + 1; c < n; c++ )
+        {
+            Lanes sum = ata[ j * n + c ];
+            for( int k = 0; k < j; k++ )
+            {
+                sum -= ata[ k * n + j ] * d[k] * ata[ k * n + c ];
+            }
+            ata[ j * n + c ] = sum / pivot;
+        }
+    }
+
+    // Forward substitution (UT) z = b, then D, then back
+    // substitution U x = z.
+    Lanes *x = pGroup->x;
+    for( int i = 0; i < n; i++ )
+    {
+        Lanes sum = pGroup->atb[i];
+        for( int k = 0; k < i; k++ )
+        {
+            sum -= ata[ k * n + i ] * x[k];
+        }
+        x[i] = sum;
+    }
+    for( int i = 0; i < n; i++ )
+    {
+        x[i] /= d[i];
+    }
+    for( int i = n - 1; i >= 0; i-- )
+    {
+        Lanes sum = x[i];
+        for( int k = i + 1; k < n; k++ )
+        {
+            sum -= ata[ i * n + k ] * x[k];
+        }
+        x[i] = sum;
+    }
+    pGroup->singular = singular;
+}
+
+//--------------------------------------------------------
+// solveGroupGeneric()
+// The build's baseline vectors (SSE2 on x86-64).
+//--------------------------------------------------------
+static void solveGroupGeneric( int n, BatchGroup *pGroup )
+{
+    solveLanes( n, pGroup );
+}
+
+#ifdef POLYFIT_BATCH_X86
+
+//--------------------------------------------------------
+// solveGroupAvx2()
+//--------------------------------------------------------
+__attribute__(( target( "avx2,fma" ) ))
+static void solveGroupAvx2( int n, BatchGroup *pGroup )
+{
+    solveLanes( n, pGroup );
+}
+
+//--------------------------------------------------------
+// solveGroupAvx512()
+//--------------------------------------------------------
+__attribute__(( target( "avx512f" ) ))
+static void solveGroupAvx512( int n, BatchGroup *pGroup )
+{
+    solveLanes( n, pGroup );
+}
+
+#endif  // POLYFIT_BATCH_X86
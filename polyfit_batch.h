@@ -0,0 +1,50 @@
+// file: polyfit_batch.h
+// Description: Many small, independent MLS fits in one call.
+//
+// A workload of thousands of short series - a few hundred points
+// each - pays polyfit()'s allocation and thread fork/join once per
+// series.  polyfit_batch() takes every series as a range of shared x
+// and y arrays and spreads groups of POLYFIT_BATCH_LANES series over
+// one OpenMP team.  Each series' power sums come from the
+// polyfit_simd() kernel, and the group's normal equations are stored
+// structure-of-arrays, each element holding one value per series,
+// so all the group's small systems are factored and solved together,
+// one series per vector lane.
+
+#ifndef POLYFIT_BATCH_H
+#define POLYFIT_BATCH_H
+
+// Series solved together: one AVX-512 vector of doubles.
+#define POLYFIT_BATCH_LANES     (8)
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_batch()
+// Fits each of seriesCount series with coefficientCount
+// terms.  Series s is the points seriesStarts[s] up to
+// seriesStarts[s + 1] of xValues and yValues, so
+// seriesStarts has seriesCount + 1 nondecreasing entries;
+// series may share points.  Its coefficients, highest
+// power first, go to coefficientResults[s * coefficientCount]
+// and its polyfit() status (0, -2 if it has fewer points
+// than coefficients, -4 if singular) to seriesResults[s].
+// A series that isn't fitted gets zero coefficients.
+// seriesResults may be NULL.  threadCount <= 0 uses the
+// OpenMP default.
+//
+// Returns the number of series that weren't fitted (0 if
+// all were), or
+//          -1 if passed a NULL pointer,
+//          -2 if coefficientCount is out of range, or
+//             seriesStarts is negative, decreasing or has a
+//             series longer than INT_MAX points.
+//--------------------------------------------------------
+int polyfit_batch( int seriesCount, const long *seriesStarts, const double *xValues, const double *yValues,
+                   int coefficientCount, int threadCount, double *coefficientResults, int *seriesResults );
+
+
+#endif	// POLYFIT_BATCH_H
@@ -0,0 +1,228 @@
+// Name: polyfit_bin.c
+// Description: Binary columnar dataset files for polynomial fitting.
+
+#include <fcntl.h>      // open()
+#include <float.h>      // DBL_MAX
+#include <stdio.h>      // fopen(), fwrite()
+#include <string.h>     // memcmp(), memset(), strncpy()
+#include <sys/mman.h>   // mmap()
+#include <sys/stat.h>   // fstat()
+#include <unistd.h>     // close()
+
+#include "polyfit_bin.h"
+#include <omp.h>
+
+// MACRO to round a byte count up to the column alignment.
+#define ALIGN_UP( bytes )  ((((bytes) + POLYFIT_BIN_ALIGNMENT - 1) / POLYFIT_BIN_ALIGNMENT) * POLYFIT_BIN_ALIGNMENT)
+
+// The format is little-endian, and columns are used in place.
+#define HOST_IS_LITTLE_ENDIAN   (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+
+_Static_assert( sizeof( polyfit_bin_column_t ) == 64, "column descriptor must be 64 bytes" );
+_Static_assert( sizeof( polyfit_bin_header_t ) % POLYFIT_BIN_ALIGNMENT == 0, "header must keep columns aligned" );
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static void describeColumn( polyfit_bin_column_t *pColumn, const char *name, uint64_t offset,
+                            long pointCount, const double *pValues );
+static int  writePadded( FILE *pFile, const void *pData, size_t byteCount );
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_bin_write()
+// Writes the header, then each column padded to the
+// column alignment.
+//--------------------------------------------------------
+int polyfit_bin_write( const char *fileName, long pointCount, const double *xValues, const double *yValues,
+                       const char *xName, const char *yName )
+{
+    if( (NULL == fileName) || (NULL == xValues) || (NULL == yValues) )
+    {
+        return -1;
+    }
+    if( pointCount < 0 )
+    {
+        return -2;
+    }
+    if( !HOST_IS_LITTLE_ENDIAN )
+    {
+        return -5;
+    }
+
+    polyfit_bin_header_t header;
+    memset( &header, 0, sizeof( header ) );
+    memcpy( header.magic, POLYFIT_BIN_MAGIC, sizeof( header.magic ) );
+    header.version = POLYFIT_BIN_VERSION;
+    header.columnCount = POLYFIT_BIN_COLUMN_COUNT;
+    header.rowCount = (uint64_t) pointCount;
+
+    uint64_t columnBytes = ALIGN_UP( (uint64_t) pointCount * sizeof( double ) );
+    describeColumn( &header.columns[0], (NULL == xName) ? "x" : xName, sizeof( header ), pointCount, xValues );
+    describeColumn( &header.columns[1], (NULL == yName) ? "y" : yName, sizeof( header ) + columnBytes, pointCount, yValues );
+
+    FILE *pFile = fopen( fileName, "wb" );
+    if( NULL == pFile )
+    {
+        return -5;
+    }
+
+    int rVal = 0;
+    if( (1 != fwrite( &header, sizeof( header ), 1, pFile )) ||
+        (0 != writePadded( pFile, xValues, pointCount * sizeof( double ) )) ||
+        (0 != writePadded( pFile, yValues, pointCount * sizeof( double ) )) )
+    {
+        rVal = -5;
+    }
+    if( 0 != fclose( pFile ) )
+    {
+        rVal = -5;
+    }
+    if( 0 != rVal )
+    {
+        remove( fileName );
+    }
+    return rVal;
+}
+
+//--------------------------------------------------------
+// polyfit_bin_load()
+// Maps a dataset file and checks its header.
+//--------------------------------------------------------
+int polyfit_bin_load( const char *fileName, polyfit_bin_t *pBin )
+{
+    if( (NULL == fileName) || (NULL == pBin) )
+    {
+        return -1;
+    }
+    memset( pBin, 0, sizeof( *pBin ) );
+    if( !HOST_IS_LITTLE_ENDIAN )
+    {
+        return -6;
+    }
+
+    int fd = open( fileName, O_RDONLY );
+    if( fd < 0 )
+    {
+        return -5;
+    }
+    struct stat fileStat;
+    if( 0 != fstat( fd, &fileStat ) )
+    {
+        close( fd );
+        return -5;
+    }
+
+    size_t fileSize = (size_t) fileStat.st_size;
+    if( fileSize < sizeof( polyfit_bin_header_t ) )
+    {
+        close( fd );
+        return -6;
+    }
+    void *pMap = mmap( NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if( MAP_FAILED == pMap )
+    {
+        return -5;
+    }
+
+    // Check the header, and that both columns lie in the file.
+    const polyfit_bin_header_t *pHeader = (const polyfit_bin_header_t *) pMap;
+    int valid = (0 == memcmp( pHeader->magic, POLYFIT_BIN_MAGIC, sizeof( pHeader->magic ) )) &&
+                (POLYFIT_BIN_VERSION == pHeader->version) &&
+                (POLYFIT_BIN_COLUMN_COUNT == pHeader->columnCount) &&
+                (pHeader->rowCount <= fileSize / sizeof( double ));
+    for( int c = 0; valid && (c < POLYFIT_BIN_COLUMN_COUNT); c++ )
+    {
+        uint64_t offset = pHeader->columns[c].offset;
+        valid = (0 == offset % POLYFIT_BIN_ALIGNMENT) &&
+                (offset <= fileSize) &&
+                (pHeader->rowCount * sizeof( double ) <= fileSize - offset);
+    }
+    if( !valid )
+    {
+        munmap( pMap, fileSize );
+        return -6;
+    }
+
+    pBin->pointCount = (long) pHeader->rowCount;
+    pBin->xValues = (double *) ((char *) pMap + pHeader->columns[0].offset);
+    pBin->yValues = (double *) ((char *) pMap + pHeader->columns[1].offset);
+    pBin->pHeader = pHeader;
+    pBin->pMap = pMap;
+    pBin->mapSize = fileSize;
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_bin_close()
+// Unmaps a dataset and clears it.
+//--------------------------------------------------------
+void polyfit_bin_close( polyfit_bin_t *pBin )
+{
+    if( (NULL != pBin) && (NULL != pBin->pMap) )
+    {
+        munmap( pBin->pMap, pBin->mapSize );
+        memset( pBin, 0, sizeof( *pBin ) );
+    }
+}
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// describeColumn()
+// Fills in a column descriptor, computing its min, max
+// and sum.
+//--------------------------------------------------------
+static void describeColumn( polyfit_bin_column_t *pColumn, const char *name, uint64_t offset,
+                            long pointCount, const double *pValues )
+{
+    double minimum = DBL_MAX;
+    double maximum = -DBL_MAX;
+    double sum = 0.0;
+
+    #pragma omp parallel for reduction(min:minimum) reduction(max:maximum) reduction(+:sum)
+    for( long i = 0; i < pointCount; i++ )
+    {
+        minimum = (pValues[i] < minimum) ? pValues[i] : minimum;
+        maximum = (pValues[i] > maximum) ? pValues[i] : maximum;
+        sum += pValues[i];
+    }
+
+    strncpy( pColumn->name, name, POLYFIT_BIN_NAME_SIZE - 1 );
+    pColumn->offset = offset;
+    pColumn->minimum = (pointCount > 0) ? minimum : 0.0;
+    pColumn->maximum = (pointCount > 0) ? maximum : 0.0;
+    pColumn->sum = sum;
+}
+
+//--------------------------------------------------------
+// writePadded()
+// Writes byteCount bytes, then zeros up to the column
+// alignment.
+//
+// Returns 0 if success, -5 if the write failed.
+//--------------------------------------------------------
+static int writePadded( FILE *pFile, const void *pData, size_t byteCount )
+{
+    static const char zeros[ POLYFIT_BIN_ALIGNMENT ] = { 0 };
+    size_t padCount = ALIGN_UP( byteCount ) - byteCount;
+
+    if( (byteCount > 0) && (1 != fwrite( pData, byteCount, 1, pFile )) )
+    {
+        return -5;
+    }
+    if( (padCount > 0) && (1 != fwrite( zeros, padCount, 1, pFile )) )
+    {
+        return -5;
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+// file: polyfit_bin.h
+// Description: Binary columnar dataset files for polynomial fitting.
+//
+// A dataset file is a 192-byte header followed by the x and y
+// columns as little-endian doubles, each column starting on a
+// 64-byte boundary.  polyfit_bin_load() maps the file and points
+// xValues and yValues straight into the mapping, so a fit can
+// start without parsing or copying anything.
+//
+//      offset  0   header: magic, version, columnCount, rowCount
+//      offset 64   2 column descriptors: name, offset, min, max, sum
+//      offset 192  x column, then y column, each padded to 64 bytes
+
+#ifndef POLYFIT_BIN_H
+#define POLYFIT_BIN_H
+
+#include <stddef.h>     // size_t
+#include <stdint.h>     // uint32_t, uint64_t
+
+// First 8 bytes of every dataset file.
+#define POLYFIT_BIN_MAGIC           "PFITBIN1"
+
+// Layout version written by polyfit_bin_write().
+#define POLYFIT_BIN_VERSION         (1)
+
+// Columns per file: x, then y.
+#define POLYFIT_BIN_COLUMN_COUNT    (2)
+
+// Column name size, with its terminator.
+#define POLYFIT_BIN_NAME_SIZE       (32)
+
+// Alignment of each column, in bytes.
+#define POLYFIT_BIN_ALIGNMENT       (64)
+
+// File name extension used for dataset files.
+#define POLYFIT_BIN_EXTENSION       ".pfb"
+
+// One column descriptor (64 bytes).
+typedef struct polyfit_bin_column_s
+{
+    char        name[ POLYFIT_BIN_NAME_SIZE ];
+    uint64_t    offset;         // Byte offset of the first value from the start of the file.
+    double      minimum;
+    double      maximum;
+    double      sum;
+} polyfit_bin_column_t;
+
+// File header (192 bytes).
+typedef struct polyfit_bin_header_s
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    columnCount;
+    uint64_t    rowCount;
+    uint8_t     reserved[40];
+    polyfit_bin_column_t columns[ POLYFIT_BIN_COLUMN_COUNT ];
+} polyfit_bin_header_t;
+
+// A mapped dataset.  xValues and yValues point into a read-only
+// mapping; writing through them faults.
+typedef struct polyfit_bin_s
+{
+    long        pointCount;
+    double      *xValues;
+    double      *yValues;
+    const polyfit_bin_header_t *pHeader;
+
+    void        *pMap;
+    size_t      mapSize;
+} polyfit_bin_t;
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_bin_write()
+// Writes pointCount x,y points to a dataset file, with the
+// given column names (NULL for "x" and "y") and statistics.
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -2 if pointCount < 0,
+//          -5 if the file can't be written.
+//--------------------------------------------------------
+int polyfit_bin_write( const char *fileName, long pointCount, const double *xValues, const double *yValues,
+                       const char *xName, const char *yName );
+
+//--------------------------------------------------------
+// polyfit_bin_load()
+// Maps a dataset file.  Nothing is read but the header;
+// pages of the columns are faulted in as a fit uses them.
+// Release it with polyfit_bin_close().
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -5 if the file can't be opened or mapped,
+//          -6 if it isn't a valid dataset file (or this
+//             machine isn't little-endian).
+//--------------------------------------------------------
+int polyfit_bin_load( const char *fileName, polyfit_bin_t *pBin );
+
+//--------------------------------------------------------
+// polyfit_bin_close()
+// Unmaps a dataset and clears it.
+//--------------------------------------------------------
+void polyfit_bin_close( polyfit_bin_t *pBin );
+
+
+#endif	// POLYFIT_BIN_H
@@ -0,0 +1,499 @@
+// Name: polyfit_csv.c
+// Description: Fast loader for two-column "x,y" CSV files.
+
+#include <fcntl.h>      // open()
+#include <stdint.h>     // uint64_t
+#include <stdio.h>      // NULL
+#include <stdlib.h>     // malloc(), strtod()
+#include <string.h>     // memchr(), memcpy(), memmove()
+#include <sys/mman.h>   // mmap()
+#include <sys/stat.h>   // fstat()
+#include <unistd.h>     // close()
+
+#include "polyfit_csv.h"
+#include <omp.h>
+
+// Chunks handed out per thread, so uneven lines still balance.
+#define CSV_CHUNKS_PER_THREAD   (4)
+
+// Smallest chunk worth a task of its own.
+#define CSV_MIN_CHUNK_BYTES     (64 * 1024)
+
+// Longest number copied out for the strtod() fallback.
+#define CSV_MAX_NUMBER_CHARS    (64)
+
+// Decimal digits that always fit in a uint64_t.
+#define CSV_MAX_MANTISSA_DIGITS (19)
+
+// One newline-aligned piece of the file.
+typedef struct csv_chunk_s
+{
+    const char  *pStart;
+    const char  *pEnd;
+    long        lineCount;      // Lines in the chunk; also the rows reserved for it.
+    long        rowOffset;      // First row reserved for the chunk.
+    long        parsedCount;
+    long        malformedCount;
+    int         reportedCount;
+    long        malformedLines[ POLYFIT_CSV_MAX_REPORTED ];
+} csv_chunk_t;
+
+// Powers of ten that are exact in a double.
+static const double exactPowersOf10[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+#define CSV_MAX_EXACT_POWER     ((int) (sizeof( exactPowersOf10 ) / sizeof( exactPowersOf10[0] )) - 1)
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static void     copyName( const char *pStart, const char *pEnd, char *pName );
+static long     countLines( const char *pStart, const char *pEnd );
+static int      isBlank( char c );
+static void     parseChunk( csv_chunk_t *pChunk, long firstLine, double *xValues, double *yValues );
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_csv_load()
+// Loads the "x,y" lines of a CSV file in parallel.
+//--------------------------------------------------------
+int polyfit_csv_load( const char *fileName, polyfit_csv_t *pCsv )
+{
+    if( (NULL == fileName) || (NULL == pCsv) )
+    {
+        return -1;
+    }
+    memset( pCsv, 0, sizeof( *pCsv ) );
+
+    int fd = open( fileName, O_RDONLY );
+    if( fd < 0 )
+    {
+        return -5;
+    }
+    struct stat fileStat;
+    if( 0 != fstat( fd, &fileStat ) )
+    {
+        close( fd );
+        return -5;
+    }
+
+    size_t fileSize = (size_t) fileStat.st_size;
+    const char *pFile = NULL;
+    if( fileSize > 0 )
+    {
+        void *pMap = mmap( NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if( MAP_FAILED == pMap )
+        {
+            close( fd );
+            return -5;
+        }
+        madvise( pMap, fileSize, MADV_WILLNEED );
+        pFile = (const char *) pMap;
+    }
+    close( fd );
+
+    // Skip the header line.
+    const char *pEnd = pFile + fileSize;
+    const char *pData = pEnd;
+    if( fileSize > 0 )
+    {
+        const char *pNewline = memchr( pFile, '\n', fileSize );
+        pData = (NULL == pNewline) ? pEnd : pNewline + 1;
+
+        const char *pHeaderEnd = (NULL == pNewline) ? pEnd : pNewline;
+        const char *pComma = memchr( pFile, ',', (size_t) (pHeaderEnd - pFile) );
+        if( NULL != pComma )
+        {
+            copyName( pFile, pComma, pCsv->xName );
+            copyName( pComma + 1, pHeaderEnd, pCsv->yName );
+        }
+    }
+
+    // Cut the data into chunks that each end just after a newline.
+    size_t dataSize = (size_t) (pEnd - pData);
+    int chunkCount = omp_get_max_threads() * CSV_CHUNKS_PER_THREAD;
+    if( (size_t) chunkCount > (dataSize / CSV_MIN_CHUNK_BYTES) )
+    {
+        chunkCount = (int) (dataSize / CSV_MIN_CHUNK_BYTES);
+    }
+    if( chunkCount < 1 )
+    {
+        chunkCount = 1;
+    }
+
+    csv_chunk_t *pChunks = calloc( chunkCount, sizeof( csv_chunk_t ) );
+    if( NULL == pChunks )
+    {
+        if( NULL != pFile )
+        {
+            munmap( (void *) pFile, fileSize );
+        }
+        return -3;
+    }
+
+    const char *pCut = pData;
+    for( int c = 0; c < chunkCount; c++ )
+    {
+        pChunks[c].pStart = pCut;
+        if( c == chunkCount - 1 )
+        {
+            pCut = pEnd;
+        }
+        else
+        {
+            const char *pTarget = pData + (dataSize * (c + 1)) / chunkCount;
+            if( pTarget > pCut )
+            {
+                const char *pNewline = memchr( pTarget, '\n', (size_t) (pEnd - pTarget) );
+                pCut = (NULL == pNewline) ? pEnd : pNewline + 1;
+            }
+        }
+        pChunks[c].pEnd = pCut;
+    }
+
+    // First pass: count lines, to size the arrays exactly once.
+    #pragma omp parallel for schedule(dynamic, 1)
+    for( int c = 0; c < chunkCount; c++ )
+    {
+        pChunks[c].lineCount = countLines( pChunks[c].pStart, pChunks[c].pEnd );
+    }
+
+    long lineTotal = 0;
+    for( int c = 0; c < chunkCount; c++ )
+    {
+        pChunks[c].rowOffset = lineTotal;
+        lineTotal += pChunks[c].lineCount;
+    }
+
+    double *xValues = malloc( (lineTotal > 0 ? lineTotal : 1) * sizeof( double ) );
+    double *yValues = malloc( (lineTotal > 0 ? lineTotal : 1) * sizeof( double ) );
+    if( (NULL == xValues) || (NULL == yValues) )
+    {
+        free( xValues );
+        free( yValues );
+        free( pChunks );
+        if( NULL != pFile )
+        {
+            munmap( (void *) pFile, fileSize );
+        }
+        return -3;
+    }
+
+    // Second pass: parse each chunk into its reserved rows.
+    // Line numbers are 1-based, and line 1 is the header.
+    #pragma omp parallel for schedule(dynamic, 1)
+    for( int c = 0; c < chunkCount; c++ )
+    {
+        parseChunk( &pChunks[c], 2 + pChunks[c].rowOffset, xValues, yValues );
+    }
+
+    // Close the gaps left by blank and malformed lines, and
+    // gather the malformed line numbers in file order.
+    long pointCount = 0;
+    for( int c = 0; c < chunkCount; c++ )
+    {
+        csv_chunk_t *pChunk = &pChunks[c];
+        if( pointCount != pChunk->rowOffset )
+        {
+            memmove( &xValues[ pointCount ], &xValues[ pChunk->rowOffset ], pChunk->parsedCount * sizeof( double ) );
+            memmove( &yValues[ pointCount ], &yValues[ pChunk->rowOffset ], pChunk->parsedCount * sizeof( double ) );
+        }
+        pointCount += pChunk->parsedCount;
+
+        for( int m = 0; (m < pChunk->reportedCount) && (pCsv->reportedCount < POLYFIT_CSV_MAX_REPORTED); m++ )
+        {
+            pCsv->malformedLines[ pCsv->reportedCount++ ] = pChunk->malformedLines[m];
+        }
+        pCsv->malformedCount += pChunk->malformedCount;
+    }
+
+    pCsv->pointCount = pointCount;
+    pCsv->xValues = xValues;
+    pCsv->yValues = yValues;
+
+    free( pChunks );
+    if( NULL != pFile )
+    {
+        munmap( (void *) pFile, fileSize );
+    }
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_csv_free()
+// Frees the arrays of a loaded file and clears it.
+//--------------------------------------------------------
+void polyfit_csv_free( polyfit_csv_t *pCsv )
+{
+    if( NULL != pCsv )
+    {
+        free( pCsv->xValues );
+        free( pCsv->yValues );
+        memset( pCsv, 0, sizeof( *pCsv ) );
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_csv_parse_double()
+// Parses a decimal number.  Up to 19 significant digits are
+// gathered into an integer; when that integer and the power
+// of ten are both exact in a double, one multiply or divide
+// gives the correctly rounded value.  Anything else (very
+// long mantissas, large exponents) is handed to strtod().
+//--------------------------------------------------------
+const char *polyfit_csv_parse_double( const char *pText, const char *pEnd, double *pValue )
+{
+    const char *p = pText;
+    while( (p < pEnd) && isBlank( *p ) )
+    {
+        p++;
+    }
+    const char *pNumber = p;
+
+    int negative = 0;
+    if( (p < pEnd) && (('-' == *p) || ('+' == *p)) )
+    {
+        negative = ('-' == *p);
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int mantissaDigits = 0;
+    int digitCount = 0;
+    int exponent = 0;
+    int exact = 1;
+
+    while( (p < pEnd) && (*p >= '0') && (*p <= '9') )
+    {
+        if( mantissaDigits < CSV_MAX_MANTISSA_DIGITS )
+        {
+            mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+            mantissaDigits += (mantissa > 0);
+        }
+        else
+        {
+            exponent++;
+            exact = 0;
+        }
+        digitCount++;
+        p++;
+    }
+    if( (p < pEnd) && ('.' == *p) )
+    {
+        p++;
+        while( (p < pEnd) && (*p >= '0') && (*p <= '9') )
+        {
+            if( mantissaDigits < CSV_MAX_MANTISSA_DIGITS )
+            {
+                mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+                mantissaDigits += (mantissa > 0);
+                exponent--;
+            }
+            else
+            {
+                exact = 0;
+            }
+            digitCount++;
+            p++;
+        }
+    }
+    if( 0 == digitCount )
+    {
+        return NULL;
+    }
+
+    if( (p < pEnd) && (('e' == *p) || ('E' == *p)) )
+    {
+        const char *pExponent = p + 1;
+        int exponentNegative = 0;
+        if( (pExponent < pEnd) && (('-' == *pExponent) || ('+' == *pExponent)) )
+        {
+            exponentNegative = ('-' == *pExponent);
+            pExponent++;
+        }
+        if( (pExponent < pEnd) && (*pExponent >= '0') && (*pExponent <= '9') )
+        {
+            int written = 0;
+            while( (pExponent < pEnd) && (*pExponent >= '0') && (*pExponent <= '9') )
+            {
+                if( written < 100000 )
+                {
+                    written = written * 10 + (*pExponent - '0');
+                }
+                pExponent++;
+            }
+            exponent += exponentNegative ? -written : written;
+            p = pExponent;
+        }
+    }
+
+    double value;
+    if( exact && (mantissa <= ((uint64_t) 1 << 53)) &&
+        (exponent >= -CSV_MAX_EXACT_POWER) && (exponent <= CSV_MAX_EXACT_POWER) )
+    {
+        value = (double) mantissa;
+        value = (exponent < 0) ? (value / exactPowersOf10[ -exponent ]) : (value * exactPowersOf10[ exponent ]);
+        value = negative ? -value : value;
+    }
+    else
+    {
+        char buffer[ CSV_MAX_NUMBER_CHARS + 1 ];
+        size_t length = (size_t) (p - pNumber);
+        if( length > CSV_MAX_NUMBER_CHARS )
+        {
+            return NULL;
+        }
+        memcpy( buffer, pNumber, length );
+        buffer[ length ] = '\0';
+        value = strtod( buffer, NULL );
+    }
+
+    *pValue = value;
+    return p;
+}
+
+//--------------------------------------------------------
+// polyfit_csv_parse_line()
+// Parses "x,y" from one line, allowing blanks around the
+// values.
+//--------------------------------------------------------
+int polyfit_csv_parse_line( const char *pLine, const char *pEnd, double *pX, double *pY )
+{
+    const char *p = pLine;
+    while( (p < pEnd) && isBlank( *p ) )
+    {
+        p++;
+    }
+    if( p == pEnd )
+    {
+        return 0;
+    }
+
+    p = polyfit_csv_parse_double( p, pEnd, pX );
+    while( (NULL != p) && (p < pEnd) && isBlank( *p ) )
+    {
+        p++;
+    }
+    if( (NULL == p) || (p == pEnd) || (',' != *p) )
+    {
+        return -1;
+    }
+
+    p = polyfit_csv_parse_double( p + 1, pEnd, pY );
+    while( (NULL != p) && (p < pEnd) && isBlank( *p ) )
+    {
+        p++;
+    }
+    if( (NULL == p) || (p != pEnd) )
+    {
+        return -1;
+    }
+    return 1;
+}
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// copyName()
+// Copies a header field, without surrounding blanks, into
+// a POLYFIT_CSV_NAME_SIZE buffer.
+//--------------------------------------------------------
+static void copyName( const char *pStart, const char *pEnd, char *pName )
+{
+    while( (pStart < pEnd) && isBlank( *pStart ) )
+    {
+        pStart++;
+    }
+    while( (pEnd > pStart) && isBlank( pEnd[-1] ) )
+    {
+        pEnd--;
+    }
+
+    size_t length = (size_t) (pEnd - pStart);
+    if( length > POLYFIT_CSV_NAME_SIZE - 1 )
+    {
+        length = POLYFIT_CSV_NAME_SIZE - 1;
+    }
+    memcpy( pName, pStart, length );
+    pName[ length ] = '\0';
+}
+
+//--------------------------------------------------------
+// countLines()
+// Counts the lines in [pStart, pEnd), including a last
+// line that has no newline.
+//--------------------------------------------------------
+static long countLines( const char *pStart, const char *pEnd )
+{
+    long lineCount = 0;
+    const char *p = pStart;
+    while( p < pEnd )
+    {
+        const char *pNewline = memchr( p, '\n', (size_t) (pEnd - p) );
+        lineCount++;
+        if( NULL == pNewline )
+        {
+            break;
+        }
+        p = pNewline + 1;
+    }
+    return lineCount;
+}
+
+//--------------------------------------------------------
+// isBlank()
+// Returns nonzero for a space, tab or carriage return.
+//--------------------------------------------------------
+static int isBlank( char c )
+{
+    return (' ' == c) || ('\t' == c) || ('\r' == c);
+}
+
+//--------------------------------------------------------
+// parseChunk()
+// Parses the lines of one chunk into the rows starting at
+// pChunk->rowOffset.  firstLine is the file line number of
+// the chunk's first line.
+//--------------------------------------------------------
+static void parseChunk( csv_chunk_t *pChunk, long firstLine, double *xValues, double *yValues )
+{
+    double *pX = &xValues[ pChunk->rowOffset ];
+    double *pY = &yValues[ pChunk->rowOffset ];
+    long row = 0;
+    long lineNumber = firstLine;
+
+    const char *p = pChunk->pStart;
+    while( p < pChunk->pEnd )
+    {
+        const char *pNewline = memchr( p, '\n', (size_t) (pChunk->pEnd - p) );
+        const char *pLineEnd = (NULL == pNewline) ? pChunk->pEnd : pNewline;
+
+        int parsed = polyfit_csv_parse_line( p, pLineEnd, &pX[ row ], &pY[ row ] );
+        if( parsed > 0 )
+        {
+            row++;
+        }
+        else if( parsed < 0 )
+        {
+            if( pChunk->reportedCount < POLYFIT_CSV_MAX_REPORTED )
+            {
+                pChunk->malformedLines[ pChunk->reportedCount++ ] = lineNumber;
+            }
+            pChunk->malformedCount++;
+        }
+
+        lineNumber++;
+        p = pLineEnd + 1;
+    }
+    pChunk->parsedCount = row;
+}
@@ -0,0 +1,82 @@
+// file: polyfit_csv.h
+// Description: Fast loader for two-column "x,y" CSV files.
+//
+// The file is memory mapped and cut at newline boundaries into
+// chunks that are parsed in parallel with a hand-written number
+// parser.  Lines are counted first, so the x and y arrays are
+// allocated once at their final size.  Lines that don't hold two
+// numbers are skipped and reported by count and line number.
+
+#ifndef POLYFIT_CSV_H
+#define POLYFIT_CSV_H
+
+// Most malformed line numbers kept in a polyfit_csv_t.
+#define POLYFIT_CSV_MAX_REPORTED    (16)
+
+// Longest column name kept from the header, with its terminator.
+#define POLYFIT_CSV_NAME_SIZE       (32)
+
+// A loaded file.
+typedef struct polyfit_csv_s
+{
+    long    pointCount;
+    double  *xValues;       // malloc()ed, pointCount values
+    double  *yValues;       // malloc()ed, pointCount values
+    char    xName[ POLYFIT_CSV_NAME_SIZE ];     // Header names, truncated if need be.
+    char    yName[ POLYFIT_CSV_NAME_SIZE ];
+
+    long    malformedCount;                                 // Lines skipped as malformed.
+    int     reportedCount;                                  // Entries used in malformedLines.
+    long    malformedLines[ POLYFIT_CSV_MAX_REPORTED ];     // First malformed line numbers, 1-based.
+} polyfit_csv_t;
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_csv_load()
+// Loads every "x,y" line of a CSV file after the first
+// (header) line.  Blank lines are ignored, and carriage
+// returns and blanks around the values are allowed.
+//
+// On success, release the arrays with polyfit_csv_free()
+// (or free() each of them).
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -3 if unable to allocate memory,
+//          -5 if the file can't be opened or mapped.
+//--------------------------------------------------------
+int polyfit_csv_load( const char *fileName, polyfit_csv_t *pCsv );
+
+//--------------------------------------------------------
+// polyfit_csv_free()
+// Frees the arrays of a loaded file and clears it.
+//--------------------------------------------------------
+void polyfit_csv_free( polyfit_csv_t *pCsv );
+
+//--------------------------------------------------------
+// polyfit_csv_parse_double()
+// Parses a decimal number ("-12.5", "3e-4", ...) starting
+// at pText, not reading at or past pEnd.  Leading blanks
+// are skipped.
+//
+// Returns a pointer just past the number, or NULL if
+// there isn't one.
+//--------------------------------------------------------
+const char *polyfit_csv_parse_double( const char *pText, const char *pEnd, double *pValue );
+
+//--------------------------------------------------------
+// polyfit_csv_parse_line()
+// Parses "x,y" from a line that ends at pEnd (the newline
+// is not included).
+//
+// Returns 1 if the line held two numbers, 0 if it is
+// blank, -1 if it is malformed.
+//--------------------------------------------------------
+int polyfit_csv_parse_line( const char *pLine, const char *pEnd, double *pX, double *pY );
+
+
+#endif	// POLYFIT_CSV_H
@@ -0,0 +1,421 @@
+// Name: polyfit_ex.c
+// Description: One entry point for every fit engine.
+
+#include <stdbool.h>    // bool
+#include <stdio.h>      // NULL
+#include <string.h>     // memset()
+
+#include "polyfit.h"
+#include "polyfit_ex.h"
+#include "polyfit_mixed.h"
+#include "polyfit_ortho.h"
+#include "polyfit_qr.h"
+#include "polyfit_stats.h"
+#include "polyfit_sums.h"
+#include "polyfit_tune.h"
+#include "openMP_polyfit.h"
+#include "pthreads_polyfit.h"
+#include <omp.h>
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static int  resolveOptions( int pointCount, int coefficientCount, const polyfit_options_t *pOptions,
+                            polyfit_backend_t *pBackend, int *pThreadCount );
+static int  runFit( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults,
+                    const polyfit_options_t *pOptions, polyfit_backend_t backend, int threadCount,
+                    polyfit_mixed_report_t *pMixed, polyfit_stats_t *pStats );
+static int  runMatrixFit( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults,
+                          polyfit_workspace_t *pWorkspace, polyfit_backend_t backend, int threadCount,
+                          polyfit_stats_t *pStats );
+static void     attachCounters( polyfit_perf_t *pPerf, polyfit_backend_t backend, int threadCount );
+
+
+// Indexed by polyfit_backend_t.
+static const char *backendNames[ POLYFIT_BACKEND_COUNT ] =
+{
+    "auto", "serial", "openmp", "pthreads", "simd"
+};
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_options_defaults()
+// Fills in the default options.
+//--------------------------------------------------------
+void polyfit_options_defaults( polyfit_options_t *pOptions )
+{
+    if( NULL != pOptions )
+    {
+        memset( pOptions, 0, sizeof( *pOptions ) );
+        pOptions->backend = POLYFIT_BACKEND_AUTO;
+        pOptions->threadCount = 0;
+        pOptions->precision = POLYFIT_PRECISION_DOUBLE;
+        pOptions->solver = POLYFIT_SOLVER_NORMAL;
+        pOptions->pWorkspace = NULL;
+        pOptions->pPerf = NULL;
+        pOptions->xMin = 0.0;
+        pOptions->xMax = 0.0;
+        pOptions->refinements = 0;
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_ex()
+// Resolves the backend and thread count and runs the fit
+// on them.  It is only timed when there is a pResult to
+// report to.
+//--------------------------------------------------------
+int polyfit_ex( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults,
+                const polyfit_options_t *pOptions, polyfit_result_t *pResult )
+{
+    polyfit_options_t options;
+    polyfit_result_t result;
+    polyfit_backend_t backend = POLYFIT_BACKEND_SERIAL;
+    int threadCount = 1;
+    int rVal = 0;
+
+    memset( &result, 0, sizeof( result ) );
+    if( NULL == pOptions )
+    {
+        polyfit_options_defaults( &options );
+        pOptions = &options;
+    }
+
+    // Check that the input pointers aren't null.
+    if( (NULL == xValues) || (NULL == yValues) || (NULL == coefficientResults) )
+    {
+        rVal = -1;
+    }
+    // Check that pointCount >= coefficientCount.
+    else if( (coefficientCount <= 0) || (pointCount < coefficientCount) )
+    {
+        rVal = -2;
+    }
+    else
+    {
+        rVal = resolveOptions( pointCount, coefficientCount, pOptions, &backend, &threadCount );
+    }
+
+    if( 0 == rVal )
+    {
+        polyfit_stats_t *pStats = (NULL != pResult) ? &result.stats : NULL;
+        long long startTime = (NULL != pResult) ? polyfit_stats_now() : 0;
+#ifndef POLYFIT_NO_STATS
+        result.stats.pointCount = pointCount;
+        result.stats.threadCount = threadCount;
+        result.stats.pPerf = pOptions->pPerf;
+#endif  // POLYFIT_NO_STATS
+
+        rVal = runFit( pointCount, xValues, yValues, coefficientCount, coefficientResults,
+                       pOptions, backend, threadCount, &result.mixed, pStats );
+
+        result.backend = backend;
+        result.threadCount = threadCount;
+        if( NULL != pResult )
+        {
+            long long elapsed = polyfit_stats_now() - startTime;
+            result.seconds = elapsed / 1e9;
+        }
+    }
+
+    result.status = rVal;
+    if( NULL != pResult )
+    {
+        *pResult = result;
+    }
+    return rVal;
+}
+
+//--------------------------------------------------------
+// polyfit_backend_name()
+// Returns the name of a backend.
+//--------------------------------------------------------
+const char *polyfit_backend_name( polyfit_backend_t backend )
+{
+    if( (backend < POLYFIT_BACKEND_AUTO) || (backend >= POLYFIT_BACKEND_COUNT) )
+    {
+        return "unknown";
+    }
+    return backendNames[ backend ];
+}
+
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// resolveOptions()
+// Checks the options and picks the backend and thread
+// count the fit will actually run on.
+//
+// AUTO takes the profile's class for the fit's size, if
+// there is one.  Otherwise it takes the SIMD power sums
+// when the normal equations fit in a polyfit_sums_t, and
+// the matrix fit if not; either way on one thread below
+// the profile's parallelPoints and on all of them above.
+//
+// Returns 0 if success, -2 if the options are out of range
+// or not available together, -3 if the pthreads pool
+// can't be started.
+//--------------------------------------------------------
+static int resolveOptions( int pointCount, int coefficientCount, const polyfit_options_t *pOptions,
+                           polyfit_backend_t *pBackend, int *pThreadCount )
+{
+    polyfit_backend_t backend = pOptions->backend;
+    int threadCount = pOptions->threadCount;
+
+    if( (backend < POLYFIT_BACKEND_AUTO) || (backend >= POLYFIT_BACKEND_COUNT) ||
+        (pOptions->precision < POLYFIT_PRECISION_DOUBLE) || (pOptions->precision >= POLYFIT_PRECISION_COUNT) ||
+        (pOptions->solver < POLYFIT_SOLVER_NORMAL) || (pOptions->solver >= POLYFIT_SOLVER_COUNT) ||
+        (pOptions->refinements < 0) )
+    {
+        return -2;
+    }
+
+    // Mixed precision is its own normal equation solver.
+    if( (POLYFIT_PRECISION_MIXED == pOptions->precision) && (POLYFIT_SOLVER_NORMAL != pOptions->solver) )
+    {
+        return -2;
+    }
+
+    // Everything but the double precision normal equations
+    // runs on OpenMP threads.
+    bool isOpenMPOnly = (POLYFIT_PRECISION_DOUBLE != pOptions->precision) || (POLYFIT_SOLVER_NORMAL != pOptions->solver);
+
+    if( POLYFIT_BACKEND_AUTO == backend )
+    {
+        const polyfit_tune_t *pTune = polyfit_tune();
+        const polyfit_tune_class_t *pClass = NULL;
+
+        if( !isOpenMPOnly )
+        {
+            pClass = polyfit_tune_lookup( pTune, pointCount, coefficientCount );
+        }
+        if( (NULL != pClass) && (POLYFIT_BACKEND_SIMD == pClass->backend) && (coefficientCount > POLYFIT_MAX_COEFFICIENTS) )
+        {
+            pClass = NULL;
+        }
+
+        if( NULL != pClass )
+        {
+            backend = pClass->backend;
+            if( threadCount < 1 )
+            {
+                threadCount = pClass->threadCount;
+            }
+        }
+        else
+        {
+            int maxThreads = (threadCount > 0) ? threadCount : omp_get_max_threads();
+            bool isParallel = (pointCount >= pTune->parallelPoints) && (maxThreads > 1);
+
+            if( isOpenMPOnly || (coefficientCount > POLYFIT_MAX_COEFFICIENTS) )
+            {
+                backend = isParallel ? POLYFIT_BACKEND_OPENMP : POLYFIT_BACKEND_SERIAL;
+            }
+            else
+            {
+                backend = POLYFIT_BACKEND_SIMD;
+            }
+            threadCount = isParallel ? maxThreads : 1;
+        }
+    }
+
+    switch( backend )
+    {
+    case POLYFIT_BACKEND_SERIAL:
+        threadCount = 1;
+        break;
+
+    case POLYFIT_BACKEND_OPENMP:
+        if( threadCount < 1 )
+        {
+            threadCount = omp_get_max_threads();
+        }
+        break;
+
+    case POLYFIT_BACKEND_PTHREADS:
+        if( isOpenMPOnly )
+        {
+            return -2;
+        }
+        // A team of the shared pool's first threads; resizing
+        // the pool is left to pthreads_polyfit_set_threads().
+        if( (threadCount < 1) || (threadCount > pthreads_polyfit_threads()) )
+        {
+            threadCount = pthreads_polyfit_threads();
+        }
+        if( threadCount < 1 )
+        {
+            return -3;
+        }
+        break;
+
+    case POLYFIT_BACKEND_SIMD:
+        if( !isOpenMPOnly && (coefficientCount > POLYFIT_MAX_COEFFICIENTS) )
+        {
+            return -2;
+        }
+        if( isOpenMPOnly || (threadCount < 1) )
+        {
+            threadCount = 1;
+        }
+        break;
+
+    default:
+        return -2;
+    }
+
+    *pBackend = backend;
+    *pThreadCount = threadCount;
+    return 0;
+}
+
+//--------------------------------------------------------
+// runFit()
+// Runs the fit on a resolved backend.  The OpenMP engines
+// run with the thread count set for the calling thread,
+// which is put back afterwards.  Any counters are moved to
+// the threads about to run before the clock starts.
+//--------------------------------------------------------
+static int runFit( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults,
+                   const polyfit_options_t *pOptions, polyfit_backend_t backend, int threadCount,
+                   polyfit_mixed_report_t *pMixed, polyfit_stats_t *pStats )
+{
+    int rVal = 0;
+    int savedThreads = omp_get_max_threads();
+
+    if( (POLYFIT_BACKEND_PTHREADS != backend) && (threadCount != savedThreads) )
+    {
+        omp_set_num_threads( threadCount );
+    }
+
+    if( (NULL != pStats) && (NULL != pStats->pPerf) )
+    {
+        attachCounters( pStats->pPerf, backend, threadCount );
+    }
+    POLYFIT_STATS_BEGIN( pStats, POLYFIT_PHASE_TOTAL );
+
+    if( POLYFIT_PRECISION_MIXED == pOptions->precision )
+    {
+        rVal = polyfit_mixed( pointCount, xValues, yValues, coefficientCount, coefficientResults,
+                              pOptions->xMin, pOptions->xMax, pOptions->refinements, POLYFIT_MIXED_TOLERANCE, pMixed );
+    }
+    else if( POLYFIT_SOLVER_QR == pOptions->solver )
+    {
+        rVal = polyfit_qr( pointCount, xValues, yValues, coefficientCount, coefficientResults );
+    }
+    else if( POLYFIT_SOLVER_ORTHO == pOptions->solver )
+    {
+        rVal = polyfit_ortho( pointCount, xValues, yValues, coefficientCount, coefficientResults );
+    }
+    else if( POLYFIT_BACKEND_SIMD == backend )
+    {
+        // One pass over x and y; the phases aren't split.  Per
+        // point: 2k-2 multiplies for the powers, k for y * x^p,
+        // and 3k-1 adds.
+        POLYFIT_STATS_BEGIN( pStats, POLYFIT_PHASE_PRODUCT );
+        if( 1 == threadCount )
+        {
+            rVal = polyfit_stream( pointCount, xValues, yValues, coefficientCount, coefficientResults );
+        }
+        else
+        {
+            rVal = openmp_polyfit_stream( pointCount, xValues, yValues, coefficientCount, coefficientResults );
+        }
+        POLYFIT_STATS_END( pStats, POLYFIT_PHASE_PRODUCT, 2 * (long long) pointCount * sizeof( double ),
+                           (long long) pointCount * (6 * coefficientCount - 3) );
+    }
+    else if( NULL != pOptions->pWorkspace )
+    {
+        rVal = runMatrixFit( pointCount, xValues, yValues, coefficientCount, coefficientResults,
+                             pOptions->pWorkspace, backend, threadCount, pStats );
+    }
+    else
+    {
+        // One allocation for the whole fit, freed on every path.
+        polyfit_workspace_t *pWorkspace = polyfit_workspace_create( pointCount, coefficientCount, threadCount );
+        if( NULL == pWorkspace )
+        {
+            rVal = -3;
+        }
+        else
+        {
+            rVal = runMatrixFit( pointCount, xValues, yValues, coefficientCount, coefficientResults,
+                                 pWorkspace, backend, threadCount, pStats );
+            polyfit_workspace_destroy( pWorkspace );
+        }
+    }
+
+    POLYFIT_STATS_END( pStats, POLYFIT_PHASE_TOTAL, 0, 0 );
+    if( (POLYFIT_BACKEND_PTHREADS != backend) && (threadCount != savedThreads) )
+    {
+        omp_set_num_threads( savedThreads );
+    }
+    return rVal;
+}
+
+//--------------------------------------------------------
+// runMatrixFit()
+// Runs one of the A, (AT)A, (AT)b fits in pWorkspace; the
+// pthreads fit on a team of threadCount.
+//--------------------------------------------------------
+static int runMatrixFit( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults,
+                         polyfit_workspace_t *pWorkspace, polyfit_backend_t backend, int threadCount,
+                         polyfit_stats_t *pStats )
+{
+    switch( backend )
+    {
+    case POLYFIT_BACKEND_SERIAL:
+        return polyfit_ws( pWorkspace, pointCount, xValues, yValues, coefficientCount, coefficientResults, pStats );
+
+    case POLYFIT_BACKEND_OPENMP:
+        return openmp_polyfit_ws( pWorkspace, pointCount, xValues, yValues, coefficientCount, coefficientResults, pStats );
+
+    case POLYFIT_BACKEND_PTHREADS:
+        return pthreads_polyfit_team_ws( pWorkspace, threadCount, pointCount, xValues, yValues, coefficientCount,
+                                         coefficientResults, pStats );
+
+    default:
+        return -2;
+    }
+}
+
+//--------------------------------------------------------
+// attachCounters()
+// Points pPerf at the threads the backend runs on: the
+// pthreads pool, the OpenMP team, or just the caller.  If
+// counters aren't permitted the fit is only timed.
+//--------------------------------------------------------
+static void attachCounters( polyfit_perf_t *pPerf, polyfit_backend_t backend, int threadCount )
+{
+    int threadIds[ POLYFIT_PERF_MAX_THREADS ];
+    int idCount = 1;
+
+    if( POLYFIT_BACKEND_PTHREADS == backend )
+    {
+        // The team is the pool's first threadCount threads.
+        idCount = pthreads_polyfit_thread_ids( threadIds, POLYFIT_PERF_MAX_THREADS );
+        idCount = (idCount > threadCount) ? threadCount : idCount;
+    }
+    else if( threadCount > 1 )
+    {
+        idCount = openmp_polyfit_thread_ids( threadIds, POLYFIT_PERF_MAX_THREADS );
+    }
+    else
+    {
+        threadIds[0] = polyfit_perf_thread_id();
+    }
+
+    if( idCount > 0 )
+    {
+        polyfit_perf_attach( pPerf, threadIds, idCount );
+    }
+}
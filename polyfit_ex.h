@@ -0,0 +1,123 @@
+// file: polyfit_ex.h
+// Description: One entry point for every fit engine.
+//
+// polyfit_ex() runs a fit on the backend, thread count, precision and
+// solver named in a polyfit_options_t, and reports what it actually
+// ran and how long it took in a polyfit_result_t.  polyfit(),
+// openmp_polyfit() and pthreads_polyfit() are wrappers around it.
+
+#ifndef POLYFIT_EX_H
+#define POLYFIT_EX_H
+
+#include "polyfit_mixed.h"
+#include "polyfit_perf.h"
+#include "polyfit_stats.h"
+#include "polyfit_workspace.h"
+
+// Below this many points POLYFIT_BACKEND_AUTO stays on one thread;
+// forking threads costs more than it saves.  A tuning profile
+// (polyfit_tune.h) replaces this with a measured value.
+#define POLYFIT_AUTO_PARALLEL_POINTS    (32768)
+
+// Who runs the fit.
+typedef enum polyfit_backend_e
+{
+    POLYFIT_BACKEND_AUTO = 0,   // The tuning profile's choice, else SIMD on one thread for small
+                                // inputs and all threads for large ones.
+    POLYFIT_BACKEND_SERIAL,     // polyfit_ws(): builds A, (AT)A and (AT)b on one thread.
+    POLYFIT_BACKEND_OPENMP,     // openmp_polyfit_ws(): the same, on OpenMP threads.
+    POLYFIT_BACKEND_PTHREADS,   // pthreads_polyfit_ws(): the same, on the pthreads pool.
+    POLYFIT_BACKEND_SIMD,       // Single pass of vectorized power sums, no A; one thread unless threadCount
+                                // asks for more (polyfit_stream(), openmp_polyfit_stream()).
+    POLYFIT_BACKEND_COUNT
+} polyfit_backend_t;
+
+// Arithmetic the sums are accumulated in.
+typedef enum polyfit_precision_e
+{
+    POLYFIT_PRECISION_DOUBLE = 0,
+    POLYFIT_PRECISION_MIXED,    // polyfit_mixed(): float sums, refined in double if asked.
+    POLYFIT_PRECISION_COUNT
+} polyfit_precision_t;
+
+// How the least squares problem is solved.
+typedef enum polyfit_solver_e
+{
+    POLYFIT_SOLVER_NORMAL = 0,  // Cholesky on the normal equations.
+    POLYFIT_SOLVER_QR,          // polyfit_qr(): TSQR of A.
+    POLYFIT_SOLVER_ORTHO,       // polyfit_ortho(): orthogonal polynomial basis.
+    POLYFIT_SOLVER_COUNT
+} polyfit_solver_t;
+
+// What to run.  Start from polyfit_options_defaults().
+//
+// POLYFIT_PRECISION_MIXED and the QR and ORTHO solvers run on OpenMP
+// threads; with them the SERIAL and SIMD backends mean one thread and
+// the PTHREADS backend is not available.
+typedef struct polyfit_options_s
+{
+    polyfit_backend_t   backend;
+    int                 threadCount;    // < 1 for the backend's default.
+    polyfit_precision_t precision;
+    polyfit_solver_t    solver;
+    polyfit_workspace_t *pWorkspace;    // Scratch for the matrix backends, or NULL to allocate one per call.
+    polyfit_perf_t      *pPerf;         // Hardware counters to add each phase to, or NULL.  Needs a pResult.
+    double              xMin;           // Range of x, if known (xMin < xMax), so POLYFIT_PRECISION_MIXED
+    double              xMax;           // needn't pass over x to find it; else 0 and 0.
+    int                 refinements;    // POLYFIT_PRECISION_MIXED: most refinement steps, each a pass over
+                                        // the points in double; 0 for the float fit alone.
+} polyfit_options_t;
+
+// What was run.
+typedef struct polyfit_result_s
+{
+    int                 status;         // polyfit_ex()'s return value.
+    polyfit_backend_t   backend;        // Backend used; never AUTO once status is 0.
+    int                 threadCount;    // Threads the backend ran on.
+    double              seconds;        // Wall time of the fit.
+    polyfit_mixed_report_t mixed;       // Filled for POLYFIT_PRECISION_MIXED.
+    polyfit_stats_t     stats;          // Per-phase time and bytes; zero under POLYFIT_NO_STATS.
+} polyfit_result_t;
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_options_defaults()
+// Fills pOptions with the AUTO backend, default threads,
+// double precision, the normal equations, no workspace or
+// counters, no x range and no refinement.
+//--------------------------------------------------------
+void polyfit_options_defaults( polyfit_options_t *pOptions );
+
+//--------------------------------------------------------
+// polyfit_ex()
+// Same contract as polyfit(), run as pOptions says (NULL
+// for the defaults).  pResult may be NULL.
+//
+// A threadCount given for the PTHREADS backend runs the
+// fit on that many of its shared pool's threads (at most
+// the pool size); the pool itself is resized only by
+// pthreads_polyfit_set_threads().
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -2 if (pointCount < coefficientCount), an option
+//             is out of range, or the options name a
+//             combination that isn't available,
+//          -3 if unable to allocate memory,
+//          -4 if the equations are numerically singular.
+//--------------------------------------------------------
+int polyfit_ex( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults,
+                const polyfit_options_t *pOptions, polyfit_result_t *pResult );
+
+//--------------------------------------------------------
+// polyfit_backend_name()
+// Returns the name of a backend ("auto", "serial", ...).
+//--------------------------------------------------------
+const char *polyfit_backend_name( polyfit_backend_t backend );
+
+
+#endif	// POLYFIT_EX_H
@@ -0,0 +1,985 @@
+// Name: polyfit_index.c
+// Description: Range-query fit index over points sorted by x, with
+//              prefix sums of the normal equations' power sums.
+
+#include <math.h>       // fabs(), isfinite()
+#include <stdbool.h>    // bool
+#include <stdio.h>      // NULL
+#include <stdlib.h>     // malloc(), realloc(), qsort()
+#include <string.h>     // memset(), memcpy()
+
+#include "polyfit_index.h"
+#include "polyfit_solve.h"
+#include "polyfit_sums.h"
+#include <omp.h>
+
+// Most sums per prefix: 2 * degree + 1 powers of t, then
+// degree + 1 of y * t.
+#define MAX_STRIDE  (POLYFIT_POWER_SUM_COUNT( POLYFIT_MAX_COEFFICIENTS ) + POLYFIT_MAX_COEFFICIENTS)
+
+// Levels of blocks over the segments: 2^47 segments of
+// POLYFIT_INDEX_SEGMENT points is far past any index.
+#define MAX_LEVELS  (48)
+
+// A block node: t's shift and scale, then the sums.
+#define NODE_HEADER (2)
+
+// How far past [-1, 1] the last segment's t may run, as
+// appends widen it, before it is framed again.
+#define REFRAME_LIMIT   (2.0)
+
+// One point, for sorting.
+typedef struct
+{
+    double  x;
+    double  y;
+} Point;
+
+struct polyfit_index_s
+{
+    int     coefficientCount;       // Most terms a fit can have.
+    int     stride;                 // Sums per prefix.
+    long    pointCount;             // Sorted points.
+    long    capacity;
+    double  *xValues;               // Sorted by x.
+    double  *yValues;
+    double  *pPrefix;               // Row i: the sums over point i and those
+                                    // before it in its segment.
+    double  *segmentShift;          // t = (x - shift) * scale in each segment.
+    double  *segmentScale;
+    long    blockedCount;           // Leading segments whose blocks are built.
+    double  *pBlocks[ MAX_LEVELS ]; // Level l, node j: the sums over segments
+                                    // j * 2^l up to (j + 1) * 2^l, in t framed
+                                    // on their x range.
+    double  tail[ MAX_STRIDE ];     // The last row, and its compensation, to
+    double  tailError[ MAX_STRIDE ];    // go on from when appending.
+    long    pendingCount;           // Points not yet in the prefixes, sorted by x.
+    long    pendingCapacity;
+    double  *pendingX;
+    double  *pendingY;
+};
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static int  build( polyfit_index_t *pIndex, Point *pPoints, long pointCount );
+static int  sortPoints( Point *pPoints, long pointCount );
+static int  comparePoints( const void *pLeft, const void *pRight );
+static void mergeRuns( const Point *pSource, long left, long middle, long right, Point *pDest );
+static int  reserve( polyfit_index_t *pIndex, long capacity );
+static int  reservePending( polyfit_index_t *pIndex, long capacity );
+static void mergePending( polyfit_index_t *pIndex, Point *pPoints, long pointCount );
+static int  rebuild( polyfit_index_t *pIndex );
+static void frameSegment( polyfit_index_t *pIndex, long segment );
+static double *blockNode( const polyfit_index_t *pIndex, int level, long block );
+static void completeSegment( polyfit_index_t *pIndex, long segment );
+static void combineBlock( polyfit_index_t *pIndex, int level, long block );
+static void addSpan( const polyfit_index_t *pIndex, int degree, long first, long end, double shift, double scale,
+                     double *sums );
+static void pointTerms( const polyfit_index_t *pIndex, double x, double y, double shift, double scale,
+                        double *terms );
+static void addMoved( const polyfit_index_t *pIndex, int degree, const double *local, double alpha, double beta,
+                      double *sums );
+static long lowerBound( const double *xValues, long count, double x, bool isAfterEqual );
+static bool isAllFinite( int pointCount, const double *xValues );
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_index_create()
+// Copies the points into pairs, sorts them and builds the
+// prefixes.
+//--------------------------------------------------------
+int polyfit_index_create( int pointCount, const double *xValues, const double *yValues, int maxCoefficientCount,
+                          polyfit_index_t **ppIndex )
+{
+    if( (NULL == xValues) || (NULL == yValues) || (NULL == ppIndex) )
+    {
+        return -1;
+    }
+    *ppIndex = NULL;
+    if( (pointCount < 1) || (maxCoefficientCount < 1) || (maxCoefficientCount > POLYFIT_MAX_COEFFICIENTS) ||
+        !isAllFinite( pointCount, xValues ) )
+    {
+        return -2;
+    }
+
+    polyfit_index_t *pIndex = (polyfit_index_t *) calloc( 1, sizeof( polyfit_index_t ) );
+    Point *pPoints = (Point *) malloc( (size_t) pointCount * sizeof( Point ) );
+    if( (NULL == pIndex) || (NULL == pPoints) )
+    {
+        free( pIndex );
+        free( pPoints );
+        return -3;
+    }
+    pIndex->coefficientCount = maxCoefficientCount;
+    pIndex->stride = POLYFIT_POWER_SUM_COUNT( maxCoefficientCount ) + maxCoefficientCount;
+
+    #pragma omp parallel for schedule( static )
+    for( int i = 0; i < pointCount; i++ )
+    {
+        pPoints[i].x = xValues[i];
+        pPoints[i].y = yValues[i];
+    }
+
+    int rVal = build( pIndex, pPoints, pointCount );
+    free( pPoints );
+    if( 0 != rVal )
+    {
+        polyfit_index_destroy( pIndex );
+        return rVal;
+    }
+    *ppIndex = pIndex;
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_index_destroy()
+// Frees the index and everything it holds.
+//--------------------------------------------------------
+void polyfit_index_destroy( polyfit_index_t *pIndex )
+{
+    if( NULL != pIndex )
+    {
+        free( pIndex->xValues );
+        free( pIndex->yValues );
+        free( pIndex->pPrefix );
+        free( pIndex->segmentShift );
+        free( pIndex->segmentScale );
+        for( int level = 0; level < MAX_LEVELS; level++ )
+        {
+            free( pIndex->pBlocks[ level ] );
+        }
+        free( pIndex->pendingX );
+        free( pIndex->pendingY );
+        free( pIndex );
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_index_append()
+// The leading points that keep x sorted extend the
+// prefixes; once one doesn't, it and the rest are sorted
+// and merged into the pending list.  Room for both is made
+// first, so a failed allocation changes nothing.
+//
+// A new segment is framed on the points of this call that
+// will fill it.  A segment that fills up is framed again on
+// its own x range if it isn't already, and the last one as
+// soon as its t runs past REFRAME_LIMIT; its range has
+// doubled by then, so that costs O(1) a point amortized.
+// A segment is added to the blocks once it is full and
+// framed for good: O(1) blocks a segment amortized.
+//--------------------------------------------------------
+int polyfit_index_append( polyfit_index_t *pIndex, int pointCount, const double *xValues, const double *yValues )
+{
+    if( (NULL == pIndex) || (NULL == xValues) || (NULL == yValues) )
+    {
+        return -1;
+    }
+    if( (pointCount < 0) || !isAllFinite( pointCount, xValues ) )
+    {
+        return -2;
+    }
+
+    int sortedCount = 0;
+    if( 0 == pIndex->pendingCount )
+    {
+        double lastX = pIndex->xValues[ pIndex->pointCount - 1 ];
+        while( (sortedCount < pointCount) && (xValues[ sortedCount ] >= lastX) )
+        {
+            lastX = xValues[ sortedCount ];
+            sortedCount++;
+        }
+    }
+
+    int unsortedCount = pointCount - sortedCount;
+    Point *pUnsorted = NULL;
+    if( unsortedCount > 0 )
+    {
+        pUnsorted = (Point *) malloc( (size_t) unsortedCount * sizeof( Point ) );
+    }
+    if( ((unsortedCount > 0) && (NULL == pUnsorted)) ||
+        (0 != reserve( pIndex, pIndex->pointCount + sortedCount )) ||
+        (0 != reservePending( pIndex, pIndex->pendingCount + unsortedCount )) )
+    {
+        free( pUnsorted );
+        return -3;
+    }
+
+    double terms[ MAX_STRIDE ];
+    for( int i = 0; i < sortedCount; i++ )
+    {
+        long n = pIndex->pointCount;
+        long segment = n / POLYFIT_INDEX_SEGMENT;
+        double *pRow = &pIndex->pPrefix[ (size_t) n * pIndex->stride ];
+
+        if( 0 == (n % POLYFIT_INDEX_SEGMENT) )
+        {
+            long first = n - POLYFIT_INDEX_SEGMENT;
+            double width = pIndex->xValues[ n - 1 ] - pIndex->xValues[ first ];
+            double fullScale = (width > 0.0) ? (2.0 / width) : 1.0;
+            if( (pIndex->segmentShift[ segment - 1 ] != 0.5 * (pIndex->xValues[ first ] + pIndex->xValues[ n - 1 ])) ||
+                (pIndex->segmentScale[ segment - 1 ] != fullScale) )
+            {
+                frameSegment( pIndex, segment - 1 );
+            }
+            if( segment - 1 >= pIndex->blockedCount )
+            {
+                completeSegment( pIndex, segment - 1 );
+            }
+
+            // Frame the new segment on this call's points for
+            // it, or at the scale of the one before if only
+            // one x.
+            int last = (sortedCount - i < POLYFIT_INDEX_SEGMENT) ? (sortedCount - 1) : (i + POLYFIT_INDEX_SEGMENT - 1);
+            pIndex->segmentShift[ segment ] = 0.5 * (xValues[i] + xValues[ last ]);
+            pIndex->segmentScale[ segment ] = (xValues[ last ] > xValues[i]) ? (2.0 / (xValues[ last ] - xValues[i]))
+                                                                              : pIndex->segmentScale[ segment - 1 ];
+            memset( pIndex->tail, 0, sizeof( pIndex->tail ) );
+            memset( pIndex->tailError, 0, sizeof( pIndex->tailError ) );
+        }
+
+        pointTerms( pIndex, xValues[i], yValues[i], pIndex->segmentShift[ segment ],
+                    pIndex->segmentScale[ segment ], terms );
+        for( int p = 0; p < pIndex->stride; p++ )
+        {
+            polyfit_add_compensated( &pIndex->tail[p], &pIndex->tailError[p], terms[p] );
+            pRow[p] = pIndex->tail[p] + pIndex->tailError[p];
+        }
+        pIndex->xValues[n] = xValues[i];
+        pIndex->yValues[n] = yValues[i];
+        pIndex->pointCount++;
+    }
+    for( int i = 0; i < unsortedCount; i++ )
+    {
+        pUnsorted[i].x = xValues[ sortedCount + i ];
+        pUnsorted[i].y = yValues[ sortedCount + i ];
+    }
+    if( unsortedCount > 0 )
+    {
+        mergePending( pIndex, pUnsorted, unsortedCount );
+    }
+    free( pUnsorted );
+
+    if( sortedCount > 0 )
+    {
+        long segment = (pIndex->pointCount - 1) / POLYFIT_INDEX_SEGMENT;
+        double t = (pIndex->xValues[ pIndex->pointCount - 1 ] - pIndex->segmentShift[ segment ]) *
+                   pIndex->segmentScale[ segment ];
+        if( fabs( t ) > REFRAME_LIMIT )
+        {
+            frameSegment( pIndex, segment );
+        }
+    }
+
+    long pendingLimit = pIndex->pointCount / POLYFIT_INDEX_PENDING_SHARE;
+    if( pIndex->pendingCount > ((pendingLimit > POLYFIT_INDEX_MIN_PENDING) ? pendingLimit : POLYFIT_INDEX_MIN_PENDING) )
+    {
+        // If there's no memory to rebuild, the pending list
+        // just stays, and queries still see it.
+        rebuild( pIndex );
+    }
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_index_fit()
+// Sums the range in u, t centered and scaled on the
+// range's own points: from the points for a short range,
+// else from the prefixes of the segments at either end
+// and the blocks that tile the segments between, each
+// moved from its own t.  Then solves like
+// polyfit_sums_solve() and rewrites the result in x.
+//--------------------------------------------------------
+int polyfit_index_fit( const polyfit_index_t *pIndex, double xLow, double xHigh, int coefficientCount,
+                       double *coefficientResults, long *pPointCount )
+{
+    double sums[ MAX_STRIDE ];
+    double terms[ MAX_STRIDE ];
+    double ata[ POLYFIT_MAX_COEFFICIENTS * POLYFIT_MAX_COEFFICIENTS ];
+    double atb[ POLYFIT_MAX_COEFFICIENTS ];
+    double inU[ POLYFIT_MAX_COEFFICIENTS ];
+
+    if( (NULL == pIndex) || (NULL == coefficientResults) )
+    {
+        return -1;
+    }
+    if( NULL != pPointCount )
+    {
+        *pPointCount = 0;
+    }
+    if( (coefficientCount < 1) || (coefficientCount > pIndex->coefficientCount) || !(xLow <= xHigh) )
+    {
+        return -2;
+    }
+
+    // The range's points, and their x extent.
+    long low = lowerBound( pIndex->xValues, pIndex->pointCount, xLow, false );
+    long high = lowerBound( pIndex->xValues, pIndex->pointCount, xHigh, true );
+    long pendingLow = lowerBound( pIndex->pendingX, pIndex->pendingCount, xLow, false );
+    long pendingHigh = lowerBound( pIndex->pendingX, pIndex->pendingCount, xHigh, true );
+    long count = (high - low) + (pendingHigh - pendingLow);
+    double xMin = (high > low) ? pIndex->xValues[ low ] : xHigh;
+    double xMax = (high > low) ? pIndex->xValues[ high - 1 ] : xLow;
+    if( pendingHigh > pendingLow )
+    {
+        xMin = (pIndex->pendingX[ pendingLow ] < xMin) ? pIndex->pendingX[ pendingLow ] : xMin;
+        xMax = (pIndex->pendingX[ pendingHigh - 1 ] > xMax) ? pIndex->pendingX[ pendingHigh - 1 ] : xMax;
+    }
+    if( NULL != pPointCount )
+    {
+        *pPointCount = count;
+    }
+    if( count < coefficientCount )
+    {
+        return -2;
+    }
+
+    int degree = coefficientCount - 1;
+    double shift = 0.5 * (xMin + xMax);
+    double scale = (xMax > xMin) ? (2.0 / (xMax - xMin)) : 1.0;
+    memset( sums, 0, sizeof( sums ) );
+
+    if( high - low <= 2 * POLYFIT_INDEX_SEGMENT )
+    {
+        for( long i = low; i < high; i++ )
+        {
+            pointTerms( pIndex, pIndex->xValues[i], pIndex->yValues[i], shift, scale, terms );
+            for( int p = 0; p < pIndex->stride; p++ )
+            {
+                sums[p] += terms[p];
+            }
+        }
+    }
+    else
+    {
+        // More than two segments' points, so the first and
+        // last segments differ, and every one between them
+        // is full and in the blocks.
+        long firstSegment = low / POLYFIT_INDEX_SEGMENT;
+        long lastSegment = (high - 1) / POLYFIT_INDEX_SEGMENT;
+        addSpan( pIndex, degree, low, (firstSegment + 1) * POLYFIT_INDEX_SEGMENT, shift, scale, sums );
+        addSpan( pIndex, degree, lastSegment * POLYFIT_INDEX_SEGMENT, high, shift, scale, sums );
+
+        // Segments [left, right) level by level: at most two
+        // blocks a level.
+        long left = firstSegment + 1;
+        long right = lastSegment;
+        for( int level = 0; left < right; level++ )
+        {
+            if( left & 1 )
+            {
+                const double *pNode = blockNode( pIndex, level, left++ );
+                addMoved( pIndex, degree, &pNode[ NODE_HEADER ], scale / pNode[1], (pNode[0] - shift) * scale, sums );
+            }
+            if( right & 1 )
+            {
+                const double *pNode = blockNode( pIndex, level, --right );
+                addMoved( pIndex, degree, &pNode[ NODE_HEADER ], scale / pNode[1], (pNode[0] - shift) * scale, sums );
+            }
+            left >>= 1;
+            right >>= 1;
+        }
+    }
+
+    for( long i = pendingLow; i < pendingHigh; i++ )
+    {
+        pointTerms( pIndex, pIndex->pendingX[i], pIndex->pendingY[i], shift, scale, terms );
+        for( int p = 0; p < pIndex->stride; p++ )
+        {
+            sums[p] += terms[p];
+        }
+    }
+
+    // Hankel structure, as in polyfit_sums_build(); the
+    // sums of y * u^p follow the powers of u.
+    const double *sumUY = &sums[ POLYFIT_POWER_SUM_COUNT( pIndex->coefficientCount ) ];
+    for( int r = 0; r < coefficientCount; r++ )
+    {
+        for( int c = 0; c < coefficientCount; c++ )
+        {
+            ata[ r * coefficientCount + c ] = sums[ 2 * degree - r - c ];
+        }
+        atb[r] = sumUY[ degree - r ];
+    }
+
+    int rVal = polyfit_solve_normal( coefficientCount, ata, atb, inU );
+    if( 0 != rVal )
+    {
+        return rVal;
+    }
+    polyfit_unscale( coefficientCount, shift, scale, inU, coefficientResults );
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_index_count()
+// Returns the points held, sorted and pending.
+//--------------------------------------------------------
+long polyfit_index_count( const polyfit_index_t *pIndex )
+{
+    return (NULL == pIndex) ? 0 : (pIndex->pointCount + pIndex->pendingCount);
+}
+
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// build()
+// Sorts pPoints and makes them the index's points, then
+// frames each segment and builds the blocks over the full
+// ones, a level at a time, spread over threads.
+//
+// Returns 0 if success, -3 if unable to allocate memory
+// (the index is left as it was).
+//--------------------------------------------------------
+static int build( polyfit_index_t *pIndex, Point *pPoints, long pointCount )
+{
+    if( (0 != sortPoints( pPoints, pointCount )) || (0 != reserve( pIndex, pointCount )) )
+    {
+        return -3;
+    }
+    pIndex->pointCount = pointCount;
+    long segmentCount = (pointCount + POLYFIT_INDEX_SEGMENT - 1) / POLYFIT_INDEX_SEGMENT;
+
+    #pragma omp parallel for schedule( static )
+    for( long segment = 0; segment < segmentCount; segment++ )
+    {
+        long first = segment * POLYFIT_INDEX_SEGMENT;
+        long end = (first + POLYFIT_INDEX_SEGMENT < pointCount) ? (first + POLYFIT_INDEX_SEGMENT) : pointCount;
+
+        for( long i = first; i < end; i++ )
+        {
+            pIndex->xValues[i] = pPoints[i].x;
+            pIndex->yValues[i] = pPoints[i].y;
+        }
+        frameSegment( pIndex, segment );
+    }
+
+    pIndex->blockedCount = pointCount / POLYFIT_INDEX_SEGMENT;
+    #pragma omp parallel for schedule( static )
+    for( long segment = 0; segment < pIndex->blockedCount; segment++ )
+    {
+        double *pNode = blockNode( pIndex, 0, segment );
+        pNode[0] = pIndex->segmentShift[ segment ];
+        pNode[1] = pIndex->segmentScale[ segment ];
+        memcpy( &pNode[ NODE_HEADER ],
+                &pIndex->pPrefix[ (size_t) ((segment + 1) * POLYFIT_INDEX_SEGMENT - 1) * pIndex->stride ],
+                pIndex->stride * sizeof( double ) );
+    }
+    for( int level = 1; (level < MAX_LEVELS) && ((pIndex->blockedCount >> level) > 0); level++ )
+    {
+        #pragma omp parallel for schedule( static )
+        for( long block = 0; block < (pIndex->blockedCount >> level); block++ )
+        {
+            combineBlock( pIndex, level, block );
+        }
+    }
+    return 0;
+}
+
+//--------------------------------------------------------
+// sortPoints()
+// Sorts by x (then y, so the order doesn't depend on the
+// thread count): each thread sorts a run with qsort(),
+// then runs are merged pairwise, in parallel, until one
+// is left.
+//
+// Returns 0 if success, -3 if unable to allocate memory.
+//--------------------------------------------------------
+static int sortPoints( Point *pPoints, long pointCount )
+{
+    Point *pTemp = (Point *) malloc( (size_t) pointCount * sizeof( Point ) );
+    if( NULL == pTemp )
+    {
+        return -3;
+    }
+
+    long run = (pointCount + omp_get_max_threads() - 1) / omp_get_max_threads();
+    run = (run > 0) ? run : 1;
+
+    #pragma omp parallel for schedule( static )
+    for( long start = 0; start < pointCount; start += run )
+    {
+        long count = (pointCount - start < run) ? (pointCount - start) : run;
+        qsort( &pPoints[ start ], count, sizeof( Point ), comparePoints );
+    }
+
+    Point *pSource = pPoints;
+    Point *pDest = pTemp;
+    for( long width = run; width < pointCount; width *= 2 )
+    {
+        #pragma omp parallel for schedule( static )
+        for( long left = 0; left < pointCount; left += 2 * width )
+        {
+            long middle = (left + width < pointCount) ? (left + width) : pointCount;
+            long right = (left + 2 * width < pointCount) ? (left + 2 * width) : pointCount;
+            mergeRuns( pSource, left, middle, right, pDest );
+        }
+
+        Point *pSwap = pSource;
+        pSource = pDest;
+        pDest = pSwap;
+    }
+
+    if( pSource != pPoints )
+    {
+        memcpy( pPoints, pSource, (size_t) pointCount * sizeof( Point ) );
+    }
+    free( pTemp );
+    return 0;
+}
+
+//--------------------------------------------------------
+// comparePoints()
+// qsort() order: by x, then by y.
+//--------------------------------------------------------
+static int comparePoints( const void *pLeft, const void *pRight )
+{
+    const Point *pA = (const Point *) pLeft;
+    const Point *pB = (const Point *) pRight;
+
+    if( pA->x != pB->x )
+    {
+        return (pA->x < pB->x) ? -1 : 1;
+    }
+    return (pA->y < pB->y) ? -1 : ((pA->y > pB->y) ? 1 : 0);
+}
+
+//--------------------------------------------------------
+// mergeRuns()
+// Merges the sorted runs pSource[left .. middle) and
+// pSource[middle .. right) into pDest[left .. right).
+//--------------------------------------------------------
+static void mergeRuns( const Point *pSource, long left, long middle, long right, Point *pDest )
+{
+    long i = left;
+    long j = middle;
+
+    for( long out = left; out < right; out++ )
+    {
+        if( (j >= right) || ((i < middle) && (comparePoints( &pSource[i], &pSource[j] ) <= 0)) )
+        {
+            pDest[ out ] = pSource[ i++ ];
+        }
+        else
+        {
+            pDest[ out ] = pSource[ j++ ];
+        }
+    }
+}
+
+//--------------------------------------------------------
+// reserve()
+// Makes room for capacity sorted points, their prefixes,
+// segments and blocks, growing by at least half to keep appends
+// amortized O(1).
+//
+// Returns 0 if success, -3 if unable to allocate memory.
+//--------------------------------------------------------
+static int reserve( polyfit_index_t *pIndex, long capacity )
+{
+    if( capacity <= pIndex->capacity )
+    {
+        return 0;
+    }
+    if( capacity < pIndex->capacity + pIndex->capacity / 2 )
+    {
+        capacity = pIndex->capacity + pIndex->capacity / 2;
+    }
+
+    // Each array is kept as soon as it has grown, so a
+    // failure part way leaves them all usable.
+    double *pX = (double *) realloc( pIndex->xValues, (size_t) capacity * sizeof( double ) );
+    if( NULL == pX )
+    {
+        return -3;
+    }
+    pIndex->xValues = pX;
+
+    double *pY = (double *) realloc( pIndex->yValues, (size_t) capacity * sizeof( double ) );
+    if( NULL == pY )
+    {
+        return -3;
+    }
+    pIndex->yValues = pY;
+
+    double *pPrefix = (double *) realloc( pIndex->pPrefix, (size_t) capacity * pIndex->stride * sizeof( double ) );
+    if( NULL == pPrefix )
+    {
+        return -3;
+    }
+    pIndex->pPrefix = pPrefix;
+
+    long segmentCount = (capacity + POLYFIT_INDEX_SEGMENT - 1) / POLYFIT_INDEX_SEGMENT;
+    double *pShift = (double *) realloc( pIndex->segmentShift, (size_t) segmentCount * sizeof( double ) );
+    if( NULL == pShift )
+    {
+        return -3;
+    }
+    pIndex->segmentShift = pShift;
+
+    double *pScale = (double *) realloc( pIndex->segmentScale, (size_t) segmentCount * sizeof( double ) );
+    if( NULL == pScale )
+    {
+        return -3;
+    }
+    pIndex->segmentScale = pScale;
+
+    for( int level = 0; (level < MAX_LEVELS) && ((segmentCount >> level) > 0); level++ )
+    {
+        double *pBlocks = (double *) realloc( pIndex->pBlocks[ level ],
+                                              (size_t) (segmentCount >> level) * (NODE_HEADER + pIndex->stride) *
+                                              sizeof( double ) );
+        if( NULL == pBlocks )
+        {
+            return -3;
+        }
+        pIndex->pBlocks[ level ] = pBlocks;
+    }
+    pIndex->capacity = capacity;
+    return 0;
+}
+
+//--------------------------------------------------------
+// reservePending()
+// Makes room for capacity pending points, like reserve().
+//
+// Returns 0 if success, -3 if unable to allocate memory.
+//--------------------------------------------------------
+static int reservePending( polyfit_index_t *pIndex, long capacity )
+{
+    if( capacity <= pIndex->pendingCapacity )
+    {
+        return 0;
+    }
+    if( capacity < pIndex->pendingCapacity + pIndex->pendingCapacity / 2 )
+    {
+        capacity = pIndex->pendingCapacity + pIndex->pendingCapacity / 2;
+    }
+
+    double *pX = (double *) realloc( pIndex->pendingX, (size_t) capacity * sizeof( double ) );
+    if( NULL == pX )
+    {
+        return -3;
+    }
+    pIndex->pendingX = pX;
+
+    double *pY = (double *) realloc( pIndex->pendingY, (size_t) capacity * sizeof( double ) );
+    if( NULL == pY )
+    {
+        return -3;
+    }
+    pIndex->pendingY = pY;
+    pIndex->pendingCapacity = capacity;
+    return 0;
+}
+
+//--------------------------------------------------------
+// mergePending()
+// Sorts pPoints and merges them into the pending list,
+// from the back so nothing is overwritten before it is
+// moved.  The room must have been reserved.
+//--------------------------------------------------------
+static void mergePending( polyfit_index_t *pIndex, Point *pPoints, long pointCount )
+{
+    long i = pIndex->pendingCount - 1;
+    long j = pointCount - 1;
+
+    qsort( pPoints, pointCount, sizeof( Point ), comparePoints );
+    for( long out = pIndex->pendingCount + pointCount - 1; j >= 0; out-- )
+    {
+        if( (i >= 0) && (pIndex->pendingX[i] > pPoints[j].x) )
+        {
+            pIndex->pendingX[ out ] = pIndex->pendingX[i];
+            pIndex->pendingY[ out ] = pIndex->pendingY[i];
+            i--;
+        }
+        else
+        {
+            pIndex->pendingX[ out ] = pPoints[j].x;
+            pIndex->pendingY[ out ] = pPoints[j].y;
+            j--;
+        }
+    }
+    pIndex->pendingCount += pointCount;
+}
+
+//--------------------------------------------------------
+// rebuild()
+// Builds the index again from its sorted and pending
+// points together, emptying the pending list.
+//
+// Returns 0 if success, -3 if unable to allocate memory
+// (the index is left as it was).
+//--------------------------------------------------------
+static int rebuild( polyfit_index_t *pIndex )
+{
+    long total = pIndex->pointCount + pIndex->pendingCount;
+    Point *pPoints = (Point *) malloc( (size_t) total * sizeof( Point ) );
+    if( NULL == pPoints )
+    {
+        return -3;
+    }
+
+    for( long i = 0; i < pIndex->pointCount; i++ )
+    {
+        pPoints[i].x = pIndex->xValues[i];
+        pPoints[i].y = pIndex->yValues[i];
+    }
+    for( long i = 0; i < pIndex->pendingCount; i++ )
+    {
+        pPoints[ pIndex->pointCount + i ].x = pIndex->pendingX[i];
+        pPoints[ pIndex->pointCount + i ].y = pIndex->pendingY[i];
+    }
+
+    int rVal = build( pIndex, pPoints, total );
+    if( 0 == rVal )
+    {
+        pIndex->pendingCount = 0;
+    }
+    free( pPoints );
+    return rVal;
+}
+
+//--------------------------------------------------------
+// frameSegment()
+// Centers and scales a segment's t on its own points' x
+// range and fills in its prefixes with compensated sums;
+// the last segment also leaves them in the tail.
+//--------------------------------------------------------
+static void frameSegment( polyfit_index_t *pIndex, long segment )
+{
+    int stride = pIndex->stride;
+    long first = segment * POLYFIT_INDEX_SEGMENT;
+    long end = (first + POLYFIT_INDEX_SEGMENT < pIndex->pointCount) ? (first + POLYFIT_INDEX_SEGMENT)
+                                                                    : pIndex->pointCount;
+    double xMin = pIndex->xValues[ first ];
+    double xMax = pIndex->xValues[ end - 1 ];
+    double shift = 0.5 * (xMin + xMax);
+    double scale = (xMax > xMin) ? (2.0 / (xMax - xMin)) : 1.0;
+    double sum[ MAX_STRIDE ] = { 0 };
+    double error[ MAX_STRIDE ] = { 0 };
+    double terms[ MAX_STRIDE ];
+
+    pIndex->segmentShift[ segment ] = shift;
+    pIndex->segmentScale[ segment ] = scale;
+    for( long i = first; i < end; i++ )
+    {
+        double *pRow = &pIndex->pPrefix[ (size_t) i * stride ];
+
+        pointTerms( pIndex, pIndex->xValues[i], pIndex->yValues[i], shift, scale, terms );
+        for( int p = 0; p < stride; p++ )
+        {
+            polyfit_add_compensated( &sum[p], &error[p], terms[p] );
+            pRow[p] = sum[p] + error[p];
+        }
+    }
+
+    if( end == pIndex->pointCount )
+    {
+        memcpy( pIndex->tail, sum, sizeof( sum ) );
+        memcpy( pIndex->tailError, error, sizeof( error ) );
+    }
+}
+
+//--------------------------------------------------------
+// blockNode()
+// Returns the node of a block: shift, scale, then the
+// sums.
+//--------------------------------------------------------
+static double *blockNode( const polyfit_index_t *pIndex, int level, long block )
+{
+    return &pIndex->pBlocks[ level ][ (size_t) block * (NODE_HEADER + pIndex->stride) ];
+}
+
+//--------------------------------------------------------
+// completeSegment()
+// Adds a full, framed segment to the blocks: its own node,
+// then each block it is the last segment of.
+//--------------------------------------------------------
+static void completeSegment( polyfit_index_t *pIndex, long segment )
+{
+    double *pNode = blockNode( pIndex, 0, segment );
+
+    pNode[0] = pIndex->segmentShift[ segment ];
+    pNode[1] = pIndex->segmentScale[ segment ];
+    memcpy( &pNode[ NODE_HEADER ],
+            &pIndex->pPrefix[ (size_t) ((segment + 1) * POLYFIT_INDEX_SEGMENT - 1) * pIndex->stride ],
+            pIndex->stride * sizeof( double ) );
+    for( int level = 1; (level < MAX_LEVELS) && (0 == ((segment + 1) & ((1L << level) - 1))); level++ )
+    {
+        combineBlock( pIndex, level, ((segment + 1) >> level) - 1 );
+    }
+    pIndex->blockedCount = segment + 1;
+}
+
+//--------------------------------------------------------
+// combineBlock()
+// Fills a block's node from its two halves one level
+// down, moved onto t framed on the block's x range.
+//--------------------------------------------------------
+static void combineBlock( polyfit_index_t *pIndex, int level, long block )
+{
+    long first = (block << level) * POLYFIT_INDEX_SEGMENT;
+    long last = ((block + 1) << level) * POLYFIT_INDEX_SEGMENT - 1;
+    double xMin = pIndex->xValues[ first ];
+    double xMax = pIndex->xValues[ last ];
+    double shift = 0.5 * (xMin + xMax);
+    double scale = (xMax > xMin) ? (2.0 / (xMax - xMin)) : 1.0;
+    double *pNode = blockNode( pIndex, level, block );
+
+    pNode[0] = shift;
+    pNode[1] = scale;
+    memset( &pNode[ NODE_HEADER ], 0, pIndex->stride * sizeof( double ) );
+    for( long half = 2 * block; half <= 2 * block + 1; half++ )
+    {
+        const double *pHalf = blockNode( pIndex, level - 1, half );
+        addMoved( pIndex, pIndex->coefficientCount - 1, &pHalf[ NODE_HEADER ], scale / pHalf[1],
+                  (pHalf[0] - shift) * scale, &pNode[ NODE_HEADER ] );
+    }
+}
+
+//--------------------------------------------------------
+// addSpan()
+// Adds the sums of the points first up to end, all in one
+// segment, from the difference of its prefixes moved onto
+// u = (x - shift) * scale.
+//--------------------------------------------------------
+static void addSpan( const polyfit_index_t *pIndex, int degree, long first, long end, double shift, double scale,
+                     double *sums )
+{
+    double local[ MAX_STRIDE ];
+    long segment = first / POLYFIT_INDEX_SEGMENT;
+    long segmentStart = segment * POLYFIT_INDEX_SEGMENT;
+    const double *pLast = &pIndex->pPrefix[ (size_t) (end - 1) * pIndex->stride ];
+    const double *pBefore = &pIndex->pPrefix[ (size_t) (first - 1) * pIndex->stride ];
+
+    for( int p = 0; p < pIndex->stride; p++ )
+    {
+        local[p] = (first > segmentStart) ? (pLast[p] - pBefore[p]) : pLast[p];
+    }
+    addMoved( pIndex, degree, local, scale / pIndex->segmentScale[ segment ],
+              (pIndex->segmentShift[ segment ] - shift) * scale, sums );
+}
+
+//--------------------------------------------------------
+// pointTerms()
+// Writes one point's contribution to every sum of a
+// prefix, with t = (x - shift) * scale: t^p for p = 0 ..
+// 2 * degree, then y * t^p for p = 0 .. degree.
+//--------------------------------------------------------
+static void pointTerms( const polyfit_index_t *pIndex, double x, double y, double shift, double scale,
+                        double *terms )
+{
+    int degree = pIndex->coefficientCount - 1;
+    double *pTY = &terms[ POLYFIT_POWER_SUM_COUNT( pIndex->coefficientCount ) ];
+    double t = (x - shift) * scale;
+    double power = 1.0;
+
+    for( int p = 0; p <= 2 * degree; p++ )
+    {
+        terms[p] = power;
+        if( p <= degree )
+        {
+            pTY[p] = y * power;
+        }
+        power *= t;
+    }
+}
+
+//--------------------------------------------------------
+// addMoved()
+// Adds sums of a segment's t to sums of u = alpha * t +
+// beta, for a fit of the given degree:
+//      sum u^m = sum over q of C(m, q) alpha^q beta^(m-q) sum t^q
+// and the same for y * u^m.
+//--------------------------------------------------------
+static void addMoved( const polyfit_index_t *pIndex, int degree, const double *local, double alpha, double beta,
+                      double *sums )
+{
+    int yOffset = POLYFIT_POWER_SUM_COUNT( pIndex->coefficientCount );
+    double alphaPow[ POLYFIT_POWER_SUM_COUNT( POLYFIT_MAX_COEFFICIENTS ) ];
+    double betaPow[ POLYFIT_POWER_SUM_COUNT( POLYFIT_MAX_COEFFICIENTS ) ];
+
+    alphaPow[0] = 1.0;
+    betaPow[0] = 1.0;
+    for( int p = 1; p <= 2 * degree; p++ )
+    {
+        alphaPow[p] = alphaPow[ p - 1 ] * alpha;
+        betaPow[p] = betaPow[ p - 1 ] * beta;
+    }
+
+    for( int m = 0; m <= 2 * degree; m++ )
+    {
+        double sumU = 0.0;
+        double sumUY = 0.0;
+        double binomial = 1.0;      // C(m, q)
+
+        for( int q = 0; q <= m; q++ )
+        {
+            double factor = binomial * alphaPow[q] * betaPow[ m - q ];
+            sumU += factor * local[q];
+            if( m <= degree )
+            {
+                sumUY += factor * local[ yOffset + q ];
+            }
+            binomial = binomial * (m - q) / (q + 1);
+        }
+        sums[m] += sumU;
+        if( m <= degree )
+        {
+            sums[ yOffset + m ] += sumUY;
+        }
+    }
+}
+
+//--------------------------------------------------------
+// lowerBound()
+// Returns the first i with xValues[i] >= x, or with
+// xValues[i] > x if isAfterEqual; count if there is none.
+//--------------------------------------------------------
+static long lowerBound( const double *xValues, long count, double x, bool isAfterEqual )
+{
+    long low = 0;
+    long high = count;
+
+    while( low < high )
+    {
+        long middle = low + (high - low) / 2;
+        bool isBefore = isAfterEqual ? (xValues[ middle ] <= x) : (xValues[ middle ] < x);
+        if( isBefore )
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+//--------------------------------------------------------
+// isAllFinite()
+// True if no x is infinite or NaN.
+//--------------------------------------------------------
+static bool isAllFinite( int pointCount, const double *xValues )
+{
+    for( int i = 0; i < pointCount; i++ )
+    {
+        if( !isfinite( xValues[i] ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
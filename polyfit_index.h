@@ -0,0 +1,110 @@
+// file: polyfit_index.h
+// Description: Index for MLS fits of any x range of a dataset, from
+//              prefix power sums.
+//
+// Built once, the index holds the points sorted by x, so the points
+// with x in a range are a contiguous run of them.  The sorted points
+// are cut into segments of POLYFIT_INDEX_SEGMENT, and within each
+// segment every point has the prefix sums of t^p and y * t^p the
+// normal equations need (see polyfit_sums.h), with t centered and
+// scaled on the segment's own x range.  Above the full segments is
+// a tree of blocks, as a segment tree: block j of level l holds the
+// sums of segments j * 2^l up to (j + 1) * 2^l, with t framed on
+// their x range.  A range's sums are a difference of two prefixes in
+// each of its end segments plus the blocks that tile the segments
+// between, at most two a level, each moved binomially onto t
+// centered on the range itself: O(log n) moves of O(k^2) before the
+// coefficientCount x coefficientCount solve, however many points the
+// range covers.  A range of at most two segments' points is summed
+// from the points directly.
+//
+// Keeping the sums per segment and block, each in its own t, bounds
+// their rounding by their own points' sums rather than the whole
+// dataset's, so a range is fitted about as accurately as polyfit()
+// of its points would be.
+//
+// Points can be appended.  Those beyond the largest x already held
+// just extend the last segment, or start new ones; a segment joins
+// the blocks once it is full.  Others are sorted into a pending list
+// that queries bisect, adding the pending points in their range one
+// by one, and merged in with a rebuild once it grows past
+// POLYFIT_INDEX_PENDING_SHARE of the index.
+
+#ifndef POLYFIT_INDEX_H
+#define POLYFIT_INDEX_H
+
+// Sorted points per segment.
+#define POLYFIT_INDEX_SEGMENT           (4096)
+
+// Pending points allowed, as 1 / this of the points indexed
+// (at least POLYFIT_INDEX_MIN_PENDING), before a rebuild.
+#define POLYFIT_INDEX_PENDING_SHARE     (64)
+#define POLYFIT_INDEX_MIN_PENDING       (1024)
+
+typedef struct polyfit_index_s polyfit_index_t;
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_index_create()
+// Sorts a copy of the points and builds their prefix sums
+// for fits of up to maxCoefficientCount terms, on OpenMP
+// threads.  Memory is about (3 * maxCoefficientCount + 1)
+// doubles per point.
+//
+// Returns   0 if success, with *ppIndex set,
+//          -1 if passed a NULL pointer,
+//          -2 if pointCount < 1, maxCoefficientCount is
+//             out of range, or an x isn't finite,
+//          -3 if unable to allocate memory.
+//--------------------------------------------------------
+int polyfit_index_create( int pointCount, const double *xValues, const double *yValues, int maxCoefficientCount,
+                          polyfit_index_t **ppIndex );
+
+//--------------------------------------------------------
+// polyfit_index_destroy()
+// Frees an index.
+//--------------------------------------------------------
+void polyfit_index_destroy( polyfit_index_t *pIndex );
+
+//--------------------------------------------------------
+// polyfit_index_append()
+// Adds pointCount points.
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -2 if pointCount is negative or an x isn't
+//             finite,
+//          -3 if unable to allocate memory (the index is
+//             left as it was).
+//--------------------------------------------------------
+int polyfit_index_append( polyfit_index_t *pIndex, int pointCount, const double *xValues, const double *yValues );
+
+//--------------------------------------------------------
+// polyfit_index_fit()
+// Fits the points with xLow <= x <= xHigh with
+// coefficientCount terms, highest power first.  The number
+// of points fitted goes to *pPointCount, which may be NULL.
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -2 if coefficientCount is out of range for the
+//             index, xLow > xHigh, or the range holds fewer
+//             points than coefficients,
+//          -4 if the equations are numerically singular.
+//--------------------------------------------------------
+int polyfit_index_fit( const polyfit_index_t *pIndex, double xLow, double xHigh, int coefficientCount,
+                       double *coefficientResults, long *pPointCount );
+
+//--------------------------------------------------------
+// polyfit_index_count()
+// Returns the number of points held, or 0 if pIndex is
+// NULL.
+//--------------------------------------------------------
+long polyfit_index_count( const polyfit_index_t *pIndex );
+
+
+#endif	// POLYFIT_INDEX_H
@@ -0,0 +1,292 @@
+// Name: polyfit_mixed.c
+// Description: Mixed-precision MLS polynomial fitting.
+
+#include <float.h>      // DBL_MAX
+#include <math.h>       // sqrt(), fmin(), fmax(), NAN
+#include <stdio.h>      // NULL
+#include <string.h>     // memset()
+
+#include "polyfit_mixed.h"
+#include "polyfit_simd.h"
+#include "polyfit_solve.h"
+#include "polyfit_sums.h"
+#include <omp.h>
+
+// Points per block of the float pass, whole float blocks,
+// so y is still in cache when sum y^2 is taken.
+#define MIXED_BLOCK     (8 * POLYFIT_FLOAT_BLOCK)
+
+// Most points sampled for yShift when the caller gives the
+// range of x, so no pass over the points is made for it.
+#define MEAN_SAMPLES    (4096)
+
+// Points per block of the residual pass, sized for its
+// scratch to stay in L1.
+#define RESIDUAL_BLOCK  (256)
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static void findRange( int pointCount, const double *xValues, const double *yValues,
+                       double *pxMin, double *pxMax, double *pyMean );
+static double sampleMean( int pointCount, const double *yValues );
+static void measureResidual( int pointCount, const double *xValues, const double *yValues,
+                             double shift, double scale, int k, const double *coefficients,
+                             double *gradient, double *pSumSquares );
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_mixed()
+// Fits with float32 accumulation and double refinement.
+//
+// The refinement solves (AT)A d = (AT)(b - Ax) with the
+// float-accumulated (AT)A; because the right hand side is
+// formed in double, each step gains roughly as many digits
+// as float carries, divided by the condition of (AT)A.
+//
+// y is taken less yShift, near its mean, as polyfit_sweep()
+// does, so the float sums and the sum-derived SSE are good
+// relative to the spread of y rather than to sum y^2.
+//--------------------------------------------------------
+int polyfit_mixed( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults,
+                   double xMin, double xMax, int maxRefinements, double tolerance, polyfit_mixed_report_t *pReport )
+{
+    int k = coefficientCount;
+
+    // Check that the input pointers aren't null.
+    if( (NULL == xValues) || (NULL == yValues) || (NULL == coefficientResults) )
+    {
+        return -1;
+    }
+    // Check that pointCount >= coefficientCount.
+    if( (pointCount < coefficientCount) || (coefficientCount <= 0) || (coefficientCount > POLYFIT_MAX_COEFFICIENTS) )
+    {
+        return -2;
+    }
+
+    // Center and scale: t = (x - shift) * scale is in [-1, 1],
+    // and shift y by its mean, exact if a pass is made for the
+    // range, else from a sample.
+    double yShift;
+    if( !(xMin < xMax) )
+    {
+        findRange( pointCount, xValues, yValues, &xMin, &xMax, &yShift );
+    }
+    else
+    {
+        yShift = sampleMean( pointCount, yValues );
+    }
+    double shift = 0.5 * (xMin + xMax);
+    double scale = (xMax > xMin) ? (2.0 / (xMax - xMin)) : 1.0;
+
+    // Float32 power sums of t, one slice of the points per
+    // thread, and sum (y - yShift)^2 in double a block behind.
+    const polyfit_simd_kernels_t *pKernels = polyfit_simd();
+    polyfit_sums_t sums;
+    polyfit_sums_init( &sums, k );
+    sums.pointCount = pointCount;
+    double *sumT = sums.sumX;
+    double *sumTY = sums.sumXY;
+    double sumYY = 0.0;
+    #pragma omp parallel reduction(+:sumT[:POLYFIT_POWER_SUM_COUNT( k )], sumTY[:k], sumYY)
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        int start = (int) (((long) pointCount * t) / nt);
+        int end = (int) (((long) pointCount * (t + 1)) / nt);
+        for( int block = start; block < end; block += MIXED_BLOCK )
+        {
+            int count = (end - block < MIXED_BLOCK) ? (end - block) : MIXED_BLOCK;
+            pKernels->powerSumsFloat( count, &xValues[block], &yValues[block], shift, scale, yShift, k, sumT, sumTY );
+            #pragma omp simd reduction(+:sumYY)
+            for( int i = block; i < block + count; i++ )
+            {
+                double y = yValues[i] - yShift;
+                sumYY += y * y;
+            }
+        }
+    }
+
+    double ata[ POLYFIT_MAX_COEFFICIENTS * POLYFIT_MAX_COEFFICIENTS ];
+    double atb[ POLYFIT_MAX_COEFFICIENTS ];
+    double inT[ POLYFIT_MAX_COEFFICIENTS ];        // Coefficients in t, highest power first.
+    double gradient[ POLYFIT_MAX_COEFFICIENTS ];   // (AT)(b - Ax)
+    double correction[ POLYFIT_MAX_COEFFICIENTS ];
+    polyfit_sums_build( &sums, ata, atb );
+
+    int rVal = polyfit_solve_normal( k, ata, atb, inT );
+    if( 0 != rVal )
+    {
+        return rVal;
+    }
+
+    // |(AT)b| for b = y itself: (AT)(y - yShift) + yShift (AT)1,
+    // and (AT)1 is the last column of (AT)A.
+    double atbNorm = 0.0;
+    for( int i = 0; i < k; i++ )
+    {
+        double atbRaw = atb[i] + yShift * ata[ i * k + (k - 1) ];
+        atbNorm += atbRaw * atbRaw;
+    }
+    atbNorm = sqrt( atbNorm );
+
+    // SSE = sum y^2 - 2 x.(AT)b + x.(AT)A x, and (AT)A x = (AT)b,
+    // all of y - yShift; the constant term then takes yShift back.
+    int refinements = 0;
+    double sumSquares = sumYY;
+    double relativeGradient = NAN;
+    for( int i = 0; i < k; i++ )
+    {
+        sumSquares -= inT[i] * atb[i];
+    }
+    sumSquares = (sumSquares > 0.0) ? sumSquares : 0.0;
+    inT[ k - 1 ] += yShift;
+
+    while( maxRefinements > 0 )
+    {
+        measureResidual( pointCount, xValues, yValues, shift, scale, k, inT, gradient, &sumSquares );
+
+        double gradientNorm = 0.0;
+        for( int i = 0; i < k; i++ )
+        {
+            gradientNorm += gradient[i] * gradient[i];
+        }
+        relativeGradient = (atbNorm > 0.0) ? (sqrt( gradientNorm ) / atbNorm) : 0.0;
+
+        if( (relativeGradient <= tolerance) || (refinements >= maxRefinements) )
+        {
+            break;
+        }
+        if( 0 != polyfit_solve_normal( k, ata, gradient, correction ) )
+        {
+            break;
+        }
+        for( int i = 0; i < k; i++ )
+        {
+            inT[i] += correction[i];
+        }
+        refinements++;
+    }
+
+    polyfit_unscale( k, shift, scale, inT, coefficientResults );
+
+    if( NULL != pReport )
+    {
+        pReport->refinements = refinements;
+        pReport->residualRms = sqrt( sumSquares / pointCount );
+        pReport->relativeGradient = relativeGradient;
+    }
+    return 0;
+}
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// findRange()
+// Finds the smallest and largest x and the mean of y, on
+// OpenMP threads.
+//--------------------------------------------------------
+static void findRange( int pointCount, const double *xValues, const double *yValues,
+                       double *pxMin, double *pxMax, double *pyMean )
+{
+    double xMin = DBL_MAX;
+    double xMax = -DBL_MAX;
+    double sumY = 0.0;
+
+    #pragma omp parallel for reduction(min:xMin) reduction(max:xMax) reduction(+:sumY)
+    for( int i = 0; i < pointCount; i++ )
+    {
+        xMin = fmin( xMin, xValues[i] );
+        xMax = fmax( xMax, xValues[i] );
+        sumY += yValues[i];
+    }
+    *pxMin = xMin;
+    *pxMax = xMax;
+    *pyMean = sumY / pointCount;
+}
+
+//--------------------------------------------------------
+// sampleMean()
+// Returns the mean of up to MEAN_SAMPLES of y, evenly
+// strided over the points.  Any yShift near the mean
+// serves: its distance from the mean only adds its square
+// to the spread the sums are good relative to.
+//--------------------------------------------------------
+static double sampleMean( int pointCount, const double *yValues )
+{
+    long stride = (pointCount + MEAN_SAMPLES - 1) / MEAN_SAMPLES;
+    double sumY = 0.0;
+    int count = 0;
+
+    for( long i = 0; i < pointCount; i += stride )
+    {
+        sumY += yValues[i];
+        count++;
+    }
+    return sumY / count;
+}
+
+//--------------------------------------------------------
+// measureResidual()
+// In double: for r = y - p(t), computes the sum of r^2 and
+// gradient[i] = sum of r * t^(degree - i).
+//
+// A block of t and r is formed a point per SIMD lane, and
+// each sum over the block is a dot() kernel call, r
+// against the next power of t.
+//--------------------------------------------------------
+static void measureResidual( int pointCount, const double *xValues, const double *yValues,
+                             double shift, double scale, int k, const double *coefficients,
+                             double *gradient, double *pSumSquares )
+{
+    const polyfit_simd_kernels_t *pKernels = polyfit_simd();
+    double sumSquares = 0.0;
+    memset( gradient, 0, k * sizeof( double ) );
+
+    #pragma omp parallel reduction(+:sumSquares, gradient[:k])
+    {
+        double tBlock[ RESIDUAL_BLOCK ];
+        double rBlock[ RESIDUAL_BLOCK ];
+        double powerBlock[ RESIDUAL_BLOCK ];
+
+        #pragma omp for schedule(static)
+        for( int block = 0; block < pointCount; block += RESIDUAL_BLOCK )
+        {
+            int count = (pointCount - block < RESIDUAL_BLOCK) ? (pointCount - block) : RESIDUAL_BLOCK;
+
+            #pragma omp simd
+            for( int i = 0; i < count; i++ )
+            {
+                double t = (xValues[ block + i ] - shift) * scale;
+                double fit = coefficients[0];
+                for( int c = 1; c < k; c++ )
+                {
+                    fit = fit * t + coefficients[c];
+                }
+                tBlock[i] = t;
+                rBlock[i] = yValues[ block + i ] - fit;
+                powerBlock[i] = 1.0;
+            }
+
+            sumSquares += pKernels->dot( count, rBlock, rBlock );
+            for( int c = k - 1; c >= 0; c-- )
+            {
+                gradient[c] += pKernels->dot( count, rBlock, powerBlock );
+                #pragma omp simd
+                for( int i = 0; i < count; i++ )
+                {
+                    powerBlock[i] *= tBlock[i];
+                }
+            }
+        }
+    }
+    *pSumSquares = sumSquares;
+}
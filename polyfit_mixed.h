@@ -0,0 +1,68 @@
+// file: polyfit_mixed.h
+// Description: Mixed-precision MLS polynomial fitting.
+//
+// x is centered and scaled onto t in [-1, 1] and the bandwidth-heavy
+// power sums are accumulated in float32 (twice as many lanes per
+// vector as double), in one pass over the points.  Full double
+// accuracy can then be recovered, at a pass over the points per
+// step, by iterative refinement of the small system against
+// residuals computed in double.
+
+#ifndef POLYFIT_MIXED_H
+#define POLYFIT_MIXED_H
+
+// Refinement that recovers double accuracy, for callers
+// that want it.  The tolerance sits a little above the
+// rounding floor of relativeGradient from a double pass
+// (a few 1e-16), and is met in 2 to 4 steps on every
+// kernel; the cap only stops data too ill conditioned for
+// the float solve to converge.
+#define POLYFIT_MIXED_MAX_REFINEMENTS   (6)
+#define POLYFIT_MIXED_TOLERANCE         (1e-14)
+
+// What the fit achieved.
+typedef struct polyfit_mixed_report_s
+{
+    int     refinements;        // Refinement steps applied.
+    double  residualRms;        // RMS of y - p(x) for the returned coefficients.
+    double  relativeGradient;   // |(AT)(b - Ax)| / |(AT)b|; 0 at the exact MLS solution,
+                                // NAN if no residual pass was made.
+} polyfit_mixed_report_t;
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_mixed()
+// Same contract as polyfit(), with the float32 fast path.
+//
+// xMin and xMax are the range of x, if the caller knows
+// it; pass xMin >= xMax (e.g. 0, 0) to have it found by a
+// pass over x.  A range wider than the points only costs
+// conditioning.
+//
+// With maxRefinements = 0 the float solve is returned
+// after its one pass, and residualRms comes from the sums:
+// sum (y - mean y)^2, kept in double, less the part the
+// fit explains, good to about float rounding of the spread
+// of y about its mean, however large the mean.  The mean
+// is taken in the pass for the range of x, or from a
+// sample of y if the range is given.  Otherwise each
+// further pass measures the residual in double; while
+// relativeGradient is above tolerance and fewer than
+// maxRefinements steps were made, a correction is solved
+// for and applied.  pReport may be NULL.
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -2 if (pointCount < coefficientCount) or
+//             coefficientCount is out of range,
+//          -4 if the equations are numerically singular.
+//--------------------------------------------------------
+int polyfit_mixed( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults,
+                   double xMin, double xMax, int maxRefinements, double tolerance, polyfit_mixed_report_t *pReport );
+
+
+#endif	// POLYFIT_MIXED_H
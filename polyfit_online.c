@@ -0,0 +1,179 @@
+// Name: polyfit_online.c
+// Description: Incremental MLS fit with point removal.
+
+#include <math.h>       // isfinite()
+#include <stdio.h>      // NULL
+#include <string.h>     // memset()
+
+#include "polyfit_online.h"
+#include "polyfit_solve.h"
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static void updateSums( polyfit_online_t *pOnline, int pointCount, const double *xValues,
+                        const double *yValues, double sign );
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_online_init()
+// Clears the sums and keeps the settings.
+//--------------------------------------------------------
+int polyfit_online_init( polyfit_online_t *pOnline, int coefficientCount, double shift, double scale )
+{
+    if( NULL == pOnline )
+    {
+        return -1;
+    }
+    if( (coefficientCount <= 0) || (coefficientCount > POLYFIT_MAX_COEFFICIENTS) ||
+        !isfinite( shift ) || !isfinite( scale ) || !(scale > 0.0) )
+    {
+        return -2;
+    }
+
+    memset( pOnline, 0, sizeof( *pOnline ) );
+    pOnline->coefficientCount = coefficientCount;
+    pOnline->shift = shift;
+    pOnline->scale = scale;
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_online_reset()
+// Clears the sums.
+//--------------------------------------------------------
+int polyfit_online_reset( polyfit_online_t *pOnline )
+{
+    if( NULL == pOnline )
+    {
+        return -1;
+    }
+    return polyfit_online_init( pOnline, pOnline->coefficientCount, pOnline->shift, pOnline->scale );
+}
+
+//--------------------------------------------------------
+// polyfit_online_add()
+// Adds the points' powers into the sums.
+//--------------------------------------------------------
+int polyfit_online_add( polyfit_online_t *pOnline, int pointCount, const double *xValues, const double *yValues )
+{
+    if( (NULL == pOnline) || (NULL == xValues) || (NULL == yValues) )
+    {
+        return -1;
+    }
+    if( pointCount < 0 )
+    {
+        return -2;
+    }
+
+    updateSums( pOnline, pointCount, xValues, yValues, 1.0 );
+    pOnline->pointCount += pointCount;
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_online_remove()
+// Takes the points' powers back out of the sums.
+//--------------------------------------------------------
+int polyfit_online_remove( polyfit_online_t *pOnline, int pointCount, const double *xValues, const double *yValues )
+{
+    if( (NULL == pOnline) || (NULL == xValues) || (NULL == yValues) )
+    {
+        return -1;
+    }
+    if( (pointCount < 0) || (pointCount > pOnline->pointCount) )
+    {
+        return -2;
+    }
+
+    updateSums( pOnline, pointCount, xValues, yValues, -1.0 );
+    pOnline->pointCount -= pointCount;
+    if( 0 == pOnline->pointCount )
+    {
+        // Nothing is held, so drop any rounding left behind.
+        polyfit_online_reset( pOnline );
+    }
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_online_solve()
+// Solves the normal equations in t, with each sum's
+// compensation folded in, then rewrites the result in x.
+//--------------------------------------------------------
+int polyfit_online_solve( const polyfit_online_t *pOnline, double *coefficientResults )
+{
+    double ata[ POLYFIT_MAX_COEFFICIENTS * POLYFIT_MAX_COEFFICIENTS ];
+    double atb[ POLYFIT_MAX_COEFFICIENTS ];
+    double inT[ POLYFIT_MAX_COEFFICIENTS ];
+
+    if( (NULL == pOnline) || (NULL == coefficientResults) )
+    {
+        return -1;
+    }
+
+    int k = pOnline->coefficientCount;
+    int degree = k - 1;
+    if( pOnline->pointCount < k )
+    {
+        return -2;
+    }
+
+    // Hankel structure, as in polyfit_sums_build().
+    for( int r = 0; r < k; r++ )
+    {
+        for( int c = 0; c < k; c++ )
+        {
+            int p = 2 * degree - r - c;
+            ata[ r * k + c ] = pOnline->sumT[p] + pOnline->sumTError[p];
+        }
+        atb[r] = pOnline->sumTY[ degree - r ] + pOnline->sumTYError[ degree - r ];
+    }
+
+    int rVal = polyfit_solve_normal( k, ata, atb, inT );
+    if( 0 != rVal )
+    {
+        return rVal;
+    }
+    polyfit_unscale( k, pOnline->shift, pOnline->scale, inT, coefficientResults );
+    return 0;
+}
+
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// updateSums()
+// Adds sign times each point's powers to the sums; the
+// powers are formed by repeated multiplication, so a point
+// removed gives back bit for bit the terms it added.
+//--------------------------------------------------------
+static void updateSums( polyfit_online_t *pOnline, int pointCount, const double *xValues,
+                        const double *yValues, double sign )
+{
+    int degree = pOnline->coefficientCount - 1;
+
+    for( int i = 0; i < pointCount; i++ )
+    {
+        double t = (xValues[i] - pOnline->shift) * pOnline->scale;
+        double power = 1.0;
+
+        for( int p = 0; p <= 2 * degree; p++ )
+        {
+            polyfit_add_compensated( &pOnline->sumT[p], &pOnline->sumTError[p], sign * power );
+            if( p <= degree )
+            {
+                polyfit_add_compensated( &pOnline->sumTY[p], &pOnline->sumTYError[p], sign * (power * yValues[i]) );
+            }
+            power *= t;
+        }
+    }
+}
@@ -0,0 +1,95 @@
+// file: polyfit_online.h
+// Description: Stateful MLS fit that points can be added to and
+//              removed from at any time.
+//
+// The power sums of the normal equations (see polyfit_sums.h) are
+// kept up to date point by point: adding or removing one costs
+// O(coefficientCount), and the current coefficients are solved for
+// on demand in O(coefficientCount^3), without the points that were
+// added before.  Removing exactly the points that were added makes
+// sliding windows possible.
+//
+// Two things keep a long-lived context accurate.  The sums are of
+// powers of t = (x - shift) * scale, so x far from 0 (timestamps,
+// say) doesn't swamp the sums; pick shift near the middle of the
+// data and scale about 1 / (half its range).  And every sum carries
+// a running compensation (Neumaier summation), so removing a point
+// takes back very nearly what adding it put in, however many points
+// have passed through.
+
+#ifndef POLYFIT_ONLINE_H
+#define POLYFIT_ONLINE_H
+
+#include "polyfit_sums.h"
+
+typedef struct polyfit_online_s
+{
+    int     coefficientCount;
+    long    pointCount;         // Points added less points removed.
+    double  shift;
+    double  scale;
+    double  sumT[ POLYFIT_POWER_SUM_COUNT( POLYFIT_MAX_COEFFICIENTS ) ];        // sum of t^p
+    double  sumTError[ POLYFIT_POWER_SUM_COUNT( POLYFIT_MAX_COEFFICIENTS ) ];   // Compensation of sumT[p].
+    double  sumTY[ POLYFIT_MAX_COEFFICIENTS ];                                  // sum of y * t^p
+    double  sumTYError[ POLYFIT_MAX_COEFFICIENTS ];
+} polyfit_online_t;
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_online_init()
+// Starts an empty fit with coefficientCount terms, on
+// t = (x - shift) * scale.  shift = 0, scale = 1 sums
+// powers of x itself, like polyfit_sums_t.
+//
+// Returns 0 if success, -1 if passed a NULL pointer,
+// -2 if coefficientCount is out of range or scale is not
+// a positive number.
+//--------------------------------------------------------
+int polyfit_online_init( polyfit_online_t *pOnline, int coefficientCount, double shift, double scale );
+
+//--------------------------------------------------------
+// polyfit_online_reset()
+// Removes every point, keeping the settings.
+//
+// Returns 0 if success, -1 if passed a NULL pointer.
+//--------------------------------------------------------
+int polyfit_online_reset( polyfit_online_t *pOnline );
+
+//--------------------------------------------------------
+// polyfit_online_add()
+// Adds pointCount points.
+//
+// Returns 0 if success, -1 if passed a NULL pointer,
+// -2 if pointCount is negative.
+//--------------------------------------------------------
+int polyfit_online_add( polyfit_online_t *pOnline, int pointCount, const double *xValues, const double *yValues );
+
+//--------------------------------------------------------
+// polyfit_online_remove()
+// Removes pointCount points that were added before, with
+// the same x and y.  Removing a point that wasn't added
+// leaves a fit of no real data.
+//
+// Returns 0 if success, -1 if passed a NULL pointer,
+// -2 if pointCount is negative or more than are held.
+//--------------------------------------------------------
+int polyfit_online_remove( polyfit_online_t *pOnline, int pointCount, const double *xValues, const double *yValues );
+
+//--------------------------------------------------------
+// polyfit_online_solve()
+// Solves for the coefficients of the points currently
+// held, highest power first, in x.
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -2 if fewer points than coefficients are held,
+//          -4 if the equations are numerically singular.
+//--------------------------------------------------------
+int polyfit_online_solve( const polyfit_online_t *pOnline, double *coefficientResults );
+
+
+#endif	// POLYFIT_ONLINE_H
@@ -0,0 +1,201 @@
+// Name: polyfit_ortho.c
+// Description: MLS polynomial fitting in a basis of polynomials
+//              orthogonal over the data (Forsythe's method).
+
+#include <float.h>      // DBL_EPSILON, DBL_MAX
+#include <math.h>       // fmin()
+#include <stdio.h>      // NULL
+#include <stdlib.h>     // malloc()
+#include <string.h>     // memset(), memcpy()
+
+#include "polyfit_ortho.h"
+#include "polyfit_sums.h"
+#include <omp.h>
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static void toMonomial( int k, const double *alpha, const double *beta, const double *coeff,
+                        double shift, double scale, double *pScratch, double *coefficientResults );
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_ortho()
+// Fits with Forsythe's orthogonal polynomials.
+//
+// x is first mapped onto t in [-1, 1].  Each degree then
+// takes one parallel pass over the points, which updates
+// the residual r, forms p[j+1] from p[j] and p[j-1], and
+// reduces the sums that give a[j+1] and the coefficient
+// of p[j+1].  Fitting the residual, rather than y, keeps
+// the coefficients accurate at high degree.  The per
+// degree scalars and toMonomial()'s scratch share one heap
+// block, so a large coefficientCount can't overrun the
+// stack.
+//--------------------------------------------------------
+int polyfit_ortho( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults )
+{
+    int rVal = 0;
+    int k = coefficientCount;
+
+    // Check that the input pointers aren't null.
+    if( (NULL == xValues) || (NULL == yValues) || (NULL == coefficientResults) )
+    {
+        return -1;
+    }
+    // Check that pointCount >= coefficientCount.
+    if( (pointCount < coefficientCount) || (coefficientCount <= 0) )
+    {
+        return -2;
+    }
+
+    double *pPrev = (double *) malloc( pointCount * sizeof( double ) );     // p[j-1]
+    double *pCur = (double *) malloc( pointCount * sizeof( double ) );      // p[j]
+    double *pResidual = (double *) malloc( pointCount * sizeof( double ) );
+    double *pScalars = (double *) malloc( (size_t) 8 * k * sizeof( double ) );   // Three arrays, then scratch.
+    if( (NULL == pPrev) || (NULL == pCur) || (NULL == pResidual) || (NULL == pScalars) )
+    {
+        free( pPrev );
+        free( pCur );
+        free( pResidual );
+        free( pScalars );
+        return -3;
+    }
+
+    // Map x onto t = (x - shift) * scale in [-1, 1].
+    double xMin = DBL_MAX;
+    double xMax = -DBL_MAX;
+    #pragma omp parallel for reduction(min:xMin) reduction(max:xMax)
+    for( int i = 0; i < pointCount; i++ )
+    {
+        xMin = fmin( xMin, xValues[i] );
+        xMax = fmax( xMax, xValues[i] );
+    }
+    double shift = 0.5 * (xMin + xMax);
+    double scale = (xMax > xMin) ? (2.0 / (xMax - xMin)) : 1.0;
+
+    double *alpha = &pScalars[0];       // a[j]
+    double *beta = &pScalars[k];        // b[j]
+    double *coeff = &pScalars[2 * k];   // Coefficient of p[j].
+    double norm = 0.0;                  // Sum of p[j]^2.
+
+    // Degree 0: p[0] = 1.
+    double sumT = 0.0;
+    double sumY = 0.0;
+    #pragma omp parallel for reduction(+:sumT, sumY)
+    for( int i = 0; i < pointCount; i++ )
+    {
+        pPrev[i] = 0.0;
+        pCur[i] = 1.0;
+        pResidual[i] = yValues[i];
+        sumT += (xValues[i] - shift) * scale;
+        sumY += yValues[i];
+    }
+    norm = pointCount;
+    alpha[0] = sumT / norm;
+    beta[0] = 0.0;
+    coeff[0] = sumY / norm;
+
+    for( int j = 0; j + 1 < k; j++ )
+    {
+        double a = alpha[j];
+        double b = beta[j];
+        double c = coeff[j];
+        double sumPP = 0.0;     // Sum of p[j+1]^2
+        double sumTPP = 0.0;    // Sum of t * p[j+1]^2
+        double sumRP = 0.0;     // Sum of r * p[j+1]
+
+        #pragma omp parallel for reduction(+:sumPP, sumTPP, sumRP)
+        for( int i = 0; i < pointCount; i++ )
+        {
+            double t = (xValues[i] - shift) * scale;
+            double pj = pCur[i];
+            double pNext = (t - a) * pj - b * pPrev[i];
+            double r = pResidual[i] - c * pj;
+
+            pResidual[i] = r;
+            pPrev[i] = pj;
+            pCur[i] = pNext;
+            sumPP += pNext * pNext;
+            sumTPP += t * pNext * pNext;
+            sumRP += r * pNext;
+        }
+
+        // p[j+1] vanishing at every point means too few distinct x.
+        if( sumPP <= (DBL_EPSILON * norm) )
+        {
+            rVal = -4;
+            break;
+        }
+        alpha[j + 1] = sumTPP / sumPP;
+        beta[j + 1] = sumPP / norm;
+        coeff[j + 1] = sumRP / sumPP;
+        norm = sumPP;
+    }
+
+    free( pPrev );
+    free( pCur );
+    free( pResidual );
+
+    if( 0 == rVal )
+    {
+        toMonomial( k, alpha, beta, coeff, shift, scale, &pScalars[3 * k], coefficientResults );
+    }
+    free( pScalars );
+    return rVal;
+}
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// toMonomial()
+// Expands sum{j} coeff[j] * p[j](t) into powers of t by
+// running the recurrence on coefficient arrays, then
+// substitutes t = (x - shift) * scale with
+// polyfit_unscale().  Writes the result highest power
+// first, as polyfit() does.  pScratch holds 5 * k doubles.
+//--------------------------------------------------------
+static void toMonomial( int k, const double *alpha, const double *beta, const double *coeff,
+                        double shift, double scale, double *pScratch, double *coefficientResults )
+{
+    double *prev = &pScratch[0];        // p[j-1], lowest power first.
+    double *cur = &pScratch[k];         // p[j]
+    double *next = &pScratch[2 * k];
+    double *inT = &pScratch[3 * k];     // The fit, in powers of t.
+    double *highFirst = &pScratch[4 * k];
+
+    memset( prev, 0, k * sizeof( double ) );
+    memset( cur, 0, k * sizeof( double ) );
+    memset( inT, 0, k * sizeof( double ) );
+    cur[0] = 1.0;
+    inT[0] = coeff[0];
+
+    for( int j = 0; j + 1 < k; j++ )
+    {
+        // p[j+1] = (t - a[j]) * p[j] - b[j] * p[j-1]
+        for( int m = 0; m < k; m++ )
+        {
+            next[m] = ((m > 0) ? cur[m - 1] : 0.0) - alpha[j] * cur[m] - beta[j] * prev[m];
+        }
+        memcpy( prev, cur, k * sizeof( double ) );
+        memcpy( cur, next, k * sizeof( double ) );
+        for( int m = 0; m <= j + 1; m++ )
+        {
+            inT[m] += coeff[j + 1] * cur[m];
+        }
+    }
+
+    for( int i = 0; i < k; i++ )
+    {
+        highFirst[i] = inT[ (k - 1) - i ];
+    }
+    polyfit_unscale( k, shift, scale, highFirst, coefficientResults );
+}
@@ -0,0 +1,37 @@
+// file: polyfit_ortho.h
+// Description: MLS polynomial fitting in a basis of polynomials
+//              orthogonal over the data (Forsythe's method).
+//
+// The basis is generated by the three-term recurrence
+//      p[0](t) = 1,  p[1](t) = (t - a[0]),
+//      p[j+1](t) = (t - a[j]) * p[j](t) - b[j] * p[j-1](t),
+// so every coefficient is a ratio of two sums over the points and
+// no linear system is solved.  This stays usable at degrees 10-20,
+// where the monomial normal equations have lost all their digits.
+
+#ifndef POLYFIT_ORTHO_H
+#define POLYFIT_ORTHO_H
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_ortho()
+// Same contract as polyfit().  The fit is made in the
+// orthogonal basis and converted back to the monomial
+// coefficients (highest power first) that polyToString()
+// expects.
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -2 if (pointCount < coefficientCount),
+//          -3 if unable to allocate memory,
+//          -4 if there are fewer distinct x values than
+//             coefficients.
+//--------------------------------------------------------
+int polyfit_ortho( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults );
+
+
+#endif	// POLYFIT_ORTHO_H
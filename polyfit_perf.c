@@ -0,0 +1,425 @@
+// Name: polyfit_perf.c
+// Description: Hardware performance counters per fit phase, read
+//              with Linux perf_event_open().
+
+#include <stdbool.h>    // bool
+#include <stdio.h>      // fprintf()
+#include <stdlib.h>     // calloc(), free()
+#include <string.h>     // memset()
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>    // SYS_perf_event_open, SYS_gettid
+#include <unistd.h>         // syscall(), read(), close()
+#endif  // __linux__
+
+#include "polyfit_perf.h"
+
+// One counted thread.  counts[] stays with the position in
+// the team, whichever thread holds it.
+typedef struct
+{
+    int         threadId;
+    int         fds[ POLYFIT_COUNTER_COUNT ];       // -1 if not open.
+    long long   start[ POLYFIT_PHASE_COUNT ][ POLYFIT_COUNTER_COUNT ];
+    long long   counts[ POLYFIT_PHASE_COUNT ][ POLYFIT_COUNTER_COUNT ];
+} PerfThread;
+
+struct polyfit_perf_s
+{
+    int         threadCount;        // Threads attached now.
+    int         countedThreads;     // Most threads attached since the last reset.
+    bool        isOpen[ POLYFIT_COUNTER_COUNT ];    // Open on some thread.
+    long long   pointCounts[ POLYFIT_PHASE_COUNT ];
+    PerfThread  threads[ POLYFIT_PERF_MAX_THREADS ];
+};
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static void         closeCounters( polyfit_perf_t *pPerf );
+static int          openCounter( int threadId, polyfit_counter_t counter );
+static long long    readCounter( int fd );
+static double       ratio( long long numerator, long long denominator );
+
+
+// Indexed by polyfit_counter_t.
+static const char *counterNames[ POLYFIT_COUNTER_COUNT ] =
+{
+    "cycles", "instructions", "llc-misses", "branch-misses"
+};
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_perf_create()
+// Returns an empty, unattached set of counters.
+//--------------------------------------------------------
+polyfit_perf_t *polyfit_perf_create( void )
+{
+    polyfit_perf_t *pPerf = (polyfit_perf_t *) calloc( 1, sizeof( polyfit_perf_t ) );
+    if( NULL == pPerf )
+    {
+        return NULL;
+    }
+
+    for( int t = 0; t < POLYFIT_PERF_MAX_THREADS; t++ )
+    {
+        for( int c = 0; c < POLYFIT_COUNTER_COUNT; c++ )
+        {
+            pPerf->threads[t].fds[c] = -1;
+        }
+    }
+    return pPerf;
+}
+
+//--------------------------------------------------------
+// polyfit_perf_destroy()
+// Closes the counters and frees pPerf.
+//--------------------------------------------------------
+void polyfit_perf_destroy( polyfit_perf_t *pPerf )
+{
+    if( NULL != pPerf )
+    {
+        closeCounters( pPerf );
+        free( pPerf );
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_perf_attach()
+// Reopens the counters only if the threads changed.
+//--------------------------------------------------------
+int polyfit_perf_attach( polyfit_perf_t *pPerf, const int *threadIds, int threadCount )
+{
+    if( (NULL == pPerf) || (NULL == threadIds) )
+    {
+        return -1;
+    }
+    if( (threadCount < 1) || (threadCount > POLYFIT_PERF_MAX_THREADS) )
+    {
+        return -2;
+    }
+
+    bool isSame = (threadCount == pPerf->threadCount);
+    for( int t = 0; isSame && (t < threadCount); t++ )
+    {
+        isSame = (threadIds[t] == pPerf->threads[t].threadId);
+    }
+    if( isSame )
+    {
+        return polyfit_perf_available( pPerf ) ? 0 : -7;
+    }
+
+    closeCounters( pPerf );
+    for( int t = 0; t < threadCount; t++ )
+    {
+        PerfThread *pThread = &pPerf->threads[t];
+        pThread->threadId = threadIds[t];
+        for( int c = 0; c < POLYFIT_COUNTER_COUNT; c++ )
+        {
+            pThread->fds[c] = openCounter( threadIds[t], (polyfit_counter_t) c );
+            if( pThread->fds[c] >= 0 )
+            {
+                pPerf->isOpen[c] = true;
+            }
+        }
+    }
+    pPerf->threadCount = threadCount;
+    if( threadCount > pPerf->countedThreads )
+    {
+        pPerf->countedThreads = threadCount;
+    }
+    return polyfit_perf_available( pPerf ) ? 0 : -7;
+}
+
+//--------------------------------------------------------
+// polyfit_perf_available()
+// Returns true if any counter is open.
+//--------------------------------------------------------
+bool polyfit_perf_available( const polyfit_perf_t *pPerf )
+{
+    if( NULL == pPerf )
+    {
+        return false;
+    }
+
+    for( int c = 0; c < POLYFIT_COUNTER_COUNT; c++ )
+    {
+        if( pPerf->isOpen[c] )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//--------------------------------------------------------
+// polyfit_perf_thread_id()
+// Returns the kernel id of the calling thread.
+//--------------------------------------------------------
+int polyfit_perf_thread_id( void )
+{
+#ifdef __linux__
+    return (int) syscall( SYS_gettid );
+#else
+    return 0;
+#endif  // __linux__
+}
+
+//--------------------------------------------------------
+// polyfit_perf_begin()
+// Reads every counter at the start of a phase.
+//--------------------------------------------------------
+void polyfit_perf_begin( polyfit_perf_t *pPerf, polyfit_phase_t phase )
+{
+    if( (NULL == pPerf) || (phase < POLYFIT_PHASE_FILL) || (phase >= POLYFIT_PHASE_COUNT) )
+    {
+        return;
+    }
+
+    for( int t = 0; t < pPerf->threadCount; t++ )
+    {
+        PerfThread *pThread = &pPerf->threads[t];
+        for( int c = 0; c < POLYFIT_COUNTER_COUNT; c++ )
+        {
+            pThread->start[ phase ][c] = readCounter( pThread->fds[c] );
+        }
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_perf_end()
+// Adds each counter's increase since the phase began.
+//--------------------------------------------------------
+void polyfit_perf_end( polyfit_perf_t *pPerf, polyfit_phase_t phase, long pointCount )
+{
+    if( (NULL == pPerf) || (phase < POLYFIT_PHASE_FILL) || (phase >= POLYFIT_PHASE_COUNT) )
+    {
+        return;
+    }
+
+    for( int t = 0; t < pPerf->threadCount; t++ )
+    {
+        PerfThread *pThread = &pPerf->threads[t];
+        for( int c = 0; c < POLYFIT_COUNTER_COUNT; c++ )
+        {
+            pThread->counts[ phase ][c] += readCounter( pThread->fds[c] ) - pThread->start[ phase ][c];
+        }
+    }
+    pPerf->pointCounts[ phase ] += pointCount;
+}
+
+//--------------------------------------------------------
+// polyfit_perf_count()
+// Returns one thread's count, or the sum of all of them.
+//--------------------------------------------------------
+long long polyfit_perf_count( const polyfit_perf_t *pPerf, polyfit_phase_t phase, int thread, polyfit_counter_t counter )
+{
+    if( (NULL == pPerf) || (phase < POLYFIT_PHASE_FILL) || (phase >= POLYFIT_PHASE_COUNT) ||
+        (counter < POLYFIT_COUNTER_CYCLES) || (counter >= POLYFIT_COUNTER_COUNT) ||
+        (thread < -1) || (thread >= pPerf->countedThreads) || !pPerf->isOpen[ counter ] )
+    {
+        return -1;
+    }
+
+    if( thread >= 0 )
+    {
+        return pPerf->threads[ thread ].counts[ phase ][ counter ];
+    }
+
+    long long total = 0;
+    for( int t = 0; t < pPerf->countedThreads; t++ )
+    {
+        total += pPerf->threads[t].counts[ phase ][ counter ];
+    }
+    return total;
+}
+
+//--------------------------------------------------------
+// polyfit_perf_reset()
+// Zeroes the counts, keeping the counters open.
+//--------------------------------------------------------
+void polyfit_perf_reset( polyfit_perf_t *pPerf )
+{
+    if( NULL != pPerf )
+    {
+        for( int t = 0; t < POLYFIT_PERF_MAX_THREADS; t++ )
+        {
+            memset( pPerf->threads[t].counts, 0, sizeof( pPerf->threads[t].counts ) );
+        }
+        memset( pPerf->pointCounts, 0, sizeof( pPerf->pointCounts ) );
+        pPerf->countedThreads = pPerf->threadCount;
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_perf_print()
+// Writes the per-phase table, then the per-thread one.
+//--------------------------------------------------------
+void polyfit_perf_print( const polyfit_perf_t *pPerf, FILE *pFile, const char *title )
+{
+    if( (NULL == pPerf) || (NULL == pFile) )
+    {
+        return;
+    }
+
+    if( NULL == title )
+    {
+        title = "counters";
+    }
+    if( !polyfit_perf_available( pPerf ) )
+    {
+        fprintf( pFile, "%s: hardware counters unavailable, times only\n", title );
+        return;
+    }
+
+    fprintf( pFile, "%s: %d threads, -1 where a counter couldn't be opened\n", title, pPerf->countedThreads );
+    fprintf( pFile, "  %-10s %15s %15s %7s %13s %13s\n", "phase", "cycles", "instructions", "IPC",
+             "llc-miss/pt", "branch-miss/pt" );
+    for( int p = 0; p < POLYFIT_PHASE_COUNT; p++ )
+    {
+        polyfit_phase_t phase = (polyfit_phase_t) p;
+        if( 0 == pPerf->pointCounts[p] )
+        {
+            continue;   // Phase never run.
+        }
+
+        long long cycles = polyfit_perf_count( pPerf, phase, -1, POLYFIT_COUNTER_CYCLES );
+        long long instructions = polyfit_perf_count( pPerf, phase, -1, POLYFIT_COUNTER_INSTRUCTIONS );
+        fprintf( pFile, "  %-10s %15lld %15lld %7.2f %13.4f %13.4f\n", polyfit_phase_name( phase ), cycles, instructions,
+                 ratio( instructions, cycles ),
+                 ratio( polyfit_perf_count( pPerf, phase, -1, POLYFIT_COUNTER_LLC_MISSES ), pPerf->pointCounts[p] ),
+                 ratio( polyfit_perf_count( pPerf, phase, -1, POLYFIT_COUNTER_BRANCH_MISSES ), pPerf->pointCounts[p] ) );
+    }
+
+    fprintf( pFile, "  %-10s %15s %15s %7s %13s %13s  (whole fits)\n", "thread", "cycles", "instructions", "IPC",
+             "llc-misses", "branch-misses" );
+    for( int t = 0; t < pPerf->countedThreads; t++ )
+    {
+        long long cycles = polyfit_perf_count( pPerf, POLYFIT_PHASE_TOTAL, t, POLYFIT_COUNTER_CYCLES );
+        long long instructions = polyfit_perf_count( pPerf, POLYFIT_PHASE_TOTAL, t, POLYFIT_COUNTER_INSTRUCTIONS );
+        fprintf( pFile, "  %-10d %15lld %15lld %7.2f %13lld %13lld\n", t, cycles, instructions, ratio( instructions, cycles ),
+                 polyfit_perf_count( pPerf, POLYFIT_PHASE_TOTAL, t, POLYFIT_COUNTER_LLC_MISSES ),
+                 polyfit_perf_count( pPerf, POLYFIT_PHASE_TOTAL, t, POLYFIT_COUNTER_BRANCH_MISSES ) );
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_counter_name()
+// Returns the name of a counter.
+//--------------------------------------------------------
+const char *polyfit_counter_name( polyfit_counter_t counter )
+{
+    if( (counter < POLYFIT_COUNTER_CYCLES) || (counter >= POLYFIT_COUNTER_COUNT) )
+    {
+        return "unknown";
+    }
+    return counterNames[ counter ];
+}
+
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// closeCounters()
+// Closes every open counter and detaches all threads.
+//--------------------------------------------------------
+static void closeCounters( polyfit_perf_t *pPerf )
+{
+    for( int t = 0; t < pPerf->threadCount; t++ )
+    {
+        PerfThread *pThread = &pPerf->threads[t];
+        for( int c = 0; c < POLYFIT_COUNTER_COUNT; c++ )
+        {
+#ifdef __linux__
+            if( pThread->fds[c] >= 0 )
+            {
+                close( pThread->fds[c] );
+            }
+#endif  // __linux__
+            pThread->fds[c] = -1;
+        }
+        pThread->threadId = 0;
+    }
+    memset( pPerf->isOpen, 0, sizeof( pPerf->isOpen ) );
+    pPerf->threadCount = 0;
+}
+
+//--------------------------------------------------------
+// openCounter()
+// Starts one user-space counter on a thread, on whatever
+// CPU it runs.
+//
+// Returns the file descriptor, or -1 if the counter isn't
+// permitted or supported.
+//--------------------------------------------------------
+static int openCounter( int threadId, polyfit_counter_t counter )
+{
+#ifdef __linux__
+    static const unsigned long long configs[ POLYFIT_COUNTER_COUNT ] =
+    {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+    };
+    struct perf_event_attr attr;
+
+    memset( &attr, 0, sizeof( attr ) );
+    attr.size = sizeof( attr );
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[ counter ];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    long fd = syscall( SYS_perf_event_open, &attr, threadId, -1, -1, 0 );
+    return (fd < 0) ? -1 : (int) fd;
+#else
+    (void) threadId;
+    (void) counter;
+    return -1;
+#endif  // __linux__
+}
+
+//--------------------------------------------------------
+// readCounter()
+// Returns a counter's value, or 0 if it isn't open.
+//--------------------------------------------------------
+static long long readCounter( int fd )
+{
+#ifdef __linux__
+    unsigned long long value = 0;
+
+    if( (fd >= 0) && ((ssize_t) sizeof( value ) == read( fd, &value, sizeof( value ) )) )
+    {
+        return (long long) value;
+    }
+#else
+    (void) fd;
+#endif  // __linux__
+    return 0;
+}
+
+//--------------------------------------------------------
+// ratio()
+// Returns numerator / denominator, -1 if either is a
+// count that wasn't taken, or 0 if nothing was counted.
+//--------------------------------------------------------
+static double ratio( long long numerator, long long denominator )
+{
+    if( (numerator < 0) || (denominator < 0) )
+    {
+        return -1.0;
+    }
+    if( 0 == denominator )
+    {
+        return 0.0;
+    }
+    return (double) numerator / (double) denominator;
+}
@@ -0,0 +1,130 @@
+// file: polyfit_perf.h
+// Description: Hardware performance counters per fit phase, read
+//              with Linux perf_event_open().
+//
+// A polyfit_perf_t is handed to polyfit_ex() in polyfit_options_t.
+// Before each fit it is attached to the threads the backend runs on
+// (the calling thread, the OpenMP team or the pthreads pool), and
+// every phase polyfit_stats_t times also adds the cycles,
+// instructions, last level cache misses and branch misses of each of
+// those threads.  The counts add up over fits until
+// polyfit_perf_reset().
+//
+// Counting needs perf_event_paranoid <= 2 and a PMU the kernel
+// exposes.  Counters that can't be opened read as -1; with none at
+// all the fits run as before and only their times are kept.
+
+#ifndef POLYFIT_PERF_H
+#define POLYFIT_PERF_H
+
+#include <stdbool.h>    // bool
+#include <stdio.h>      // FILE
+
+#include "polyfit_stats.h"
+
+// Most threads counted per fit.
+#define POLYFIT_PERF_MAX_THREADS    (256)
+
+// Counters read per thread.
+typedef enum polyfit_counter_e
+{
+    POLYFIT_COUNTER_CYCLES = 0,
+    POLYFIT_COUNTER_INSTRUCTIONS,
+    POLYFIT_COUNTER_LLC_MISSES,
+    POLYFIT_COUNTER_BRANCH_MISSES,
+    POLYFIT_COUNTER_COUNT
+} polyfit_counter_t;
+
+typedef struct polyfit_perf_s polyfit_perf_t;
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_perf_create()
+// Returns an empty, unattached set of counters, or NULL
+// if unable to allocate memory.
+//--------------------------------------------------------
+polyfit_perf_t *polyfit_perf_create( void );
+
+//--------------------------------------------------------
+// polyfit_perf_destroy()
+// Closes the counters and frees pPerf.
+//--------------------------------------------------------
+void polyfit_perf_destroy( polyfit_perf_t *pPerf );
+
+//--------------------------------------------------------
+// polyfit_perf_attach()
+// Counts the threads threadIds[0 .. threadCount - 1] from
+// now on.  Counters already open on the same threads are
+// kept; counts stay with the thread's position, so thread
+// 0 is always the caller.
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -2 if threadCount is out of range,
+//          -7 if no counter could be opened.
+//--------------------------------------------------------
+int polyfit_perf_attach( polyfit_perf_t *pPerf, const int *threadIds, int threadCount );
+
+//--------------------------------------------------------
+// polyfit_perf_available()
+// Returns true if any counter is open.
+//--------------------------------------------------------
+bool polyfit_perf_available( const polyfit_perf_t *pPerf );
+
+//--------------------------------------------------------
+// polyfit_perf_thread_id()
+// Returns the kernel id of the calling thread, as
+// polyfit_perf_attach() takes it.
+//--------------------------------------------------------
+int polyfit_perf_thread_id( void );
+
+//--------------------------------------------------------
+// polyfit_perf_begin()
+// Reads every counter at the start of a phase.  Does
+// nothing if pPerf is NULL.
+//--------------------------------------------------------
+void polyfit_perf_begin( polyfit_perf_t *pPerf, polyfit_phase_t phase );
+
+//--------------------------------------------------------
+// polyfit_perf_end()
+// Adds what every counter counted since
+// polyfit_perf_begin() to the phase, and pointCount to the
+// points the phase has covered.  Does nothing if pPerf is
+// NULL.
+//--------------------------------------------------------
+void polyfit_perf_end( polyfit_perf_t *pPerf, polyfit_phase_t phase, long pointCount );
+
+//--------------------------------------------------------
+// polyfit_perf_count()
+// Returns what a counter counted in a phase on one
+// thread, or on all of them if thread is -1.  Returns -1
+// if the counter isn't open or an index is out of range.
+//--------------------------------------------------------
+long long polyfit_perf_count( const polyfit_perf_t *pPerf, polyfit_phase_t phase, int thread, polyfit_counter_t counter );
+
+//--------------------------------------------------------
+// polyfit_perf_reset()
+// Zeroes the counts, keeping the counters open.
+//--------------------------------------------------------
+void polyfit_perf_reset( polyfit_perf_t *pPerf );
+
+//--------------------------------------------------------
+// polyfit_perf_print()
+// Writes each phase's cycles, instructions, IPC and
+// misses per point, then each thread's share of the
+// whole fits, headed by title.
+//--------------------------------------------------------
+void polyfit_perf_print( const polyfit_perf_t *pPerf, FILE *pFile, const char *title );
+
+//--------------------------------------------------------
+// polyfit_counter_name()
+// Returns the name of a counter ("cycles", ...).
+//--------------------------------------------------------
+const char *polyfit_counter_name( polyfit_counter_t counter );
+
+
+#endif	// POLYFIT_PERF_H
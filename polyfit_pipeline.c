@@ -0,0 +1,512 @@
+// Name: polyfit_pipeline.c
+// Description: Out-of-core MLS polynomial fitting straight from a CSV file.
+
+#include <fcntl.h>      // open(), posix_fadvise()
+#include <stdio.h>      // NULL
+#include <stdlib.h>     // calloc()
+#include <string.h>     // memchr(), memcpy(), memset()
+#include <unistd.h>     // read(), close()
+
+#include "polyfit_pipeline.h"
+#include "polyfit_csv.h"
+#include "polyfit_sums.h"
+#include <pthread.h>
+
+// Points parsed before each polyfit_sums_add().
+#define PIPELINE_BATCH_POINTS   (512)
+
+// One chunk of whole lines.
+typedef struct pipeline_chunk_s
+{
+    char    *pData;
+    size_t  byteCount;
+    long    firstLine;      // File line number of the first line.
+} pipeline_chunk_t;
+
+// Bounded FIFO of chunk pointers.
+typedef struct pipeline_queue_s
+{
+    pipeline_chunk_t    **ppSlots;
+    int                 capacity;
+    int                 head;
+    int                 count;
+    pthread_mutex_t     mutex;
+    pthread_cond_t      notEmpty;
+    pthread_cond_t      notFull;
+} pipeline_queue_t;
+
+// Malformed lines seen by one thread.
+typedef struct pipeline_malformed_s
+{
+    long    count;
+    int     reportedCount;
+    long    lines[ POLYFIT_PIPELINE_MAX_REPORTED ];     // Lowest line numbers, ascending.
+} pipeline_malformed_t;
+
+// State of one worker thread.
+typedef struct pipeline_worker_s
+{
+    pthread_t               thread;
+    pipeline_queue_t        *pFull;     // Chunks to parse; NULL means stop.
+    pipeline_queue_t        *pFree;     // Parsed chunks go back here.
+    polyfit_sums_t          sums;
+    pipeline_malformed_t    malformed;
+} pipeline_worker_t;
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static int                  initQueue( pipeline_queue_t *pQueue, int capacity );
+static void                 destroyQueue( pipeline_queue_t *pQueue );
+static void                 pushChunk( pipeline_queue_t *pQueue, pipeline_chunk_t *pChunk );
+static pipeline_chunk_t *   popChunk( pipeline_queue_t *pQueue );
+
+static void                 noteMalformed( pipeline_malformed_t *pMalformed, long lineNumber );
+static void                 mergeMalformed( pipeline_malformed_t *pDest, const pipeline_malformed_t *pSrc );
+static long                 countNewlines( const char *pData, size_t byteCount );
+static long                 readFully( int fd, char *pData, size_t byteCount );
+static void *               parseChunks( void *pArg );
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_pipeline_defaults()
+// Fills in the default configuration.
+//--------------------------------------------------------
+void polyfit_pipeline_defaults( polyfit_pipeline_config_t *pConfig )
+{
+    if( NULL != pConfig )
+    {
+        pConfig->chunkBytes = POLYFIT_PIPELINE_CHUNK_BYTES;
+        pConfig->workerCount = POLYFIT_PIPELINE_WORKER_COUNT;
+        pConfig->chunksInFlight = 2 * POLYFIT_PIPELINE_WORKER_COUNT;
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_pipeline_fit()
+// Reads chunks on the calling thread while the workers
+// parse and accumulate them.
+//
+// Each chunk holds whole lines: the partial line at the
+// end of a read is carried over to the start of the next
+// chunk buffer.
+//--------------------------------------------------------
+int polyfit_pipeline_fit( const char *fileName, int coefficientCount, const polyfit_pipeline_config_t *pConfig,
+                          double *coefficientResults, polyfit_pipeline_report_t *pReport )
+{
+    polyfit_pipeline_config_t config;
+    polyfit_sums_t sums;
+
+    if( (NULL == fileName) || (NULL == coefficientResults) )
+    {
+        return -1;
+    }
+    if( NULL == pConfig )
+    {
+        polyfit_pipeline_defaults( &config );
+    }
+    else
+    {
+        config = *pConfig;
+    }
+    if( (config.chunkBytes < POLYFIT_PIPELINE_MIN_CHUNK_BYTES) || (config.workerCount < 1) || (config.chunksInFlight < 2) )
+    {
+        return -2;
+    }
+    if( 0 != polyfit_sums_init( &sums, coefficientCount ) )
+    {
+        return -2;
+    }
+
+    int fd = open( fileName, O_RDONLY );
+    if( fd < 0 )
+    {
+        return -5;
+    }
+    posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+
+    // The chunk pool, plus one buffer for the carried partial line.
+    int bufferCount = config.chunksInFlight;
+    pipeline_chunk_t *pChunks = calloc( bufferCount, sizeof( pipeline_chunk_t ) );
+    char *pBuffers = malloc( (size_t) (bufferCount + 1) * config.chunkBytes );
+    pipeline_worker_t *pWorkers = calloc( config.workerCount, sizeof( pipeline_worker_t ) );
+    pipeline_queue_t fullQueue;
+    pipeline_queue_t freeQueue;
+    int queuesReady = 0;
+    if( (NULL != pChunks) && (NULL != pBuffers) && (NULL != pWorkers) )
+    {
+        queuesReady = (0 == initQueue( &fullQueue, bufferCount + config.workerCount ));
+        if( queuesReady && (0 != initQueue( &freeQueue, bufferCount )) )
+        {
+            destroyQueue( &fullQueue );
+            queuesReady = 0;
+        }
+    }
+    if( !queuesReady )
+    {
+        free( pChunks );
+        free( pBuffers );
+        free( pWorkers );
+        close( fd );
+        return -3;
+    }
+
+    for( int b = 0; b < bufferCount; b++ )
+    {
+        pChunks[b].pData = pBuffers + (size_t) b * config.chunkBytes;
+        pushChunk( &freeQueue, &pChunks[b] );
+    }
+    char *pCarry = pBuffers + (size_t) bufferCount * config.chunkBytes;
+
+    int startedCount = 0;
+    int rVal = 0;
+    for( int w = 0; w < config.workerCount; w++ )
+    {
+        pipeline_worker_t *pWorker = &pWorkers[w];
+        pWorker->pFull = &fullQueue;
+        pWorker->pFree = &freeQueue;
+        polyfit_sums_init( &pWorker->sums, coefficientCount );
+        if( 0 != pthread_create( &pWorker->thread, NULL, parseChunks, pWorker ) )
+        {
+            rVal = -3;
+            break;
+        }
+        startedCount++;
+    }
+
+    // Reader stage.
+    pipeline_malformed_t readerMalformed;
+    memset( &readerMalformed, 0, sizeof( readerMalformed ) );
+    size_t carryCount = 0;
+    long nextLine = 1;
+    long chunkCount = 0;
+    int inHeader = 1;           // Still skipping line 1.
+    int inLongLine = 0;         // Skipping the rest of an overlong line.
+    int atEnd = (0 != rVal);
+    while( !atEnd )
+    {
+        pipeline_chunk_t *pChunk = popChunk( &freeQueue );
+        memcpy( pChunk->pData, pCarry, carryCount );
+
+        long readCount = readFully( fd, pChunk->pData + carryCount, config.chunkBytes - carryCount );
+        if( readCount < 0 )
+        {
+            rVal = -5;
+            pushChunk( &freeQueue, pChunk );
+            break;
+        }
+        size_t byteCount = carryCount + (size_t) readCount;
+        atEnd = (byteCount < config.chunkBytes);
+        carryCount = 0;
+
+        char *pStart = pChunk->pData;
+        char *pEnd = pChunk->pData + byteCount;
+        char *pLastNewline = NULL;
+        for( char *p = pEnd; p > pStart; p-- )
+        {
+            if( '\n' == p[-1] )
+            {
+                pLastNewline = p - 1;
+                break;
+            }
+        }
+
+        if( inHeader || inLongLine )
+        {
+            // Drop everything up to the end of the current line.
+            char *pNewline = memchr( pStart, '\n', byteCount );
+            if( NULL == pNewline )
+            {
+                pushChunk( &freeQueue, pChunk );
+                continue;
+            }
+            pStart = pNewline + 1;
+            nextLine++;
+            inHeader = 0;
+            inLongLine = 0;
+        }
+
+        if( !atEnd )
+        {
+            if( (NULL == pLastNewline) || (pLastNewline < pStart) )
+            {
+                if( pStart == pChunk->pData )
+                {
+                    // A whole buffer without a line end: give up on the line.
+                    noteMalformed( &readerMalformed, nextLine );
+                    inLongLine = 1;
+                }
+                else
+                {
+                    carryCount = (size_t) (pEnd - pStart);
+                    memcpy( pCarry, pStart, carryCount );
+                }
+                pushChunk( &freeQueue, pChunk );
+                continue;
+            }
+            carryCount = (size_t) (pEnd - (pLastNewline + 1));
+            memcpy( pCarry, pLastNewline + 1, carryCount );
+            pEnd = pLastNewline + 1;
+        }
+
+        pChunk->byteCount = (size_t) (pEnd - pStart);
+        if( pStart != pChunk->pData )
+        {
+            memmove( pChunk->pData, pStart, pChunk->byteCount );
+        }
+        pChunk->firstLine = nextLine;
+        nextLine += countNewlines( pChunk->pData, pChunk->byteCount );
+        chunkCount++;
+        pushChunk( &fullQueue, pChunk );
+    }
+    close( fd );
+
+    // Stop the workers, then merge their sums in a fixed order.
+    for( int w = 0; w < startedCount; w++ )
+    {
+        pushChunk( &fullQueue, NULL );
+    }
+    pipeline_malformed_t malformed = readerMalformed;
+    for( int w = 0; w < startedCount; w++ )
+    {
+        pthread_join( pWorkers[w].thread, NULL );
+        polyfit_sums_merge( &sums, &pWorkers[w].sums );
+        mergeMalformed( &malformed, &pWorkers[w].malformed );
+    }
+
+    if( NULL != pReport )
+    {
+        memset( pReport, 0, sizeof( *pReport ) );
+        pReport->pointCount = sums.pointCount;
+        pReport->chunkCount = chunkCount;
+        pReport->bufferBytes = (size_t) (bufferCount + 1) * config.chunkBytes;
+        pReport->malformedCount = malformed.count;
+        pReport->reportedCount = malformed.reportedCount;
+        memcpy( pReport->malformedLines, malformed.lines, sizeof( malformed.lines ) );
+    }
+
+    destroyQueue( &fullQueue );
+    destroyQueue( &freeQueue );
+    free( pWorkers );
+    free( pBuffers );
+    free( pChunks );
+
+    if( 0 != rVal )
+    {
+        return rVal;
+    }
+    return polyfit_sums_solve( &sums, coefficientResults );
+}
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// initQueue()
+// Creates an empty queue of the given capacity.
+//
+// Returns 0 if success, -3 if unable to allocate memory.
+//--------------------------------------------------------
+static int initQueue( pipeline_queue_t *pQueue, int capacity )
+{
+    memset( pQueue, 0, sizeof( *pQueue ) );
+    pQueue->ppSlots = calloc( capacity, sizeof( pipeline_chunk_t * ) );
+    if( NULL == pQueue->ppSlots )
+    {
+        return -3;
+    }
+    pQueue->capacity = capacity;
+    pthread_mutex_init( &pQueue->mutex, NULL );
+    pthread_cond_init( &pQueue->notEmpty, NULL );
+    pthread_cond_init( &pQueue->notFull, NULL );
+    return 0;
+}
+
+//--------------------------------------------------------
+// destroyQueue()
+// Frees a queue made by initQueue().
+//--------------------------------------------------------
+static void destroyQueue( pipeline_queue_t *pQueue )
+{
+    pthread_cond_destroy( &pQueue->notFull );
+    pthread_cond_destroy( &pQueue->notEmpty );
+    pthread_mutex_destroy( &pQueue->mutex );
+    free( pQueue->ppSlots );
+}
+
+//--------------------------------------------------------
+// pushChunk()
+// Appends a chunk, waiting while the queue is full.
+//--------------------------------------------------------
+static void pushChunk( pipeline_queue_t *pQueue, pipeline_chunk_t *pChunk )
+{
+    pthread_mutex_lock( &pQueue->mutex );
+    while( pQueue->count == pQueue->capacity )
+    {
+        pthread_cond_wait( &pQueue->notFull, &pQueue->mutex );
+    }
+    pQueue->ppSlots[ (pQueue->head + pQueue->count) % pQueue->capacity ] = pChunk;
+    pQueue->count++;
+    pthread_cond_signal( &pQueue->notEmpty );
+    pthread_mutex_unlock( &pQueue->mutex );
+}
+
+//--------------------------------------------------------
+// popChunk()
+// Removes the oldest chunk, waiting while the queue is
+// empty.
+//--------------------------------------------------------
+static pipeline_chunk_t *popChunk( pipeline_queue_t *pQueue )
+{
+    pthread_mutex_lock( &pQueue->mutex );
+    while( 0 == pQueue->count )
+    {
+        pthread_cond_wait( &pQueue->notEmpty, &pQueue->mutex );
+    }
+    pipeline_chunk_t *pChunk = pQueue->ppSlots[ pQueue->head ];
+    pQueue->head = (pQueue->head + 1) % pQueue->capacity;
+    pQueue->count--;
+    pthread_cond_signal( &pQueue->notFull );
+    pthread_mutex_unlock( &pQueue->mutex );
+    return pChunk;
+}
+
+//--------------------------------------------------------
+// noteMalformed()
+// Counts a malformed line, keeping the lowest line
+// numbers in ascending order.
+//--------------------------------------------------------
+static void noteMalformed( pipeline_malformed_t *pMalformed, long lineNumber )
+{
+    pMalformed->count++;
+
+    int m = pMalformed->reportedCount;
+    if( m == POLYFIT_PIPELINE_MAX_REPORTED )
+    {
+        if( lineNumber > pMalformed->lines[ m - 1 ] )
+        {
+            return;
+        }
+        m--;
+    }
+    else
+    {
+        pMalformed->reportedCount++;
+    }
+    while( (m > 0) && (pMalformed->lines[ m - 1 ] > lineNumber) )
+    {
+        pMalformed->lines[m] = pMalformed->lines[ m - 1 ];
+        m--;
+    }
+    pMalformed->lines[m] = lineNumber;
+}
+
+//--------------------------------------------------------
+// mergeMalformed()
+// Adds the malformed lines of pSrc into pDest.
+//--------------------------------------------------------
+static void mergeMalformed( pipeline_malformed_t *pDest, const pipeline_malformed_t *pSrc )
+{
+    long count = pDest->count + pSrc->count;
+    for( int m = 0; m < pSrc->reportedCount; m++ )
+    {
+        noteMalformed( pDest, pSrc->lines[m] );
+    }
+    pDest->count = count;
+}
+
+//--------------------------------------------------------
+// countNewlines()
+// Counts the '\n' bytes in a buffer.
+//--------------------------------------------------------
+static long countNewlines( const char *pData, size_t byteCount )
+{
+    long count = 0;
+    const char *pEnd = pData + byteCount;
+    const char *p = pData;
+    while( (p < pEnd) && (NULL != (p = memchr( p, '\n', (size_t) (pEnd - p) ))) )
+    {
+        count++;
+        p++;
+    }
+    return count;
+}
+
+//--------------------------------------------------------
+// readFully()
+// Reads until byteCount bytes arrive or the file ends.
+//
+// Returns the bytes read, or -1 if a read failed.
+//--------------------------------------------------------
+static long readFully( int fd, char *pData, size_t byteCount )
+{
+    size_t total = 0;
+    while( total < byteCount )
+    {
+        ssize_t got = read( fd, pData + total, byteCount - total );
+        if( got < 0 )
+        {
+            return -1;
+        }
+        if( 0 == got )
+        {
+            break;
+        }
+        total += (size_t) got;
+    }
+    return (long) total;
+}
+
+//--------------------------------------------------------
+// parseChunks()
+// Worker thread: parses chunks into its sums until it is
+// handed a NULL chunk.
+//--------------------------------------------------------
+static void *parseChunks( void *pArg )
+{
+    pipeline_worker_t *pWorker = (pipeline_worker_t *) pArg;
+    double xBatch[ PIPELINE_BATCH_POINTS ];
+    double yBatch[ PIPELINE_BATCH_POINTS ];
+
+    pipeline_chunk_t *pChunk;
+    while( NULL != (pChunk = popChunk( pWorker->pFull )) )
+    {
+        int batchCount = 0;
+        long lineNumber = pChunk->firstLine;
+        const char *p = pChunk->pData;
+        const char *pEnd = pChunk->pData + pChunk->byteCount;
+        while( p < pEnd )
+        {
+            const char *pNewline = memchr( p, '\n', (size_t) (pEnd - p) );
+            const char *pLineEnd = (NULL == pNewline) ? pEnd : pNewline;
+
+            int parsed = polyfit_csv_parse_line( p, pLineEnd, &xBatch[ batchCount ], &yBatch[ batchCount ] );
+            if( parsed > 0 )
+            {
+                if( ++batchCount == PIPELINE_BATCH_POINTS )
+                {
+                    polyfit_sums_add( &pWorker->sums, batchCount, xBatch, yBatch );
+                    batchCount = 0;
+                }
+            }
+            else if( parsed < 0 )
+            {
+                noteMalformed( &pWorker->malformed, lineNumber );
+            }
+
+            lineNumber++;
+            p = pLineEnd + 1;
+        }
+        polyfit_sums_add( &pWorker->sums, batchCount, xBatch, yBatch );
+
+        pushChunk( pWorker->pFree, pChunk );
+    }
+    return NULL;
+}
@@ -0,0 +1,80 @@
+// file: polyfit_pipeline.h
+// Description: Out-of-core MLS polynomial fitting straight from a CSV file.
+//
+// The calling thread reads the file in fixed-size chunks, cut at
+// line boundaries, into a fixed pool of buffers.  Worker threads
+// take filled chunks from a bounded queue, parse them and fold the
+// points into their own polyfit_sums_t, then hand the buffers back.
+// Reading and parsing overlap, and memory use is set by the chunk
+// size and the number of chunks in flight, not by the file size.
+
+#ifndef POLYFIT_PIPELINE_H
+#define POLYFIT_PIPELINE_H
+
+#include <stddef.h>     // size_t
+
+// Defaults used by polyfit_pipeline_defaults().
+#define POLYFIT_PIPELINE_CHUNK_BYTES        (4 * 1024 * 1024)
+#define POLYFIT_PIPELINE_WORKER_COUNT       (8)
+
+// Smallest chunk accepted; also the longest line handled.
+#define POLYFIT_PIPELINE_MIN_CHUNK_BYTES    (4 * 1024)
+
+// Most malformed line numbers kept in a report.
+#define POLYFIT_PIPELINE_MAX_REPORTED       (16)
+
+// How a pipeline runs.
+typedef struct polyfit_pipeline_config_s
+{
+    size_t  chunkBytes;         // Bytes read per chunk.
+    int     chunksInFlight;     // Chunk buffers; at least 2 so reading overlaps parsing.
+    int     workerCount;        // Parsing threads.
+} polyfit_pipeline_config_t;
+
+// What a pipeline did.
+typedef struct polyfit_pipeline_report_s
+{
+    long    pointCount;
+    long    chunkCount;
+    size_t  bufferBytes;        // Memory held for chunks; the peak for the whole run.
+
+    long    malformedCount;
+    int     reportedCount;
+    long    malformedLines[ POLYFIT_PIPELINE_MAX_REPORTED ];   // Lowest malformed line numbers, 1-based.
+} polyfit_pipeline_report_t;
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_pipeline_defaults()
+// Fills in the default configuration: 4 MiB chunks, 8
+// workers, and two chunks in flight per worker.
+//--------------------------------------------------------
+void polyfit_pipeline_defaults( polyfit_pipeline_config_t *pConfig );
+
+//--------------------------------------------------------
+// polyfit_pipeline_fit()
+// Fits the "x,y" lines of a CSV file (after its header
+// line) without loading the file.  Parsing follows
+// polyfit_csv_load(); a line longer than chunkBytes is
+// reported as malformed.  pConfig and pReport may be NULL.
+//
+// The coefficients match polyfit_stream() on the loaded
+// points, up to rounding in the order of summation.
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -2 if fewer points than coefficients were read,
+//             or coefficientCount or pConfig is out of range,
+//          -3 if unable to allocate memory or start threads,
+//          -4 if the equations are numerically singular,
+//          -5 if the file can't be opened or read.
+//--------------------------------------------------------
+int polyfit_pipeline_fit( const char *fileName, int coefficientCount, const polyfit_pipeline_config_t *pConfig,
+                          double *coefficientResults, polyfit_pipeline_report_t *pReport );
+
+
+#endif	// POLYFIT_PIPELINE_H
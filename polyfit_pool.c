@@ -0,0 +1,271 @@
+// Name: polyfit_pool.c
+// Description: Persistent pool of worker threads.
+
+#include <stdio.h>      // NULL
+#include <stdlib.h>     // calloc(), getenv(), strtol()
+#include <unistd.h>     // sysconf()
+
+#include "polyfit_pool.h"
+#include <pthread.h>
+
+// One pool thread.
+typedef struct pool_worker_s
+{
+    pthread_t       thread;
+    int             index;          // Participant number, 1 .. threadCount - 1.
+    polyfit_pool_t  *pPool;
+} pool_worker_t;
+
+struct polyfit_pool_s
+{
+    int                 threadCount;
+    int                 teamCount;      // Participants in the current run.
+    pool_worker_t       *pWorkers;      // threadCount - 1 threads.
+    int                 startedCount;
+
+    pthread_mutex_t     runMutex;       // Held for a whole run.
+    pthread_mutex_t     mutex;          // Guards the fields below.
+    pthread_cond_t      startCond;
+    pthread_cond_t      doneCond;
+    unsigned long       generation;     // Bumped to start a run.
+    int                 pendingCount;   // Pool threads still in the run.
+    int                 stopping;
+    polyfit_pool_task_t pTask;
+    void                *pArg;
+
+    pthread_barrier_t   barrier;        // Sized for teamCount.
+};
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static void *   runWorker( void *pArg );
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_pool_create()
+// Starts the pool threads; they wait for the first run.
+//--------------------------------------------------------
+polyfit_pool_t *polyfit_pool_create( int threadCount )
+{
+    if( threadCount < 1 )
+    {
+        return NULL;
+    }
+
+    polyfit_pool_t *pPool = (polyfit_pool_t *) calloc( 1, sizeof( polyfit_pool_t ) );
+    if( NULL == pPool )
+    {
+        return NULL;
+    }
+    pPool->pWorkers = (pool_worker_t *) calloc( threadCount, sizeof( pool_worker_t ) );
+    if( NULL == pPool->pWorkers )
+    {
+        free( pPool );
+        return NULL;
+    }
+
+    pPool->threadCount = threadCount;
+    pPool->teamCount = threadCount;
+    pthread_mutex_init( &pPool->runMutex, NULL );
+    pthread_mutex_init( &pPool->mutex, NULL );
+    pthread_cond_init( &pPool->startCond, NULL );
+    pthread_cond_init( &pPool->doneCond, NULL );
+    pthread_barrier_init( &pPool->barrier, NULL, threadCount );
+
+    for( int i = 1; i < threadCount; i++ )
+    {
+        pool_worker_t *pWorker = &pPool->pWorkers[ i - 1 ];
+        pWorker->index = i;
+        pWorker->pPool = pPool;
+        if( 0 != pthread_create( &pWorker->thread, NULL, runWorker, pWorker ) )
+        {
+            polyfit_pool_destroy( pPool );
+            return NULL;
+        }
+        pPool->startedCount++;
+    }
+    return pPool;
+}
+
+//--------------------------------------------------------
+// polyfit_pool_destroy()
+// Waits out any run in progress, then stops and joins the
+// threads, and frees the pool.
+//--------------------------------------------------------
+void polyfit_pool_destroy( polyfit_pool_t *pPool )
+{
+    if( NULL == pPool )
+    {
+        return;
+    }
+
+    pthread_mutex_lock( &pPool->runMutex );
+    pthread_mutex_lock( &pPool->mutex );
+    pPool->stopping = 1;
+    pthread_cond_broadcast( &pPool->startCond );
+    pthread_mutex_unlock( &pPool->mutex );
+    pthread_mutex_unlock( &pPool->runMutex );
+
+    for( int i = 0; i < pPool->startedCount; i++ )
+    {
+        pthread_join( pPool->pWorkers[i].thread, NULL );
+    }
+
+    pthread_barrier_destroy( &pPool->barrier );
+    pthread_cond_destroy( &pPool->doneCond );
+    pthread_cond_destroy( &pPool->startCond );
+    pthread_mutex_destroy( &pPool->mutex );
+    pthread_mutex_destroy( &pPool->runMutex );
+    free( pPool->pWorkers );
+    free( pPool );
+}
+
+//--------------------------------------------------------
+// polyfit_pool_size()
+// Returns the number of participants in a run.
+//--------------------------------------------------------
+int polyfit_pool_size( const polyfit_pool_t *pPool )
+{
+    return (NULL == pPool) ? 0 : pPool->threadCount;
+}
+
+//--------------------------------------------------------
+// polyfit_pool_run()
+// A run of the whole pool.
+//--------------------------------------------------------
+void polyfit_pool_run( polyfit_pool_t *pPool, polyfit_pool_task_t pTask, void *pArg )
+{
+    polyfit_pool_run_team( pPool, pPool->threadCount, pTask, pArg );
+}
+
+//--------------------------------------------------------
+// polyfit_pool_run_team()
+// Wakes the pool threads, runs participant 0 on the
+// calling thread, then waits for the rest of the team.
+// Threads outside the team see the run start and go back
+// to sleep.  The barrier is resized only when the team
+// size changes, while no run can be waiting on it.
+//--------------------------------------------------------
+void polyfit_pool_run_team( polyfit_pool_t *pPool, int teamCount, polyfit_pool_task_t pTask, void *pArg )
+{
+    if( (teamCount < 1) || (teamCount > pPool->threadCount) )
+    {
+        teamCount = pPool->threadCount;
+    }
+
+    pthread_mutex_lock( &pPool->runMutex );
+
+    if( teamCount != pPool->teamCount )
+    {
+        pthread_barrier_destroy( &pPool->barrier );
+        pthread_barrier_init( &pPool->barrier, NULL, teamCount );
+    }
+
+    pthread_mutex_lock( &pPool->mutex );
+    pPool->teamCount = teamCount;
+    pPool->pTask = pTask;
+    pPool->pArg = pArg;
+    pPool->pendingCount = teamCount - 1;
+    pPool->generation++;
+    pthread_cond_broadcast( &pPool->startCond );
+    pthread_mutex_unlock( &pPool->mutex );
+
+    pTask( pArg, 0, teamCount );
+
+    pthread_mutex_lock( &pPool->mutex );
+    while( pPool->pendingCount > 0 )
+    {
+        pthread_cond_wait( &pPool->doneCond, &pPool->mutex );
+    }
+    pthread_mutex_unlock( &pPool->mutex );
+
+    pthread_mutex_unlock( &pPool->runMutex );
+}
+
+//--------------------------------------------------------
+// polyfit_pool_barrier()
+// Waits for every participant of the current run.
+//--------------------------------------------------------
+void polyfit_pool_barrier( polyfit_pool_t *pPool )
+{
+    if( pPool->teamCount > 1 )
+    {
+        pthread_barrier_wait( &pPool->barrier );
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_pool_default_size()
+// POLYFIT_THREADS, or else the number of online CPUs.
+//--------------------------------------------------------
+int polyfit_pool_default_size( void )
+{
+    const char *pSetting = getenv( POLYFIT_POOL_THREADS_ENV );
+    if( NULL != pSetting )
+    {
+        long threadCount = strtol( pSetting, NULL, 10 );
+        if( (threadCount > 0) && (threadCount <= 1024) )
+        {
+            return (int) threadCount;
+        }
+    }
+
+    long cpuCount = sysconf( _SC_NPROCESSORS_ONLN );
+    return (cpuCount > 0) ? (int) cpuCount : 1;
+}
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// runWorker()
+// Pool thread: runs the task of each new generation it is
+// part of the team for, until the pool is stopped.
+//--------------------------------------------------------
+static void *runWorker( void *pArg )
+{
+    pool_worker_t *pWorker = (pool_worker_t *) pArg;
+    polyfit_pool_t *pPool = pWorker->pPool;
+    unsigned long seenGeneration = 0;
+
+    for( ;; )
+    {
+        pthread_mutex_lock( &pPool->mutex );
+        while( (seenGeneration == pPool->generation) && !pPool->stopping )
+        {
+            pthread_cond_wait( &pPool->startCond, &pPool->mutex );
+        }
+        if( pPool->stopping )
+        {
+            pthread_mutex_unlock( &pPool->mutex );
+            break;
+        }
+        seenGeneration = pPool->generation;
+        polyfit_pool_task_t pTask = pPool->pTask;
+        void *pTaskArg = pPool->pArg;
+        int teamCount = pPool->teamCount;
+        pthread_mutex_unlock( &pPool->mutex );
+
+        if( pWorker->index >= teamCount )
+        {
+            continue;
+        }
+        pTask( pTaskArg, pWorker->index, teamCount );
+
+        pthread_mutex_lock( &pPool->mutex );
+        if( 0 == --pPool->pendingCount )
+        {
+            pthread_cond_signal( &pPool->doneCond );
+        }
+        pthread_mutex_unlock( &pPool->mutex );
+    }
+    return NULL;
+}
@@ -0,0 +1,82 @@
+// file: polyfit_pool.h
+// Description: Persistent pool of worker threads.
+//
+// The threads are created once and sleep between runs.  A run calls
+// one task function on every participant at the same time (the
+// calling thread is participant 0), like an OpenMP parallel region,
+// so a phase costs a wake-up instead of a pthread_create() and
+// pthread_join() per thread.
+
+#ifndef POLYFIT_POOL_H
+#define POLYFIT_POOL_H
+
+// Environment variable that sets polyfit_pool_default_size().
+#define POLYFIT_POOL_THREADS_ENV    "POLYFIT_THREADS"
+
+// Work run by each participant: thread is 0 .. threadCount - 1.
+typedef void (*polyfit_pool_task_t)( void *pArg, int thread, int threadCount );
+
+typedef struct polyfit_pool_s polyfit_pool_t;
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_pool_create()
+// Starts a pool with threadCount participants: the caller
+// of polyfit_pool_run() plus threadCount - 1 threads.
+//
+// Returns the pool, or NULL if threadCount < 1 or the
+// threads can't be started.
+//--------------------------------------------------------
+polyfit_pool_t *polyfit_pool_create( int threadCount );
+
+//--------------------------------------------------------
+// polyfit_pool_destroy()
+// Stops and joins the threads, and frees the pool.  A run
+// in progress is finished first, but the caller must make
+// sure no new one is started.
+//--------------------------------------------------------
+void polyfit_pool_destroy( polyfit_pool_t *pPool );
+
+//--------------------------------------------------------
+// polyfit_pool_size()
+// Returns the number of participants in a run.
+//--------------------------------------------------------
+int polyfit_pool_size( const polyfit_pool_t *pPool );
+
+//--------------------------------------------------------
+// polyfit_pool_run()
+// Calls pTask( pArg, thread, threadCount ) on every
+// participant and returns when all have finished.  Runs
+// from several threads are taken one at a time.
+//--------------------------------------------------------
+void polyfit_pool_run( polyfit_pool_t *pPool, polyfit_pool_task_t pTask, void *pArg );
+
+//--------------------------------------------------------
+// polyfit_pool_run_team()
+// Same as polyfit_pool_run(), but only participants 0 ..
+// teamCount - 1 take part, and threadCount is teamCount.
+// teamCount < 1 or above polyfit_pool_size() means the
+// whole pool.
+//--------------------------------------------------------
+void polyfit_pool_run_team( polyfit_pool_t *pPool, int teamCount, polyfit_pool_task_t pTask, void *pArg );
+
+//--------------------------------------------------------
+// polyfit_pool_barrier()
+// Waits until every participant of the current run has
+// reached the barrier.  Only valid inside a task.
+//--------------------------------------------------------
+void polyfit_pool_barrier( polyfit_pool_t *pPool );
+
+//--------------------------------------------------------
+// polyfit_pool_default_size()
+// Returns the POLYFIT_THREADS environment variable if it
+// is a positive number, or else the number of online CPUs.
+//--------------------------------------------------------
+int polyfit_pool_default_size( void );
+
+
+#endif	// POLYFIT_POOL_H
@@ -0,0 +1,230 @@
+// Name: polyfit_qr.c
+// Description: MLS polynomial fitting by tall-skinny QR (TSQR).
+
+#include <float.h>      // DBL_EPSILON, DBL_MAX
+#include <math.h>       // sqrt(), fmin(), fmax()
+#include <stdio.h>      // NULL
+#include <stdlib.h>     // calloc()
+
+#include "polyfit_qr.h"
+#include "polyfit_sums.h"
+#include <omp.h>
+
+// Rows of A factored into a thread's R at a time.
+#define QR_PANEL_ROWS   (64)
+
+// MACRO to round a per-thread R factor or panel up to whole
+// 64-byte cache lines, so threads don't share lines.
+#define PARTIAL_SIZE( count )  ((((count) + 7) / 8) * 8)
+
+// MACRO to access a value in a matrix of rows with (cols) columns.
+#define ROW_VALUE( p, cols, row, col )  ((p)[ ((row) * (cols)) + (col) ])
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static void factorStacked( int k, double *pR, int rowCount, double *pRows );
+static void fillPanel( int k, int rowCount, double shift, double scale, const double *xValues, const double *yValues,
+                       double *pRows );
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_qr()
+// Fits by TSQR.
+//
+// R is kept augmented with the matching rows of (QT)b, as
+// a k x (k+1) matrix [ R | (QT)b ], so b never needs to be
+// stored and the coefficients follow from R x = (QT)b.
+// Each thread's R and panel of rows come from one heap
+// block, so a large coefficientCount can't overrun an
+// OpenMP worker's stack.
+//--------------------------------------------------------
+int polyfit_qr( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults )
+{
+    int rVal = 0;
+    int k = coefficientCount;
+    int cols = k + 1;
+
+    // Check that the input pointers aren't null.
+    if( (NULL == xValues) || (NULL == yValues) || (NULL == coefficientResults) )
+    {
+        return -1;
+    }
+    // Check that pointCount >= coefficientCount.
+    if( (pointCount < coefficientCount) || (coefficientCount <= 0) )
+    {
+        return -2;
+    }
+
+    // Fit in t = (x - shift) * scale in [-1, 1], so every
+    // column of A is at most 1 in magnitude, data far from 0
+    // keeps its low powers distinct, and the rank test below
+    // is scale independent.
+    double xMin = DBL_MAX;
+    double xMax = -DBL_MAX;
+    #pragma omp parallel for reduction(min:xMin) reduction(max:xMax)
+    for( int i = 0; i < pointCount; i++ )
+    {
+        xMin = fmin( xMin, xValues[i] );
+        xMax = fmax( xMax, xValues[i] );
+    }
+    double shift = 0.5 * (xMin + xMax);
+    double scale = (xMax > xMin) ? (2.0 / (xMax - xMin)) : 1.0;
+
+    // Per thread, R then a panel; then the coefficients in t.
+    int partialSize = PARTIAL_SIZE( k * cols );
+    int blockSize = partialSize + PARTIAL_SIZE( QR_PANEL_ROWS * cols );
+    int maxThreads = omp_get_max_threads();
+    double *pRs = (double *) calloc( (size_t) maxThreads * blockSize + k, sizeof( double ) );
+    if( NULL == pRs )
+    {
+        return -3;
+    }
+
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        int start = (int) (((long) pointCount * t) / nt);
+        int end = (int) (((long) pointCount * (t + 1)) / nt);
+        double *pR = &pRs[ (size_t) t * blockSize ];
+        double *pRows = &pR[ partialSize ];
+
+        // Factor this thread's block of A one panel at a time.
+        for( int p = start; p < end; p += QR_PANEL_ROWS )
+        {
+            int rowCount = (end - p < QR_PANEL_ROWS) ? (end - p) : QR_PANEL_ROWS;
+            fillPanel( k, rowCount, shift, scale, &xValues[p], &yValues[p], pRows );
+            factorStacked( k, pR, rowCount, pRows );
+        }
+
+        // Reduce the R factors pairwise: R of [R1; R2] replaces R1.
+        for( int stride = 1; stride < nt; stride *= 2 )
+        {
+            #pragma omp barrier
+            if( (0 == (t % (2 * stride))) && (t + stride < nt) )
+            {
+                factorStacked( k, pR, k, &pRs[ (size_t) (t + stride) * blockSize ] );
+            }
+        }
+    }
+
+    // Back substitution: R x = (QT)b.
+    double *pR = pRs;
+    double *inT = &pRs[ (size_t) maxThreads * blockSize ];
+    double maxDiagonal = 0.0;
+    for( int i = 0; i < k; i++ )
+    {
+        maxDiagonal = fmax( maxDiagonal, fabs( ROW_VALUE( pR, cols, i, i ) ) );
+    }
+    for( int i = k - 1; i >= 0; i-- )
+    {
+        double rii = ROW_VALUE( pR, cols, i, i );
+        if( fabs( rii ) <= (k * DBL_EPSILON * maxDiagonal) )
+        {
+            rVal = -4;
+            break;
+        }
+        double sum = ROW_VALUE( pR, cols, i, k );
+        for( int c = i + 1; c < k; c++ )
+        {
+            sum -= ROW_VALUE( pR, cols, i, c ) * inT[c];
+        }
+        inT[i] = sum / rii;
+    }
+
+    if( 0 == rVal )
+    {
+        polyfit_unscale( k, shift, scale, inT, coefficientResults );
+    }
+
+    free( pRs );
+    return rVal;
+}
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// fillPanel()
+// Writes rowCount rows of [ A | b ] for t = (x - shift) *
+// scale: row r is { t^degree, ... t^1, t^0, y }.
+//--------------------------------------------------------
+static void fillPanel( int k, int rowCount, double shift, double scale, const double *xValues, const double *yValues,
+                       double *pRows )
+{
+    int cols = k + 1;
+    for( int r = 0; r < rowCount; r++ )
+    {
+        double t = (xValues[r] - shift) * scale;
+        double tPow = 1.0;
+        for( int c = k - 1; c >= 0; c-- )
+        {
+            ROW_VALUE( pRows, cols, r, c ) = tPow;
+            tPow *= t;
+        }
+        ROW_VALUE( pRows, cols, r, k ) = yValues[r];
+    }
+}
+
+//--------------------------------------------------------
+// factorStacked()
+// Replaces the k x (k+1) upper triangular pR with the R
+// factor of the stacked matrix [ pR ; pRows ], where pRows
+// has rowCount rows of k+1 columns.  pRows is overwritten.
+//
+// Below the diagonal pR is zero, so each Householder
+// reflector only touches row j of pR and the rows of pRows.
+//--------------------------------------------------------
+static void factorStacked( int k, double *pR, int rowCount, double *pRows )
+{
+    int cols = k + 1;
+
+    for( int j = 0; j < k; j++ )
+    {
+        double alpha = ROW_VALUE( pR, cols, j, j );
+        double sigma = 0.0;
+        for( int m = 0; m < rowCount; m++ )
+        {
+            sigma += ROW_VALUE( pRows, cols, m, j ) * ROW_VALUE( pRows, cols, m, j );
+        }
+        if( 0.0 == sigma )
+        {
+            continue;   // Column is already reduced.
+        }
+
+        // Reflector H = I - tau * v * (vT), with v = { 1, v_m }.
+        double norm = sqrt( alpha * alpha + sigma );
+        double beta = (alpha >= 0.0) ? -norm : norm;
+        double tau = (beta - alpha) / beta;
+        double scale = 1.0 / (alpha - beta);
+        for( int m = 0; m < rowCount; m++ )
+        {
+            ROW_VALUE( pRows, cols, m, j ) *= scale;
+        }
+        ROW_VALUE( pR, cols, j, j ) = beta;
+
+        // Apply H to the remaining columns, including (QT)b.
+        for( int c = j + 1; c < cols; c++ )
+        {
+            double w = ROW_VALUE( pR, cols, j, c );
+            for( int m = 0; m < rowCount; m++ )
+            {
+                w += ROW_VALUE( pRows, cols, m, j ) * ROW_VALUE( pRows, cols, m, c );
+            }
+            w *= tau;
+            ROW_VALUE( pR, cols, j, c ) -= w;
+            for( int m = 0; m < rowCount; m++ )
+            {
+                ROW_VALUE( pRows, cols, m, c ) -= w * ROW_VALUE( pRows, cols, m, j );
+            }
+        }
+    }
+}
@@ -0,0 +1,33 @@
+// file: polyfit_qr.h
+// Description: MLS polynomial fitting by tall-skinny QR (TSQR).
+//
+// Solving the normal equations squares the condition number of A,
+// which loses most of the digits of a high-degree fit.  Here A is
+// factored directly: each thread Householder-factors the rows of A
+// for its block of points, and the small R factors are combined
+// pairwise in a tree, so the fit stays numerically stable while
+// still scaling across cores.
+
+#ifndef POLYFIT_QR_H
+#define POLYFIT_QR_H
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_qr()
+// Same contract as polyfit(), but solves the least squares
+// problem A x = b by TSQR instead of forming (AT)A.
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -2 if (pointCount < coefficientCount),
+//          -3 if unable to allocate memory,
+//          -4 if A is numerically rank deficient.
+//--------------------------------------------------------
+int polyfit_qr( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults );
+
+
+#endif	// POLYFIT_QR_H
@@ -0,0 +1,232 @@
+// Name: polyfit_rolling.c
+// Description: Rolling-window MLS fitting with add/remove updates,
+//              split into segments over OpenMP threads.
+
+#include <limits.h>     // INT_MAX
+#include <math.h>       // floor(), isfinite()
+#include <stdbool.h>    // bool
+#include <stdio.h>      // NULL
+#include <string.h>     // memset()
+
+#include "polyfit_online.h"
+#include "polyfit_rolling.h"
+#include <omp.h>
+
+// Everything a segment needs to know about the job.
+typedef struct
+{
+    int                 pointCount;
+    const double        *xValues;
+    const double        *yValues;
+    int                 coefficientCount;
+    polyfit_window_t    window;
+    double              windowLength;
+    double              *coefficientResults;
+    int                 *windowResults;
+} RollingJob;
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static int  checkWindow( int pointCount, const double *xValues, polyfit_window_t window, double windowLength );
+static int  rollSegment( const RollingJob *pJob, long first, long last );
+static long findStart( const RollingJob *pJob, long end, long from );
+static void rebase( const RollingJob *pJob, long start, long end, polyfit_online_t *pOnline );
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_rolling()
+// Thread t rolls the windows ending in the t'th slice of
+// the series, as openmp_polyfit_stream() slices points.
+//--------------------------------------------------------
+int polyfit_rolling( int pointCount, const double *xValues, const double *yValues, int coefficientCount,
+                     polyfit_window_t window, double windowLength, int threadCount,
+                     double *coefficientResults, int *windowResults )
+{
+    if( (NULL == xValues) || (NULL == yValues) || (NULL == coefficientResults) )
+    {
+        return -1;
+    }
+    if( (pointCount < 0) || (coefficientCount <= 0) || (coefficientCount > POLYFIT_MAX_COEFFICIENTS) ||
+        (0 != checkWindow( pointCount, xValues, window, windowLength )) )
+    {
+        return -2;
+    }
+
+    RollingJob job = { pointCount, xValues, yValues, coefficientCount, window, windowLength,
+                       coefficientResults, windowResults };
+    int failCount = 0;
+
+    if( threadCount < 1 )
+    {
+        threadCount = omp_get_max_threads();
+    }
+
+    #pragma omp parallel num_threads( threadCount ) reduction( + : failCount )
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        long first = ((long) pointCount * t) / nt;
+        long last = ((long) pointCount * (t + 1)) / nt;
+
+        failCount += rollSegment( &job, first, last );
+    }
+    return failCount;
+}
+
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// checkWindow()
+// Returns 0 if the window can be rolled over the series,
+// or -2.
+//--------------------------------------------------------
+static int checkWindow( int pointCount, const double *xValues, polyfit_window_t window, double windowLength )
+{
+    if( POLYFIT_WINDOW_POINTS == window )
+    {
+        bool isWhole = (windowLength >= 1.0) && (windowLength <= INT_MAX) && (windowLength == floor( windowLength ));
+        return isWhole ? 0 : -2;
+    }
+    if( (POLYFIT_WINDOW_SPAN != window) || !isfinite( windowLength ) || !(windowLength > 0.0) )
+    {
+        return -2;
+    }
+    for( int i = 0; i < pointCount; i++ )
+    {
+        if( !isfinite( xValues[i] ) || ((i > 0) && (xValues[i] < xValues[ i - 1 ])) )
+        {
+            return -2;
+        }
+    }
+    return 0;
+}
+
+//--------------------------------------------------------
+// rollSegment()
+// Fits the windows ending at points first up to last.
+// The first window is built from scratch; after that each
+// step adds the new point and removes those the window's
+// start has passed, unless the window has turned over
+// since the last rebase, when it is rebuilt instead.
+//
+// Returns the number of windows not fitted.
+//--------------------------------------------------------
+static int rollSegment( const RollingJob *pJob, long first, long last )
+{
+    polyfit_online_t online;
+    int k = pJob->coefficientCount;
+    long start = 0;
+    long rebaseEnd = -1;        // Last point of the last rebuild.
+    int failCount = 0;
+
+    for( long i = first; i < last; i++ )
+    {
+        long newStart = findStart( pJob, i, start );
+
+        if( (i == first) || (newStart > rebaseEnd) )
+        {
+            rebase( pJob, newStart, i, &online );
+            rebaseEnd = i;
+        }
+        else
+        {
+            polyfit_online_add( &online, 1, &pJob->xValues[i], &pJob->yValues[i] );
+            polyfit_online_remove( &online, (int) (newStart - start), &pJob->xValues[ start ], &pJob->yValues[ start ] );
+        }
+        start = newStart;
+
+        double *pResult = &pJob->coefficientResults[ (size_t) i * k ];
+        int status = -2;
+        if( (POLYFIT_WINDOW_SPAN == pJob->window) || (i + 1 >= (long) pJob->windowLength) )
+        {
+            status = polyfit_online_solve( &online, pResult );
+        }
+        if( 0 != status )
+        {
+            memset( pResult, 0, k * sizeof( double ) );
+            failCount++;
+        }
+        if( NULL != pJob->windowResults )
+        {
+            pJob->windowResults[i] = status;
+        }
+    }
+    return failCount;
+}
+
+//--------------------------------------------------------
+// findStart()
+// Returns the first point of the window ending at end.
+// For a span, the search goes forward from a previous
+// window's start, from, or by bisection on a segment's
+// first window.  The window always holds end itself, even
+// if windowLength is lost in the rounding of x[end].
+//--------------------------------------------------------
+static long findStart( const RollingJob *pJob, long end, long from )
+{
+    if( POLYFIT_WINDOW_POINTS == pJob->window )
+    {
+        long start = end - (long) pJob->windowLength + 1;
+        return (start > 0) ? start : 0;
+    }
+
+    const double *x = pJob->xValues;
+    double limit = x[ end ] - pJob->windowLength;
+
+    if( 0 == from )
+    {
+        long low = 0;
+        long high = end;
+        while( low < high )
+        {
+            long middle = low + (high - low) / 2;
+            if( x[ middle ] > limit )
+            {
+                high = middle;
+            }
+            else
+            {
+                low = middle + 1;
+            }
+        }
+        return low;
+    }
+
+    while( (from < end) && (x[ from ] <= limit) )
+    {
+        from++;
+    }
+    return from;
+}
+
+//--------------------------------------------------------
+// rebase()
+// Rebuilds pOnline from the points start to end, with t
+// centered on their x range and scaled to [-1, 1].
+//--------------------------------------------------------
+static void rebase( const RollingJob *pJob, long start, long end, polyfit_online_t *pOnline )
+{
+    const double *x = pJob->xValues;
+    double xMin = x[ start ];
+    double xMax = x[ start ];
+
+    for( long i = start + 1; i <= end; i++ )
+    {
+        xMin = (x[i] < xMin) ? x[i] : xMin;
+        xMax = (x[i] > xMax) ? x[i] : xMax;
+    }
+
+    double scale = (xMax > xMin) ? (2.0 / (xMax - xMin)) : 1.0;
+    polyfit_online_init( pOnline, pJob->coefficientCount, 0.5 * (xMin + xMax), scale );
+    polyfit_online_add( pOnline, (int) (end - start + 1), &x[ start ], &pJob->yValues[ start ] );
+}
@@ -0,0 +1,56 @@
+// file: polyfit_rolling.h
+// Description: MLS fits of every position of a window rolled along a
+//              series, in one pass.
+//
+// Fitting each window with polyfit() costs O(pointCount * window).
+// polyfit_rolling() instead moves one polyfit_online_t along the
+// series, adding each point as the window reaches it and removing it
+// as the window leaves it, so each position costs O(coefficientCount)
+// to update and O(coefficientCount^3) to solve.  The series is split
+// into one segment per OpenMP thread, each of which warms up its own
+// window at its start.
+//
+// Whenever the window has moved entirely past the points it held at
+// the last rebase, it is rebuilt from its current points with t
+// centered and scaled on them.  That keeps t near [-1, 1] however far
+// the window travels, for O(coefficientCount) extra per position.
+
+#ifndef POLYFIT_ROLLING_H
+#define POLYFIT_ROLLING_H
+
+// How the window's length is measured.
+typedef enum polyfit_window_e
+{
+    POLYFIT_WINDOW_POINTS = 0,  // The last windowLength points, up to and including this one.
+    POLYFIT_WINDOW_SPAN,        // The points with x in (x - windowLength, x]; x must be sorted.
+    POLYFIT_WINDOW_TYPE_COUNT
+} polyfit_window_t;
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_rolling()
+// Fits the window ending at each point i of the series,
+// with coefficientCount terms, highest power first, into
+// coefficientResults[i * coefficientCount], and its
+// polyfit() status to windowResults[i]: 0, -2 if it holds
+// fewer points than coefficients (or, by points, isn't
+// full yet), -4 if singular.  A window that isn't fitted
+// gets zero coefficients.  windowResults may be NULL.
+// threadCount <= 0 uses the OpenMP default.
+//
+// Returns the number of windows not fitted, or
+//          -1 if passed a NULL pointer,
+//          -2 if coefficientCount or windowLength is out of
+//             range (a whole number of points >= 1, or a
+//             positive span), or x isn't sorted for a span.
+//--------------------------------------------------------
+int polyfit_rolling( int pointCount, const double *xValues, const double *yValues, int coefficientCount,
+                     polyfit_window_t window, double windowLength, int threadCount,
+                     double *coefficientResults, int *windowResults );
+
+
+#endif	// POLYFIT_ROLLING_H
@@ -0,0 +1,344 @@
+// Name: polyfit_roofline.c
+// Description: Machine peaks for a roofline view of the fit phases.
+
+#include <stdio.h>      // NULL
+#include <stdlib.h>     // malloc(), free()
+#include <omp.h>
+
+#include "polyfit_roofline.h"
+#include "polyfit_stats.h"
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#define POLYFIT_ROOFLINE_X86 1
+#include <immintrin.h>
+#endif  // __x86_64__ || __i386__
+
+// Each kernel is run this many times and its best kept.
+#define TRIAL_COUNT         (5)
+
+// The peak kernel's iterations double until a run takes at
+// least this long.
+#define MIN_PEAK_SECONDS    (0.05)
+
+// Independent chains in the peak kernels: enough to cover
+// the multiply-add latency on two pipes.
+#define CHAIN_COUNT         (8)
+
+// Multiplier and addend of the chains; each chain stays
+// near 1, so nothing overflows or goes subnormal.
+#define CHAIN_SCALE         (0.999999)
+#define CHAIN_STEP          (1e-6)
+
+// Returns the sum of CHAIN_COUNT chains run for iterations
+// steps.  Each step is one multiply and one add per lane.
+typedef double (*PeakKernel)( long iterations );
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static double   measureBandwidth( int threadCount, double *pA, double *pB, double *pC );
+static double   measurePeak( int threadCount, PeakKernel pKernel, int laneCount );
+static double   peakScalar( long iterations );
+#ifdef POLYFIT_ROOFLINE_X86
+static double   peakSse2( long iterations );
+static double   peakAvx2( long iterations );
+static double   peakAvx512( long iterations );
+#endif  // POLYFIT_ROOFLINE_X86
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_roofline_measure()
+// Runs the triad and the peak kernel of the selected ISA.
+//--------------------------------------------------------
+int polyfit_roofline_measure( int threadCount, polyfit_roofline_t *pRoofline )
+{
+    if( NULL == pRoofline )
+    {
+        return -1;
+    }
+    if( threadCount < 1 )
+    {
+        return -2;
+    }
+
+    double *pA = (double *) malloc( POLYFIT_ROOFLINE_STREAM_COUNT * sizeof( double ) );
+    double *pB = (double *) malloc( POLYFIT_ROOFLINE_STREAM_COUNT * sizeof( double ) );
+    double *pC = (double *) malloc( POLYFIT_ROOFLINE_STREAM_COUNT * sizeof( double ) );
+    if( (NULL == pA) || (NULL == pB) || (NULL == pC) )
+    {
+        free( pA );
+        free( pB );
+        free( pC );
+        return -3;
+    }
+
+    pRoofline->threadCount = threadCount;
+    pRoofline->isa = polyfit_simd()->isa;
+    pRoofline->bandwidth = measureBandwidth( threadCount, pA, pB, pC );
+    free( pA );
+    free( pB );
+    free( pC );
+
+    switch( pRoofline->isa )
+    {
+#ifdef POLYFIT_ROOFLINE_X86
+    case POLYFIT_ISA_SSE2:
+        pRoofline->peakFlops = measurePeak( threadCount, peakSse2, 2 );
+        break;
+    case POLYFIT_ISA_AVX2:
+        pRoofline->peakFlops = measurePeak( threadCount, peakAvx2, 4 );
+        break;
+    case POLYFIT_ISA_AVX512:
+        pRoofline->peakFlops = measurePeak( threadCount, peakAvx512, 8 );
+        break;
+#endif  // POLYFIT_ROOFLINE_X86
+    default:
+        pRoofline->isa = POLYFIT_ISA_SCALAR;
+        pRoofline->peakFlops = measurePeak( threadCount, peakScalar, 1 );
+        break;
+    }
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_roofline_bound()
+// The lower of the compute and bandwidth roofs.
+//--------------------------------------------------------
+double polyfit_roofline_bound( const polyfit_roofline_t *pRoofline, double intensity )
+{
+    if( NULL == pRoofline )
+    {
+        return 0.0;
+    }
+
+    double memoryBound = pRoofline->bandwidth * intensity;
+    return (memoryBound < pRoofline->peakFlops) ? memoryBound : pRoofline->peakFlops;
+}
+
+//--------------------------------------------------------
+// polyfit_roofline_percent()
+// Achieved FLOP rate over the bound, or achieved bandwidth
+// over the bandwidth for a phase without flops.
+//--------------------------------------------------------
+double polyfit_roofline_percent( const polyfit_roofline_t *pRoofline, double seconds,
+                                 long long byteCount, long long flopCount )
+{
+    if( (NULL == pRoofline) || (seconds <= 0.0) )
+    {
+        return 0.0;
+    }
+
+    if( flopCount > 0 )
+    {
+        double bound = (byteCount > 0) ? polyfit_roofline_bound( pRoofline, (double) flopCount / byteCount )
+                                       : pRoofline->peakFlops;
+        return (bound > 0.0) ? 100.0 * (flopCount / seconds) / bound : 0.0;
+    }
+    if( (byteCount > 0) && (pRoofline->bandwidth > 0.0) )
+    {
+        return 100.0 * (byteCount / seconds) / pRoofline->bandwidth;
+    }
+    return 0.0;
+}
+
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// measureBandwidth()
+// Returns the bytes per second of a[i] = b[i] + s * c[i],
+// counting 3 doubles a point as STREAM does.  The arrays
+// are first touched by the threads that use them.
+//--------------------------------------------------------
+static double measureBandwidth( int threadCount, double *pA, double *pB, double *pC )
+{
+    long count = POLYFIT_ROOFLINE_STREAM_COUNT;
+    double bestSeconds = -1.0;
+    double scale = 3.0;
+
+    #pragma omp parallel for num_threads( threadCount ) schedule( static )
+    for( long i = 0; i < count; i++ )
+    {
+        pA[i] = 0.0;
+        pB[i] = 1.0;
+        pC[i] = 2.0;
+    }
+
+    for( int trial = 0; trial < TRIAL_COUNT; trial++ )
+    {
+        long long startTime = polyfit_stats_now();
+
+        #pragma omp parallel for num_threads( threadCount ) schedule( static )
+        for( long i = 0; i < count; i++ )
+        {
+            pA[i] = pB[i] + scale * pC[i];
+        }
+
+        double seconds = (polyfit_stats_now() - startTime) / 1e9;
+        if( (bestSeconds < 0.0) || (seconds < bestSeconds) )
+        {
+            bestSeconds = seconds;
+        }
+    }
+    return (bestSeconds > 0.0) ? 3.0 * sizeof( double ) * count / bestSeconds : 0.0;
+}
+
+//--------------------------------------------------------
+// measurePeak()
+// Returns the flops per second of pKernel run on every
+// thread at once.  The result of each thread is kept so
+// the chains can't be optimized away.
+//--------------------------------------------------------
+static double measurePeak( int threadCount, PeakKernel pKernel, int laneCount )
+{
+    volatile double sink = 0.0;
+    long iterations = 1 << 16;
+    double bestSeconds = -1.0;
+
+    // Grow the run until it is long enough to time.
+    for( ;; )
+    {
+        long long startTime = polyfit_stats_now();
+        sink += pKernel( iterations );
+        if( (polyfit_stats_now() - startTime) / 1e9 >= MIN_PEAK_SECONDS )
+        {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    for( int trial = 0; trial < TRIAL_COUNT; trial++ )
+    {
+        double total = 0.0;
+        long long startTime = polyfit_stats_now();
+
+        #pragma omp parallel num_threads( threadCount ) reduction( + : total )
+        {
+            total += pKernel( iterations );
+        }
+
+        double seconds = (polyfit_stats_now() - startTime) / 1e9;
+        sink += total;
+        if( (bestSeconds < 0.0) || (seconds < bestSeconds) )
+        {
+            bestSeconds = seconds;
+        }
+    }
+
+    double flops = 2.0 * CHAIN_COUNT * laneCount * (double) iterations * threadCount;
+    return (bestSeconds > 0.0) ? flops / bestSeconds : 0.0;
+}
+
+//--------------------------------------------------------
+// Peak kernels
+// CHAIN_COUNT chains of a = a * CHAIN_SCALE + CHAIN_STEP,
+// each at one ISA level's vector width.
+//--------------------------------------------------------
+static double peakScalar( long iterations )
+{
+    double a0 = 1.0, a1 = 1.1, a2 = 1.2, a3 = 1.3, a4 = 1.4, a5 = 1.5, a6 = 1.6, a7 = 1.7;
+
+    for( long i = 0; i < iterations; i++ )
+    {
+        a0 = a0 * CHAIN_SCALE + CHAIN_STEP;
+        a1 = a1 * CHAIN_SCALE + CHAIN_STEP;
+        a2 = a2 * CHAIN_SCALE + CHAIN_STEP;
+        a3 = a3 * CHAIN_SCALE + CHAIN_STEP;
+        a4 = a4 * CHAIN_SCALE + CHAIN_STEP;
+        a5 = a5 * CHAIN_SCALE + CHAIN_STEP;
+        a6 = a6 * CHAIN_SCALE + CHAIN_STEP;
+        a7 = a7 * CHAIN_SCALE + CHAIN_STEP;
+    }
+    return a0 + a1 + a2 + a3 + a4 + a5 + a6 + a7;
+}
+
+#ifdef POLYFIT_ROOFLINE_X86
+
+__attribute__(( target( "sse2" ) ))
+static double peakSse2( long iterations )
+{
+    __m128d m = _mm_set1_pd( CHAIN_SCALE );
+    __m128d c = _mm_set1_pd( CHAIN_STEP );
+    __m128d a0 = _mm_set1_pd( 1.0 ), a1 = _mm_set1_pd( 1.1 ), a2 = _mm_set1_pd( 1.2 ), a3 = _mm_set1_pd( 1.3 );
+    __m128d a4 = _mm_set1_pd( 1.4 ), a5 = _mm_set1_pd( 1.5 ), a6 = _mm_set1_pd( 1.6 ), a7 = _mm_set1_pd( 1.7 );
+    double lanes[2];
+
+    for( long i = 0; i < iterations; i++ )
+    {
+        a0 = _mm_add_pd( _mm_mul_pd( a0, m ), c );
+        a1 = _mm_add_pd( _mm_mul_pd( a1, m ), c );
+        a2 = _mm_add_pd( _mm_mul_pd( a2, m ), c );
+        a3 = _mm_add_pd( _mm_mul_pd( a3, m ), c );
+        a4 = _mm_add_pd( _mm_mul_pd( a4, m ), c );
+        a5 = _mm_add_pd( _mm_mul_pd( a5, m ), c );
+        a6 = _mm_add_pd( _mm_mul_pd( a6, m ), c );
+        a7 = _mm_add_pd( _mm_mul_pd( a7, m ), c );
+    }
+
+    a0 = _mm_add_pd( _mm_add_pd( _mm_add_pd( a0, a1 ), _mm_add_pd( a2, a3 ) ),
+                     _mm_add_pd( _mm_add_pd( a4, a5 ), _mm_add_pd( a6, a7 ) ) );
+    _mm_storeu_pd( lanes, a0 );
+    return lanes[0] + lanes[1];
+}
+
+__attribute__(( target( "avx2,fma" ) ))
+static double peakAvx2( long iterations )
+{
+    __m256d m = _mm256_set1_pd( CHAIN_SCALE );
+    __m256d c = _mm256_set1_pd( CHAIN_STEP );
+    __m256d a0 = _mm256_set1_pd( 1.0 ), a1 = _mm256_set1_pd( 1.1 ), a2 = _mm256_set1_pd( 1.2 ), a3 = _mm256_set1_pd( 1.3 );
+    __m256d a4 = _mm256_set1_pd( 1.4 ), a5 = _mm256_set1_pd( 1.5 ), a6 = _mm256_set1_pd( 1.6 ), a7 = _mm256_set1_pd( 1.7 );
+    double lanes[4];
+
+    for( long i = 0; i < iterations; i++ )
+    {
+        a0 = _mm256_fmadd_pd( a0, m, c );
+        a1 = _mm256_fmadd_pd( a1, m, c );
+        a2 = _mm256_fmadd_pd( a2, m, c );
+        a3 = _mm256_fmadd_pd( a3, m, c );
+        a4 = _mm256_fmadd_pd( a4, m, c );
+        a5 = _mm256_fmadd_pd( a5, m, c );
+        a6 = _mm256_fmadd_pd( a6, m, c );
+        a7 = _mm256_fmadd_pd( a7, m, c );
+    }
+
+    a0 = _mm256_add_pd( _mm256_add_pd( _mm256_add_pd( a0, a1 ), _mm256_add_pd( a2, a3 ) ),
+                        _mm256_add_pd( _mm256_add_pd( a4, a5 ), _mm256_add_pd( a6, a7 ) ) );
+    _mm256_storeu_pd( lanes, a0 );
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+__attribute__(( target( "avx512f" ) ))
+static double peakAvx512( long iterations )
+{
+    __m512d m = _mm512_set1_pd( CHAIN_SCALE );
+    __m512d c = _mm512_set1_pd( CHAIN_STEP );
+    __m512d a0 = _mm512_set1_pd( 1.0 ), a1 = _mm512_set1_pd( 1.1 ), a2 = _mm512_set1_pd( 1.2 ), a3 = _mm512_set1_pd( 1.3 );
+    __m512d a4 = _mm512_set1_pd( 1.4 ), a5 = _mm512_set1_pd( 1.5 ), a6 = _mm512_set1_pd( 1.6 ), a7 = _mm512_set1_pd( 1.7 );
+
+    for( long i = 0; i < iterations; i++ )
+    {
+        a0 = _mm512_fmadd_pd( a0, m, c );
+        a1 = _mm512_fmadd_pd( a1, m, c );
+        a2 = _mm512_fmadd_pd( a2, m, c );
+        a3 = _mm512_fmadd_pd( a3, m, c );
+        a4 = _mm512_fmadd_pd( a4, m, c );
+        a5 = _mm512_fmadd_pd( a5, m, c );
+        a6 = _mm512_fmadd_pd( a6, m, c );
+        a7 = _mm512_fmadd_pd( a7, m, c );
+    }
+
+    a0 = _mm512_add_pd( _mm512_add_pd( _mm512_add_pd( a0, a1 ), _mm512_add_pd( a2, a3 ) ),
+                        _mm512_add_pd( _mm512_add_pd( a4, a5 ), _mm512_add_pd( a6, a7 ) ) );
+    return _mm512_reduce_add_pd( a0 );
+}
+
+#endif  // POLYFIT_ROOFLINE_X86
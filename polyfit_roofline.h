@@ -0,0 +1,64 @@
+// file: polyfit_roofline.h
+// Description: Machine peaks for a roofline view of the fit phases.
+//
+// polyfit_roofline_measure() times two small kernels on a given
+// number of OpenMP threads: a STREAM-style triad over arrays much
+// larger than the caches for the sustainable memory bandwidth, and
+// independent multiply-add chains at the ISA level polyfit_simd()
+// selected for the peak FLOP rate.  A phase whose bytes and flops are
+// known (see polyfit_stats_t) can then be placed against the bound
+// min( peak, bandwidth * intensity ).
+
+#ifndef POLYFIT_ROOFLINE_H
+#define POLYFIT_ROOFLINE_H
+
+#include "polyfit_simd.h"
+
+// Doubles in each of the triad's three arrays.
+#define POLYFIT_ROOFLINE_STREAM_COUNT   (1 << 24)
+
+typedef struct polyfit_roofline_s
+{
+    int             threadCount;
+    polyfit_isa_t   isa;            // Level the peak was measured at.
+    double          bandwidth;      // Bytes per second.
+    double          peakFlops;      // Floating point operations per second.
+} polyfit_roofline_t;
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_roofline_measure()
+// Measures the bandwidth and peak on threadCount threads.
+// Each kernel's best of several runs is kept.  Takes
+// about a second, and 3 * POLYFIT_ROOFLINE_STREAM_COUNT
+// doubles of memory.
+//
+// Returns 0 if success, -1 if passed a NULL pointer, -2 if
+// threadCount < 1, -3 if unable to allocate memory.
+//--------------------------------------------------------
+int polyfit_roofline_measure( int threadCount, polyfit_roofline_t *pRoofline );
+
+//--------------------------------------------------------
+// polyfit_roofline_bound()
+// Returns the highest FLOP rate the roofline allows at an
+// arithmetic intensity (flops per byte).
+//--------------------------------------------------------
+double polyfit_roofline_bound( const polyfit_roofline_t *pRoofline, double intensity );
+
+//--------------------------------------------------------
+// polyfit_roofline_percent()
+// Returns how close a phase that did flopCount operations
+// over byteCount bytes in seconds came to its bound, in
+// percent.  A phase without flops, like the transpose, is
+// measured against the bandwidth instead.  Returns 0 if
+// there is nothing to measure.
+//--------------------------------------------------------
+double polyfit_roofline_percent( const polyfit_roofline_t *pRoofline, double seconds,
+                                 long long byteCount, long long flopCount );
+
+
+#endif	// POLYFIT_ROOFLINE_H
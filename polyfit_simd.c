@@ -0,0 +1,775 @@
+// Name: polyfit_simd.c
+// Description: Vectorized kernels for the fill and reduction phases,
+//              with the instruction set chosen once at startup.
+
+#include <stdio.h>      // NULL
+#include <stdlib.h>     // getenv()
+#include <string.h>     // strcmp()
+
+#include "polyfit_simd.h"
+#include "polyfit_sums.h"
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#define POLYFIT_SIMD_X86 1
+#include <immintrin.h>
+#endif  // __x86_64__ || __i386__
+
+#define MAX_SUMS    POLYFIT_POWER_SUM_COUNT( POLYFIT_MAX_COEFFICIENTS )
+
+// Partial sums the scalar float kernel keeps, as many as
+// an AVX2 vector has float lanes.
+#define FLOAT_LANES (8)
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static void     fillPowersScalar( int pointCount, const double *xValues, int coefficientCount, double *pRows );
+static double   dotScalar( int count, const double *pLeft, const double *pRight );
+static void     powerSumsScalar( int pointCount, const double *xValues, const double *yValues,
+                                 int coefficientCount, double *sumX, double *sumXY );
+static void     powerSumsFloatScalar( int pointCount, const double *xValues, const double *yValues,
+                                      double shift, double scale, double yShift,
+                                      int coefficientCount, double *sumT, double *sumTY );
+#ifdef POLYFIT_SIMD_X86
+static void     fillPowersSse2( int pointCount, const double *xValues, int coefficientCount, double *pRows );
+static double   dotSse2( int count, const double *pLeft, const double *pRight );
+static void     powerSumsSse2( int pointCount, const double *xValues, const double *yValues,
+                               int coefficientCount, double *sumX, double *sumXY );
+static void     powerSumsFloatSse2( int pointCount, const double *xValues, const double *yValues,
+                                    double shift, double scale, double yShift,
+                                    int coefficientCount, double *sumT, double *sumTY );
+static void     fillPowersAvx2( int pointCount, const double *xValues, int coefficientCount, double *pRows );
+static double   dotAvx2( int count, const double *pLeft, const double *pRight );
+static void     powerSumsAvx2( int pointCount, const double *xValues, const double *yValues,
+                               int coefficientCount, double *sumX, double *sumXY );
+static void     powerSumsFloatAvx2( int pointCount, const double *xValues, const double *yValues,
+                                    double shift, double scale, double yShift,
+                                    int coefficientCount, double *sumT, double *sumTY );
+static void     fillPowersAvx512( int pointCount, const double *xValues, int coefficientCount, double *pRows );
+static double   dotAvx512( int count, const double *pLeft, const double *pRight );
+static void     powerSumsAvx512( int pointCount, const double *xValues, const double *yValues,
+                                 int coefficientCount, double *sumX, double *sumXY );
+static void     powerSumsFloatAvx512( int pointCount, const double *xValues, const double *yValues,
+                                      double shift, double scale, double yShift,
+                                      int coefficientCount, double *sumT, double *sumTY );
+#endif  // POLYFIT_SIMD_X86
+
+
+// Kernel table, indexed by polyfit_isa_t.  Levels this build
+// can't produce fall back to the scalar kernels.
+static const polyfit_simd_kernels_t kernelTable[ POLYFIT_ISA_COUNT ] =
+{
+    { POLYFIT_ISA_SCALAR, "scalar", fillPowersScalar, dotScalar, powerSumsScalar, powerSumsFloatScalar },
+#ifdef POLYFIT_SIMD_X86
+    { POLYFIT_ISA_SSE2,   "sse2",   fillPowersSse2,   dotSse2,   powerSumsSse2,   powerSumsFloatSse2 },
+    { POLYFIT_ISA_AVX2,   "avx2",   fillPowersAvx2,   dotAvx2,   powerSumsAvx2,   powerSumsFloatAvx2 },
+    { POLYFIT_ISA_AVX512, "avx512", fillPowersAvx512, dotAvx512, powerSumsAvx512, powerSumsFloatAvx512 },
+#else   // POLYFIT_SIMD_X86
+    { POLYFIT_ISA_SSE2,   "sse2",   fillPowersScalar, dotScalar, powerSumsScalar, powerSumsFloatScalar },
+    { POLYFIT_ISA_AVX2,   "avx2",   fillPowersScalar, dotScalar, powerSumsScalar, powerSumsFloatScalar },
+    { POLYFIT_ISA_AVX512, "avx512", fillPowersScalar, dotScalar, powerSumsScalar, powerSumsFloatScalar },
+#endif  // POLYFIT_SIMD_X86
+};
+
+// The selected kernels.  Chosen before main() runs.
+static const polyfit_simd_kernels_t *pSelected = &kernelTable[ POLYFIT_ISA_SCALAR ];
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_simd()
+// Returns the kernels selected for this process.
+//--------------------------------------------------------
+const polyfit_simd_kernels_t *polyfit_simd( void )
+{
+    return pSelected;
+}
+
+//--------------------------------------------------------
+// polyfit_simd_supported()
+// Returns the highest ISA level this CPU can run.
+//--------------------------------------------------------
+polyfit_isa_t polyfit_simd_supported( void )
+{
+#ifdef POLYFIT_SIMD_X86
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports( "avx512f" ) )
+    {
+        return POLYFIT_ISA_AVX512;
+    }
+    if( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ) )
+    {
+        return POLYFIT_ISA_AVX2;
+    }
+    if( __builtin_cpu_supports( "sse2" ) )
+    {
+        return POLYFIT_ISA_SSE2;
+    }
+#endif  // POLYFIT_SIMD_X86
+    return POLYFIT_ISA_SCALAR;
+}
+
+//--------------------------------------------------------
+// polyfit_simd_force()
+// Selects the kernels of a given ISA level.
+//--------------------------------------------------------
+int polyfit_simd_force( polyfit_isa_t isa )
+{
+    if( (isa < POLYFIT_ISA_SCALAR) || (isa >= POLYFIT_ISA_COUNT) || (isa > polyfit_simd_supported()) )
+    {
+        return -2;
+    }
+    pSelected = &kernelTable[ isa ];
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_simd_name()
+// Returns the name of an ISA level.
+//--------------------------------------------------------
+const char *polyfit_simd_name( polyfit_isa_t isa )
+{
+    if( (isa < POLYFIT_ISA_SCALAR) || (isa >= POLYFIT_ISA_COUNT) )
+    {
+        return "unknown";
+    }
+    return kernelTable[ isa ].name;
+}
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// selectKernels()
+// Runs once at startup: picks the best supported level,
+// unless POLYFIT_ISA names another one.
+//--------------------------------------------------------
+__attribute__(( constructor ))
+static void selectKernels( void )
+{
+    polyfit_isa_t isa = polyfit_simd_supported();
+    const char *pForced = getenv( "POLYFIT_ISA" );
+
+    if( NULL != pForced )
+    {
+        for( int i = 0; i < POLYFIT_ISA_COUNT; i++ )
+        {
+            if( (0 == strcmp( pForced, kernelTable[i].name )) && (i <= (int) isa) )
+            {
+                isa = (polyfit_isa_t) i;
+                break;
+            }
+        }
+    }
+    pSelected = &kernelTable[ isa ];
+}
+
+//--------------------------------------------------------
+// Scalar kernels
+//--------------------------------------------------------
+static void fillPowersScalar( int pointCount, const double *xValues, int coefficientCount, double *pRows )
+{
+    for( int r = 0; r < pointCount; r++ )
+    {
+        double *pRow = &pRows[ (long) r * coefficientCount ];
+        double xPow = 1.0;
+        for( int c = coefficientCount - 1; c >= 0; c-- )
+        {
+            pRow[c] = xPow;
+            xPow *= xValues[r];
+        }
+    }
+}
+
+static double dotScalar( int count, const double *pLeft, const double *pRight )
+{
+    double sum = 0.0;
+    for( int i = 0; i < count; i++ )
+    {
+        sum += pLeft[i] * pRight[i];
+    }
+    return sum;
+}
+
+static void powerSumsScalar( int pointCount, const double *xValues, const double *yValues,
+                             int coefficientCount, double *sumX, double *sumXY )
+{
+    int sumCount = POLYFIT_POWER_SUM_COUNT( coefficientCount );
+
+    for( int i = 0; i < pointCount; i++ )
+    {
+        double x = xValues[i];
+        double y = yValues[i];
+        double xPow = 1.0;      // x^p
+
+        for( int p = 0; p < coefficientCount; p++ )
+        {
+            sumX[p] += xPow;
+            sumXY[p] += xPow * y;
+            xPow *= x;
+        }
+        for( int p = coefficientCount; p < sumCount; p++ )
+        {
+            sumX[p] += xPow;
+            xPow *= x;
+        }
+    }
+}
+
+// Spreads the points over FLOAT_LANES partial float sums,
+// as the vector kernels spread them over their lanes, so
+// no one float sum takes more than 1 / FLOAT_LANES of a
+// block.
+static void powerSumsFloatScalar( int pointCount, const double *xValues, const double *yValues,
+                                  double shift, double scale, double yShift,
+                                  int coefficientCount, double *sumT, double *sumTY )
+{
+    int sumCount = POLYFIT_POWER_SUM_COUNT( coefficientCount );
+    float accT[ MAX_SUMS ][ FLOAT_LANES ];
+    float accTY[ POLYFIT_MAX_COEFFICIENTS ][ FLOAT_LANES ];
+
+    for( int block = 0; block < pointCount; block += POLYFIT_FLOAT_BLOCK )
+    {
+        int blockEnd = (pointCount - block < POLYFIT_FLOAT_BLOCK) ? pointCount : (block + POLYFIT_FLOAT_BLOCK);
+        memset( accT, 0, sizeof( accT ) );
+        memset( accTY, 0, sizeof( accTY ) );
+
+        for( int i = block; i < blockEnd; i += FLOAT_LANES )
+        {
+            int laneCount = (blockEnd - i < FLOAT_LANES) ? (blockEnd - i) : FLOAT_LANES;
+            for( int lane = 0; lane < laneCount; lane++ )
+            {
+                float t = (float) ((xValues[ i + lane ] - shift) * scale);
+                float y = (float) (yValues[ i + lane ] - yShift);
+                float tPow = 1.0f;
+                for( int p = 0; p < coefficientCount; p++ )
+                {
+                    accT[p][lane] += tPow;
+                    accTY[p][lane] += tPow * y;
+                    tPow *= t;
+                }
+                for( int p = coefficientCount; p < sumCount; p++ )
+                {
+                    accT[p][lane] += tPow;
+                    tPow *= t;
+                }
+            }
+        }
+
+        for( int p = 0; p < sumCount; p++ )
+        {
+            sumT[p] += (double) (((accT[p][0] + accT[p][1]) + (accT[p][2] + accT[p][3])) +
+                                 ((accT[p][4] + accT[p][5]) + (accT[p][6] + accT[p][7])));
+        }
+        for( int p = 0; p < coefficientCount; p++ )
+        {
+            sumTY[p] += (double) (((accTY[p][0] + accTY[p][1]) + (accTY[p][2] + accTY[p][3])) +
+                                  ((accTY[p][4] + accTY[p][5]) + (accTY[p][6] + accTY[p][7])));
+        }
+    }
+}
+
+#ifdef POLYFIT_SIMD_X86
+
+//--------------------------------------------------------
+// SSE2 kernels (2 points per vector)
+//--------------------------------------------------------
+__attribute__(( target( "sse2" ) ))
+static void fillPowersSse2( int pointCount, const double *xValues, int coefficientCount, double *pRows )
+{
+    int r = 0;
+    for( ; r + 2 <= pointCount; r += 2 )
+    {
+        __m128d vx = _mm_loadu_pd( &xValues[r] );
+        __m128d xPow = _mm_set1_pd( 1.0 );
+        double *pRow0 = &pRows[ (long) r * coefficientCount ];
+        double *pRow1 = pRow0 + coefficientCount;
+        for( int c = coefficientCount - 1; c >= 0; c-- )
+        {
+            _mm_storel_pd( &pRow0[c], xPow );
+            _mm_storeh_pd( &pRow1[c], xPow );
+            xPow = _mm_mul_pd( xPow, vx );
+        }
+    }
+    fillPowersScalar( pointCount - r, &xValues[r], coefficientCount, &pRows[ (long) r * coefficientCount ] );
+}
+
+__attribute__(( target( "sse2" ) ))
+static double dotSse2( int count, const double *pLeft, const double *pRight )
+{
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    int i = 0;
+    for( ; i + 4 <= count; i += 4 )
+    {
+        acc0 = _mm_add_pd( acc0, _mm_mul_pd( _mm_loadu_pd( &pLeft[i] ), _mm_loadu_pd( &pRight[i] ) ) );
+        acc1 = _mm_add_pd( acc1, _mm_mul_pd( _mm_loadu_pd( &pLeft[i + 2] ), _mm_loadu_pd( &pRight[i + 2] ) ) );
+    }
+    double lanes[2];
+    _mm_storeu_pd( lanes, _mm_add_pd( acc0, acc1 ) );
+    return lanes[0] + lanes[1] + dotScalar( count - i, &pLeft[i], &pRight[i] );
+}
+
+__attribute__(( target( "sse2" ) ))
+static void powerSumsSse2( int pointCount, const double *xValues, const double *yValues,
+                           int coefficientCount, double *sumX, double *sumXY )
+{
+    int sumCount = POLYFIT_POWER_SUM_COUNT( coefficientCount );
+    __m128d accX[ MAX_SUMS ];
+    __m128d accXY[ POLYFIT_MAX_COEFFICIENTS ];
+    for( int p = 0; p < sumCount; p++ )
+    {
+        accX[p] = _mm_setzero_pd();
+    }
+    for( int p = 0; p < coefficientCount; p++ )
+    {
+        accXY[p] = _mm_setzero_pd();
+    }
+
+    int i = 0;
+    for( ; i + 2 <= pointCount; i += 2 )
+    {
+        __m128d vx = _mm_loadu_pd( &xValues[i] );
+        __m128d vy = _mm_loadu_pd( &yValues[i] );
+        __m128d xPow = _mm_set1_pd( 1.0 );
+        for( int p = 0; p < coefficientCount; p++ )
+        {
+            accX[p] = _mm_add_pd( accX[p], xPow );
+            accXY[p] = _mm_add_pd( accXY[p], _mm_mul_pd( xPow, vy ) );
+            xPow = _mm_mul_pd( xPow, vx );
+        }
+        for( int p = coefficientCount; p < sumCount; p++ )
+        {
+            accX[p] = _mm_add_pd( accX[p], xPow );
+            xPow = _mm_mul_pd( xPow, vx );
+        }
+    }
+
+    double lanes[2];
+    for( int p = 0; p < sumCount; p++ )
+    {
+        _mm_storeu_pd( lanes, accX[p] );
+        sumX[p] += lanes[0] + lanes[1];
+    }
+    for( int p = 0; p < coefficientCount; p++ )
+    {
+        _mm_storeu_pd( lanes, accXY[p] );
+        sumXY[p] += lanes[0] + lanes[1];
+    }
+    powerSumsScalar( pointCount - i, &xValues[i], &yValues[i], coefficientCount, sumX, sumXY );
+}
+
+__attribute__(( target( "sse2" ) ))
+static void powerSumsFloatSse2( int pointCount, const double *xValues, const double *yValues,
+                                double shift, double scale, double yShift,
+                                int coefficientCount, double *sumT, double *sumTY )
+{
+    int sumCount = POLYFIT_POWER_SUM_COUNT( coefficientCount );
+    __m128d vShift = _mm_set1_pd( shift );
+    __m128d vScale = _mm_set1_pd( scale );
+    __m128d vYShift = _mm_set1_pd( yShift );
+    __m128 accT[ MAX_SUMS ];
+    __m128 accTY[ POLYFIT_MAX_COEFFICIENTS ];
+    float lanes[4];
+
+    int i = 0;
+    while( i + 4 <= pointCount )
+    {
+        int blockEnd = (pointCount - i < POLYFIT_FLOAT_BLOCK) ? pointCount : (i + POLYFIT_FLOAT_BLOCK);
+        for( int p = 0; p < sumCount; p++ )
+        {
+            accT[p] = _mm_setzero_ps();
+        }
+        for( int p = 0; p < coefficientCount; p++ )
+        {
+            accTY[p] = _mm_setzero_ps();
+        }
+
+        for( ; i + 4 <= blockEnd; i += 4 )
+        {
+            // t is formed in double, then narrowed.
+            __m128 vt = _mm_movelh_ps(
+                _mm_cvtpd_ps( _mm_mul_pd( _mm_sub_pd( _mm_loadu_pd( &xValues[i] ), vShift ), vScale ) ),
+                _mm_cvtpd_ps( _mm_mul_pd( _mm_sub_pd( _mm_loadu_pd( &xValues[i + 2] ), vShift ), vScale ) ) );
+            __m128 vy = _mm_movelh_ps( _mm_cvtpd_ps( _mm_sub_pd( _mm_loadu_pd( &yValues[i] ), vYShift ) ),
+                                       _mm_cvtpd_ps( _mm_sub_pd( _mm_loadu_pd( &yValues[i + 2] ), vYShift ) ) );
+            __m128 tPow = _mm_set1_ps( 1.0f );
+            for( int p = 0; p < coefficientCount; p++ )
+            {
+                accT[p] = _mm_add_ps( accT[p], tPow );
+                accTY[p] = _mm_add_ps( accTY[p], _mm_mul_ps( tPow, vy ) );
+                tPow = _mm_mul_ps( tPow, vt );
+            }
+            for( int p = coefficientCount; p < sumCount; p++ )
+            {
+                accT[p] = _mm_add_ps( accT[p], tPow );
+                tPow = _mm_mul_ps( tPow, vt );
+            }
+        }
+
+        for( int p = 0; p < sumCount; p++ )
+        {
+            _mm_storeu_ps( lanes, accT[p] );
+            sumT[p] += (double) ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]));
+        }
+        for( int p = 0; p < coefficientCount; p++ )
+        {
+            _mm_storeu_ps( lanes, accTY[p] );
+            sumTY[p] += (double) ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]));
+        }
+    }
+    powerSumsFloatScalar( pointCount - i, &xValues[i], &yValues[i], shift, scale, yShift, coefficientCount, sumT, sumTY );
+}
+
+//--------------------------------------------------------
+// AVX2 + FMA kernels (4 points per vector)
+//--------------------------------------------------------
+__attribute__(( target( "avx2,fma" ) ))
+static void fillPowersAvx2( int pointCount, const double *xValues, int coefficientCount, double *pRows )
+{
+    double lanes[4];
+    int r = 0;
+    for( ; r + 4 <= pointCount; r += 4 )
+    {
+        __m256d vx = _mm256_loadu_pd( &xValues[r] );
+        __m256d xPow = _mm256_set1_pd( 1.0 );
+        double *pRow = &pRows[ (long) r * coefficientCount ];
+        for( int c = coefficientCount - 1; c >= 0; c-- )
+        {
+            _mm256_storeu_pd( lanes, xPow );
+            pRow[c] = lanes[0];
+            pRow[c + coefficientCount] = lanes[1];
+            pRow[c + 2 * coefficientCount] = lanes[2];
+            pRow[c + 3 * coefficientCount] = lanes[3];
+            xPow = _mm256_mul_pd( xPow, vx );
+        }
+    }
+    fillPowersScalar( pointCount - r, &xValues[r], coefficientCount, &pRows[ (long) r * coefficientCount ] );
+}
+
+__attribute__(( target( "avx2,fma" ) ))
+static double dotAvx2( int count, const double *pLeft, const double *pRight )
+{
+    // Four independent accumulators hide the FMA latency.
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd();
+    __m256d acc3 = _mm256_setzero_pd();
+    int i = 0;
+    for( ; i + 16 <= count; i += 16 )
+    {
+        acc0 = _mm256_fmadd_pd( _mm256_loadu_pd( &pLeft[i] ),      _mm256_loadu_pd( &pRight[i] ),      acc0 );
+        acc1 = _mm256_fmadd_pd( _mm256_loadu_pd( &pLeft[i + 4] ),  _mm256_loadu_pd( &pRight[i + 4] ),  acc1 );
+        acc2 = _mm256_fmadd_pd( _mm256_loadu_pd( &pLeft[i + 8] ),  _mm256_loadu_pd( &pRight[i + 8] ),  acc2 );
+        acc3 = _mm256_fmadd_pd( _mm256_loadu_pd( &pLeft[i + 12] ), _mm256_loadu_pd( &pRight[i + 12] ), acc3 );
+    }
+    for( ; i + 4 <= count; i += 4 )
+    {
+        acc0 = _mm256_fmadd_pd( _mm256_loadu_pd( &pLeft[i] ), _mm256_loadu_pd( &pRight[i] ), acc0 );
+    }
+    double lanes[4];
+    _mm256_storeu_pd( lanes, _mm256_add_pd( _mm256_add_pd( acc0, acc1 ), _mm256_add_pd( acc2, acc3 ) ) );
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + dotScalar( count - i, &pLeft[i], &pRight[i] );
+}
+
+__attribute__(( target( "avx2,fma" ) ))
+static void powerSumsAvx2( int pointCount, const double *xValues, const double *yValues,
+                           int coefficientCount, double *sumX, double *sumXY )
+{
+    int sumCount = POLYFIT_POWER_SUM_COUNT( coefficientCount );
+    __m256d accX[ MAX_SUMS ];
+    __m256d accXY[ POLYFIT_MAX_COEFFICIENTS ];
+    for( int p = 0; p < sumCount; p++ )
+    {
+        accX[p] = _mm256_setzero_pd();
+    }
+    for( int p = 0; p < coefficientCount; p++ )
+    {
+        accXY[p] = _mm256_setzero_pd();
+    }
+
+    int i = 0;
+    for( ; i + 4 <= pointCount; i += 4 )
+    {
+        __m256d vx = _mm256_loadu_pd( &xValues[i] );
+        __m256d vy = _mm256_loadu_pd( &yValues[i] );
+        __m256d xPow = _mm256_set1_pd( 1.0 );
+        for( int p = 0; p < coefficientCount; p++ )
+        {
+            accX[p] = _mm256_add_pd( accX[p], xPow );
+            accXY[p] = _mm256_fmadd_pd( xPow, vy, accXY[p] );
+            xPow = _mm256_mul_pd( xPow, vx );
+        }
+        for( int p = coefficientCount; p < sumCount; p++ )
+        {
+            accX[p] = _mm256_add_pd( accX[p], xPow );
+            xPow = _mm256_mul_pd( xPow, vx );
+        }
+    }
+
+    double lanes[4];
+    for( int p = 0; p < sumCount; p++ )
+    {
+        _mm256_storeu_pd( lanes, accX[p] );
+        sumX[p] += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+    for( int p = 0; p < coefficientCount; p++ )
+    {
+        _mm256_storeu_pd( lanes, accXY[p] );
+        sumXY[p] += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+    powerSumsScalar( pointCount - i, &xValues[i], &yValues[i], coefficientCount, sumX, sumXY );
+}
+
+__attribute__(( target( "avx2,fma" ) ))
+static void powerSumsFloatAvx2( int pointCount, const double *xValues, const double *yValues,
+                                double shift, double scale, double yShift,
+                                int coefficientCount, double *sumT, double *sumTY )
+{
+    int sumCount = POLYFIT_POWER_SUM_COUNT( coefficientCount );
+    __m256d vShift = _mm256_set1_pd( shift );
+    __m256d vScale = _mm256_set1_pd( scale );
+    __m256d vYShift = _mm256_set1_pd( yShift );
+    __m256 accT[ MAX_SUMS ];
+    __m256 accTY[ POLYFIT_MAX_COEFFICIENTS ];
+    float lanes[8];
+
+    int i = 0;
+    while( i + 8 <= pointCount )
+    {
+        int blockEnd = (pointCount - i < POLYFIT_FLOAT_BLOCK) ? pointCount : (i + POLYFIT_FLOAT_BLOCK);
+        for( int p = 0; p < sumCount; p++ )
+        {
+            accT[p] = _mm256_setzero_ps();
+        }
+        for( int p = 0; p < coefficientCount; p++ )
+        {
+            accTY[p] = _mm256_setzero_ps();
+        }
+
+        for( ; i + 8 <= blockEnd; i += 8 )
+        {
+            // t is formed in double, then narrowed.
+            __m256 vt = _mm256_set_m128(
+                _mm256_cvtpd_ps( _mm256_mul_pd( _mm256_sub_pd( _mm256_loadu_pd( &xValues[i + 4] ), vShift ), vScale ) ),
+                _mm256_cvtpd_ps( _mm256_mul_pd( _mm256_sub_pd( _mm256_loadu_pd( &xValues[i] ), vShift ), vScale ) ) );
+            __m256 vy = _mm256_set_m128( _mm256_cvtpd_ps( _mm256_sub_pd( _mm256_loadu_pd( &yValues[i + 4] ), vYShift ) ),
+                                         _mm256_cvtpd_ps( _mm256_sub_pd( _mm256_loadu_pd( &yValues[i] ), vYShift ) ) );
+            __m256 tPow = _mm256_set1_ps( 1.0f );
+            for( int p = 0; p < coefficientCount; p++ )
+            {
+                accT[p] = _mm256_add_ps( accT[p], tPow );
+                accTY[p] = _mm256_fmadd_ps( tPow, vy, accTY[p] );
+                tPow = _mm256_mul_ps( tPow, vt );
+            }
+            for( int p = coefficientCount; p < sumCount; p++ )
+            {
+                accT[p] = _mm256_add_ps( accT[p], tPow );
+                tPow = _mm256_mul_ps( tPow, vt );
+            }
+        }
+
+        for( int p = 0; p < sumCount; p++ )
+        {
+            _mm256_storeu_ps( lanes, accT[p] );
+            sumT[p] += (double) (((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7])));
+        }
+        for( int p = 0; p < coefficientCount; p++ )
+        {
+            _mm256_storeu_ps( lanes, accTY[p] );
+            sumTY[p] += (double) (((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7])));
+        }
+    }
+    powerSumsFloatScalar( pointCount - i, &xValues[i], &yValues[i], shift, scale, yShift, coefficientCount, sumT, sumTY );
+}
+
+//--------------------------------------------------------
+// AVX-512F kernels (8 points per vector)
+//--------------------------------------------------------
+__attribute__(( target( "avx512f" ) ))
+static void fillPowersAvx512( int pointCount, const double *xValues, int coefficientCount, double *pRows )
+{
+    // Element l of a vector goes to row r + l: scatter with a row stride.
+    long cc = coefficientCount;
+    __m512i rowOffsets = _mm512_set_epi64( 7 * cc, 6 * cc, 5 * cc, 4 * cc, 3 * cc, 2 * cc, cc, 0 );
+    int r = 0;
+    for( ; r + 8 <= pointCount; r += 8 )
+    {
+        __m512d vx = _mm512_loadu_pd( &xValues[r] );
+        __m512d xPow = _mm512_set1_pd( 1.0 );
+        double *pRow = &pRows[ (long) r * coefficientCount ];
+        for( int c = coefficientCount - 1; c >= 0; c-- )
+        {
+            _mm512_i64scatter_pd( &pRow[c], rowOffsets, xPow, 8 );
+            xPow = _mm512_mul_pd( xPow, vx );
+        }
+    }
+    fillPowersScalar( pointCount - r, &xValues[r], coefficientCount, &pRows[ (long) r * coefficientCount ] );
+}
+
+__attribute__(( target( "avx512f" ) ))
+static double dotAvx512( int count, const double *pLeft, const double *pRight )
+{
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    __m512d acc2 = _mm512_setzero_pd();
+    __m512d acc3 = _mm512_setzero_pd();
+    int i = 0;
+    for( ; i + 32 <= count; i += 32 )
+    {
+        acc0 = _mm512_fmadd_pd( _mm512_loadu_pd( &pLeft[i] ),      _mm512_loadu_pd( &pRight[i] ),      acc0 );
+        acc1 = _mm512_fmadd_pd( _mm512_loadu_pd( &pLeft[i + 8] ),  _mm512_loadu_pd( &pRight[i + 8] ),  acc1 );
+        acc2 = _mm512_fmadd_pd( _mm512_loadu_pd( &pLeft[i + 16] ), _mm512_loadu_pd( &pRight[i + 16] ), acc2 );
+        acc3 = _mm512_fmadd_pd( _mm512_loadu_pd( &pLeft[i + 24] ), _mm512_loadu_pd( &pRight[i + 24] ), acc3 );
+    }
+    for( ; i + 8 <= count; i += 8 )
+    {
+        acc0 = _mm512_fmadd_pd( _mm512_loadu_pd( &pLeft[i] ), _mm512_loadu_pd( &pRight[i] ), acc0 );
+    }
+    double sum = _mm512_reduce_add_pd( _mm512_add_pd( _mm512_add_pd( acc0, acc1 ), _mm512_add_pd( acc2, acc3 ) ) );
+    return sum + dotScalar( count - i, &pLeft[i], &pRight[i] );
+}
+
+__attribute__(( target( "avx512f" ) ))
+static void powerSumsAvx512( int pointCount, const double *xValues, const double *yValues,
+                             int coefficientCount, double *sumX, double *sumXY )
+{
+    int sumCount = POLYFIT_POWER_SUM_COUNT( coefficientCount );
+    __m512d accX[ MAX_SUMS ];
+    __m512d accXY[ POLYFIT_MAX_COEFFICIENTS ];
+    for( int p = 0; p < sumCount; p++ )
+    {
+        accX[p] = _mm512_setzero_pd();
+    }
+    for( int p = 0; p < coefficientCount; p++ )
+    {
+        accXY[p] = _mm512_setzero_pd();
+    }
+
+    int i = 0;
+    for( ; i + 8 <= pointCount; i += 8 )
+    {
+        __m512d vx = _mm512_loadu_pd( &xValues[i] );
+        __m512d vy = _mm512_loadu_pd( &yValues[i] );
+        __m512d xPow = _mm512_set1_pd( 1.0 );
+        for( int p = 0; p < coefficientCount; p++ )
+        {
+            accX[p] = _mm512_add_pd( accX[p], xPow );
+            accXY[p] = _mm512_fmadd_pd( xPow, vy, accXY[p] );
+            xPow = _mm512_mul_pd( xPow, vx );
+        }
+        for( int p = coefficientCount; p < sumCount; p++ )
+        {
+            accX[p] = _mm512_add_pd( accX[p], xPow );
+            xPow = _mm512_mul_pd( xPow, vx );
+        }
+    }
+
+    for( int p = 0; p < sumCount; p++ )
+    {
+        sumX[p] += _mm512_reduce_add_pd( accX[p] );
+    }
+    for( int p = 0; p < coefficientCount; p++ )
+    {
+        sumXY[p] += _mm512_reduce_add_pd( accXY[p] );
+    }
+    powerSumsScalar( pointCount - i, &xValues[i], &yValues[i], coefficientCount, sumX, sumXY );
+}
+
+//--------------------------------------------------------
+// joinFloatsAvx512()
+// Returns the 16 floats { low, high }, using only AVX-512F.
+//--------------------------------------------------------
+__attribute__(( target( "avx512f" ) ))
+static inline __m512 joinFloatsAvx512( __m256 low, __m256 high )
+{
+    __m512d joined = _mm512_castpd256_pd512( _mm256_castps_pd( low ) );
+    joined = _mm512_insertf64x4( joined, _mm256_castps_pd( high ), 1 );
+    return _mm512_castpd_ps( joined );
+}
+
+//--------------------------------------------------------
+// narrowTAvx512()
+// Returns t = (x - shift) * scale of 8 points, formed in
+// double and narrowed to float.
+//--------------------------------------------------------
+__attribute__(( target( "avx512f" ) ))
+static inline __m256 narrowTAvx512( const double *xValues, __m512d vShift, __m512d vScale )
+{
+    return _mm512_cvtpd_ps( _mm512_mul_pd( _mm512_sub_pd( _mm512_loadu_pd( xValues ), vShift ), vScale ) );
+}
+
+__attribute__(( target( "avx512f" ) ))
+static void powerSumsFloatAvx512( int pointCount, const double *xValues, const double *yValues,
+                                  double shift, double scale, double yShift,
+                                  int coefficientCount, double *sumT, double *sumTY )
+{
+    int sumCount = POLYFIT_POWER_SUM_COUNT( coefficientCount );
+    __m512d vShift = _mm512_set1_pd( shift );
+    __m512d vScale = _mm512_set1_pd( scale );
+    __m512d vYShift = _mm512_set1_pd( yShift );
+    __m512 accT[ MAX_SUMS ];
+    __m512 accTY[ POLYFIT_MAX_COEFFICIENTS ];
+
+    int i = 0;
+    while( i + 32 <= pointCount )
+    {
+        int blockEnd = (pointCount - i < POLYFIT_FLOAT_BLOCK) ? pointCount : (i + POLYFIT_FLOAT_BLOCK);
+        for( int p = 0; p < sumCount; p++ )
+        {
+            accT[p] = _mm512_setzero_ps();
+        }
+        for( int p = 0; p < coefficientCount; p++ )
+        {
+            accTY[p] = _mm512_setzero_ps();
+        }
+
+        // Two vectors of points a step, so their chains of
+        // powers overlap.
+        for( ; i + 32 <= blockEnd; i += 32 )
+        {
+            // t is formed in double, then narrowed.
+            __m512 vt = joinFloatsAvx512( narrowTAvx512( &xValues[i], vShift, vScale ),
+                                          narrowTAvx512( &xValues[i + 8], vShift, vScale ) );
+            __m512 vt2 = joinFloatsAvx512( narrowTAvx512( &xValues[i + 16], vShift, vScale ),
+                                           narrowTAvx512( &xValues[i + 24], vShift, vScale ) );
+            __m512 vy = joinFloatsAvx512( _mm512_cvtpd_ps( _mm512_sub_pd( _mm512_loadu_pd( &yValues[i] ), vYShift ) ),
+                                          _mm512_cvtpd_ps( _mm512_sub_pd( _mm512_loadu_pd( &yValues[i + 8] ), vYShift ) ) );
+            __m512 vy2 = joinFloatsAvx512( _mm512_cvtpd_ps( _mm512_sub_pd( _mm512_loadu_pd( &yValues[i + 16] ), vYShift ) ),
+                                           _mm512_cvtpd_ps( _mm512_sub_pd( _mm512_loadu_pd( &yValues[i + 24] ), vYShift ) ) );
+            __m512 tPow = _mm512_set1_ps( 1.0f );
+            __m512 tPow2 = tPow;
+            for( int p = 0; p < coefficientCount; p++ )
+            {
+                accT[p] = _mm512_add_ps( accT[p], _mm512_add_ps( tPow, tPow2 ) );
+                accTY[p] = _mm512_fmadd_ps( tPow, vy, _mm512_fmadd_ps( tPow2, vy2, accTY[p] ) );
+                tPow = _mm512_mul_ps( tPow, vt );
+                tPow2 = _mm512_mul_ps( tPow2, vt2 );
+            }
+            for( int p = coefficientCount; p < sumCount; p++ )
+            {
+                accT[p] = _mm512_add_ps( accT[p], _mm512_add_ps( tPow, tPow2 ) );
+                tPow = _mm512_mul_ps( tPow, vt );
+                tPow2 = _mm512_mul_ps( tPow2, vt2 );
+            }
+        }
+
+        for( int p = 0; p < sumCount; p++ )
+        {
+            sumT[p] += (double) _mm512_reduce_add_ps( accT[p] );
+        }
+        for( int p = 0; p < coefficientCount; p++ )
+        {
+            sumTY[p] += (double) _mm512_reduce_add_ps( accTY[p] );
+        }
+    }
+    powerSumsFloatScalar( pointCount - i, &xValues[i], &yValues[i], shift, scale, yShift, coefficientCount, sumT, sumTY );
+}
+
+#endif  // POLYFIT_SIMD_X86
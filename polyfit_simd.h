@@ -0,0 +1,89 @@
+// file: polyfit_simd.h
+// Description: Vectorized kernels for the fill and reduction phases,
+//              with the instruction set chosen once at startup.
+//
+// The kernels are selected from the best ISA level the CPU supports.
+// Setting the environment variable POLYFIT_ISA to "scalar", "sse2",
+// "avx2" or "avx512" (or calling polyfit_simd_force()) overrides the
+// choice, e.g. to benchmark one level against another.
+
+#ifndef POLYFIT_SIMD_H
+#define POLYFIT_SIMD_H
+
+// Instruction set levels, in increasing order.
+typedef enum polyfit_isa_e
+{
+    POLYFIT_ISA_SCALAR = 0,
+    POLYFIT_ISA_SSE2,
+    POLYFIT_ISA_AVX2,       // AVX2 + FMA
+    POLYFIT_ISA_AVX512,     // AVX-512F
+    POLYFIT_ISA_COUNT
+} polyfit_isa_t;
+
+// One set of kernels.
+typedef struct polyfit_simd_kernels_s
+{
+    polyfit_isa_t isa;
+    const char *name;
+
+    // Writes the pointCount x coefficientCount row-major
+    // Vandermonde rows: pRows[r * coefficientCount + c] = x[r]^(degree - c).
+    void    (*fillPowers)( int pointCount, const double *xValues, int coefficientCount, double *pRows );
+
+    // Returns the sum of pLeft[i] * pRight[i] for i < count.
+    double  (*dot)( int count, const double *pLeft, const double *pRight );
+
+    // Same contract as polyfit_power_sums(): adds sum of x^p into
+    // sumX[0 .. 2*degree] and sum of y * x^p into sumXY[0 .. degree].
+    void    (*powerSums)( int pointCount, const double *xValues, const double *yValues,
+                          int coefficientCount, double *sumX, double *sumXY );
+
+    // Float32 version of powerSums() for t = (x - shift) * scale
+    // and y - yShift, at twice the vector width; both are formed
+    // in double before narrowing.  The sums are kept in float over
+    // blocks of POLYFIT_FLOAT_BLOCK points, then added into the
+    // double arrays sumT and sumTY, so rounding error doesn't grow
+    // with pointCount.
+    void    (*powerSumsFloat)( int pointCount, const double *xValues, const double *yValues,
+                               double shift, double scale, double yShift,
+                               int coefficientCount, double *sumT, double *sumTY );
+} polyfit_simd_kernels_t;
+
+// Points accumulated in float before flushing to double.
+#define POLYFIT_FLOAT_BLOCK     (512)
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_simd()
+// Returns the kernels selected for this process.
+//--------------------------------------------------------
+const polyfit_simd_kernels_t *polyfit_simd( void );
+
+//--------------------------------------------------------
+// polyfit_simd_supported()
+// Returns the highest ISA level this CPU can run.
+//--------------------------------------------------------
+polyfit_isa_t polyfit_simd_supported( void );
+
+//--------------------------------------------------------
+// polyfit_simd_force()
+// Selects the kernels of a given ISA level.  Not thread
+// safe; call it before starting any fits.
+//
+// Returns 0 if success, -2 if isa is out of range or not
+// supported by this CPU.
+//--------------------------------------------------------
+int polyfit_simd_force( polyfit_isa_t isa );
+
+//--------------------------------------------------------
+// polyfit_simd_name()
+// Returns the name of an ISA level ("scalar", "sse2", ...).
+//--------------------------------------------------------
+const char *polyfit_simd_name( polyfit_isa_t isa );
+
+
+#endif	// POLYFIT_SIMD_H
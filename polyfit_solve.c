@@ -0,0 +1,144 @@
+// Name: polyfit_solve.c
+// Description: Cholesky solver for the MLS normal equations.
+
+#include <float.h>      // DBL_EPSILON
+#include <math.h>       // sqrt(), fabs()
+#include <stdbool.h>    // bool
+#include <stdio.h>      // NULL
+#include <stdlib.h>     // malloc(), free()
+
+#include "polyfit_solve.h"
+#include "polyfit_sums.h"
+
+// MACRO to access element (row, col) of an n x n row-major matrix.
+#define AT( p, n, row, col )  ((p)[ ((row) * (n)) + (col) ])
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static int  factorCholesky( int n, const double *ata, double *u );
+static bool isPivotSingular( int n, double pivot, double diagonal );
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_solve_normal()
+// Solves (AT)A x = (AT)b by Cholesky.
+//
+// Cholesky costs about n^3/6 multiply-adds, a third of the
+// unpivoted Gauss-Jordan elimination it replaces.  The
+// factors of the usual small systems live on the stack;
+// the matrix backends take any coefficientCount, so larger
+// ones go on the heap.
+//--------------------------------------------------------
+int polyfit_solve_normal( int n, const double *ata, const double *atb, double *x )
+{
+    double uFixed[ POLYFIT_MAX_COEFFICIENTS * POLYFIT_MAX_COEFFICIENTS ];
+
+    if( (NULL == ata) || (NULL == atb) || (NULL == x) )
+    {
+        return -1;
+    }
+
+    double *u = uFixed;     // Upper triangular factor.
+    double *pHeap = NULL;
+    if( n > POLYFIT_MAX_COEFFICIENTS )
+    {
+        pHeap = (double *) malloc( (size_t) n * n * sizeof( double ) );
+        if( NULL == pHeap )
+        {
+            return -3;
+        }
+        u = pHeap;
+    }
+
+    int rVal = factorCholesky( n, ata, u );
+    if( 0 != rVal )
+    {
+        free( pHeap );
+        return rVal;
+    }
+
+    // Forward substitution: (UT) z = b, z stored in x.
+    for( int i = 0; i < n; i++ )
+    {
+        double sum = atb[i];
+        for( int k = 0; k < i; k++ )
+        {
+            sum -= AT( u, n, k, i ) * x[k];
+        }
+        x[i] = sum / AT( u, n, i, i );
+    }
+
+    // Back substitution: U x = z.
+    for( int i = n - 1; i >= 0; i-- )
+    {
+        double sum = x[i];
+        for( int k = i + 1; k < n; k++ )
+        {
+            sum -= AT( u, n, i, k ) * x[k];
+        }
+        x[i] = sum / AT( u, n, i, i );
+    }
+    free( pHeap );
+    return 0;
+}
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// factorCholesky()
+// Computes the upper triangle of U with (UT)U = ata.
+// A pivot that is not above the rounding error of its
+// diagonal (zero, negative or NaN included) means (AT)A is
+// singular to working precision, or made indefinite by
+// rounding; no factorization of it would give a solution
+// worth returning.
+// Returns 0 on success, -4 if a pivot is not usable.
+//--------------------------------------------------------
+static int factorCholesky( int n, const double *ata, double *u )
+{
+    for( int j = 0; j < n; j++ )
+    {
+        double pivot = AT( ata, n, j, j );
+        for( int k = 0; k < j; k++ )
+        {
+            pivot -= AT( u, n, k, j ) * AT( u, n, k, j );
+        }
+        if( isPivotSingular( n, pivot, AT( ata, n, j, j ) ) )
+        {
+            return -4;
+        }
+
+        double ujj = sqrt( pivot );
+        AT( u, n, j, j ) = ujj;
+        for( int c = j + 1; c < n; c++ )
+        {
+            double sum = AT( ata, n, j, c );
+            for( int k = 0; k < j; k++ )
+            {
+                sum -= AT( u, n, k, j ) * AT( u, n, k, c );
+            }
+            AT( u, n, j, c ) = sum / ujj;
+        }
+    }
+    return 0;
+}
+
+//--------------------------------------------------------
+// isPivotSingular()
+// True unless a pivot is above the rounding error of the
+// diagonal element it came from; written so that a NaN
+// pivot or diagonal counts as singular.
+//--------------------------------------------------------
+static bool isPivotSingular( int n, double pivot, double diagonal )
+{
+    return !(pivot > (n * DBL_EPSILON * fabs( diagonal )));
+}
@@ -0,0 +1,32 @@
+// file: polyfit_solve.h
+// Description: Solver for the symmetric positive definite normal
+//              equations (AT)A x = (AT)b of an MLS fit.
+
+#ifndef POLYFIT_SOLVE_H
+#define POLYFIT_SOLVE_H
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_solve_normal()
+// Solves (AT)A x = (AT)b by Cholesky factorization,
+// (AT)A = (UT)U.  A pivot not above n * DBL_EPSILON times
+// its diagonal element, zero, negative or NaN included, is
+// reported as singular rather than divided by.
+//
+// Only the upper triangle of the n x n row-major matrix
+// ata is read; ata and atb are not modified.
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -3 if unable to allocate memory (only for n
+//             above POLYFIT_MAX_COEFFICIENTS),
+//          -4 if the system is numerically singular.
+//--------------------------------------------------------
+int polyfit_solve_normal( int n, const double *ata, const double *atb, double *x );
+
+
+#endif	// POLYFIT_SOLVE_H
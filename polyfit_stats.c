@@ -0,0 +1,257 @@
+// Name: polyfit_stats.c
+// Description: Per-phase timing and counters for the fits, and a
+//              collector that summarizes them over many calls.
+
+#include <stdio.h>      // fprintf()
+#include <stdlib.h>     // malloc(), realloc(), qsort()
+#include <string.h>     // memset()
+#include <time.h>       // clock_gettime()
+
+#include "polyfit_perf.h"
+#include "polyfit_stats.h"
+
+// Samples the first addition makes room for.
+#define INITIAL_CAPACITY    (64)
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static int  compareSamples( const void *pLeft, const void *pRight );
+
+
+// Indexed by polyfit_phase_t.
+static const char *phaseNames[ POLYFIT_PHASE_COUNT ] =
+{
+    "fill", "transpose", "product", "solve", "total"
+};
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_stats_clear()
+// Zeroes pStats.
+//--------------------------------------------------------
+void polyfit_stats_clear( polyfit_stats_t *pStats )
+{
+    if( NULL != pStats )
+    {
+        memset( pStats, 0, sizeof( *pStats ) );
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_stats_now()
+// Returns CLOCK_MONOTONIC in nanoseconds.
+//--------------------------------------------------------
+long long polyfit_stats_now( void )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+//--------------------------------------------------------
+// polyfit_stats_begin()
+// Starts timing a phase.  The counters are read first so
+// the clock call isn't counted.
+//--------------------------------------------------------
+void polyfit_stats_begin( polyfit_stats_t *pStats, polyfit_phase_t phase )
+{
+    if( (NULL != pStats) && (phase >= POLYFIT_PHASE_FILL) && (phase < POLYFIT_PHASE_COUNT) )
+    {
+        polyfit_perf_begin( pStats->pPerf, phase );
+        pStats->phaseStart[ phase ] = polyfit_stats_now();
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_stats_end()
+// Adds the elapsed time and work to a phase, and the work
+// to the total.
+//--------------------------------------------------------
+void polyfit_stats_end( polyfit_stats_t *pStats, polyfit_phase_t phase, long long byteCount, long long flopCount )
+{
+    if( (NULL != pStats) && (phase >= POLYFIT_PHASE_FILL) && (phase < POLYFIT_PHASE_COUNT) )
+    {
+        pStats->nanoseconds[ phase ] += polyfit_stats_now() - pStats->phaseStart[ phase ];
+        pStats->bytes[ phase ] += byteCount;
+        pStats->flops[ phase ] += flopCount;
+        if( POLYFIT_PHASE_TOTAL != phase )
+        {
+            pStats->bytes[ POLYFIT_PHASE_TOTAL ] += byteCount;
+            pStats->flops[ POLYFIT_PHASE_TOTAL ] += flopCount;
+        }
+        polyfit_perf_end( pStats->pPerf, phase, pStats->pointCount );
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_phase_name()
+// Returns the name of a phase.
+//--------------------------------------------------------
+const char *polyfit_phase_name( polyfit_phase_t phase )
+{
+    if( (phase < POLYFIT_PHASE_FILL) || (phase >= POLYFIT_PHASE_COUNT) )
+    {
+        return "unknown";
+    }
+    return phaseNames[ phase ];
+}
+
+//--------------------------------------------------------
+// polyfit_stats_collector_init()
+// Readies an empty collector.
+//--------------------------------------------------------
+int polyfit_stats_collector_init( polyfit_stats_collector_t *pCollector )
+{
+    if( NULL == pCollector )
+    {
+        return -1;
+    }
+
+    memset( pCollector, 0, sizeof( *pCollector ) );
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_stats_collector_add()
+// Appends one row of phase times, doubling the storage
+// when it is full.
+//--------------------------------------------------------
+int polyfit_stats_collector_add( polyfit_stats_collector_t *pCollector, const polyfit_stats_t *pStats )
+{
+    if( (NULL == pCollector) || (NULL == pStats) )
+    {
+        return -1;
+    }
+
+    if( pCollector->sampleCount == pCollector->capacity )
+    {
+        long capacity = (0 == pCollector->capacity) ? INITIAL_CAPACITY : 2 * pCollector->capacity;
+        long long *pSamples = (long long *) realloc( pCollector->pSamples,
+                                                     capacity * POLYFIT_PHASE_COUNT * sizeof( long long ) );
+        if( NULL == pSamples )
+        {
+            return -3;
+        }
+        pCollector->pSamples = pSamples;
+        pCollector->capacity = capacity;
+    }
+
+    long long *pRow = &pCollector->pSamples[ pCollector->sampleCount * POLYFIT_PHASE_COUNT ];
+    for( int p = 0; p < POLYFIT_PHASE_COUNT; p++ )
+    {
+        pRow[p] = pStats->nanoseconds[p];
+    }
+    pCollector->sampleCount++;
+    pCollector->bytesTouched += pStats->bytes[ POLYFIT_PHASE_TOTAL ];
+    pCollector->pointCount += pStats->pointCount;
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_stats_collector_summary()
+// Sorts a copy of one phase's samples; the percentiles
+// are nearest-rank.
+//--------------------------------------------------------
+int polyfit_stats_collector_summary( const polyfit_stats_collector_t *pCollector, polyfit_phase_t phase,
+                                     polyfit_stats_summary_t *pSummary )
+{
+    if( (NULL == pCollector) || (NULL == pSummary) )
+    {
+        return -1;
+    }
+    if( (phase < POLYFIT_PHASE_FILL) || (phase >= POLYFIT_PHASE_COUNT) || (pCollector->sampleCount <= 0) )
+    {
+        return -2;
+    }
+
+    long count = pCollector->sampleCount;
+    long long *pSorted = (long long *) malloc( count * sizeof( long long ) );
+    if( NULL == pSorted )
+    {
+        return -3;
+    }
+
+    double sum = 0.0;
+    for( long i = 0; i < count; i++ )
+    {
+        pSorted[i] = pCollector->pSamples[ i * POLYFIT_PHASE_COUNT + phase ];
+        sum += (double) pSorted[i];
+    }
+    qsort( pSorted, count, sizeof( long long ), compareSamples );
+
+    pSummary->sampleCount = count;
+    pSummary->minimum = (double) pSorted[0];
+    pSummary->mean = sum / count;
+    pSummary->p50 = (double) pSorted[ (count + 1) / 2 - 1 ];
+    pSummary->p99 = (double) pSorted[ (99 * count + 99) / 100 - 1 ];
+    pSummary->maximum = (double) pSorted[ count - 1 ];
+
+    free( pSorted );
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_stats_collector_print()
+// Writes a table of every phase's summary.
+//--------------------------------------------------------
+void polyfit_stats_collector_print( const polyfit_stats_collector_t *pCollector, FILE *pFile, const char *title )
+{
+    polyfit_stats_summary_t summary;
+
+    if( (NULL == pCollector) || (NULL == pFile) )
+    {
+        return;
+    }
+
+    fprintf( pFile, "%s: %ld fits, %.0f points and %.0f bytes per fit\n", (NULL != title) ? title : "stats",
+             pCollector->sampleCount,
+             (pCollector->sampleCount > 0) ? (double) pCollector->pointCount / pCollector->sampleCount : 0.0,
+             (pCollector->sampleCount > 0) ? (double) pCollector->bytesTouched / pCollector->sampleCount : 0.0 );
+    fprintf( pFile, "  %-10s %12s %12s %12s %12s %12s  (microseconds)\n", "phase", "min", "mean", "p50", "p99", "max" );
+
+    for( int p = 0; p < POLYFIT_PHASE_COUNT; p++ )
+    {
+        if( 0 == polyfit_stats_collector_summary( pCollector, (polyfit_phase_t) p, &summary ) )
+        {
+            fprintf( pFile, "  %-10s %12.1f %12.1f %12.1f %12.1f %12.1f\n", phaseNames[p],
+                     summary.minimum / 1e3, summary.mean / 1e3, summary.p50 / 1e3, summary.p99 / 1e3, summary.maximum / 1e3 );
+        }
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_stats_collector_free()
+// Frees the samples and empties the collector.
+//--------------------------------------------------------
+void polyfit_stats_collector_free( polyfit_stats_collector_t *pCollector )
+{
+    if( NULL != pCollector )
+    {
+        free( pCollector->pSamples );
+        memset( pCollector, 0, sizeof( *pCollector ) );
+    }
+}
+
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// compareSamples()
+// qsort() order for long long.
+//--------------------------------------------------------
+static int compareSamples( const void *pLeft, const void *pRight )
+{
+    long long left = *(const long long *) pLeft;
+    long long right = *(const long long *) pRight;
+    return (left > right) - (left < right);
+}
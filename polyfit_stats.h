@@ -0,0 +1,159 @@
+// file: polyfit_stats.h
+// Description: Per-phase timing and counters for the fits, and a
+//              collector that summarizes them over many calls.
+//
+// A fit fills a polyfit_stats_t only when it is given one, so an
+// uninstrumented call costs a NULL test per phase.  Define
+// POLYFIT_NO_STATS when building the library to compile the
+// instrumentation out altogether; the structs are then left zero.
+//
+// Hardware counters are read with the times when pPerf is set (see
+// polyfit_perf.h).
+
+#ifndef POLYFIT_STATS_H
+#define POLYFIT_STATS_H
+
+#include <stdio.h>      // FILE
+
+// Phases of a fit.
+typedef enum polyfit_phase_e
+{
+    POLYFIT_PHASE_FILL = 0,     // Building A and b, or reading the points.
+    POLYFIT_PHASE_TRANSPOSE,    // Building AT.
+    POLYFIT_PHASE_PRODUCT,      // Forming (AT)A and (AT)b.
+    POLYFIT_PHASE_SOLVE,        // Solving for the coefficients.
+    POLYFIT_PHASE_TOTAL,        // The whole fit.
+    POLYFIT_PHASE_COUNT
+} polyfit_phase_t;
+
+// Measurements of one fit.  Phases a backend doesn't have
+// stay 0; the TOTAL phase's bytes and flops are the sums
+// of the others'.
+typedef struct polyfit_stats_s
+{
+    long long   nanoseconds[ POLYFIT_PHASE_COUNT ];
+    long long   bytes[ POLYFIT_PHASE_COUNT ];   // Bytes read and written, by the access pattern.
+    long long   flops[ POLYFIT_PHASE_COUNT ];   // Floating point operations, counted the same way.
+    long        pointCount;     // Points processed.
+    int         threadCount;    // Threads used.
+    long long   phaseStart[ POLYFIT_PHASE_COUNT ];  // Start of each phase being timed.
+    struct polyfit_perf_s *pPerf;   // Counters to read with the times, or NULL.
+} polyfit_stats_t;
+
+// Distribution of one phase over the collected fits, in
+// nanoseconds.
+typedef struct polyfit_stats_summary_s
+{
+    long        sampleCount;
+    double      minimum;
+    double      mean;
+    double      p50;
+    double      p99;
+    double      maximum;
+} polyfit_stats_summary_t;
+
+// Every fit added, kept so percentiles are exact.
+typedef struct polyfit_stats_collector_s
+{
+    long        sampleCount;
+    long        capacity;
+    long long   *pSamples;      // sampleCount rows of POLYFIT_PHASE_COUNT nanoseconds.
+    long long   bytesTouched;   // Totals over all samples.
+    long long   pointCount;
+} polyfit_stats_collector_t;
+
+#ifndef POLYFIT_NO_STATS
+#define POLYFIT_STATS_BEGIN( pStats, phase )                polyfit_stats_begin( (pStats), (phase) )
+#define POLYFIT_STATS_END( pStats, phase, byteCount, flopCount ) \
+            polyfit_stats_end( (pStats), (phase), (byteCount), (flopCount) )
+#else   // POLYFIT_NO_STATS
+#define POLYFIT_STATS_BEGIN( pStats, phase )                ((void) (pStats))
+#define POLYFIT_STATS_END( pStats, phase, byteCount, flopCount ) \
+            ((void) (pStats), (void) (byteCount), (void) (flopCount))
+#endif  // POLYFIT_NO_STATS
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_stats_clear()
+// Zeroes pStats, detaching any counters.  pStats may be
+// NULL.
+//--------------------------------------------------------
+void polyfit_stats_clear( polyfit_stats_t *pStats );
+
+//--------------------------------------------------------
+// polyfit_stats_now()
+// Returns CLOCK_MONOTONIC in nanoseconds.
+//--------------------------------------------------------
+long long polyfit_stats_now( void );
+
+//--------------------------------------------------------
+// polyfit_stats_begin()
+// Starts timing a phase, and reads pStats->pPerf if it is
+// set.  Phases may nest within POLYFIT_PHASE_TOTAL.  Does
+// nothing if pStats is NULL.  Use POLYFIT_STATS_BEGIN() so
+// POLYFIT_NO_STATS removes it.
+//--------------------------------------------------------
+void polyfit_stats_begin( polyfit_stats_t *pStats, polyfit_phase_t phase );
+
+//--------------------------------------------------------
+// polyfit_stats_end()
+// Adds the time since polyfit_stats_begin(), byteCount
+// and flopCount to a phase, and the counts to
+// pStats->pPerf if it is set.  Does nothing if pStats is
+// NULL.  Use POLYFIT_STATS_END().
+//--------------------------------------------------------
+void polyfit_stats_end( polyfit_stats_t *pStats, polyfit_phase_t phase, long long byteCount, long long flopCount );
+
+//--------------------------------------------------------
+// polyfit_phase_name()
+// Returns the name of a phase ("fill", "transpose", ...).
+//--------------------------------------------------------
+const char *polyfit_phase_name( polyfit_phase_t phase );
+
+//--------------------------------------------------------
+// polyfit_stats_collector_init()
+// Readies an empty collector.
+//
+// Returns 0 if success, -1 if passed a NULL pointer.
+//--------------------------------------------------------
+int polyfit_stats_collector_init( polyfit_stats_collector_t *pCollector );
+
+//--------------------------------------------------------
+// polyfit_stats_collector_add()
+// Adds one fit's measurements.
+//
+// Returns 0 if success, -1 if passed a NULL pointer, -3 if
+// unable to allocate memory.
+//--------------------------------------------------------
+int polyfit_stats_collector_add( polyfit_stats_collector_t *pCollector, const polyfit_stats_t *pStats );
+
+//--------------------------------------------------------
+// polyfit_stats_collector_summary()
+// Computes min/mean/p50/p99/max of one phase.
+//
+// Returns 0 if success, -1 if passed a NULL pointer, -2 if
+// phase is out of range or nothing was collected, -3 if
+// unable to allocate memory.
+//--------------------------------------------------------
+int polyfit_stats_collector_summary( const polyfit_stats_collector_t *pCollector, polyfit_phase_t phase,
+                                     polyfit_stats_summary_t *pSummary );
+
+//--------------------------------------------------------
+// polyfit_stats_collector_print()
+// Writes a table of every phase's summary, in
+// microseconds, headed by title.
+//--------------------------------------------------------
+void polyfit_stats_collector_print( const polyfit_stats_collector_t *pCollector, FILE *pFile, const char *title );
+
+//--------------------------------------------------------
+// polyfit_stats_collector_free()
+// Frees the samples and empties the collector.
+//--------------------------------------------------------
+void polyfit_stats_collector_free( polyfit_stats_collector_t *pCollector );
+
+
+#endif	// POLYFIT_STATS_H
@@ -0,0 +1,194 @@
+// Name: polyfit_sums.c
+// Description: Streaming accumulation of the MLS normal equations.
+
+#include <stdio.h>      // NULL
+#include <string.h>     // memset()
+
+#include "polyfit_sums.h"
+#include "polyfit_simd.h"
+#include "polyfit_solve.h"
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_sums_init()
+// Clears the sums for a fit with coefficientCount terms.
+//--------------------------------------------------------
+int polyfit_sums_init( polyfit_sums_t *pSums, int coefficientCount )
+{
+    if( NULL == pSums )
+    {
+        return -1;
+    }
+    if( (coefficientCount <= 0) || (coefficientCount > POLYFIT_MAX_COEFFICIENTS) )
+    {
+        return -2;
+    }
+
+    memset( pSums, 0, sizeof( *pSums ) );
+    pSums->coefficientCount = coefficientCount;
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_sums_add()
+// Folds a block of points into the running sums.
+//--------------------------------------------------------
+int polyfit_sums_add( polyfit_sums_t *pSums, int pointCount, const double *xValues, const double *yValues )
+{
+    if( (NULL == pSums) || (NULL == xValues) || (NULL == yValues) )
+    {
+        return -1;
+    }
+
+    polyfit_power_sums( pointCount, xValues, yValues, pSums->coefficientCount, pSums->sumX, pSums->sumXY );
+    pSums->pointCount += pointCount;
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_power_sums()
+// Power-sum kernel.  Each point costs 2*degree multiplies
+// to form its powers, instead of the coefficientCount^2
+// multiply-adds of an (AT)A outer product.  Runs the
+// vectorized kernel selected by polyfit_simd().
+//--------------------------------------------------------
+void polyfit_power_sums( int pointCount, const double *xValues, const double *yValues,
+                         int coefficientCount, double *sumX, double *sumXY )
+{
+    polyfit_simd()->powerSums( pointCount, xValues, yValues, coefficientCount, sumX, sumXY );
+}
+
+//--------------------------------------------------------
+// polyfit_sums_build()
+// Expands the power sums into (AT)A and (AT)b.
+//--------------------------------------------------------
+int polyfit_sums_build( const polyfit_sums_t *pSums, double *ata, double *atb )
+{
+    if( (NULL == pSums) || (NULL == ata) || (NULL == atb) )
+    {
+        return -1;
+    }
+
+    int cc = pSums->coefficientCount;
+    int degree = cc - 1;
+    for( int r = 0; r < cc; r++ )
+    {
+        for( int c = 0; c < cc; c++ )
+        {
+            ata[ r * cc + c ] = pSums->sumX[ 2 * degree - r - c ];
+        }
+        atb[r] = pSums->sumXY[ degree - r ];
+    }
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_sums_merge()
+// Adds the sums of pSrc into pDest.
+//--------------------------------------------------------
+int polyfit_sums_merge( polyfit_sums_t *pDest, const polyfit_sums_t *pSrc )
+{
+    if( (NULL == pDest) || (NULL == pSrc) )
+    {
+        return -1;
+    }
+    if( pDest->coefficientCount != pSrc->coefficientCount )
+    {
+        return -2;
+    }
+
+    int cc = pDest->coefficientCount;
+    for( int p = 0; p < POLYFIT_POWER_SUM_COUNT( cc ); p++ )
+    {
+        pDest->sumX[p] += pSrc->sumX[p];
+    }
+    for( int p = 0; p < cc; p++ )
+    {
+        pDest->sumXY[p] += pSrc->sumXY[p];
+    }
+    pDest->pointCount += pSrc->pointCount;
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_sums_solve()
+// Solves (AT)A x = (AT)b with polyfit_solve_normal().
+//--------------------------------------------------------
+int polyfit_sums_solve( const polyfit_sums_t *pSums, double *coefficientResults )
+{
+    if( (NULL == pSums) || (NULL == coefficientResults) )
+    {
+        return -1;
+    }
+
+    int cc = pSums->coefficientCount;
+    if( pSums->pointCount < cc )
+    {
+        return -2;
+    }
+
+    double ata[ POLYFIT_MAX_COEFFICIENTS * POLYFIT_MAX_COEFFICIENTS ];
+    double atb[ POLYFIT_MAX_COEFFICIENTS ];
+    polyfit_sums_build( pSums, ata, atb );
+
+    return polyfit_solve_normal( cc, ata, atb, coefficientResults );
+}
+
+//--------------------------------------------------------
+// polyfit_unscale()
+// t^m = scale^m * (x - shift)^m, expanded binomially.
+//--------------------------------------------------------
+void polyfit_unscale( int coefficientCount, double shift, double scale, const double *inT, double *inX )
+{
+    int degree = coefficientCount - 1;
+    memset( inX, 0, coefficientCount * sizeof( double ) );
+
+    double scalePow = 1.0;
+    for( int m = 0; m <= degree; m++ )
+    {
+        double binomial = 1.0;      // C(m, q)
+        double shiftPow = 1.0;      // (-shift)^(m - q)
+        for( int q = m; q >= 0; q-- )
+        {
+            inX[ degree - q ] += inT[ degree - m ] * scalePow * binomial * shiftPow;
+            binomial = binomial * q / (m - q + 1);
+            shiftPow *= -shift;
+        }
+        scalePow *= scale;
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_stream()
+// Single-pass polyfit() that never builds the A matrix.
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -2 if (pointCount < coefficientCount) or
+//             coefficientCount is out of range,
+//          -4 if the equations are numerically singular.
+//--------------------------------------------------------
+int polyfit_stream( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults )
+{
+    polyfit_sums_t sums;
+
+    if( (NULL == xValues) || (NULL == yValues) || (NULL == coefficientResults) )
+    {
+        return -1;
+    }
+    if( pointCount < coefficientCount )
+    {
+        return -2;
+    }
+    if( 0 != polyfit_sums_init( &sums, coefficientCount ) )
+    {
+        return -2;
+    }
+
+    polyfit_sums_add( &sums, pointCount, xValues, yValues );
+    return polyfit_sums_solve( &sums, coefficientResults );
+}
@@ -0,0 +1,134 @@
+// file: polyfit_sums.h
+// Description: Streaming accumulation of the MLS normal equations.
+//
+// Instead of building the pointCount x coefficientCount matrix A,
+// its transpose and their product, the sums kept here are updated
+// one point at a time, so a fit needs O(coefficientCount) memory
+// no matter how many points are processed.
+
+#ifndef POLYFIT_SUMS_H
+#define POLYFIT_SUMS_H
+
+#include <math.h>       // fabs()
+
+// Largest coefficientCount supported by the streaming accumulator.
+#define POLYFIT_MAX_COEFFICIENTS    (24)
+
+// Number of distinct power sums of x for coefficientCount terms.
+#define POLYFIT_POWER_SUM_COUNT( coefficientCount )  (2 * (coefficientCount) - 1)
+
+// Running sums of the normal equations.
+// (AT)A is a Hankel matrix, (AT)A[i,j] = sumX[2*degree - i - j],
+// and (AT)b[i] = sumXY[degree - i], so only the power sums are kept.
+typedef struct polyfit_sums_s
+{
+    int     coefficientCount;
+    long    pointCount;
+    double  sumX[ POLYFIT_POWER_SUM_COUNT( POLYFIT_MAX_COEFFICIENTS ) ];   // sum of x^p
+    double  sumXY[ POLYFIT_MAX_COEFFICIENTS ];                              // sum of y * x^p
+} polyfit_sums_t;
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_sums_init()
+// Clears the sums for a fit with coefficientCount terms.
+//
+// Returns 0 if success, -1 if passed a NULL pointer,
+// -2 if coefficientCount is out of range.
+//--------------------------------------------------------
+int polyfit_sums_init( polyfit_sums_t *pSums, int coefficientCount );
+
+//--------------------------------------------------------
+// polyfit_sums_add()
+// Folds a block of points into the running sums.
+//
+// Returns 0 if success, -1 if passed a NULL pointer.
+//--------------------------------------------------------
+int polyfit_sums_add( polyfit_sums_t *pSums, int pointCount, const double *xValues, const double *yValues );
+
+//--------------------------------------------------------
+// polyfit_power_sums()
+// Power-sum kernel: adds sum of x^p for p = 0 .. 2*degree
+// into sumX[p], and sum of y * x^p for p = 0 .. degree into
+// sumXY[p].  Powers are formed by repeated multiplication.
+//--------------------------------------------------------
+void polyfit_power_sums( int pointCount, const double *xValues, const double *yValues,
+                         int coefficientCount, double *sumX, double *sumXY );
+
+//--------------------------------------------------------
+// polyfit_sums_build()
+// Expands the power sums into the full coefficientCount x
+// coefficientCount matrix (AT)A (row-major) and vector (AT)b.
+//
+// Returns 0 if success, -1 if passed a NULL pointer.
+//--------------------------------------------------------
+int polyfit_sums_build( const polyfit_sums_t *pSums, double *ata, double *atb );
+
+//--------------------------------------------------------
+// polyfit_sums_merge()
+// Adds the sums of pSrc into pDest.  Both must have been
+// initialized with the same coefficientCount.
+//
+// Returns 0 if success, -1 if passed a NULL pointer,
+// -2 if the coefficient counts differ.
+//--------------------------------------------------------
+int polyfit_sums_merge( polyfit_sums_t *pDest, const polyfit_sums_t *pSrc );
+
+//--------------------------------------------------------
+// polyfit_sums_solve()
+// Solves the accumulated normal equations for the
+// polynomial coefficients (highest power first).
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -2 if fewer points than coefficients were added,
+//          -4 if the equations are numerically singular.
+//--------------------------------------------------------
+int polyfit_sums_solve( const polyfit_sums_t *pSums, double *coefficientResults );
+
+//--------------------------------------------------------
+// polyfit_unscale()
+// Rewrites a polynomial in t = (x - shift) * scale as a
+// polynomial in x, for fits made on shifted and scaled x.
+// Both are highest power first; inT and inX must not
+// overlap.
+//--------------------------------------------------------
+void polyfit_unscale( int coefficientCount, double shift, double scale, const double *inT, double *inX );
+
+//--------------------------------------------------------
+// polyfit_add_compensated()
+// Neumaier's compensated sum: adds value to *pSum, and the
+// rounding error of that addition to *pError.  The sum is
+// *pSum + *pError.  Inline, as it runs once per term per
+// point.
+//--------------------------------------------------------
+static inline void polyfit_add_compensated( double *pSum, double *pError, double value )
+{
+    double sum = *pSum + value;
+
+    if( fabs( *pSum ) >= fabs( value ) )
+    {
+        *pError += (*pSum - sum) + value;
+    }
+    else
+    {
+        *pError += (value - sum) + *pSum;
+    }
+    *pSum = sum;
+}
+
+//--------------------------------------------------------
+// polyfit_stream()
+// Same contract as polyfit(), but makes a single pass over
+// the points without materializing the A matrix.
+//
+// Returns 0 if success, or the polyfit() error codes.
+//--------------------------------------------------------
+int polyfit_stream( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults );
+
+
+#endif	// POLYFIT_SUMS_H
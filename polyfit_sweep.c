@@ -0,0 +1,325 @@
+// Name: polyfit_sweep.c
+// Description: Single-pass fits of every degree up to a maximum, and
+//              degree selection by information criterion.
+
+#include <float.h>      // DBL_EPSILON, DBL_MIN, DBL_MAX
+#include <math.h>       // fabs(), fmin(), fmax(), log(), isfinite(), isnan(), NAN
+#include <stdbool.h>    // bool
+#include <stdio.h>      // NULL
+#include <stdlib.h>     // calloc()
+#include <string.h>     // memset()
+
+#include "polyfit_sweep.h"
+#include <omp.h>
+
+// Points folded into the sums at a time, so y is still in
+// cache when its squares are added.
+#define SWEEP_BLOCK     (4096)
+
+// One thread's share of the accumulation.
+typedef struct
+{
+    polyfit_sums_t  sums;
+    double          sumYY;
+} SweepPartial;
+
+static const char *criterionNames[ POLYFIT_CRITERION_COUNT ] =
+{
+    "bic", "aic", "adjusted-r2"
+};
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static int  factorSweep( const polyfit_sums_t *pSums, double *u, double *d, double *z );
+static void solveFit( int coefficientCount, int maxCoefficientCount, const double *u, const double *d,
+                      const double *z, double *coefficients );
+static bool isBetter( polyfit_criterion_t criterion, const polyfit_sweep_fit_t *pFit,
+                      const polyfit_sweep_fit_t *pBest );
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_sweep()
+// Centers and scales x to t in [-1, 1] as polyfit_mixed()
+// does, and shifts y by its mean, found in the same pass,
+// then each thread folds a contiguous slice of the points
+// into its own sums of t, a block at a time, as in
+// openmp_polyfit_stream(); the partials are merged in
+// thread order, so the result doesn't depend on timing.
+//--------------------------------------------------------
+int polyfit_sweep( int pointCount, const double *xValues, const double *yValues, int maxCoefficientCount,
+                   polyfit_criterion_t criterion, polyfit_sweep_t *pSweep )
+{
+    polyfit_sums_t sums;
+    double sumYY = 0.0;
+
+    if( (NULL == xValues) || (NULL == yValues) || (NULL == pSweep) )
+    {
+        return -1;
+    }
+    if( (pointCount < 1) || (0 != polyfit_sums_init( &sums, maxCoefficientCount )) )
+    {
+        return -2;
+    }
+
+    double xMin = DBL_MAX;
+    double xMax = -DBL_MAX;
+    double sumY = 0.0;
+    #pragma omp parallel for reduction(min:xMin) reduction(max:xMax) reduction(+:sumY)
+    for( int i = 0; i < pointCount; i++ )
+    {
+        xMin = fmin( xMin, xValues[i] );
+        xMax = fmax( xMax, xValues[i] );
+        sumY += yValues[i];
+    }
+    double shift = 0.5 * (xMin + xMax);
+    double scale = (xMax > xMin) ? (2.0 / (xMax - xMin)) : 1.0;
+    double yShift = sumY / pointCount;
+
+    int maxThreads = omp_get_max_threads();
+    SweepPartial *pPartials = (SweepPartial *) calloc( maxThreads, sizeof( SweepPartial ) );
+    if( NULL == pPartials )
+    {
+        return -3;
+    }
+
+    int numThreads = 1;
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        long start = ((long) pointCount * t) / nt;
+        long end = ((long) pointCount * (t + 1)) / nt;
+
+        #pragma omp single
+        numThreads = nt;
+
+        polyfit_sums_init( &pPartials[t].sums, maxCoefficientCount );
+        for( long block = start; block < end; block += SWEEP_BLOCK )
+        {
+            int count = (end - block < SWEEP_BLOCK) ? (int) (end - block) : SWEEP_BLOCK;
+            double tValues[ SWEEP_BLOCK ];
+            double yShifted[ SWEEP_BLOCK ];
+            double blockYY = 0.0;
+
+            for( int i = 0; i < count; i++ )
+            {
+                tValues[i] = (xValues[ block + i ] - shift) * scale;
+                yShifted[i] = yValues[ block + i ] - yShift;
+                blockYY += yShifted[i] * yShifted[i];
+            }
+            polyfit_sums_add( &pPartials[t].sums, count, tValues, yShifted );
+            pPartials[t].sumYY += blockYY;
+        }
+    }
+
+    for( int t = 0; t < numThreads; t++ )
+    {
+        polyfit_sums_merge( &sums, &pPartials[t].sums );
+        sumYY += pPartials[t].sumYY;
+    }
+    free( pPartials );
+
+    return polyfit_sweep_sums( &sums, sumYY, shift, scale, yShift, criterion, pSweep );
+}
+
+//--------------------------------------------------------
+// polyfit_sweep_sums()
+// Factors once, then reads every fit's SSE off z and D
+// and back-substitutes its coefficients in t from the
+// leading block of U, adding yShift back to the constant
+// term and rewriting them in x.  SSE doesn't depend on
+// yShift, as every fit has a constant term.  It is floored
+// at DBL_EPSILON * sum (y - yShift)^2, below which the
+// subtraction can't resolve it, so a near-exact fit's
+// criterion stays finite.
+//--------------------------------------------------------
+int polyfit_sweep_sums( const polyfit_sums_t *pSums, double sumYY, double shift, double scale, double yShift,
+                        polyfit_criterion_t criterion, polyfit_sweep_t *pSweep )
+{
+    double u[ POLYFIT_MAX_COEFFICIENTS * POLYFIT_MAX_COEFFICIENTS ];
+    double inT[ POLYFIT_MAX_COEFFICIENTS ];
+    double d[ POLYFIT_MAX_COEFFICIENTS ];
+    double z[ POLYFIT_MAX_COEFFICIENTS ];
+
+    if( (NULL == pSums) || (NULL == pSweep) )
+    {
+        return -1;
+    }
+    int maxCount = pSums->coefficientCount;
+    long n = pSums->pointCount;
+    if( (maxCount < 1) || (maxCount > POLYFIT_MAX_COEFFICIENTS) || (n < 1) ||
+        !isfinite( shift ) || !isfinite( scale ) || !(scale > 0.0) || !isfinite( yShift ) ||
+        (criterion < 0) || (criterion >= POLYFIT_CRITERION_COUNT) )
+    {
+        return -2;
+    }
+
+    memset( pSweep, 0, sizeof( *pSweep ) );
+    pSweep->maxCoefficientCount = maxCount;
+    pSweep->pointCount = n;
+    pSweep->criterion = criterion;
+    double sumY = pSums->sumXY[0];
+    pSweep->sst = sumYY - sumY * sumY / n;
+    pSweep->sst = (pSweep->sst > 0.0) ? pSweep->sst : 0.0;
+
+    int solvedCount = factorSweep( pSums, u, d, z );
+    double sseFloor = (DBL_EPSILON * sumYY > DBL_MIN) ? (DBL_EPSILON * sumYY) : DBL_MIN;
+
+    const polyfit_sweep_fit_t *pBest = NULL;
+    double explained = 0.0;
+    for( int c = 1; c <= maxCount; c++ )
+    {
+        polyfit_sweep_fit_t *pFit = &pSweep->fits[ c - 1 ];
+
+        if( c > n )
+        {
+            pFit->status = -2;
+            continue;
+        }
+        if( c > solvedCount )
+        {
+            pFit->status = -4;
+            continue;
+        }
+
+        explained += z[ c - 1 ] * z[ c - 1 ] / d[ c - 1 ];
+        pFit->sse = (sumYY - explained > sseFloor) ? (sumYY - explained) : sseFloor;
+        pFit->aic = n * log( pFit->sse / n ) + 2.0 * c;
+        pFit->bic = n * log( pFit->sse / n ) + c * log( (double) n );
+        pFit->adjustedR2 = ((n > c) && (pSweep->sst > 0.0))
+                           ? 1.0 - (pFit->sse / (n - c)) / (pSweep->sst / (n - 1)) : NAN;
+        solveFit( c, maxCount, u, d, z, inT );
+        inT[ c - 1 ] += yShift;
+        polyfit_unscale( c, shift, scale, inT, pFit->coefficients );
+
+        if( isBetter( criterion, pFit, pBest ) )
+        {
+            pBest = pFit;
+            pSweep->bestCoefficientCount = c;
+        }
+    }
+    return (NULL == pBest) ? -4 : 0;
+}
+
+//--------------------------------------------------------
+// polyfit_criterion_name()
+// Returns the name of a criterion.
+//--------------------------------------------------------
+const char *polyfit_criterion_name( polyfit_criterion_t criterion )
+{
+    if( (criterion < 0) || (criterion >= POLYFIT_CRITERION_COUNT) )
+    {
+        return "unknown";
+    }
+    return criterionNames[ criterion ];
+}
+
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// factorSweep()
+// LDLT of (AT)A[i,j] = sumX[i+j] in the row-major
+// maxCount x maxCount u, unit upper triangular, and the
+// forward substitution z = (UT)^-1 (AT)b.  Stops at the
+// first pivot that isn't above the rounding error of its
+// diagonal (zero, negative or NaN included), the
+// polyfit_solve_normal() test for the smallest system that
+// holds it; the fits past it are singular.
+//
+// Returns how many leading pivots were usable.
+//--------------------------------------------------------
+static int factorSweep( const polyfit_sums_t *pSums, double *u, double *d, double *z )
+{
+    int n = pSums->coefficientCount;
+
+    for( int j = 0; j < n; j++ )
+    {
+        double diagonal = pSums->sumX[ 2 * j ];
+        double pivot = diagonal;
+        for( int k = 0; k < j; k++ )
+        {
+            pivot -= u[ k * n + j ] * u[ k * n + j ] * d[k];
+        }
+        if( !(pivot > ((j + 1) * DBL_EPSILON * fabs( diagonal ))) )
+        {
+            return j;
+        }
+
+        d[j] = pivot;
+        u[ j * n + j ] = 1.0;
+        for( int c = j + 1; c < n; c++ )
+        {
+            double sum = pSums->sumX[ j + c ];
+            for( int k = 0; k < j; k++ )
+            {
+                sum -= u[ k * n + j ] * d[k] * u[ k * n + c ];
+            }
+            u[ j * n + c ] = sum / pivot;
+        }
+
+        double sum = pSums->sumXY[j];
+        for( int k = 0; k < j; k++ )
+        {
+            sum -= u[ k * n + j ] * z[k];
+        }
+        z[j] = sum;
+    }
+    return n;
+}
+
+//--------------------------------------------------------
+// solveFit()
+// Back substitution through the leading coefficientCount
+// block of U, written highest power first.
+//--------------------------------------------------------
+static void solveFit( int coefficientCount, int maxCoefficientCount, const double *u, const double *d,
+                      const double *z, double *coefficients )
+{
+    double a[ POLYFIT_MAX_COEFFICIENTS ];
+    int n = maxCoefficientCount;
+
+    for( int i = coefficientCount - 1; i >= 0; i-- )
+    {
+        double sum = z[i] / d[i];
+        for( int k = i + 1; k < coefficientCount; k++ )
+        {
+            sum -= u[ i * n + k ] * a[k];
+        }
+        a[i] = sum;
+    }
+    for( int i = 0; i < coefficientCount; i++ )
+    {
+        coefficients[ coefficientCount - 1 - i ] = a[i];
+    }
+}
+
+//--------------------------------------------------------
+// isBetter()
+// True if pFit beats pBest (or there is no pBest yet) by
+// criterion.  An undefined adjusted R^2 only wins over
+// nothing.
+//--------------------------------------------------------
+static bool isBetter( polyfit_criterion_t criterion, const polyfit_sweep_fit_t *pFit,
+                      const polyfit_sweep_fit_t *pBest )
+{
+    switch( criterion )
+    {
+        case POLYFIT_CRITERION_AIC:
+            return (NULL == pBest) || (pFit->aic < pBest->aic);
+        case POLYFIT_CRITERION_ADJUSTED_R2:
+            return (NULL == pBest) ||
+                   (!isnan( pFit->adjustedR2 ) && (isnan( pBest->adjustedR2 ) || (pFit->adjustedR2 > pBest->adjustedR2)));
+        default:
+            return (NULL == pBest) || (pFit->bic < pBest->bic);
+    }
+}
@@ -0,0 +1,113 @@
+// file: polyfit_sweep.h
+// Description: Every degree up to a maximum from one pass over the
+//              points, with the best one picked by AIC, BIC or
+//              adjusted R-squared.
+//
+// With the powers ordered lowest first, the normal equations of
+// coefficientCount c are the leading c x c block of those of any
+// larger count, (AT)A[i,j] = sum of x^(i+j).  So one accumulation
+// of the power sums for the largest count, plus the sum of y^2,
+// gives every smaller fit: one LDLT factorization (AT)A = (UT)DU
+// serves all of them, its leading blocks being the smaller
+// factorizations, and with z = (UT)^-1 (AT)b the residual sum of
+// squares of coefficientCount c is
+//      SSE(c) = sum y^2 - sum over i < c of z[i]^2 / D[i]
+// with no further pass over the data.
+//
+// The sums are of t = (x - shift) * scale, x centered and scaled to
+// [-1, 1], since raw power sums of x far from 0 cancel the higher
+// pivots away; each fit is rewritten in x at the end.  Likewise y is
+// taken less yShift, its mean, so that SSE and the total sum of
+// squares aren't small differences of a large sum y^2 when y sits
+// far from 0.
+
+#ifndef POLYFIT_SWEEP_H
+#define POLYFIT_SWEEP_H
+
+#include "polyfit_sums.h"
+
+// How the best coefficientCount is picked.
+typedef enum polyfit_criterion_e
+{
+    POLYFIT_CRITERION_BIC = 0,      // Smallest n ln(SSE/n) + c ln(n).
+    POLYFIT_CRITERION_AIC,          // Smallest n ln(SSE/n) + 2c.
+    POLYFIT_CRITERION_ADJUSTED_R2,  // Largest 1 - (SSE/(n-c)) / (SST/(n-1)).
+    POLYFIT_CRITERION_COUNT
+} polyfit_criterion_t;
+
+// The fit with one coefficientCount.
+typedef struct polyfit_sweep_fit_s
+{
+    int     status;         // 0, -2 if too few points for c, -4 if singular.
+    double  coefficients[ POLYFIT_MAX_COEFFICIENTS ];   // Highest power first.
+    double  sse;            // Residual sum of squares.
+    double  aic;
+    double  bic;
+    double  adjustedR2;
+} polyfit_sweep_fit_t;
+
+// Every fit of a sweep.  fits[c - 1] has coefficientCount c.
+typedef struct polyfit_sweep_s
+{
+    int                 maxCoefficientCount;
+    long                pointCount;
+    double              sst;                // Total sum of squares about the mean of y.
+    polyfit_criterion_t criterion;
+    int                 bestCoefficientCount;
+    polyfit_sweep_fit_t fits[ POLYFIT_MAX_COEFFICIENTS ];
+} polyfit_sweep_t;
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_sweep()
+// Fits every coefficientCount from 1 to
+// maxCoefficientCount in one OpenMP pass over the points,
+// and picks the best by criterion.
+//
+// SSE is found by subtraction from sum (y - mean y)^2, so
+// it is only good to about DBL_EPSILON times that; that is
+// ample to rank the fits, and a near-exact fit's SSE is
+// floored there.
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -2 if maxCoefficientCount or criterion is out of
+//             range, or there are too few points for even
+//             one fit,
+//          -3 if unable to allocate memory,
+//          -4 if no fit could be solved.
+//--------------------------------------------------------
+int polyfit_sweep( int pointCount, const double *xValues, const double *yValues, int maxCoefficientCount,
+                   polyfit_criterion_t criterion, polyfit_sweep_t *pSweep );
+
+//--------------------------------------------------------
+// polyfit_sweep_sums()
+// Same as polyfit_sweep(), from sums already accumulated
+// (with polyfit_sums_add(), or merged from several
+// streams) and sumYY over the same points.
+// maxCoefficientCount is pSums->coefficientCount.  The
+// sums must be of t = (x - shift) * scale, with t near
+// [-1, 1], and of y - yShift, with sumYY the sum of
+// (y - yShift)^2; a yShift near the mean of y keeps SSE
+// accurate.  Pass shift 0, scale 1 and yShift 0 for sums
+// of x and y that are already so.
+//
+// Returns 0 if success, or the polyfit_sweep() error codes
+// other than -3 (-2 also if scale isn't positive or
+// yShift isn't finite).
+//--------------------------------------------------------
+int polyfit_sweep_sums( const polyfit_sums_t *pSums, double sumYY, double shift, double scale, double yShift,
+                        polyfit_criterion_t criterion, polyfit_sweep_t *pSweep );
+
+//--------------------------------------------------------
+// polyfit_criterion_name()
+// Returns "bic", "aic" or "adjusted-r2", or "unknown".
+//--------------------------------------------------------
+const char *polyfit_criterion_name( polyfit_criterion_t criterion );
+
+
+#endif	// POLYFIT_SWEEP_H
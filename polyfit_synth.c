@@ -0,0 +1,174 @@
+// Name: polyfit_synth.c
+// Description: Deterministic synthetic datasets for benchmarks and
+//              checks.
+
+#include <math.h>       // sqrt(), log(), cos()
+#include <stdio.h>      // NULL
+#include <string.h>     // memset()
+
+#include "polyfit_synth.h"
+
+// Random draws made per point: x, two for the noise, and
+// two for the outlier choice and offset.
+#define DRAWS_PER_POINT     (5)
+
+// Draws are numbered from here for the coefficients, past
+// any point's.
+#define COEFFICIENT_STREAM  (0xC0EFFULL << 40)
+
+#ifndef M_PI
+#define M_PI    (3.14159265358979323846)
+#endif
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static int      checkSettings( const polyfit_synth_t *pSynth );
+static double   draw( unsigned long long seed, unsigned long long index );
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_synth_defaults()
+// Fills in the default dataset settings.
+//--------------------------------------------------------
+void polyfit_synth_defaults( polyfit_synth_t *pSynth )
+{
+    if( NULL != pSynth )
+    {
+        memset( pSynth, 0, sizeof( *pSynth ) );
+        pSynth->seed = 1;
+        pSynth->pointCount = 0;
+        pSynth->degree = 4;
+        pSynth->xMin = -1.0;
+        pSynth->xMax = 1.0;
+        pSynth->noise = 0.01;
+        pSynth->outlierFraction = 0.0;
+        pSynth->outlierScale = 10.0;
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_synth_coefficients()
+// Draws the generating polynomial from the seed, kept
+// away from 0 so every power matters.
+//--------------------------------------------------------
+int polyfit_synth_coefficients( const polyfit_synth_t *pSynth, double *coefficients )
+{
+    if( (NULL == pSynth) || (NULL == coefficients) )
+    {
+        return -1;
+    }
+    if( (pSynth->degree < 0) || (pSynth->degree > POLYFIT_SYNTH_MAX_DEGREE) )
+    {
+        return -2;
+    }
+
+    for( int i = 0; i <= pSynth->degree; i++ )
+    {
+        double u = draw( pSynth->seed, COEFFICIENT_STREAM + i );
+        double magnitude = 0.25 + 0.75 * (2.0 * fabs( u - 0.5 ));
+        coefficients[i] = (u < 0.5) ? -magnitude : magnitude;
+    }
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_synth_generate()
+// Each point only depends on its index, so the loop is
+// split over threads without changing the data.
+//--------------------------------------------------------
+int polyfit_synth_generate( const polyfit_synth_t *pSynth, double *xValues, double *yValues, double *coefficients )
+{
+    double trueCoefficients[ POLYFIT_SYNTH_MAX_DEGREE + 1 ];
+
+    if( (NULL == pSynth) || (NULL == xValues) || (NULL == yValues) )
+    {
+        return -1;
+    }
+    if( 0 != checkSettings( pSynth ) )
+    {
+        return -2;
+    }
+
+    polyfit_synth_coefficients( pSynth, trueCoefficients );
+    if( NULL != coefficients )
+    {
+        memcpy( coefficients, trueCoefficients, (pSynth->degree + 1) * sizeof( double ) );
+    }
+
+    unsigned long long seed = pSynth->seed;
+    int degree = pSynth->degree;
+    double xSpan = pSynth->xMax - pSynth->xMin;
+
+    #pragma omp parallel for schedule( static )
+    for( long i = 0; i < pSynth->pointCount; i++ )
+    {
+        unsigned long long index = (unsigned long long) i * DRAWS_PER_POINT;
+        double x = pSynth->xMin + xSpan * draw( seed, index );
+
+        // Horner's rule over the generating polynomial.
+        double y = trueCoefficients[0];
+        for( int j = 1; j <= degree; j++ )
+        {
+            y = y * x + trueCoefficients[j];
+        }
+
+        // Box-Muller; 1 - u keeps the log finite.
+        double u1 = 1.0 - draw( seed, index + 1 );
+        double u2 = draw( seed, index + 2 );
+        y += pSynth->noise * sqrt( -2.0 * log( u1 ) ) * cos( 2.0 * M_PI * u2 );
+
+        if( draw( seed, index + 3 ) < pSynth->outlierFraction )
+        {
+            double offset = 2.0 * draw( seed, index + 4 ) - 1.0;
+            y += pSynth->outlierScale * ((offset < 0.0) ? offset - 0.5 : offset + 0.5) / 1.5;
+        }
+
+        xValues[i] = x;
+        yValues[i] = y;
+    }
+    return 0;
+}
+
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// checkSettings()
+// Returns 0 if every setting of pSynth is usable, or -2.
+//--------------------------------------------------------
+static int checkSettings( const polyfit_synth_t *pSynth )
+{
+    if( (pSynth->pointCount < 0) ||
+        (pSynth->degree < 0) || (pSynth->degree > POLYFIT_SYNTH_MAX_DEGREE) ||
+        !(pSynth->xMax > pSynth->xMin) || !(pSynth->noise >= 0.0) ||
+        !(pSynth->outlierFraction >= 0.0) || !(pSynth->outlierFraction <= 1.0) ||
+        !(pSynth->outlierScale >= 0.0) )
+    {
+        return -2;
+    }
+    return 0;
+}
+
+//--------------------------------------------------------
+// draw()
+// Returns a uniform double in [0, 1) for one draw: the
+// splitmix64 finalizer of the seed and the draw's index.
+//--------------------------------------------------------
+static double draw( unsigned long long seed, unsigned long long index )
+{
+    unsigned long long z = seed + (index + 1) * 0x9E3779B97F4A7C15ULL;
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return (double) (z >> 11) / (double) (1ULL << 53);
+}
@@ -0,0 +1,64 @@
+// file: polyfit_synth.h
+// Description: Deterministic synthetic datasets for benchmarks and
+//              checks.
+//
+// Point i is drawn from a hash of the seed and i alone, so a dataset
+// is the same on every machine, for every thread count, and any
+// prefix of a large dataset is the smaller one with the same seed.
+
+#ifndef POLYFIT_SYNTH_H
+#define POLYFIT_SYNTH_H
+
+// Largest degree of the generating polynomial.
+#define POLYFIT_SYNTH_MAX_DEGREE    (23)
+
+typedef struct polyfit_synth_s
+{
+    unsigned long long  seed;
+    long                pointCount;
+    int                 degree;             // Degree of the generating polynomial.
+    double              xMin;               // x is uniform over [xMin, xMax).
+    double              xMax;
+    double              noise;              // Standard deviation of the Gaussian noise added to y.
+    double              outlierFraction;    // Share of points pushed off the curve, 0 .. 1.
+    double              outlierScale;       // Largest distance an outlier is pushed.
+} polyfit_synth_t;
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_synth_defaults()
+// Fills pSynth with seed 1, no points, a quartic over
+// [-1, 1), noise 0.01 and no outliers (outlierScale 10
+// for when they are turned on).
+//--------------------------------------------------------
+void polyfit_synth_defaults( polyfit_synth_t *pSynth );
+
+//--------------------------------------------------------
+// polyfit_synth_coefficients()
+// Fills coefficients[0 .. degree] with the generating
+// polynomial, highest power first.  Each is drawn from
+// the seed in [-1, -0.25] or [0.25, 1].
+//
+// Returns 0 if success, -1 if passed a NULL pointer, -2 if
+// the degree is out of range.
+//--------------------------------------------------------
+int polyfit_synth_coefficients( const polyfit_synth_t *pSynth, double *coefficients );
+
+//--------------------------------------------------------
+// polyfit_synth_generate()
+// Fills xValues and yValues with pSynth->pointCount
+// points, on OpenMP threads.  coefficients, if not NULL,
+// gets the generating polynomial as from
+// polyfit_synth_coefficients().
+//
+// Returns 0 if success, -1 if passed a NULL pointer, -2 if
+// a setting is out of range.
+//--------------------------------------------------------
+int polyfit_synth_generate( const polyfit_synth_t *pSynth, double *xValues, double *yValues, double *coefficients );
+
+
+#endif	// POLYFIT_SYNTH_H
@@ -0,0 +1,303 @@
+// Name: polyfit_tune.c
+// Description: Per-machine tuning profile for the automatic backend
+//              choice and the blocked transpose.
+
+#include <stdbool.h>    // bool
+#include <stdio.h>      // fopen(), fgets(), fprintf()
+#include <stdlib.h>     // getenv()
+#include <string.h>     // strchr(), strcmp()
+
+#include "polyfit_tune.h"
+
+// Longest profile file line.
+#define LINE_SIZE       (256)
+
+// Largest thread count or block size a profile may hold.
+#define MAX_SETTING     (4096)
+
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static int  checkProfile( const polyfit_tune_t *pTune );
+static int  parseLine( char *pLine, polyfit_tune_t *pTune );
+
+
+// The profile in effect.  Loaded before main() runs.
+static polyfit_tune_t activeProfile =
+{
+    .blockSize = POLYFIT_TUNE_BLOCK_SIZE,
+    .parallelPoints = POLYFIT_AUTO_PARALLEL_POINTS,
+    .classCount = 0
+};
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_tune()
+// Returns the profile in effect for this process.
+//--------------------------------------------------------
+const polyfit_tune_t *polyfit_tune( void )
+{
+    return &activeProfile;
+}
+
+//--------------------------------------------------------
+// polyfit_tune_defaults()
+// Fills in the built-in profile.
+//--------------------------------------------------------
+void polyfit_tune_defaults( polyfit_tune_t *pTune )
+{
+    if( NULL != pTune )
+    {
+        memset( pTune, 0, sizeof( *pTune ) );
+        pTune->blockSize = POLYFIT_TUNE_BLOCK_SIZE;
+        pTune->parallelPoints = POLYFIT_AUTO_PARALLEL_POINTS;
+        pTune->classCount = 0;
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_tune_set()
+// Puts a profile into effect.
+//--------------------------------------------------------
+int polyfit_tune_set( const polyfit_tune_t *pTune )
+{
+    if( NULL == pTune )
+    {
+        return -1;
+    }
+    if( 0 != checkProfile( pTune ) )
+    {
+        return -2;
+    }
+
+    activeProfile = *pTune;
+    return 0;
+}
+
+//--------------------------------------------------------
+// polyfit_tune_lookup()
+// Returns the first class covering the fit, or NULL.
+//--------------------------------------------------------
+const polyfit_tune_class_t *polyfit_tune_lookup( const polyfit_tune_t *pTune, int pointCount, int coefficientCount )
+{
+    if( NULL == pTune )
+    {
+        return NULL;
+    }
+
+    for( int i = 0; i < pTune->classCount; i++ )
+    {
+        const polyfit_tune_class_t *pClass = &pTune->classes[i];
+        if( (pointCount <= pClass->maxPointCount) && (coefficientCount <= pClass->maxCoefficientCount) )
+        {
+            return pClass;
+        }
+    }
+    return NULL;
+}
+
+//--------------------------------------------------------
+// polyfit_tune_load()
+// Reads a profile file into pTune.
+//--------------------------------------------------------
+int polyfit_tune_load( const char *fileName, polyfit_tune_t *pTune )
+{
+    char line[ LINE_SIZE ];
+
+    if( (NULL == fileName) || (NULL == pTune) )
+    {
+        return -1;
+    }
+
+    FILE *pFile = fopen( fileName, "r" );
+    if( NULL == pFile )
+    {
+        return -5;
+    }
+
+    polyfit_tune_defaults( pTune );
+
+    int rVal = 0;
+    while( (0 == rVal) && (NULL != fgets( line, sizeof( line ), pFile )) )
+    {
+        rVal = parseLine( line, pTune );
+    }
+    fclose( pFile );
+
+    if( (0 == rVal) && (0 != checkProfile( pTune )) )
+    {
+        rVal = -6;
+    }
+    return rVal;
+}
+
+//--------------------------------------------------------
+// polyfit_tune_save()
+// Writes pTune as a profile file.
+//--------------------------------------------------------
+int polyfit_tune_save( const char *fileName, const polyfit_tune_t *pTune )
+{
+    if( (NULL == fileName) || (NULL == pTune) )
+    {
+        return -1;
+    }
+
+    FILE *pFile = fopen( fileName, "w" );
+    if( NULL == pFile )
+    {
+        return -5;
+    }
+
+    fprintf( pFile, "# polyfit tuning profile, written by autotune\n" );
+    fprintf( pFile, "blockSize %d\n", pTune->blockSize );
+    fprintf( pFile, "parallelPoints %d\n", pTune->parallelPoints );
+    fprintf( pFile, "# class maxPointCount maxCoefficientCount backend threadCount\n" );
+    for( int i = 0; i < pTune->classCount; i++ )
+    {
+        const polyfit_tune_class_t *pClass = &pTune->classes[i];
+        fprintf( pFile, "class %d %d %s %d\n", pClass->maxPointCount, pClass->maxCoefficientCount,
+                 polyfit_backend_name( pClass->backend ), pClass->threadCount );
+    }
+
+    int rVal = ferror( pFile ) ? -5 : 0;
+    if( 0 != fclose( pFile ) )
+    {
+        rVal = -5;
+    }
+    return rVal;
+}
+
+
+//=========================================================
+//      Private function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// loadProfile()
+// Runs once at startup: loads POLYFIT_PROFILE, or else
+// POLYFIT_TUNE_DEFAULT_FILE if there is one.  A profile
+// that doesn't parse is reported and ignored.
+//--------------------------------------------------------
+__attribute__(( constructor ))
+static void loadProfile( void )
+{
+    polyfit_tune_t profile;
+    const char *fileName = getenv( POLYFIT_TUNE_PROFILE_ENV );
+    bool isNamed = (NULL != fileName);
+
+    if( !isNamed )
+    {
+        fileName = POLYFIT_TUNE_DEFAULT_FILE;
+    }
+
+    int rVal = polyfit_tune_load( fileName, &profile );
+    if( 0 == rVal )
+    {
+        activeProfile = profile;
+    }
+    else if( isNamed || (-5 != rVal) )
+    {
+        fprintf( stderr, "polyfit: ignoring profile %s (error = %d)\n", fileName, rVal );
+    }
+}
+
+//--------------------------------------------------------
+// checkProfile()
+// Returns 0 if every setting of pTune is in range, or -2.
+//--------------------------------------------------------
+static int checkProfile( const polyfit_tune_t *pTune )
+{
+    if( (pTune->blockSize < 1) || (pTune->blockSize > MAX_SETTING) ||
+        (pTune->parallelPoints < 1) ||
+        (pTune->classCount < 0) || (pTune->classCount > POLYFIT_TUNE_MAX_CLASSES) )
+    {
+        return -2;
+    }
+
+    for( int i = 0; i < pTune->classCount; i++ )
+    {
+        const polyfit_tune_class_t *pClass = &pTune->classes[i];
+        if( (pClass->maxPointCount < 1) || (pClass->maxCoefficientCount < 1) ||
+            (pClass->backend <= POLYFIT_BACKEND_AUTO) || (pClass->backend >= POLYFIT_BACKEND_COUNT) ||
+            (pClass->threadCount < 0) || (pClass->threadCount > MAX_SETTING) )
+        {
+            return -2;
+        }
+    }
+    return 0;
+}
+
+//--------------------------------------------------------
+// parseLine()
+// Applies one profile file line to pTune.
+//
+// Returns 0 if success, -6 if the line can't be parsed.
+//--------------------------------------------------------
+static int parseLine( char *pLine, polyfit_tune_t *pTune )
+{
+    char keyword[ 32 ];
+    char backendName[ 32 ];
+    int value = 0;
+
+    char *pComment = strchr( pLine, '#' );
+    if( NULL != pComment )
+    {
+        *pComment = '\0';
+    }
+    if( 1 != sscanf( pLine, "%31s", keyword ) )
+    {
+        return 0;   // Blank line.
+    }
+
+    if( 0 == strcmp( keyword, "blockSize" ) )
+    {
+        if( 1 != sscanf( pLine, "%*s %d", &value ) )
+        {
+            return -6;
+        }
+        pTune->blockSize = value;
+    }
+    else if( 0 == strcmp( keyword, "parallelPoints" ) )
+    {
+        if( 1 != sscanf( pLine, "%*s %d", &value ) )
+        {
+            return -6;
+        }
+        pTune->parallelPoints = value;
+    }
+    else if( 0 == strcmp( keyword, "class" ) )
+    {
+        if( pTune->classCount >= POLYFIT_TUNE_MAX_CLASSES )
+        {
+            return -6;
+        }
+
+        polyfit_tune_class_t *pClass = &pTune->classes[ pTune->classCount ];
+        if( 4 != sscanf( pLine, "%*s %d %d %31s %d", &pClass->maxPointCount, &pClass->maxCoefficientCount,
+                         backendName, &pClass->threadCount ) )
+        {
+            return -6;
+        }
+
+        pClass->backend = POLYFIT_BACKEND_COUNT;
+        for( int b = POLYFIT_BACKEND_AUTO; b < POLYFIT_BACKEND_COUNT; b++ )
+        {
+            if( 0 == strcmp( backendName, polyfit_backend_name( (polyfit_backend_t) b ) ) )
+            {
+                pClass->backend = (polyfit_backend_t) b;
+            }
+        }
+        pTune->classCount++;
+    }
+    else
+    {
+        return -6;
+    }
+    return 0;
+}
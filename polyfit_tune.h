@@ -0,0 +1,111 @@
+// file: polyfit_tune.h
+// Description: Per-machine tuning profile for the automatic backend
+//              choice and the blocked transpose.
+//
+// The profile is a text file written by the autotune tool.  It is
+// loaded once at startup from the file named by the environment
+// variable POLYFIT_PROFILE, or else from POLYFIT_TUNE_DEFAULT_FILE in
+// the working directory.  Without a file the built-in defaults are
+// used.
+//
+// Profile file lines, '#' starting a comment:
+//      blockSize <n>
+//      parallelPoints <n>
+//      class <maxPointCount> <maxCoefficientCount> <backend> <threadCount>
+//
+// A fit takes the first class whose limits cover its point and
+// coefficient counts, so classes are written smallest first.
+
+#ifndef POLYFIT_TUNE_H
+#define POLYFIT_TUNE_H
+
+#include "polyfit_ex.h"
+
+// Environment variable naming the profile file.
+#define POLYFIT_TUNE_PROFILE_ENV    "POLYFIT_PROFILE"
+
+// Profile file used when POLYFIT_PROFILE isn't set.
+#define POLYFIT_TUNE_DEFAULT_FILE   "polyfit.profile"
+
+// Most size classes a profile holds.
+#define POLYFIT_TUNE_MAX_CLASSES    (64)
+
+// Built-in transpose block size, in elements.
+#define POLYFIT_TUNE_BLOCK_SIZE     (32)
+
+// Fastest configuration measured for one size class.
+typedef struct polyfit_tune_class_s
+{
+    int                 maxPointCount;
+    int                 maxCoefficientCount;
+    polyfit_backend_t   backend;            // Never AUTO.
+    int                 threadCount;        // < 1 for the backend's default.
+} polyfit_tune_class_t;
+
+typedef struct polyfit_tune_s
+{
+    int                 blockSize;          // Block edge of openMP_polyfit.c's transpose.
+    int                 parallelPoints;     // AUTO crossover for fits no class covers.
+    int                 classCount;
+    polyfit_tune_class_t classes[ POLYFIT_TUNE_MAX_CLASSES ];
+} polyfit_tune_t;
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_tune()
+// Returns the profile in effect for this process.
+//--------------------------------------------------------
+const polyfit_tune_t *polyfit_tune( void );
+
+//--------------------------------------------------------
+// polyfit_tune_defaults()
+// Fills pTune with the built-in profile: no classes,
+// POLYFIT_TUNE_BLOCK_SIZE and POLYFIT_AUTO_PARALLEL_POINTS.
+//--------------------------------------------------------
+void polyfit_tune_defaults( polyfit_tune_t *pTune );
+
+//--------------------------------------------------------
+// polyfit_tune_set()
+// Puts a profile into effect.  Not thread safe; call it
+// before starting any fits.
+//
+// Returns 0 if success, -1 if passed a NULL pointer, -2
+// if a value is out of range.
+//--------------------------------------------------------
+int polyfit_tune_set( const polyfit_tune_t *pTune );
+
+//--------------------------------------------------------
+// polyfit_tune_lookup()
+// Returns the first class of pTune covering a fit of
+// pointCount points and coefficientCount coefficients,
+// or NULL if none does.
+//--------------------------------------------------------
+const polyfit_tune_class_t *polyfit_tune_lookup( const polyfit_tune_t *pTune, int pointCount, int coefficientCount );
+
+//--------------------------------------------------------
+// polyfit_tune_load()
+// Reads a profile file into pTune.  Settings the file
+// leaves out keep their built-in values.
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -5 if the file can't be opened,
+//          -6 if a line can't be parsed or is out of range.
+//--------------------------------------------------------
+int polyfit_tune_load( const char *fileName, polyfit_tune_t *pTune );
+
+//--------------------------------------------------------
+// polyfit_tune_save()
+// Writes pTune as a profile file.
+//
+// Returns 0 if success, -1 if passed a NULL pointer, -5 if
+// the file can't be written.
+//--------------------------------------------------------
+int polyfit_tune_save( const char *fileName, const polyfit_tune_t *pTune );
+
+
+#endif	// POLYFIT_TUNE_H
@@ -0,0 +1,151 @@
+// Name: polyfit_workspace.c
+// Description: Reusable scratch memory for the matrix fits.
+
+#include <stdio.h>      // NULL
+#include <stdlib.h>     // aligned_alloc(), free()
+
+#include "polyfit_workspace.h"
+#include "polyfit_pool.h"
+
+// MACRO to round a byte count up to the workspace alignment.
+#define ALIGN_UP( bytes )  ((((bytes) + POLYFIT_WORKSPACE_ALIGNMENT - 1) / POLYFIT_WORKSPACE_ALIGNMENT) * POLYFIT_WORKSPACE_ALIGNMENT)
+
+// MACRO to round a per-thread partial up to whole 64-byte
+// cache lines, as the backends do.
+#define PARTIAL_SIZE( count )  ((((count) + 7) / 8) * 8)
+
+// Matrix headers a fit takes: A, b, AT, (AT)A and (AT)b.
+#define MATRIX_COUNT    (5)
+
+// Bytes per matrix header, with room to spare.
+#define MATRIX_HEADER_BYTES     (POLYFIT_WORKSPACE_ALIGNMENT)
+
+
+//=========================================================
+//      Global function definitions
+//=========================================================
+
+//--------------------------------------------------------
+// polyfit_workspace_bytes()
+// A, b and AT, the two products, and one padded partial
+// per thread for each product's reduction.
+//--------------------------------------------------------
+size_t polyfit_workspace_bytes( int maxPointCount, int maxCoefficientCount, int threadCount )
+{
+    size_t n = (size_t) maxPointCount;
+    size_t k = (size_t) maxCoefficientCount;
+    size_t t = (size_t) ((threadCount < 1) ? polyfit_pool_default_size() : threadCount);
+
+    return MATRIX_COUNT * MATRIX_HEADER_BYTES +
+           2 * ALIGN_UP( n * k * sizeof( double ) ) +           // A and AT
+           ALIGN_UP( n * sizeof( double ) ) +                   // b
+           ALIGN_UP( k * k * sizeof( double ) ) +               // (AT)A
+           ALIGN_UP( k * sizeof( double ) ) +                   // (AT)b
+           ALIGN_UP( t * PARTIAL_SIZE( 2 * k - 1 ) * sizeof( double ) ) +
+           ALIGN_UP( t * PARTIAL_SIZE( k ) * sizeof( double ) );
+}
+
+//--------------------------------------------------------
+// polyfit_workspace_create()
+// Allocates a workspace sized for a fit.
+//--------------------------------------------------------
+polyfit_workspace_t *polyfit_workspace_create( int maxPointCount, int maxCoefficientCount, int threadCount )
+{
+    if( (maxPointCount < 1) || (maxCoefficientCount < 1) )
+    {
+        return NULL;
+    }
+    return polyfit_workspace_create_bytes( polyfit_workspace_bytes( maxPointCount, maxCoefficientCount, threadCount ) );
+}
+
+//--------------------------------------------------------
+// polyfit_workspace_create_bytes()
+// Allocates a workspace of byteCount bytes.
+//--------------------------------------------------------
+polyfit_workspace_t *polyfit_workspace_create_bytes( size_t byteCount )
+{
+    polyfit_workspace_t *pWorkspace = (polyfit_workspace_t *) calloc( 1, sizeof( polyfit_workspace_t ) );
+    if( NULL == pWorkspace )
+    {
+        return NULL;
+    }
+
+    pWorkspace->capacity = ALIGN_UP( byteCount );
+    pWorkspace->pBase = (char *) aligned_alloc( POLYFIT_WORKSPACE_ALIGNMENT,
+                                                (pWorkspace->capacity > 0) ? pWorkspace->capacity : POLYFIT_WORKSPACE_ALIGNMENT );
+    if( NULL == pWorkspace->pBase )
+    {
+        free( pWorkspace );
+        return NULL;
+    }
+    return pWorkspace;
+}
+
+//--------------------------------------------------------
+// polyfit_workspace_destroy()
+// Frees a workspace.
+//--------------------------------------------------------
+void polyfit_workspace_destroy( polyfit_workspace_t *pWorkspace )
+{
+    if( NULL != pWorkspace )
+    {
+        free( pWorkspace->pBase );
+        free( pWorkspace );
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_workspace_alloc()
+// Bumps the allocation point by byteCount, rounded up.
+//--------------------------------------------------------
+void *polyfit_workspace_alloc( polyfit_workspace_t *pWorkspace, size_t byteCount )
+{
+    if( NULL == pWorkspace )
+    {
+        return NULL;
+    }
+
+    size_t size = ALIGN_UP( byteCount );
+    if( size > pWorkspace->capacity - pWorkspace->used )
+    {
+        return NULL;
+    }
+
+    void *pBlock = pWorkspace->pBase + pWorkspace->used;
+    pWorkspace->used += size;
+    if( pWorkspace->used > pWorkspace->highWater )
+    {
+        pWorkspace->highWater = pWorkspace->used;
+    }
+    return pBlock;
+}
+
+//--------------------------------------------------------
+// polyfit_workspace_mark()
+// Returns the current allocation point.
+//--------------------------------------------------------
+size_t polyfit_workspace_mark( const polyfit_workspace_t *pWorkspace )
+{
+    return (NULL == pWorkspace) ? 0 : pWorkspace->used;
+}
+
+//--------------------------------------------------------
+// polyfit_workspace_release()
+// Rewinds the allocation point to mark.
+//--------------------------------------------------------
+void polyfit_workspace_release( polyfit_workspace_t *pWorkspace, size_t mark )
+{
+    if( (NULL != pWorkspace) && (mark <= pWorkspace->used) )
+    {
+        pWorkspace->used = mark;
+    }
+}
+
+//--------------------------------------------------------
+// polyfit_workspace_high_water()
+// Returns the most bytes ever in use at once.
+//--------------------------------------------------------
+size_t polyfit_workspace_high_water( const polyfit_workspace_t *pWorkspace )
+{
+    return (NULL == pWorkspace) ? 0 : pWorkspace->highWater;
+}
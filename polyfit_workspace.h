@@ -0,0 +1,95 @@
+// file: polyfit_workspace.h
+// Description: Reusable scratch memory for the matrix fits.
+//
+// A workspace is one 64-byte aligned block, allocated once and
+// handed out by bumping an offset.  A fit takes the matrices it
+// needs from the workspace and gives them all back when it
+// returns, so repeated fits through polyfit_ws(), openmp_polyfit_ws()
+// or pthreads_polyfit_ws() make no heap calls at all.
+//
+// A workspace may be used by one fit at a time.
+
+#ifndef POLYFIT_WORKSPACE_H
+#define POLYFIT_WORKSPACE_H
+
+#include <stddef.h>     // size_t
+
+// Alignment of every block handed out, in bytes.
+#define POLYFIT_WORKSPACE_ALIGNMENT     (64)
+
+typedef struct polyfit_workspace_s
+{
+    char    *pBase;         // POLYFIT_WORKSPACE_ALIGNMENT aligned
+    size_t  capacity;       // Bytes at pBase.
+    size_t  used;           // Bytes handed out.
+    size_t  highWater;      // Most bytes ever handed out at once.
+} polyfit_workspace_t;
+
+
+//------------------------------------------------
+// Function Prototypes
+//------------------------------------------------
+
+//--------------------------------------------------------
+// polyfit_workspace_bytes()
+// Returns the bytes one matrix fit of up to maxPointCount
+// points and maxCoefficientCount coefficients needs when
+// it runs on threadCount threads (< 1 for
+// polyfit_pool_default_size()).
+//--------------------------------------------------------
+size_t polyfit_workspace_bytes( int maxPointCount, int maxCoefficientCount, int threadCount );
+
+//--------------------------------------------------------
+// polyfit_workspace_create()
+// Allocates a workspace of polyfit_workspace_bytes().
+//
+// Returns the workspace, or NULL if the counts are out of
+// range or the memory can't be allocated.
+//--------------------------------------------------------
+polyfit_workspace_t *polyfit_workspace_create( int maxPointCount, int maxCoefficientCount, int threadCount );
+
+//--------------------------------------------------------
+// polyfit_workspace_create_bytes()
+// Allocates a workspace of byteCount bytes.
+//
+// Returns the workspace, or NULL.
+//--------------------------------------------------------
+polyfit_workspace_t *polyfit_workspace_create_bytes( size_t byteCount );
+
+//--------------------------------------------------------
+// polyfit_workspace_destroy()
+// Frees a workspace.
+//--------------------------------------------------------
+void polyfit_workspace_destroy( polyfit_workspace_t *pWorkspace );
+
+//--------------------------------------------------------
+// polyfit_workspace_alloc()
+// Hands out byteCount bytes, aligned to
+// POLYFIT_WORKSPACE_ALIGNMENT.  The bytes are not cleared.
+//
+// Returns the block, or NULL if the workspace is full.
+//--------------------------------------------------------
+void *polyfit_workspace_alloc( polyfit_workspace_t *pWorkspace, size_t byteCount );
+
+//--------------------------------------------------------
+// polyfit_workspace_mark()
+// Returns the current allocation point, to be passed to
+// polyfit_workspace_release().
+//--------------------------------------------------------
+size_t polyfit_workspace_mark( const polyfit_workspace_t *pWorkspace );
+
+//--------------------------------------------------------
+// polyfit_workspace_release()
+// Gives back every block handed out since mark was taken.
+//--------------------------------------------------------
+void polyfit_workspace_release( polyfit_workspace_t *pWorkspace, size_t mark );
+
+//--------------------------------------------------------
+// polyfit_workspace_high_water()
+// Returns the most bytes that were ever in use at once,
+// for sizing a workspace with polyfit_workspace_create_bytes().
+//--------------------------------------------------------
+size_t polyfit_workspace_high_water( const polyfit_workspace_t *pWorkspace );
+
+
+#endif	// POLYFIT_WORKSPACE_H
@@ -26,13 +26,19 @@
 // SOFTWARE.
 //------------------------------------------------------------------------------------
 
-#include <math.h>       // pow()
 #include <stdbool.h>    // bool
 #include <stdio.h>      // printf()
 #include <stdlib.h>     // calloc()
 #include <string.h>     // strlen()
 
 #include "pthreads_polyfit.h"
+#include "polyfit_ex.h"
+#include "polyfit_perf.h"
+#include "polyfit_sums.h"
+#include "polyfit_simd.h"
+#include "polyfit_solve.h"
+#include "polyfit_pool.h"
+#include "polyfit_workspace.h"
 #include <pthread.h>
 
 // Define SHOW_MATRIX to display intermediate matrix values:
@@ -46,22 +52,56 @@ typedef struct matrix_s
 	double *pContents;
 } matrix_t;
 
+// The participants a fit runs on: the first threadCount of
+// the shared pool.
+typedef struct
+{
+    polyfit_pool_t *pPool;
+    int threadCount;
+} PoolTeam;
+
+// Shared state of one reduction-parallel product: every
+// thread reduces its slice of the points into a private
+// partial result, and the partials are merged as a tree.
+typedef struct
+{
+    int partialSize;        // doubles per partial, padded to a cache line
+    double *pPartials;      // one partial result per team thread
+    const PoolTeam *pTeam;
+} ReductionShared;
+
 typedef struct
 {
-    int start_row;
-    int end_row;
     matrix_t *pLeft;
     matrix_t *pRight;
-    matrix_t *pResult;
-} ThreadArgs_product;
+    ReductionShared *pShared;
+} TaskArgs_product;
+
+typedef struct
+{
+    matrix_t *pMatAT;
+    ReductionShared *pShared;
+} TaskArgs_hankel;
 
 typedef struct
 {
-    int start_row;
-    int end_row;
     matrix_t *pInput;
     matrix_t *pOutput;
-} ThreadArgs_transpose;
+} TaskArgs_transpose;
+
+typedef struct
+{
+    int pointCount;
+    double *xValues;
+    double *yValues;
+    polyfit_sums_t *pSums;  // one set of sums per pool thread
+} TaskArgs_sums;
+
+// Pool shared by every fit, created on first use.  Fits hold
+// the lock for reading from start to finish, so the pool is
+// only replaced (under the write lock) when none is running.
+static polyfit_pool_t *pThreadPool = NULL;
+static pthread_rwlock_t threadPoolLock = PTHREAD_RWLOCK_INITIALIZER;
 
 // MACRO to access a value with a matrix.
 #define MATRIX_VALUE_PTR( pA, row, col )  (&(((pA)->pContents)[ (row * (pA)->cols) + col]))
@@ -81,13 +121,27 @@ typedef struct
 // Private Function Prototypes
 //------------------------------------------------
 
-static matrix_t *   createMatrix( int rows, int cols );
-static void         destroyMatrix( matrix_t *pMat );
+static int          fitMatrices( polyfit_workspace_t *pWorkspace, const PoolTeam *pTeam, int pointCount,
+                                 double *xValues, double *yValues, int coefficientCount, double *coefficientResults,
+                                 polyfit_stats_t *pStats );
+static matrix_t *   createMatrix( polyfit_workspace_t *pWorkspace, int rows, int cols );
 #ifdef SHOW_MATRIX
 static void         reallyShowMatrix( matrix_t *pMat );
 #endif  // SHOW_MATRIX
-static matrix_t *   createTranspose( matrix_t *pMat, int numThreads );
-static matrix_t *   createProduct( matrix_t *pLeft, matrix_t *pRight, int numThreads );
+static matrix_t *   createTranspose( polyfit_workspace_t *pWorkspace, matrix_t *pMat, const PoolTeam *pTeam );
+static matrix_t *   createProduct( polyfit_workspace_t *pWorkspace, matrix_t *pLeft, matrix_t *pRight, const PoolTeam *pTeam );
+static matrix_t *   createHankelProduct( polyfit_workspace_t *pWorkspace, matrix_t *pMatAT, const PoolTeam *pTeam );
+static void         setHankelDiagonal( matrix_t *pMat, int s, double value );
+static int          initReduction( ReductionShared *pShared, polyfit_workspace_t *pWorkspace, const PoolTeam *pTeam, int resultSize );
+static void         treeMergePartials( ReductionShared *pShared, int thread );
+static polyfit_pool_t * acquireThreadPool( void );
+static void         releaseThreadPool( void );
+static void         threadSlice( int count, int thread, int threadCount, int *pStart, int *pEnd );
+static void         transposeRows( void *pArg, int thread, int threadCount );
+static void         multiplySlice( void *pArg, int thread, int threadCount );
+static void         multiplyHankelSlice( void *pArg, int thread, int threadCount );
+static void         accumulateRows( void *pArg, int thread, int threadCount );
+static void         recordThreadId( void *pArg, int thread, int threadCount );
 
 
 //=========================================================
@@ -117,16 +171,41 @@ static matrix_t *   createProduct( matrix_t *pLeft, matrix_t *pRight, int numThr
 //          -1 if passed a NULL pointer,
 //          -2 if (pointCount < coefficientCount),
 //          -3 if unable to allocate memory,
-//          -4 if unable to solve equations.
+//          -4 if the equations are numerically singular.
 //--------------------------------------------------------
 //int polyfit( int pointCount, point_t pointArray[],  int coeffCount, double coeffArray[] )
 int pthreads_polyfit( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults )
 {
-    int rVal = 0;
-    int degree = coefficientCount - 1;
+    polyfit_options_t options;
 
+    polyfit_options_defaults( &options );
+    options.backend = POLYFIT_BACKEND_PTHREADS;
+    return polyfit_ex( pointCount, xValues, yValues, coefficientCount, coefficientResults, &options, NULL );
+}
+
+//--------------------------------------------------------
+// pthreads_polyfit_ws()
+// A fit on the whole pool.
+//--------------------------------------------------------
+int pthreads_polyfit_ws( polyfit_workspace_t *pWorkspace, int pointCount, double *xValues, double *yValues,
+                         int coefficientCount, double *coefficientResults, polyfit_stats_t *pStats )
+{
+    return pthreads_polyfit_team_ws( pWorkspace, 0, pointCount, xValues, yValues, coefficientCount,
+                                     coefficientResults, pStats );
+}
+
+//--------------------------------------------------------
+// pthreads_polyfit_team_ws()
+// pthreads_polyfit() on the first threadCount pool threads,
+// with its matrices taken from a workspace, and given back
+// before it returns.
+//--------------------------------------------------------
+int pthreads_polyfit_team_ws( polyfit_workspace_t *pWorkspace, int threadCount, int pointCount,
+                              double *xValues, double *yValues, int coefficientCount, double *coefficientResults,
+                              polyfit_stats_t *pStats )
+{
     // Check that the input pointers aren't null.
-    if( (NULL == xValues) || (NULL == yValues) || (NULL == coefficientResults) )
+    if( (NULL == pWorkspace) || (NULL == xValues) || (NULL == yValues) || (NULL == coefficientResults) )
     {
         return -1;
     }
@@ -136,134 +215,160 @@ int pthreads_polyfit( int pointCount, double *xValues, double *yValues, int coef
         return -2;
     }
 
-    // printf( "pointCount = %d:", pointCount );
-
-    // for( i = 0; i < pointCount; i++ )
-    // {
-    //     printf( " ( %f, %f )", xValues[i], yValues[i] );
-    // }
-    // printf( "\n");
-
-    // printf( "coefficientCount = %d\n", coefficientCount );
-
-    // Make the A matrix:
-    matrix_t *pMatA = createMatrix( pointCount, coefficientCount );
-    if( NULL == pMatA)
+    polyfit_pool_t *pPool = acquireThreadPool();
+    if( NULL == pPool )
     {
+        releaseThreadPool();
         return -3;
     }
 
-    for( int r = 0; r < pointCount; r++)
+    PoolTeam team;
+    team.pPool = pPool;
+    team.threadCount = polyfit_pool_size( pPool );
+    if( (threadCount > 0) && (threadCount < team.threadCount) )
     {
-        for( int c = 0; c < coefficientCount; c++)
-        {
-            *(MATRIX_VALUE_PTR(pMatA, r, c)) = pow((xValues[r]), (double) (degree -c));
-        }
+        team.threadCount = threadCount;
     }
 
-    showMatrix( pMatA );
+    size_t mark = polyfit_workspace_mark( pWorkspace );
+    int rVal = fitMatrices( pWorkspace, &team, pointCount, xValues, yValues, coefficientCount, coefficientResults, pStats );
+    polyfit_workspace_release( pWorkspace, mark );
+    releaseThreadPool();
+    return rVal;
+}
 
-    // Make the b matrix
-    matrix_t *pMatB = createMatrix( pointCount, 1);
-    if( NULL == pMatB )
+//--------------------------------------------------------
+// pthreads_polyfit_stream()
+// Single-pass fit: each thread folds a contiguous slice
+// of the points into its own sums, which are then merged.
+//
+// Returns   0 if success,
+//          -1 if passed a NULL pointer,
+//          -2 if (pointCount < coefficientCount) or
+//             coefficientCount is out of range,
+//          -3 if unable to allocate memory,
+//          -4 if the equations are numerically singular.
+//--------------------------------------------------------
+int pthreads_polyfit_stream( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults )
+{
+    polyfit_sums_t sums;
+
+    if( (NULL == xValues) || (NULL == yValues) || (NULL == coefficientResults) )
     {
-        return -3;
+        return -1;
     }
-
-    for( int r = 0; r < pointCount; r++)
+    if( pointCount < coefficientCount )
     {
-        *(MATRIX_VALUE_PTR(pMatB, r, 0)) = yValues[r];
+        return -2;
+    }
+    if( 0 != polyfit_sums_init( &sums, coefficientCount ) )
+    {
+        return -2;
     }
 
-    // Make the transpose of matrix A
-    matrix_t * pMatAT = createTranspose( pMatA, 8 );
-    if( NULL == pMatAT )
+    polyfit_pool_t *pPool = acquireThreadPool();
+    if( NULL == pPool )
     {
+        releaseThreadPool();
         return -3;
     }
-
-    showMatrix( pMatAT );
-
-    // Make the product of matrices AT and A:
-    matrix_t *pMatATA = createProduct( pMatAT, pMatA, 8 );
-    if( NULL == pMatATA )
+    int numThreads = polyfit_pool_size( pPool );
+
+    TaskArgs_sums taskArgs;
+    taskArgs.pointCount = pointCount;
+    taskArgs.xValues = xValues;
+    taskArgs.yValues = yValues;
+    taskArgs.pSums = (polyfit_sums_t *) calloc( numThreads, sizeof( polyfit_sums_t ) );
+    if( NULL == taskArgs.pSums )
     {
+        releaseThreadPool();
         return -3;
     }
+    for( int i = 0; i < numThreads; i++ )
+    {
+        polyfit_sums_init( &taskArgs.pSums[i], coefficientCount );
+    }
 
-     showMatrix( pMatATA );
+    polyfit_pool_run( pPool, accumulateRows, &taskArgs );
+    releaseThreadPool();
 
-    // Make the product of matrices AT and b:
-    matrix_t *pMatATB = createProduct( pMatAT, pMatB, 8 );
-    if( NULL == pMatATB )
+    for( int i = 0; i < numThreads; i++ )
     {
-        return -3;
+        polyfit_sums_merge( &sums, &taskArgs.pSums[i] );
     }
+    free( taskArgs.pSums );
 
-    showMatrix( pMatATB );
-
-    // Now we need to solve the system of linear equations,
-    // (AT)Ax = (AT)b for "x", the coefficients of the polynomial.
+    return polyfit_sums_solve( &sums, coefficientResults );
+}
 
-    for( int c = 0; c < pMatATA->cols; c++ )
+//--------------------------------------------------------
+// pthreads_polyfit_set_threads()
+// Replaces the thread pool with one of numThreads threads,
+// once the fits running on the old one have finished.
+//--------------------------------------------------------
+int pthreads_polyfit_set_threads( int numThreads )
+{
+    if( numThreads < 1 )
     {
-        int pr = c;     // pr is the pivot row.
-        double prVal = *MATRIX_VALUE_PTR(pMatATA, pr, c);
-        // If it's zero, we can't solve the equations.
-        if( 0.0 == prVal )
-        {
-            // printf( "Unable to solve equations, pr = %d, c = %d.\n", pr, c );
-            showMatrix( pMatATA );
-            rVal = -4;
-            break;
-        }
-        for( int r = 0; r < pMatATA->rows; r++)
-        {
-            if( r != pr )
-            {
-                double targetRowVal = *MATRIX_VALUE_PTR(pMatATA, r, c);
-                double factor = targetRowVal / prVal;
-                for( int c2 = 0; c2 < pMatATA->cols; c2++ )
-                {
-                    *MATRIX_VALUE_PTR(pMatATA, r, c2) -=  *MATRIX_VALUE_PTR(pMatATA, pr, c2) * factor; 
-                    // printf( "c = %d, pr = %d, r = %d, c2=%d, targetRowVal = %f, prVal = %f, factor = %f.\n",
-                    //         c, pr, r, c2, targetRowVal, prVal, factor );
-
-                    // showMatrix( pMatATA );
-                   
-                }
-                *MATRIX_VALUE_PTR(pMatATB, r, 0) -=  *MATRIX_VALUE_PTR(pMatATB, pr, 0) * factor;
-
-                showMatrix( pMatATB );
-            }
-        }
+        return -2;
     }
-    for( int c = 0; c < pMatATA->cols; c++ )
+
+    polyfit_pool_t *pPool = polyfit_pool_create( numThreads );
+    if( NULL == pPool )
     {
-        int pr = c;
-        // now, pr is the pivot row.
-        double prVal = *MATRIX_VALUE_PTR(pMatATA, pr, c);
-        *MATRIX_VALUE_PTR(pMatATA, pr, c) /= prVal;
-        *MATRIX_VALUE_PTR(pMatATB, pr, 0) /= prVal;
+        return -3;
     }
 
-    showMatrix( pMatATA );
+    pthread_rwlock_wrlock( &threadPoolLock );
+    polyfit_pool_t *pOldPool = pThreadPool;
+    pThreadPool = pPool;
+    pthread_rwlock_unlock( &threadPoolLock );
 
-    showMatrix( pMatATB );
+    // No fit holds the old pool now, and none can pick it up.
+    polyfit_pool_destroy( pOldPool );
+    return 0;
+}
 
-    for( int i = 0; i < coefficientCount; i++)
+//--------------------------------------------------------
+// pthreads_polyfit_threads()
+// Returns the number of threads each fit runs on.
+//--------------------------------------------------------
+int pthreads_polyfit_threads( void )
+{
+    int numThreads = polyfit_pool_size( acquireThreadPool() );
+    releaseThreadPool();
+    return numThreads;
+}
+
+//--------------------------------------------------------
+// pthreads_polyfit_thread_ids()
+// Has every pool thread report its own id.
+//--------------------------------------------------------
+int pthreads_polyfit_thread_ids( int *threadIds, int maxThreads )
+{
+    if( NULL == threadIds )
     {
-        coefficientResults[i] = *MATRIX_VALUE_PTR(pMatATB, i, 0);
+        return -1;
     }
 
-    
-    destroyMatrix( pMatATB );
-    destroyMatrix( pMatATA );
-    destroyMatrix( pMatAT );
+    polyfit_pool_t *pPool = acquireThreadPool();
+    int numThreads = polyfit_pool_size( pPool );
+    int *pIds = (NULL == pPool) ? NULL : (int *) calloc( numThreads, sizeof( int ) );
+    if( NULL == pIds )
+    {
+        releaseThreadPool();
+        return -3;
+    }
+    polyfit_pool_run( pPool, recordThreadId, pIds );
+    releaseThreadPool();
 
-    destroyMatrix( pMatA );
-    destroyMatrix( pMatB );
-    return rVal;
+    int idCount = (numThreads < maxThreads) ? numThreads : maxThreads;
+    for( int i = 0; i < idCount; i++ )
+    {
+        threadIds[i] = pIds[i];
+    }
+    free( pIds );
+    return (idCount > 0) ? idCount : 0;
 }
 
 //--------------------------------------------------------
@@ -336,29 +441,132 @@ static void reallyShowMatrix( matrix_t *pMat )
 }
 #endif  // SHOW_MATRIX
 
-void *transposeRows(void *threadArgs)
+//--------------------------------------------------------
+// fitMatrices()
+// The body of pthreads_polyfit_ws(): fills A and b, forms
+// the products on the pool and solves.  Nothing it takes
+// from the workspace needs to be given back individually.
+//--------------------------------------------------------
+static int fitMatrices( polyfit_workspace_t *pWorkspace, const PoolTeam *pTeam, int pointCount,
+                        double *xValues, double *yValues, int coefficientCount, double *coefficientResults,
+                        polyfit_stats_t *pStats )
 {
-    ThreadArgs_transpose *args = (ThreadArgs_transpose *)threadArgs;
+    long long pointBytes = (long long) pointCount * sizeof( double );
+    int rVal = 0;
+
+    // printf( "pointCount = %d:", pointCount );
+
+    // for( i = 0; i < pointCount; i++ )
+    // {
+    //     printf( " ( %f, %f )", xValues[i], yValues[i] );
+    // }
+    // printf( "\n");
+
+    // printf( "coefficientCount = %d\n", coefficientCount );
 
-    for (int i = args->start_row; i <= args->end_row; i++)
+    // Make the A matrix:
+    matrix_t *pMatA = createMatrix( pWorkspace, pointCount, coefficientCount );
+    if( NULL == pMatA)
     {
-        for (int j = 0; j < args->pOutput->cols; j++)
+        return -3;
+    }
+
+    POLYFIT_STATS_BEGIN( pStats, POLYFIT_PHASE_FILL );
+    // Column c holds x^(degree - c); built by multiplication, not pow().
+    polyfit_simd()->fillPowers( pointCount, xValues, coefficientCount, pMatA->pContents );
+
+    showMatrix( pMatA );
+
+    // Make the b matrix
+    matrix_t *pMatB = createMatrix( pWorkspace, pointCount, 1);
+    if( NULL == pMatB )
+    {
+        return -3;
+    }
+
+    for( int r = 0; r < pointCount; r++)
+    {
+        *(MATRIX_VALUE_PTR(pMatB, r, 0)) = yValues[r];
+    }
+    // Reads x and y, writes A and b; k-1 multiplies a point.
+    POLYFIT_STATS_END( pStats, POLYFIT_PHASE_FILL, pointBytes * (coefficientCount + 3),
+                       (long long) pointCount * (coefficientCount - 1) );
+
+    POLYFIT_STATS_BEGIN( pStats, POLYFIT_PHASE_TRANSPOSE );
+    // Make the transpose of matrix A
+    matrix_t * pMatAT = createTranspose( pWorkspace, pMatA, pTeam );
+    if( NULL == pMatAT )
+    {
+        return -3;
+    }
+
+    POLYFIT_STATS_END( pStats, POLYFIT_PHASE_TRANSPOSE, 2 * pointBytes * coefficientCount, 0 );
+
+    showMatrix( pMatAT );
+
+    POLYFIT_STATS_BEGIN( pStats, POLYFIT_PHASE_PRODUCT );
+    // Make the product of matrices AT and A:
+    matrix_t *pMatATA = createHankelProduct( pWorkspace, pMatAT, pTeam );
+    if( NULL == pMatATA )
+    {
+        return -3;
+    }
+
+     showMatrix( pMatATA );
+
+    // Make the product of matrices AT and b:
+    matrix_t *pMatATB = createProduct( pWorkspace, pMatAT, pMatB, pTeam );
+    if( NULL == pMatATB )
+    {
+        return -3;
+    }
+
+    // 2k-1 dot products for (AT)A and k for (AT)b, each
+    // reading two rows of length pointCount.
+    POLYFIT_STATS_END( pStats, POLYFIT_PHASE_PRODUCT, 2 * pointBytes * (3 * coefficientCount - 1),
+                       2 * (long long) pointCount * (3 * coefficientCount - 1) );
+
+    showMatrix( pMatATB );
+
+    POLYFIT_STATS_BEGIN( pStats, POLYFIT_PHASE_SOLVE );
+    // Now we need to solve the system of linear equations,
+    // (AT)Ax = (AT)b for "x", the coefficients of the polynomial.
+    // (AT)A is symmetric positive definite, so Cholesky is used
+    // and only its upper triangle is read.
+    rVal = polyfit_solve_normal( coefficientCount, pMatATA->pContents, pMatATB->pContents, coefficientResults );
+    // Cholesky, then the two triangular solves.
+    long long solveFlops = (long long) coefficientCount * coefficientCount * (coefficientCount + 6) / 3;
+    POLYFIT_STATS_END( pStats, POLYFIT_PHASE_SOLVE, (long long) coefficientCount * (coefficientCount + 2) * sizeof( double ),
+                       solveFlops );
+
+    return rVal;
+}
+
+
+static void transposeRows(void *pArg, int thread, int threadCount)
+{
+    TaskArgs_transpose *args = (TaskArgs_transpose *)pArg;
+    int startRow, endRow;
+
+    // This thread's rows (points) of the input matrix.
+    threadSlice(args->pInput->rows, thread, threadCount, &startRow, &endRow);
+    for (int i = startRow; i <= endRow; i++)
+    {
+        for (int j = 0; j < args->pInput->cols; j++)
         {
             *MATRIX_VALUE_PTR(args->pOutput, j, i) = *MATRIX_VALUE_PTR(args->pInput, i, j);
         }
     }
-
-    pthread_exit(NULL);
 }
 
 //--------------------------------------------------------
 // createTranspose()
 // Returns the transpose of a matrix, or NULL.
 //
-// The caller must free both the allocated matrix
-// and its contents array.
+// The rows of the input (one per point) are split among
+// the threads.
 //--------------------------------------------------------
-static matrix_t *createTranspose(matrix_t *pInput, int numThreads)
+static matrix_t *createTranspose(polyfit_workspace_t *pWorkspace, matrix_t *pInput, const PoolTeam *pTeam)
 {
     matrix_t *pOutput = NULL;
 
@@ -369,70 +577,65 @@ static matrix_t *createTranspose(matrix_t *pInput, int numThreads)
     else
     {
         // Allocate the transposed matrix.
-        pOutput = (matrix_t *)calloc(1, sizeof(matrix_t));
-        pOutput->rows = pInput->cols;
-        pOutput->cols = pInput->rows;
-        pOutput->pContents = (double *)calloc(pOutput->rows * pOutput->cols, sizeof(double));
-
-        // Create threads
-        pthread_t threads[numThreads];
-        ThreadArgs_transpose threadArgs[numThreads];
-
-        int rowsPerThread = pOutput->rows / numThreads;
-        int remainingRows = pOutput->rows % numThreads;
-        int startRow = 0;
-
-        for (int i = 0; i < numThreads; i++)
+        pOutput = createMatrix(pWorkspace, pInput->cols, pInput->rows);
+        if (NULL == pOutput)
         {
-            int endRow = startRow + rowsPerThread - 1 + (i < remainingRows ? 1 : 0);
-
-            threadArgs[i].start_row = startRow;
-            threadArgs[i].end_row = endRow;
-            threadArgs[i].pInput = pInput;
-            threadArgs[i].pOutput = pOutput;
-
-            pthread_create(&threads[i], NULL, transposeRows, (void *)&threadArgs[i]);
-
-            startRow = endRow + 1;
+            return NULL;
         }
 
-        // Wait for threads to finish
-        for (int i = 0; i < numThreads; i++)
-        {
-            pthread_join(threads[i], NULL);
-        }
+        TaskArgs_transpose taskArgs;
+        taskArgs.pInput = pInput;
+        taskArgs.pOutput = pOutput;
+
+        polyfit_pool_run_team(pTeam->pPool, pTeam->threadCount, transposeRows, &taskArgs);
     }
 
     return pOutput;
 }
 
-void *multiplyRows(void *threadArgs)
+static void multiplySlice(void *pArg, int thread, int threadCount)
 {
-    ThreadArgs_product *args = (ThreadArgs_product *)threadArgs;
+    TaskArgs_product *args = (TaskArgs_product *)pArg;
+    ReductionShared *pShared = args->pShared;
+    double *pPartial = &pShared->pPartials[thread * pShared->partialSize];
+    int startK, endK;
 
-    for (int i = args->start_row; i <= args->end_row; i++)
+    threadSlice(args->pLeft->cols, thread, threadCount, &startK, &endK);
+
+    // Reduce this thread's slice of the inner (point) dimension.
+    for (int i = 0; i < args->pLeft->rows; i++)
     {
-        for (int j = 0; j < args->pResult->cols; j++)
+        if (1 == args->pRight->cols)
+        {
+            // A column vector is contiguous: use the vector dot product.
+            pPartial[i] = polyfit_simd()->dot(endK - startK + 1,
+                                              MATRIX_VALUE_PTR(args->pLeft, i, startK),
+                                              &args->pRight->pContents[startK]);
+            continue;
+        }
+        for (int j = 0; j < args->pRight->cols; j++)
         {
-            for (int k = 0; k < args->pLeft->cols; k++)
+            double sum = 0.0;
+            for (int k = startK; k <= endK; k++)
             {
-                *MATRIX_VALUE_PTR(args->pResult, i, j) +=
-                    (*MATRIX_VALUE_PTR(args->pLeft, i, k)) * (*MATRIX_VALUE_PTR(args->pRight, k, j));
+                sum += (*MATRIX_VALUE_PTR(args->pLeft, i, k)) * (*MATRIX_VALUE_PTR(args->pRight, k, j));
             }
+            pPartial[(i * args->pRight->cols) + j] = sum;
         }
     }
 
-    pthread_exit(NULL);
+    treeMergePartials(pShared, thread);
 }
 
 //--------------------------------------------------------
 // createProduct()
 // Returns the product of two matrices, or NULL.
 //
-// The caller must free both the allocated product matrix
-// and its contents array.
+// The inner dimension (the points, for (AT)A and (AT)b) is
+// split among the threads, so every thread does an equal
+// share of the work however small the product matrix is.
 //--------------------------------------------------------
-static matrix_t *createProduct(matrix_t *pLeft, matrix_t *pRight, int numThreads)
+static matrix_t *createProduct(polyfit_workspace_t *pWorkspace, matrix_t *pLeft, matrix_t *pRight, const PoolTeam *pTeam)
 {
     matrix_t *rVal = NULL;
 
@@ -443,80 +646,247 @@ static matrix_t *createProduct(matrix_t *pLeft, matrix_t *pRight, int numThreads
     else
     {
         // Allocate the product matrix.
-        rVal = (matrix_t *)calloc(1, sizeof(matrix_t));
-        rVal->rows = pLeft->rows;
-        rVal->cols = pRight->cols;
-        rVal->pContents = (double *)calloc(rVal->rows * rVal->cols, sizeof(double));
+        rVal = createMatrix(pWorkspace, pLeft->rows, pRight->cols);
+        if (NULL == rVal)
+        {
+            return NULL;
+        }
 
-        // Create threads
-        pthread_t threads[numThreads];
-        ThreadArgs_product threadArgs[numThreads];
+        ReductionShared shared;
+        if (0 != initReduction(&shared, pWorkspace, pTeam, rVal->rows * rVal->cols))
+        {
+            return NULL;
+        }
 
-        int rowsPerThread = rVal->rows / numThreads;
-        int remainingRows = rVal->rows % numThreads;
-        int startRow = 0;
+        TaskArgs_product taskArgs;
+        taskArgs.pLeft = pLeft;
+        taskArgs.pRight = pRight;
+        taskArgs.pShared = &shared;
 
-        for (int i = 0; i < numThreads; i++)
-        {
-            int endRow = startRow + rowsPerThread - 1 + (i < remainingRows ? 1 : 0);
+        polyfit_pool_run_team(pTeam->pPool, pTeam->threadCount, multiplySlice, &taskArgs);
 
-            threadArgs[i].start_row = startRow;
-            threadArgs[i].end_row = endRow;
-            threadArgs[i].pLeft = pLeft;
-            threadArgs[i].pRight = pRight;
-            threadArgs[i].pResult = rVal;
+        memcpy(rVal->pContents, shared.pPartials, rVal->rows * rVal->cols * sizeof(double));
+    }
 
-            pthread_create(&threads[i], NULL, multiplyRows, (void *)&threadArgs[i]);
+    return rVal;
+}
 
-            startRow = endRow + 1;
-        }
+static void multiplyHankelSlice(void *pArg, int thread, int threadCount)
+{
+    TaskArgs_hankel *args = (TaskArgs_hankel *)pArg;
+    ReductionShared *pShared = args->pShared;
+    double *pPartial = &pShared->pPartials[thread * pShared->partialSize];
+    int sumCount = 2 * args->pMatAT->rows - 1;
+    int startK, endK;
+
+    threadSlice(args->pMatAT->cols, thread, threadCount, &startK, &endK);
+
+    for (int s = 0; s < sumCount; s++)
+    {
+        // Any rows i, j with i + j == s give the same sum.
+        int i = s / 2;
+        int j = s - i;
+        double *pRowI = MATRIX_VALUE_PTR(args->pMatAT, i, 0);
+        double *pRowJ = MATRIX_VALUE_PTR(args->pMatAT, j, 0);
+        pPartial[s] = polyfit_simd()->dot(endK - startK + 1, &pRowI[startK], &pRowJ[startK]);
+    }
 
-        // Wait for threads to finish
-        for (int i = 0; i < numThreads; i++)
+    treeMergePartials(pShared, thread);
+}
+
+//--------------------------------------------------------
+// createHankelProduct()
+// Returns (AT)A for a Vandermonde matrix A, given AT, or NULL.
+//
+// (AT)A[i,j] is the sum of x^(2*degree - i - j), so it only
+// depends on i + j.  Each thread computes the 2k-1 distinct
+// sums over its slice of the points, the partial sums are
+// merged, and then copied along the anti-diagonals.
+//--------------------------------------------------------
+static matrix_t *createHankelProduct(polyfit_workspace_t *pWorkspace, matrix_t *pMatAT, const PoolTeam *pTeam)
+{
+    int k = pMatAT->rows;
+    int sumCount = 2 * k - 1;
+    matrix_t *rVal = createMatrix(pWorkspace, k, k);
+    if (NULL == rVal)
+    {
+        return NULL;
+    }
+    memset(rVal->pContents, 0, k * k * sizeof(double));
+
+    ReductionShared shared;
+    if (0 != initReduction(&shared, pWorkspace, pTeam, sumCount))
+    {
+        return NULL;
+    }
+
+    TaskArgs_hankel taskArgs;
+    taskArgs.pMatAT = pMatAT;
+    taskArgs.pShared = &shared;
+
+    polyfit_pool_run_team(pTeam->pPool, pTeam->threadCount, multiplyHankelSlice, &taskArgs);
+
+    for (int s = 0; s < sumCount; s++)
+    {
+        setHankelDiagonal(rVal, s, shared.pPartials[s]);
+    }
+
+    return rVal;
+}
+
+//--------------------------------------------------------
+// setHankelDiagonal()
+// Stores value in every element (r, c) of a square matrix
+// with r + c == s and r <= c.  The solver only reads the
+// upper triangle, so the lower one is left unformed.
+//--------------------------------------------------------
+static void setHankelDiagonal( matrix_t *pMat, int s, double value )
+{
+    int k = pMat->rows;
+    int rFirst = (s < k) ? 0 : (s - k + 1);
+    int rLast = s / 2;
+    for( int r = rFirst; r <= rLast; r++ )
+    {
+        *MATRIX_VALUE_PTR(pMat, r, (s - r)) = value;
+    }
+}
+
+//--------------------------------------------------------
+// initReduction()
+// Takes one cleared, cache-line padded partial result of
+// resultSize doubles per team thread from the workspace.
+// Returns 0 on success, -3 if the workspace is full.
+//--------------------------------------------------------
+static int initReduction( ReductionShared *pShared, polyfit_workspace_t *pWorkspace, const PoolTeam *pTeam, int resultSize )
+{
+    // 8 doubles per 64-byte cache line.
+    pShared->partialSize = ((resultSize + 7) / 8) * 8;
+    pShared->pTeam = pTeam;
+
+    size_t byteCount = (size_t) pTeam->threadCount * pShared->partialSize * sizeof( double );
+    pShared->pPartials = (double *) polyfit_workspace_alloc( pWorkspace, byteCount );
+    if( NULL == pShared->pPartials )
+    {
+        return -3;
+    }
+    memset( pShared->pPartials, 0, byteCount );
+    return 0;
+}
+
+//--------------------------------------------------------
+// treeMergePartials()
+// Called by every worker once its partial is complete.
+// Partials are added pairwise in log2(numThreads) rounds,
+// leaving the total in partial 0.
+//--------------------------------------------------------
+static void treeMergePartials( ReductionShared *pShared, int thread )
+{
+    int numThreads = pShared->pTeam->threadCount;
+    for( int stride = 1; stride < numThreads; stride *= 2 )
+    {
+        polyfit_pool_barrier( pShared->pTeam->pPool );
+        if( (0 == (thread % (2 * stride))) && (thread + stride < numThreads) )
         {
-            pthread_join(threads[i], NULL);
+            double *pDest = &pShared->pPartials[ thread * pShared->partialSize ];
+            double *pSrc = &pShared->pPartials[ (thread + stride) * pShared->partialSize ];
+            for( int i = 0; i < pShared->partialSize; i++ )
+            {
+                pDest[i] += pSrc[i];
+            }
         }
     }
+}
 
-    return rVal;
+static void accumulateRows(void *pArg, int thread, int threadCount)
+{
+    TaskArgs_sums *args = (TaskArgs_sums *)pArg;
+    int startRow, endRow;
+
+    threadSlice(args->pointCount, thread, threadCount, &startRow, &endRow);
+    polyfit_sums_add(&args->pSums[thread], endRow - startRow + 1, &args->xValues[startRow], &args->yValues[startRow]);
+}
+
+//--------------------------------------------------------
+// recordThreadId()
+// Pool task: stores the participant's kernel thread id.
+//--------------------------------------------------------
+static void recordThreadId( void *pArg, int thread, int threadCount )
+{
+    (void) threadCount;
+    ((int *) pArg)[ thread ] = polyfit_perf_thread_id();
 }
 
 //--------------------------------------------------------
-// destroyMatrix()
-// Frees both the allocated matrix and its contents array.
+// acquireThreadPool()
+// Returns the shared pool, creating it with
+// polyfit_pool_default_size() threads on first use, or
+// NULL if it can't be started.  Either way the pool lock
+// is held for reading until releaseThreadPool().
 //--------------------------------------------------------
-static void destroyMatrix( matrix_t *pMat )
+static polyfit_pool_t *acquireThreadPool( void )
 {
-    if(NULL != pMat)
+    pthread_rwlock_rdlock( &threadPoolLock );
+    while( NULL == pThreadPool )
     {
-        if(NULL != pMat->pContents)
+        pthread_rwlock_unlock( &threadPoolLock );
+        pthread_rwlock_wrlock( &threadPoolLock );
+        if( NULL == pThreadPool )
         {
-            free(pMat->pContents);
+            pThreadPool = polyfit_pool_create( polyfit_pool_default_size() );
+        }
+        bool isStarted = (NULL != pThreadPool);
+        pthread_rwlock_unlock( &threadPoolLock );
+        pthread_rwlock_rdlock( &threadPoolLock );
+        if( !isStarted )
+        {
+            break;
         }
-        free( pMat );
     }
+    return pThreadPool;
+}
+
+//--------------------------------------------------------
+// releaseThreadPool()
+// Lets go of the pool taken by acquireThreadPool().
+//--------------------------------------------------------
+static void releaseThreadPool( void )
+{
+    pthread_rwlock_unlock( &threadPoolLock );
+}
+
+//--------------------------------------------------------
+// threadSlice()
+// Splits count items as evenly as possible over the
+// threads, giving thread its range startIndex .. endIndex
+// (inclusive; empty when endIndex < startIndex).
+//--------------------------------------------------------
+static void threadSlice( int count, int thread, int threadCount, int *pStart, int *pEnd )
+{
+    int perThread = count / threadCount;
+    int remaining = count % threadCount;
+
+    *pStart = thread * perThread + (thread < remaining ? thread : remaining);
+    *pEnd = *pStart + perThread - 1 + (thread < remaining ? 1 : 0);
 }
 
 //--------------------------------------------------------
 // createMatrix()
-// Allocates the matrix and clears its contents array.
+// Takes the matrix and its contents array from the
+// workspace.  The contents are not cleared.
 //--------------------------------------------------------
-static matrix_t *createMatrix( int rows, int cols )
+static matrix_t *createMatrix( polyfit_workspace_t *pWorkspace, int rows, int cols )
 {
-    matrix_t *rVal = (matrix_t *) calloc(1, sizeof(matrix_t));
+    matrix_t *rVal = (matrix_t *) polyfit_workspace_alloc( pWorkspace, sizeof(matrix_t) );
     if(NULL != rVal)
     {
         rVal->rows = rows;
         rVal->cols = cols;
-        rVal->pContents = (double *) calloc( rows * cols, sizeof( double ));
+        rVal->pContents = (double *) polyfit_workspace_alloc( pWorkspace, (size_t) rows * cols * sizeof( double ));
         if(NULL == rVal->pContents)
         {
-            free( rVal );
             rVal = NULL;
         }
     }
 
     return rVal;
 }
-
- 
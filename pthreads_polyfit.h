@@ -1,6 +1,9 @@
 #ifndef PTHREADS_POLYFIT_H
 #define PTHREADS_POLYFIT_H
 
+#include "polyfit_stats.h"
+#include "polyfit_workspace.h"
+
 
 //------------------------------------------------
 // Function Prototypes
@@ -9,12 +12,85 @@
 //--------------------------------------------------------
 // polyfit()
 // Computes polynomial coefficients that best fit a set
-// of input points.
+// of input points.  Runs polyfit_ex() on
+// POLYFIT_BACKEND_PTHREADS.
 //
 // Returns 0 if success.
 //--------------------------------------------------------
 int pthreads_polyfit( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults );
 
+//--------------------------------------------------------
+// pthreads_polyfit_ws()
+// Same as pthreads_polyfit(), but takes its scratch
+// matrices from pWorkspace instead of the heap.  A
+// workspace from polyfit_workspace_create( maxPointCount,
+// maxCoefficientCount, pthreads_polyfit_threads() ) covers
+// any fit up to that size.
+//
+// pStats, if not NULL, is filled with the time and bytes
+// of each phase.
+//
+// Returns 0 if success, or the polyfit() error codes; -3
+// means the workspace is too small.
+//--------------------------------------------------------
+int pthreads_polyfit_ws( polyfit_workspace_t *pWorkspace, int pointCount, double *xValues, double *yValues,
+                         int coefficientCount, double *coefficientResults, polyfit_stats_t *pStats );
+
+//--------------------------------------------------------
+// pthreads_polyfit_team_ws()
+// Same as pthreads_polyfit_ws(), but runs on only the
+// first threadCount threads of the pool, which is left the
+// size it is; threadCount < 1, or above the pool size,
+// means the whole pool.  The workspace needs room for
+// threadCount threads.
+//
+// Returns 0 if success, or the pthreads_polyfit_ws() error
+// codes.
+//--------------------------------------------------------
+int pthreads_polyfit_team_ws( polyfit_workspace_t *pWorkspace, int threadCount, int pointCount,
+                              double *xValues, double *yValues, int coefficientCount, double *coefficientResults,
+                              polyfit_stats_t *pStats );
+
+//--------------------------------------------------------
+// pthreads_polyfit_stream()
+// Single-pass variant of pthreads_polyfit() that accumulates
+// (AT)A and (AT)b directly instead of building A.
+//
+// Returns 0 if success.
+//--------------------------------------------------------
+int pthreads_polyfit_stream( int pointCount, double *xValues, double *yValues, int coefficientCount, double *coefficientResults );
+
+//--------------------------------------------------------
+// pthreads_polyfit_set_threads()
+// Sets the number of threads the fits run on.  The fits
+// share one pool of persistent threads, created on first
+// use with polyfit_pool_default_size() threads (the
+// POLYFIT_THREADS environment variable, or the CPU count).
+// Fits already running finish on the old pool first; don't
+// call it from inside a fit.
+//
+// Returns 0 if success, -2 if numThreads < 1,
+// -3 if the threads can't be started.
+//--------------------------------------------------------
+int pthreads_polyfit_set_threads( int numThreads );
+
+//--------------------------------------------------------
+// pthreads_polyfit_threads()
+// Returns the number of threads the fits run on.
+//--------------------------------------------------------
+int pthreads_polyfit_threads( void );
+
+//--------------------------------------------------------
+// pthreads_polyfit_thread_ids()
+// Fills threadIds with the kernel thread id of each pool
+// thread, in participant order, for polyfit_perf_attach().
+//
+// Returns the number of ids written, at most maxThreads,
+// or -1 if passed a NULL pointer, -3 if the pool can't be
+// started.
+//--------------------------------------------------------
+int pthreads_polyfit_thread_ids( int *threadIds, int maxThreads );
+
 //--------------------------------------------------------
 // polyToString()
 // Produces a string representation of a polynomial from
@@ -0,0 +1,806 @@
+// Name: regress.c
+// Description: Numerical regression check of every fit engine against
+//              a high-precision reference, with the time each takes.
+//
+// Usage:   regress [dataDirectory]
+//
+// Each engine - the serial, OpenMP, pthreads and SIMD backends on the
+// normal equations, the mixed precision fit, the QR and orthogonal
+// polynomial solvers, polyfit_batch() fitting the points as one
+// series, the largest fit of a polyfit_sweep(), a polyfit_online()
+// fit that also adds and removes half the points again, the last
+// polyfit_rolling() window over the points repeated twice, and a
+// polyfit_index_fit() of the whole range from an index appended the
+// points in order of x a chunk at a time - fits generated datasets with
+// known coefficients (see polyfit_synth.h) and the shipped
+// FlightDurationPrice.csv and filteredDistTotal.csv, looked for in
+// dataDirectory (default "."; a missing file is reported and
+// skipped).
+//
+// The reference is a Householder QR in long double on x shifted and
+// scaled to [-1, 1].  Against it each fit is scored by:
+//      fit error       largest |p(x) - reference(x)| over the points,
+//                      relative to the largest |reference(x)|
+//      excess RSS      (RSS - reference RSS) / reference RSS; a least
+//                      squares fit can't do better than 0
+//      coef error      largest |coefficient - reference coefficient|,
+//                      both in t, relative to the largest reference
+//                      coefficient
+// and must keep all three within its engine's tolerance.  The fit's
+// coefficients in x are rewritten in t in long double; t is well
+// conditioned wherever the data sits, where coefficients in x far
+// from 0 are large and cancel.  Every dataset is fitted once per ISA
+// level this CPU supports, forced with polyfit_simd_force() (so
+// POLYFIT_ISA is overridden), so each dispatch path of the kernels is
+// checked.  Prints a table of error against time and exits with 1 if
+// any fit fails.
+
+#include <float.h>      // DBL_MAX
+#include <limits.h>     // INT_MAX
+#include <math.h>       // fabsl(), fmaxl(), sqrtl()
+#include <stdbool.h>    // bool
+#include <stdio.h>
+#include <stdlib.h>     // malloc(), free()
+#include <string.h>     // memset(), memcpy()
+
+#include "polyfit_batch.h"
+#include "polyfit_csv.h"
+#include "polyfit_ex.h"
+#include "polyfit_index.h"
+#include "polyfit_online.h"
+#include "polyfit_rolling.h"
+#include "polyfit_simd.h"
+#include "polyfit_stats.h"
+#include "polyfit_sums.h"
+#include "polyfit_sweep.h"
+#include "polyfit_synth.h"
+
+// Timed runs of each fit; the fastest is reported.
+#define RUN_COUNT           (3)
+
+// Most coefficients a dataset is fitted with.
+#define MAX_COEFFICIENTS    (16)
+
+// Longest data file path.
+#define PATH_SIZE           (1024)
+
+// Points the index is built on, then appended, at a time.
+#define INDEX_CHUNK         (100)
+
+// Tolerances on the fit error, excess RSS and coefficient
+// error, set against the scalar kernels, whose single
+// accumulator per sum makes them the worst case.  The
+// normal equations square the condition number, so they
+// lose the most on data far from 0: "offset" reaches about
+// 1e-3 of excess RSS on the scalar kernels (a few 1e-6 on
+// AVX-512).  The mixed fit's float sums alone carry float
+// rounding, about 1e-3 on "distances".  Refined in double
+// it, QR and the orthogonal basis work on A itself, and
+// all three stay below 1e-9 on every dataset.  Normal
+// equations in x centered and scaled to [-1, 1] are as
+// well conditioned wherever the data is, and are held to
+// the same tolerance: a sweep is out by about 1e-9 on
+// "distances" on the scalar kernels.
+#define NORMAL_TOLERANCE    (1e-2)
+#define FLOAT_TOLERANCE     (1e-2)
+#define MIXED_TOLERANCE     (1e-8)
+#define STABLE_TOLERANCE    (1e-8)
+
+// A fit through some other entry point than polyfit_ex():
+// the points in, coefficients highest power first out, and
+// 0 or an error code back.
+typedef int (*FitFunction)( int pointCount, const double *xValues, const double *yValues,
+                            int coefficientCount, double *coefficientResults );
+
+// One engine: a polyfit_ex() configuration, or a FitFunction
+// (the configuration then only describes it).
+typedef struct
+{
+    const char          *name;
+    FitFunction         pFit;           // NULL for polyfit_ex().
+    polyfit_backend_t   backend;
+    polyfit_precision_t precision;
+    polyfit_solver_t    solver;
+    double              tolerance;
+} Engine;
+
+// One dataset: a data file, or generated points.
+typedef struct
+{
+    const char          *name;
+    const char          *fileName;      // NULL to generate.
+    int                 coefficientCount;
+    long                pointCount;     // For generated data.
+    int                 degree;
+    double              xMin;
+    double              xMax;
+    double              noise;
+    double              outlierFraction;
+} Dataset;
+
+// The reference fit of one dataset.
+typedef struct
+{
+    long double         coefficients[ MAX_COEFFICIENTS ];   // In t = (x - shift) * scale, lowest power first.
+    long double         shift;
+    long double         scale;
+    long double         maxCoefficient;     // Largest |coefficients[i]|.
+    long double         *pFitted;       // Reference value at each point.
+    long double         rss;
+    long double         maxFitted;      // Largest |pFitted[i]|.
+} Reference;
+
+// One point, for sorting.
+typedef struct
+{
+    double              x;
+    double              y;
+} Point;
+
+//------------------------------------------------
+// Private Function Prototypes
+//------------------------------------------------
+
+static int          loadDataset( const Dataset *pDataset, const char *directory, long *pPointCount,
+                                 double **pxValues, double **pyValues, double *trueCoefficients );
+static int          fitReference( long pointCount, const double *xValues, const double *yValues,
+                                  int coefficientCount, Reference *pReference );
+static void         rewriteInT( int coefficientCount, long double shift, long double scale,
+                                const double *inX, long double *inT );
+static long double  evaluate( int coefficientCount, const double *coefficients, double x );
+static bool         checkEngine( const Engine *pEngine, const Dataset *pDataset, long pointCount,
+                                 double *xValues, double *yValues, const Reference *pReference );
+static int          fitRefined( int pointCount, const double *xValues, const double *yValues,
+                                int coefficientCount, double *coefficientResults );
+static int          fitBatch( int pointCount, const double *xValues, const double *yValues,
+                              int coefficientCount, double *coefficientResults );
+static int          fitSweep( int pointCount, const double *xValues, const double *yValues,
+                              int coefficientCount, double *coefficientResults );
+static int          fitOnline( int pointCount, const double *xValues, const double *yValues,
+                               int coefficientCount, double *coefficientResults );
+static int          fitRolling( int pointCount, const double *xValues, const double *yValues,
+                                int coefficientCount, double *coefficientResults );
+static int          fitIndex( int pointCount, const double *xValues, const double *yValues,
+                              int coefficientCount, double *coefficientResults );
+static int          comparePoints( const void *pLeft, const void *pRight );
+
+
+static const Engine engines[] =
+{
+    { "serial",     NULL,        POLYFIT_BACKEND_SERIAL,     POLYFIT_PRECISION_DOUBLE,   POLYFIT_SOLVER_NORMAL,  NORMAL_TOLERANCE },
+    { "openmp",     NULL,        POLYFIT_BACKEND_OPENMP,     POLYFIT_PRECISION_DOUBLE,   POLYFIT_SOLVER_NORMAL,  NORMAL_TOLERANCE },
+    { "pthreads",   NULL,        POLYFIT_BACKEND_PTHREADS,   POLYFIT_PRECISION_DOUBLE,   POLYFIT_SOLVER_NORMAL,  NORMAL_TOLERANCE },
+    { "simd",       NULL,        POLYFIT_BACKEND_SIMD,       POLYFIT_PRECISION_DOUBLE,   POLYFIT_SOLVER_NORMAL,  NORMAL_TOLERANCE },
+    { "mixed",      NULL,        POLYFIT_BACKEND_OPENMP,     POLYFIT_PRECISION_MIXED,    POLYFIT_SOLVER_NORMAL,  FLOAT_TOLERANCE },
+    { "refined",    fitRefined,  POLYFIT_BACKEND_OPENMP,     POLYFIT_PRECISION_MIXED,    POLYFIT_SOLVER_NORMAL,  MIXED_TOLERANCE },
+    { "qr",         NULL,        POLYFIT_BACKEND_OPENMP,     POLYFIT_PRECISION_DOUBLE,   POLYFIT_SOLVER_QR,      STABLE_TOLERANCE },
+    { "ortho",      NULL,        POLYFIT_BACKEND_OPENMP,     POLYFIT_PRECISION_DOUBLE,   POLYFIT_SOLVER_ORTHO,   STABLE_TOLERANCE },
+    { "batch",      fitBatch,    POLYFIT_BACKEND_SIMD,       POLYFIT_PRECISION_DOUBLE,   POLYFIT_SOLVER_NORMAL,  NORMAL_TOLERANCE },
+    { "sweep",      fitSweep,    POLYFIT_BACKEND_OPENMP,     POLYFIT_PRECISION_DOUBLE,   POLYFIT_SOLVER_NORMAL,  STABLE_TOLERANCE },
+    { "online",     fitOnline,   POLYFIT_BACKEND_SERIAL,     POLYFIT_PRECISION_DOUBLE,   POLYFIT_SOLVER_NORMAL,  STABLE_TOLERANCE },
+    { "rolling",    fitRolling,  POLYFIT_BACKEND_OPENMP,     POLYFIT_PRECISION_DOUBLE,   POLYFIT_SOLVER_NORMAL,  STABLE_TOLERANCE },
+    { "index",      fitIndex,    POLYFIT_BACKEND_OPENMP,     POLYFIT_PRECISION_DOUBLE,   POLYFIT_SOLVER_NORMAL,  STABLE_TOLERANCE },
+};
+#define ENGINE_COUNT    ((int) (sizeof( engines ) / sizeof( engines[0] )))
+
+static const Dataset datasets[] =
+{
+    { "quartic",        NULL,                       5,  1000000,  4,   -1.0,   1.0,    0.01,   0.0 },
+    { "outliers",       NULL,                       5,  1000000,  4,   -1.0,   1.0,    0.01,   0.01 },
+    { "degree 8",       NULL,                       9,  1000000,  8,   -1.0,   1.0,    0.001,  0.0 },
+    { "offset",         NULL,                       4,  100000,   3,    100.0, 110.0,  0.1,    0.0 },
+    { "flights",        "FlightDurationPrice.csv",  5,  0,        0,    0.0,   0.0,    0.0,    0.0 },
+    { "distances",      "filteredDistTotal.csv",    5,  0,        0,    0.0,   0.0,    0.0,    0.0 },
+};
+#define DATASET_COUNT   ((int) (sizeof( datasets ) / sizeof( datasets[0] )))
+
+
+//--------------------------------------------------------
+// main()
+// Runs every engine on every dataset, at every ISA level,
+// and prints the table.
+//--------------------------------------------------------
+int main( int argc, char *argv[] )
+{
+    const char *directory = (argc > 1) ? argv[1] : ".";
+    int failCount = 0;
+
+    if( argc > 2 )
+    {
+        fprintf( stderr, "Usage: %s [dataDirectory]\n", argv[0] );
+        return 1;
+    }
+
+    printf( "%-10s %7s %3s  %-6s %-9s %12s %12s %12s %12s  %s\n", "dataset", "points", "k", "isa", "engine",
+            "seconds", "fit error", "excess RSS", "coef error", "result" );
+
+    for( int d = 0; d < DATASET_COUNT; d++ )
+    {
+        const Dataset *pDataset = &datasets[d];
+        double trueCoefficients[ POLYFIT_SYNTH_MAX_DEGREE + 1 ];
+        double *xValues = NULL;
+        double *yValues = NULL;
+        long pointCount = 0;
+        Reference reference;
+
+        int rVal = loadDataset( pDataset, directory, &pointCount, &xValues, &yValues, trueCoefficients );
+        if( 0 != rVal )
+        {
+            printf( "%-10s skipped: unable to load %s (error = %d)\n", pDataset->name,
+                    (NULL != pDataset->fileName) ? pDataset->fileName : "generated data", rVal );
+            continue;
+        }
+
+        rVal = fitReference( pointCount, xValues, yValues, pDataset->coefficientCount, &reference );
+        if( 0 != rVal )
+        {
+            printf( "%-10s skipped: no reference fit (error = %d)\n", pDataset->name, rVal );
+        }
+        else
+        {
+            for( int isa = POLYFIT_ISA_SCALAR; isa <= (int) polyfit_simd_supported(); isa++ )
+            {
+                if( 0 != polyfit_simd_force( (polyfit_isa_t) isa ) )
+                {
+                    continue;
+                }
+                for( int e = 0; e < ENGINE_COUNT; e++ )
+                {
+                    if( !checkEngine( &engines[e], pDataset, pointCount, xValues, yValues, &reference ) )
+                    {
+                        failCount++;
+                    }
+                }
+            }
+            free( reference.pFitted );
+        }
+
+        free( xValues );
+        free( yValues );
+    }
+
+    printf( "%d fit(s) out of tolerance\n", failCount );
+    return (0 == failCount) ? 0 : 1;
+}
+
+//--------------------------------------------------------
+// loadDataset()
+// Generates a dataset, or reads it from directory.
+// trueCoefficients gets the generating polynomial, highest
+// power first, for generated data.  The arrays are
+// malloc()ed.
+//
+// Returns 0 if success, or the polyfit_synth_generate() or
+// polyfit_csv_load() error codes.
+//--------------------------------------------------------
+static int loadDataset( const Dataset *pDataset, const char *directory, long *pPointCount,
+                        double **pxValues, double **pyValues, double *trueCoefficients )
+{
+    if( NULL != pDataset->fileName )
+    {
+        char path[ PATH_SIZE ];
+        polyfit_csv_t csv;
+
+        snprintf( path, sizeof( path ), "%s/%s", directory, pDataset->fileName );
+        int rVal = polyfit_csv_load( path, &csv );
+        if( 0 != rVal )
+        {
+            return rVal;
+        }
+        *pPointCount = csv.pointCount;
+        *pxValues = csv.xValues;
+        *pyValues = csv.yValues;
+        return 0;
+    }
+
+    polyfit_synth_t synth;
+    polyfit_synth_defaults( &synth );
+    synth.pointCount = pDataset->pointCount;
+    synth.degree = pDataset->degree;
+    synth.xMin = pDataset->xMin;
+    synth.xMax = pDataset->xMax;
+    synth.noise = pDataset->noise;
+    synth.outlierFraction = pDataset->outlierFraction;
+
+    *pxValues = (double *) malloc( synth.pointCount * sizeof( double ) );
+    *pyValues = (double *) malloc( synth.pointCount * sizeof( double ) );
+    if( (NULL == *pxValues) || (NULL == *pyValues) )
+    {
+        free( *pxValues );
+        free( *pyValues );
+        return -3;
+    }
+    *pPointCount = synth.pointCount;
+    return polyfit_synth_generate( &synth, *pxValues, *pyValues, trueCoefficients );
+}
+
+//--------------------------------------------------------
+// fitReference()
+// Least squares by Householder QR in long double, on
+// t = (x - shift) * scale in [-1, 1] so the Vandermonde
+// columns are well conditioned.  Fills in the reference
+// values at the points and their RSS.
+//
+// Returns 0 if success, -2 if there are too few points or
+// too many coefficients, -3 if unable to allocate memory,
+// -4 if the columns are dependent.
+//--------------------------------------------------------
+static int fitReference( long pointCount, const double *xValues, const double *yValues,
+                         int coefficientCount, Reference *pReference )
+{
+    int k = coefficientCount;
+    long n = pointCount;
+
+    if( (k < 1) || (k > MAX_COEFFICIENTS) || (n < k) )
+    {
+        return -2;
+    }
+
+    long double xMin = xValues[0];
+    long double xMax = xValues[0];
+    for( long i = 1; i < n; i++ )
+    {
+        xMin = (xValues[i] < xMin) ? xValues[i] : xMin;
+        xMax = (xValues[i] > xMax) ? xValues[i] : xMax;
+    }
+    pReference->shift = (xMin + xMax) / 2.0L;
+    pReference->scale = (xMax > xMin) ? 2.0L / (xMax - xMin) : 1.0L;
+
+    // Column j holds t^j; b is the last column.
+    long double *pA = (long double *) malloc( (size_t) n * (k + 1) * sizeof( long double ) );
+    pReference->pFitted = (long double *) malloc( (size_t) n * sizeof( long double ) );
+    if( (NULL == pA) || (NULL == pReference->pFitted) )
+    {
+        free( pA );
+        free( pReference->pFitted );
+        return -3;
+    }
+    for( long i = 0; i < n; i++ )
+    {
+        long double t = (xValues[i] - pReference->shift) * pReference->scale;
+        long double power = 1.0L;
+        for( int j = 0; j < k; j++ )
+        {
+            pA[ (size_t) j * n + i ] = power;
+            power *= t;
+        }
+        pA[ (size_t) k * n + i ] = yValues[i];
+    }
+
+    // Householder reflections, applied to the remaining
+    // columns and to b.
+    long double diagonal[ MAX_COEFFICIENTS ];
+    for( int j = 0; j < k; j++ )
+    {
+        long double *pColumn = &pA[ (size_t) j * n ];
+        long double norm = 0.0L;
+        for( long i = j; i < n; i++ )
+        {
+            norm += pColumn[i] * pColumn[i];
+        }
+        norm = sqrtl( norm );
+        if( 0.0L == norm )
+        {
+            free( pA );
+            free( pReference->pFitted );
+            return -4;
+        }
+
+        long double alpha = (pColumn[j] > 0.0L) ? -norm : norm;
+        pColumn[j] -= alpha;        // v = column - alpha * e_j
+        long double vv = 0.0L;
+        for( long i = j; i < n; i++ )
+        {
+            vv += pColumn[i] * pColumn[i];
+        }
+
+        for( int c = j + 1; c <= k; c++ )
+        {
+            long double *pOther = &pA[ (size_t) c * n ];
+            long double dot = 0.0L;
+            for( long i = j; i < n; i++ )
+            {
+                dot += pColumn[i] * pOther[i];
+            }
+            long double factor = 2.0L * dot / vv;
+            for( long i = j; i < n; i++ )
+            {
+                pOther[i] -= factor * pColumn[i];
+            }
+        }
+        diagonal[j] = alpha;
+    }
+
+    // Back substitution with R's diagonal kept apart.
+    long double *pB = &pA[ (size_t) k * n ];
+    for( int j = k - 1; j >= 0; j-- )
+    {
+        long double sum = pB[j];
+        for( int c = j + 1; c < k; c++ )
+        {
+            sum -= pA[ (size_t) c * n + j ] * pReference->coefficients[c];
+        }
+        pReference->coefficients[j] = sum / diagonal[j];
+    }
+    free( pA );
+
+    pReference->rss = 0.0L;
+    pReference->maxFitted = 0.0L;
+    for( long i = 0; i < n; i++ )
+    {
+        long double t = (xValues[i] - pReference->shift) * pReference->scale;
+        long double fitted = 0.0L;
+        for( int j = k - 1; j >= 0; j-- )
+        {
+            fitted = fitted * t + pReference->coefficients[j];
+        }
+        pReference->pFitted[i] = fitted;
+        pReference->rss += (yValues[i] - fitted) * (yValues[i] - fitted);
+        if( fabsl( fitted ) > pReference->maxFitted )
+        {
+            pReference->maxFitted = fabsl( fitted );
+        }
+    }
+
+    pReference->maxCoefficient = 0.0L;
+    for( int j = 0; j < k; j++ )
+    {
+        pReference->maxCoefficient = fmaxl( pReference->maxCoefficient, fabsl( pReference->coefficients[j] ) );
+    }
+    return 0;
+}
+
+//--------------------------------------------------------
+// rewriteInT()
+// Rewrites a polynomial in x, highest power first, as one
+// in t = (x - shift) * scale, lowest power first, in long
+// double: polyfit_unscale() with x = (t - (-shift * scale))
+// / scale, so the rounding of the rewrite stays well below
+// any engine's error in t.
+//--------------------------------------------------------
+static void rewriteInT( int coefficientCount, long double shift, long double scale,
+                        const double *inX, long double *inT )
+{
+    int degree = coefficientCount - 1;
+    long double tShift = -shift * scale;
+    long double tScale = 1.0L / scale;
+
+    for( int j = 0; j <= degree; j++ )
+    {
+        inT[j] = 0.0L;
+    }
+
+    long double scalePow = 1.0L;
+    for( int m = 0; m <= degree; m++ )
+    {
+        long double binomial = 1.0L;        // C(m, q)
+        long double shiftPow = 1.0L;        // (-tShift)^(m - q)
+        for( int q = m; q >= 0; q-- )
+        {
+            inT[q] += inX[ degree - m ] * scalePow * binomial * shiftPow;
+            binomial = binomial * q / (m - q + 1);
+            shiftPow *= -tShift;
+        }
+        scalePow *= tScale;
+    }
+}
+
+//--------------------------------------------------------
+// evaluate()
+// Returns the polynomial, highest power first, at x in
+// long double.
+//--------------------------------------------------------
+static long double evaluate( int coefficientCount, const double *coefficients, double x )
+{
+    long double value = 0.0L;
+
+    for( int j = 0; j < coefficientCount; j++ )
+    {
+        value = value * x + coefficients[j];
+    }
+    return value;
+}
+
+//--------------------------------------------------------
+// checkEngine()
+// Times one engine on one dataset, with the kernels
+// polyfit_simd() has selected, scores it against the
+// reference and prints its row.
+//
+// Returns true if the fit is within tolerance.
+//--------------------------------------------------------
+static bool checkEngine( const Engine *pEngine, const Dataset *pDataset, long pointCount,
+                         double *xValues, double *yValues, const Reference *pReference )
+{
+    double coefficients[ MAX_COEFFICIENTS ];
+    polyfit_options_t options;
+    polyfit_result_t result;
+    int k = pDataset->coefficientCount;
+    double bestSeconds = -1.0;
+    int rVal = 0;
+
+    polyfit_options_defaults( &options );
+    options.backend = pEngine->backend;
+    options.precision = pEngine->precision;
+    options.solver = pEngine->solver;
+
+    for( int run = 0; (run < RUN_COUNT) && (0 == rVal); run++ )
+    {
+        if( NULL == pEngine->pFit )
+        {
+            rVal = polyfit_ex( (int) pointCount, xValues, yValues, k, coefficients, &options, &result );
+        }
+        else
+        {
+            long long startTime = polyfit_stats_now();
+            rVal = pEngine->pFit( (int) pointCount, xValues, yValues, k, coefficients );
+            result.seconds = (polyfit_stats_now() - startTime) / 1e9;
+        }
+        if( (bestSeconds < 0.0) || (result.seconds < bestSeconds) )
+        {
+            bestSeconds = result.seconds;
+        }
+    }
+
+    if( 0 != rVal )
+    {
+        printf( "%-10s %7ld %3d  %-6s %-9s %12s %12s %12s %12s  FAIL (error = %d)\n", pDataset->name, pointCount, k,
+                polyfit_simd()->name, pEngine->name, "-", "-", "-", "-", rVal );
+        return false;
+    }
+
+    long double maxDifference = 0.0L;
+    long double rss = 0.0L;
+    for( long i = 0; i < pointCount; i++ )
+    {
+        long double fitted = evaluate( k, coefficients, xValues[i] );
+        long double difference = fabsl( fitted - pReference->pFitted[i] );
+        maxDifference = (difference > maxDifference) ? difference : maxDifference;
+        rss += (yValues[i] - fitted) * (yValues[i] - fitted);
+    }
+
+    double fitError = (pReference->maxFitted > 0.0L) ? (double) (maxDifference / pReference->maxFitted)
+                                                     : (double) maxDifference;
+    double excessRss = (pReference->rss > 0.0L) ? (double) ((rss - pReference->rss) / pReference->rss)
+                                                : (double) rss;
+    long double inT[ MAX_COEFFICIENTS ];
+    long double maxCoefficientDifference = 0.0L;
+    rewriteInT( k, pReference->shift, pReference->scale, coefficients, inT );
+    for( int j = 0; j < k; j++ )
+    {
+        maxCoefficientDifference = fmaxl( maxCoefficientDifference, fabsl( inT[j] - pReference->coefficients[j] ) );
+    }
+    double coefficientError = (pReference->maxCoefficient > 0.0L)
+                              ? (double) (maxCoefficientDifference / pReference->maxCoefficient)
+                              : (double) maxCoefficientDifference;
+
+    bool isPass = (fitError <= pEngine->tolerance) && (excessRss <= pEngine->tolerance) &&
+                  (coefficientError <= pEngine->tolerance);
+
+    printf( "%-10s %7ld %3d  %-6s %-9s %12.6f %12.3e %12.3e %12.3e  %s\n", pDataset->name, pointCount, k,
+            polyfit_simd()->name, pEngine->name, bestSeconds, fitError, excessRss, coefficientError,
+            isPass ? "pass" : "FAIL" );
+    return isPass;
+}
+
+//--------------------------------------------------------
+// fitRefined()
+// The mixed precision fit with its float solve refined in
+// double.
+//
+// Returns 0 if success, or the polyfit_ex() error code.
+//--------------------------------------------------------
+static int fitRefined( int pointCount, const double *xValues, const double *yValues,
+                       int coefficientCount, double *coefficientResults )
+{
+    polyfit_options_t options;
+
+    polyfit_options_defaults( &options );
+    options.backend = POLYFIT_BACKEND_OPENMP;
+    options.precision = POLYFIT_PRECISION_MIXED;
+    options.refinements = POLYFIT_MIXED_MAX_REFINEMENTS;
+    return polyfit_ex( pointCount, (double *) xValues, (double *) yValues, coefficientCount, coefficientResults,
+                       &options, NULL );
+}
+
+//--------------------------------------------------------
+// fitBatch()
+// Fits the points as the one series of a polyfit_batch().
+//
+// Returns 0 if success, or the series' status or the
+// polyfit_batch() error code.
+//--------------------------------------------------------
+static int fitBatch( int pointCount, const double *xValues, const double *yValues,
+                     int coefficientCount, double *coefficientResults )
+{
+    long seriesStarts[2] = { 0, pointCount };
+    int seriesResult = 0;
+
+    int rVal = polyfit_batch( 1, seriesStarts, xValues, yValues, coefficientCount, 0,
+                              coefficientResults, &seriesResult );
+    return (rVal < 0) ? rVal : seriesResult;
+}
+
+//--------------------------------------------------------
+// fitSweep()
+// Sweeps every coefficientCount up to the dataset's and
+// takes the largest fit.
+//
+// Returns 0 if success, or that fit's status or the
+// polyfit_sweep() error code.
+//--------------------------------------------------------
+static int fitSweep( int pointCount, const double *xValues, const double *yValues,
+                     int coefficientCount, double *coefficientResults )
+{
+    polyfit_sweep_t sweep;
+
+    int rVal = polyfit_sweep( pointCount, xValues, yValues, coefficientCount, POLYFIT_CRITERION_BIC, &sweep );
+    if( 0 != rVal )
+    {
+        return rVal;
+    }
+
+    const polyfit_sweep_fit_t *pFit = &sweep.fits[ coefficientCount - 1 ];
+    memcpy( coefficientResults, pFit->coefficients, coefficientCount * sizeof( double ) );
+    return pFit->status;
+}
+
+//--------------------------------------------------------
+// fitOnline()
+// Frames t on the points' x range, adds every point, then
+// adds the first half again and removes it, so the fit
+// only matches if removal undoes addition.
+//
+// Returns 0 if success, or the polyfit_online() error
+// code.
+//--------------------------------------------------------
+static int fitOnline( int pointCount, const double *xValues, const double *yValues,
+                      int coefficientCount, double *coefficientResults )
+{
+    polyfit_online_t online;
+    int halfCount = pointCount / 2;
+
+    double xMin = xValues[0];
+    double xMax = xValues[0];
+    for( int i = 1; i < pointCount; i++ )
+    {
+        xMin = (xValues[i] < xMin) ? xValues[i] : xMin;
+        xMax = (xValues[i] > xMax) ? xValues[i] : xMax;
+    }
+
+    int rVal = polyfit_online_init( &online, coefficientCount, 0.5 * (xMin + xMax),
+                                    (xMax > xMin) ? 2.0 / (xMax - xMin) : 1.0 );
+    if( 0 == rVal )
+    {
+        rVal = polyfit_online_add( &online, pointCount, xValues, yValues );
+    }
+    if( 0 == rVal )
+    {
+        rVal = polyfit_online_add( &online, halfCount, xValues, yValues );
+    }
+    if( 0 == rVal )
+    {
+        rVal = polyfit_online_remove( &online, halfCount, xValues, yValues );
+    }
+    if( 0 == rVal )
+    {
+        rVal = polyfit_online_solve( &online, coefficientResults );
+    }
+    return rVal;
+}
+
+//--------------------------------------------------------
+// fitRolling()
+// Rolls a window of pointCount points over the points
+// repeated twice, so the last window holds each point once
+// and got there by sliding over the first copy, and takes
+// its fit.
+//
+// Returns 0 if success, -2 if the points can't be
+// repeated, -3 if unable to allocate memory, or the last
+// window's status or the polyfit_rolling() error code.
+//--------------------------------------------------------
+static int fitRolling( int pointCount, const double *xValues, const double *yValues,
+                       int coefficientCount, double *coefficientResults )
+{
+    if( pointCount > INT_MAX / 2 )
+    {
+        return -2;
+    }
+
+    int seriesCount = 2 * pointCount;
+    double *pSeriesX = (double *) malloc( seriesCount * sizeof( double ) );
+    double *pSeriesY = (double *) malloc( seriesCount * sizeof( double ) );
+    double *pResults = (double *) malloc( (size_t) seriesCount * coefficientCount * sizeof( double ) );
+    int *pWindowResults = (int *) malloc( seriesCount * sizeof( int ) );
+    int rVal = -3;
+
+    if( (NULL != pSeriesX) && (NULL != pSeriesY) && (NULL != pResults) && (NULL != pWindowResults) )
+    {
+        for( int copy = 0; copy < 2; copy++ )
+        {
+            memcpy( &pSeriesX[ copy * pointCount ], xValues, pointCount * sizeof( double ) );
+            memcpy( &pSeriesY[ copy * pointCount ], yValues, pointCount * sizeof( double ) );
+        }
+
+        rVal = polyfit_rolling( seriesCount, pSeriesX, pSeriesY, coefficientCount, POLYFIT_WINDOW_POINTS,
+                                pointCount, 0, pResults, pWindowResults );
+        if( rVal >= 0 )
+        {
+            rVal = pWindowResults[ seriesCount - 1 ];
+            memcpy( coefficientResults, &pResults[ (size_t) (seriesCount - 1) * coefficientCount ],
+                    coefficientCount * sizeof( double ) );
+        }
+    }
+
+    free( pSeriesX );
+    free( pSeriesY );
+    free( pResults );
+    free( pWindowResults );
+    return rVal;
+}
+
+//--------------------------------------------------------
+// fitIndex()
+// Sorts the points by x, builds an index on the first
+// INDEX_CHUNK and appends the rest in order, INDEX_CHUNK
+// at a time, so every append runs past the x range the
+// index has framed so far; then fits every x.
+//
+// Returns 0 if success, -3 if unable to allocate memory,
+// or the polyfit_index() error code.
+//--------------------------------------------------------
+static int fitIndex( int pointCount, const double *xValues, const double *yValues,
+                     int coefficientCount, double *coefficientResults )
+{
+    Point *pPoints = (Point *) malloc( pointCount * sizeof( Point ) );
+    double *pSortedX = (double *) malloc( pointCount * sizeof( double ) );
+    double *pSortedY = (double *) malloc( pointCount * sizeof( double ) );
+    polyfit_index_t *pIndex = NULL;
+    int rVal = -3;
+
+    if( (NULL != pPoints) && (NULL != pSortedX) && (NULL != pSortedY) )
+    {
+        for( int i = 0; i < pointCount; i++ )
+        {
+            pPoints[i].x = xValues[i];
+            pPoints[i].y = yValues[i];
+        }
+        qsort( pPoints, pointCount, sizeof( Point ), comparePoints );
+        for( int i = 0; i < pointCount; i++ )
+        {
+            pSortedX[i] = pPoints[i].x;
+            pSortedY[i] = pPoints[i].y;
+        }
+
+        int first = (pointCount < INDEX_CHUNK) ? pointCount : INDEX_CHUNK;
+        rVal = polyfit_index_create( first, pSortedX, pSortedY, coefficientCount, &pIndex );
+        for( int start = first; (start < pointCount) && (0 == rVal); start += INDEX_CHUNK )
+        {
+            int count = (pointCount - start < INDEX_CHUNK) ? (pointCount - start) : INDEX_CHUNK;
+            rVal = polyfit_index_append( pIndex, count, &pSortedX[ start ], &pSortedY[ start ] );
+        }
+        if( 0 == rVal )
+        {
+            rVal = polyfit_index_fit( pIndex, -DBL_MAX, DBL_MAX, coefficientCount, coefficientResults, NULL );
+        }
+    }
+
+    polyfit_index_destroy( pIndex );
+    free( pPoints );
+    free( pSortedX );
+    free( pSortedY );
+    return rVal;
+}
+
+//--------------------------------------------------------
+// comparePoints()
+// qsort() order of points by x.
+//--------------------------------------------------------
+static int comparePoints( const void *pLeft, const void *pRight )
+{
+    double left = ((const Point *) pLeft)->x;
+    double right = ((const Point *) pRight)->x;
+
+    return (left > right) - (left < right);
+}
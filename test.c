@@ -29,80 +29,70 @@
 #include  <stdio.h>
 #include  <string.h>
 #include  "polyfit.h"
+#include  "polyfit_batch.h"
 #include  "openMP_polyfit.h"
+#include  "polyfit_bin.h"
+#include  "polyfit_csv.h"
+#include  "polyfit_ex.h"
+#include  "polyfit_index.h"
+#include  "polyfit_online.h"
+#include  "polyfit_pipeline.h"
+#include  "polyfit_rolling.h"
+#include  "polyfit_sweep.h"
 //#include  "pthreads_polyfit.h"
 
 //for timing
 #include <time.h>
+//for fabs
+#include <math.h>
 //for csv
 #include <stdlib.h>
 
 #include <stdio.h>
 #include <stdlib.h>
 
+//--------------------------------------------------------
+// readCSV()
+// Loads the x,y columns of a CSV file.  If a dataset file
+// made by csv2bin sits next to it (name.csv -> name.pfb),
+// that is mapped instead, with no parsing or copying.
+// Otherwise the CSV is parsed with polyfit_csv_load() and
+// any malformed lines are summarized on stderr.
+//--------------------------------------------------------
 int readCSV(const char* csvFileName, double** x, double** y, size_t* size) {
-    FILE* file = fopen(csvFileName, "r");
-
-    if (file == NULL) {
-        fprintf(stderr, "Error: Unable to open the CSV file.\n");
-        return 1; // Return an error code
-    }
-
-    *size = 0;
-    size_t capacity = 1;  // Initial capacity, can be adjusted based on your needs
-    char line[100];
-
-    // Skip the first line
-    if (fgets(line, sizeof(line), file) == NULL) {
-        fprintf(stderr, "Error: Unable to read the first line.\n");
-        fclose(file);
-        return 1;
+    char binFileName[1024];
+    const char* dot = strrchr(csvFileName, '.');
+    int stemLength = (dot != NULL) ? (int)(dot - csvFileName) : (int)strlen(csvFileName);
+    snprintf(binFileName, sizeof(binFileName), "%.*s%s", stemLength, csvFileName, POLYFIT_BIN_EXTENSION);
+
+    polyfit_bin_t bin;
+    if (polyfit_bin_load(binFileName, &bin) == 0) {
+        // The mapping stays in place for the life of the test.
+        *x = bin.xValues;
+        *y = bin.yValues;
+        *size = (size_t)bin.pointCount;
+        return 0;
     }
 
-    // Allocate memory for *x and *y
-    *x = (double*)malloc(capacity * sizeof(double));
-    *y = (double*)malloc(capacity * sizeof(double));
+    polyfit_csv_t csv;
+    int rVal = polyfit_csv_load(csvFileName, &csv);
 
-    if (*x == NULL || *y == NULL) {
-        fprintf(stderr, "Error: Memory allocation failed.\n");
-        fclose(file);
-        return 1;
+    if (rVal != 0) {
+        fprintf(stderr, "Error: Unable to load %s (error = %d).\n", csvFileName, rVal);
+        return 1; // Return an error code
     }
 
-    while (fgets(line, sizeof(line), file) != NULL) {
-        double xValue, yValue;
-
-        if (sscanf(line, "%lf,%lf", &xValue, &yValue) == 2) {
-            if (*size == capacity) {
-                // Double the capacity
-                capacity *= 2;
-                double* tempX = realloc(*x, capacity * sizeof(double));
-                double* tempY = realloc(*y, capacity * sizeof(double));
-
-                if (tempX == NULL || tempY == NULL) {
-                    fprintf(stderr, "Error: Memory allocation failed.\n");
-                    fclose(file);
-
-                    // Clean up the existing memory
-                    free(*x);
-                    free(*y);
-
-                    return 1;
-                }
-
-                *x = tempX;
-                *y = tempY;
-            }
-
-            (*x)[*size] = xValue;
-            (*y)[*size] = yValue;
-            (*size)++;
-        } else {
-            fprintf(stderr, "Error: Invalid line format in the CSV file.\n");
+    if (csv.malformedCount > 0) {
+        fprintf(stderr, "%s: skipped %ld malformed line(s), first at line(s)", csvFileName, csv.malformedCount);
+        for (int i = 0; i < csv.reportedCount; i++) {
+            fprintf(stderr, " %ld", csv.malformedLines[i]);
         }
+        fprintf(stderr, "%s\n", (csv.malformedCount > csv.reportedCount) ? " ..." : "");
     }
 
-    fclose(file);
+    *x = csv.xValues;
+    *y = csv.yValues;
+    *size = (size_t)csv.pointCount;
     return 0; // Return 0 on success
 }
 
@@ -350,6 +340,292 @@ else
 }
 printf("10M points openmp produced %s\n", polyStringBf);
 
+// PIPELINE: fits straight from the file, without loading it first.
+polyfit_pipeline_report_t pipelineReport;
+clock_gettime(CLOCK_MONOTONIC, &start_time_lpt);
+rVal = polyfit_pipeline_fit(csvFileNameTest6, cc6, NULL, cr6, &pipelineReport);
+clock_gettime(CLOCK_MONOTONIC, &end_time_lpt);
+elapsed_time = (end_time_lpt.tv_sec - start_time_lpt.tv_sec) +
+               (end_time_lpt.tv_nsec - start_time_lpt.tv_nsec) / 1e9;
+printf("Execution time of pipeline 10M points (read + fit): %f seconds, %zu buffer bytes\n",
+       elapsed_time, pipelineReport.bufferBytes);
+
+if (0 == rVal)
+{
+    polyToString(polyStringBf, POLY_STRING_BF_SZ, cc6, cr6);
+}
+else
+{
+    snprintf(polyStringBf, POLY_STRING_BF_SZ, "error = %d", rVal);
+}
+printf("10M points pipeline produced %s\n", polyStringBf);
+
+// STATS: per-phase times and hardware counters over repeated 100K fits.
+#define STATS_RUNS (20)
+polyfit_backend_t statsBackends[] = { POLYFIT_BACKEND_SERIAL, POLYFIT_BACKEND_OPENMP, POLYFIT_BACKEND_SIMD };
+for (int b = 0; b < (int)(sizeof(statsBackends) / sizeof(statsBackends[0])); b++)
+{
+    polyfit_options_t options;
+    polyfit_result_t fitResult;
+    polyfit_stats_collector_t collector;
+    polyfit_perf_t *pPerf = polyfit_perf_create();
+
+    polyfit_options_defaults(&options);
+    options.backend = statsBackends[b];
+    options.pPerf = pPerf;
+    polyfit_stats_collector_init(&collector);
+    for (int run = 0; run < STATS_RUNS; run++)
+    {
+        if (0 == polyfit_ex(pc4, x4, y4, cc4, cr4, &options, &fitResult))
+        {
+            polyfit_stats_collector_add(&collector, &fitResult.stats);
+        }
+    }
+
+    char title[64];
+    snprintf(title, sizeof(title), "100K %s", polyfit_backend_name(statsBackends[b]));
+    polyfit_stats_collector_print(&collector, stdout, title);
+    polyfit_perf_print(pPerf, stdout, title);
+    polyfit_stats_collector_free(&collector);
+    polyfit_perf_destroy(pPerf);
+}
+
+// BATCH: the 1M points as 5000 series of 200, one polyfit() each vs one polyfit_batch().
+#define BATCH_SERIES_POINTS (200)
+int batchSeries = pc5 / BATCH_SERIES_POINTS;
+long* batchStarts = (long*)malloc((batchSeries + 1) * sizeof(long));
+double* batchResults = (double*)malloc((size_t)batchSeries * cc5 * sizeof(double));
+if ((batchSeries > 0) && (batchStarts != NULL) && (batchResults != NULL))
+{
+    int batchFailed = 0;
+    double largestDifference = 0.0;
+
+    for (int s = 0; s <= batchSeries; s++)
+    {
+        batchStarts[s] = (long)s * BATCH_SERIES_POINTS;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time_lpt);
+    for (int s = 0; s < batchSeries; s++)
+    {
+        batchFailed += (0 != polyfit(BATCH_SERIES_POINTS, &x5[batchStarts[s]], &y5[batchStarts[s]], cc5,
+                                     &batchResults[(size_t)s * cc5]));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end_time_lpt);
+    elapsed_time = (end_time_lpt.tv_sec - start_time_lpt.tv_sec) +
+                   (end_time_lpt.tv_nsec - start_time_lpt.tv_nsec) / 1e9;
+    printf("%d series polyfit() loop: %f seconds, %.0f fits/s, %d failed\n",
+           batchSeries, elapsed_time, batchSeries / elapsed_time, batchFailed);
+
+    // Keep the last series' loop result to compare against.
+    memcpy(cr5, &batchResults[(size_t)(batchSeries - 1) * cc5], cc5 * sizeof(double));
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time_lpt);
+    batchFailed = polyfit_batch(batchSeries, batchStarts, x5, y5, cc5, 0, batchResults, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end_time_lpt);
+    elapsed_time = (end_time_lpt.tv_sec - start_time_lpt.tv_sec) +
+                   (end_time_lpt.tv_nsec - start_time_lpt.tv_nsec) / 1e9;
+    for (int i = 0; i < cc5; i++)
+    {
+        double difference = fabs(cr5[i] - batchResults[(size_t)(batchSeries - 1) * cc5 + i]);
+        largestDifference = (difference > largestDifference) ? difference : largestDifference;
+    }
+    printf("%d series polyfit_batch(): %f seconds, %.0f fits/s, %d failed, last series differs by %g\n",
+           batchSeries, elapsed_time, batchSeries / elapsed_time, batchFailed, largestDifference);
+}
+free(batchStarts);
+free(batchResults);
+
+// SWEEP: every coefficient count up to 8 from one pass over the 1M points.
+#define SWEEP_MAX_COEFFICIENTS (8)
+polyfit_sweep_t sweep;
+clock_gettime(CLOCK_MONOTONIC, &start_time_lpt);
+rVal = polyfit_sweep(pc5, x5, y5, SWEEP_MAX_COEFFICIENTS, POLYFIT_CRITERION_BIC, &sweep);
+clock_gettime(CLOCK_MONOTONIC, &end_time_lpt);
+elapsed_time = (end_time_lpt.tv_sec - start_time_lpt.tv_sec) +
+               (end_time_lpt.tv_nsec - start_time_lpt.tv_nsec) / 1e9;
+printf("Execution time of sweep 1M points, 1..%d coefficients: %f seconds\n", SWEEP_MAX_COEFFICIENTS, elapsed_time);
+if (0 == rVal)
+{
+    for (int c = 1; c <= SWEEP_MAX_COEFFICIENTS; c++)
+    {
+        const polyfit_sweep_fit_t* pFit = &sweep.fits[c - 1];
+        printf("  %d coefficients: status %d, SSE %g, AIC %.1f, BIC %.1f, adjusted R2 %.6f%s\n", c, pFit->status,
+               pFit->sse, pFit->aic, pFit->bic, pFit->adjustedR2, (c == sweep.bestCoefficientCount) ? "  <- best" : "");
+    }
+}
+else
+{
+    printf("sweep error = %d\n", rVal);
+}
+
+// ONLINE: a 10K point window slid over the 1M points one point at a time,
+// against a one-shot polyfit() of the last window.
+#define ONLINE_WINDOW (10000)
+if (pc5 > ONLINE_WINDOW)
+{
+    polyfit_online_t online;
+    double xMin = x5[0];
+    double xMax = x5[0];
+    for (int i = 1; i < pc5; i++)
+    {
+        xMin = (x5[i] < xMin) ? x5[i] : xMin;
+        xMax = (x5[i] > xMax) ? x5[i] : xMax;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time_lpt);
+    polyfit_online_init(&online, cc5, 0.5 * (xMin + xMax), (xMax > xMin) ? 2.0 / (xMax - xMin) : 1.0);
+    polyfit_online_add(&online, ONLINE_WINDOW, x5, y5);
+    for (int i = ONLINE_WINDOW; i < pc5; i++)
+    {
+        polyfit_online_add(&online, 1, &x5[i], &y5[i]);
+        polyfit_online_remove(&online, 1, &x5[i - ONLINE_WINDOW], &y5[i - ONLINE_WINDOW]);
+    }
+    rVal = polyfit_online_solve(&online, cr5);
+    clock_gettime(CLOCK_MONOTONIC, &end_time_lpt);
+    elapsed_time = (end_time_lpt.tv_sec - start_time_lpt.tv_sec) +
+                   (end_time_lpt.tv_nsec - start_time_lpt.tv_nsec) / 1e9;
+    printf("Execution time of online %d point window over 1M points: %f seconds\n", ONLINE_WINDOW, elapsed_time);
+
+    if (0 == rVal)
+    {
+        polyToString(polyStringBf, POLY_STRING_BF_SZ, cc5, cr5);
+    }
+    else
+    {
+        snprintf(polyStringBf, POLY_STRING_BF_SZ, "error = %d", rVal);
+    }
+    printf("last window online produced %s\n", polyStringBf);
+
+    rVal = polyfit(ONLINE_WINDOW, &x5[pc5 - ONLINE_WINDOW], &y5[pc5 - ONLINE_WINDOW], cc5, cr5);
+    if (0 == rVal)
+    {
+        polyToString(polyStringBf, POLY_STRING_BF_SZ, cc5, cr5);
+    }
+    else
+    {
+        snprintf(polyStringBf, POLY_STRING_BF_SZ, "error = %d", rVal);
+    }
+    printf("last window polyfit() produced %s\n", polyStringBf);
+}
+
+// ROLLING: a fit of every 1000 point window of the 1M points, against polyfit() per window.
+#define ROLLING_WINDOW (1000)
+#define ROLLING_SAMPLES (1000)
+double* rollingResults = (double*)malloc((size_t)pc5 * cc5 * sizeof(double));
+if ((pc5 > ROLLING_WINDOW + ROLLING_SAMPLES) && (rollingResults != NULL))
+{
+    clock_gettime(CLOCK_MONOTONIC, &start_time_lpt);
+    rVal = polyfit_rolling(pc5, x5, y5, cc5, POLYFIT_WINDOW_POINTS, ROLLING_WINDOW, 0, rollingResults, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end_time_lpt);
+    elapsed_time = (end_time_lpt.tv_sec - start_time_lpt.tv_sec) +
+                   (end_time_lpt.tv_nsec - start_time_lpt.tv_nsec) / 1e9;
+    printf("Execution time of rolling %d point windows over 1M points: %f seconds, %d not fitted\n",
+           ROLLING_WINDOW, elapsed_time, rVal);
+
+    // polyfit() on the last windows only, scaled up to all of them.
+    clock_gettime(CLOCK_MONOTONIC, &start_time_lpt);
+    for (int i = pc5 - ROLLING_SAMPLES; i < pc5; i++)
+    {
+        rVal = polyfit(ROLLING_WINDOW, &x5[i - ROLLING_WINDOW + 1], &y5[i - ROLLING_WINDOW + 1], cc5, cr5);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end_time_lpt);
+    elapsed_time = (end_time_lpt.tv_sec - start_time_lpt.tv_sec) +
+                   (end_time_lpt.tv_nsec - start_time_lpt.tv_nsec) / 1e9;
+    printf("Estimated time of polyfit() per window: %f seconds\n",
+           elapsed_time * (pc5 - ROLLING_WINDOW + 1) / ROLLING_SAMPLES);
+
+    if (0 == rVal)
+    {
+        polyToString(polyStringBf, POLY_STRING_BF_SZ, cc5, cr5);
+    }
+    else
+    {
+        snprintf(polyStringBf, POLY_STRING_BF_SZ, "error = %d", rVal);
+    }
+    printf("last window polyfit() produced %s\n", polyStringBf);
+    polyToString(polyStringBf, POLY_STRING_BF_SZ, cc5, &rollingResults[(size_t)(pc5 - 1) * cc5]);
+    printf("last window rolling produced %s\n", polyStringBf);
+}
+free(rollingResults);
+
+// INDEX: fits of 100 x ranges, each a tenth of the 1M points' span, from an
+// index built once, against gathering each range's points for polyfit().
+#define INDEX_QUERIES (100)
+polyfit_index_t* pIndex = NULL;
+double* indexX = (double*)malloc((size_t)pc5 * sizeof(double));
+double* indexY = (double*)malloc((size_t)pc5 * sizeof(double));
+if ((pc5 > 0) && (indexX != NULL) && (indexY != NULL))
+{
+    clock_gettime(CLOCK_MONOTONIC, &start_time_lpt);
+    rVal = polyfit_index_create(pc5, x5, y5, cc5, &pIndex);
+    clock_gettime(CLOCK_MONOTONIC, &end_time_lpt);
+    elapsed_time = (end_time_lpt.tv_sec - start_time_lpt.tv_sec) +
+                   (end_time_lpt.tv_nsec - start_time_lpt.tv_nsec) / 1e9;
+    printf("Execution time of building the index over 1M points: %f seconds, status %d\n", elapsed_time, rVal);
+}
+if (pIndex != NULL)
+{
+    double xMin = x5[0];
+    double xMax = x5[0];
+    for (int i = 1; i < pc5; i++)
+    {
+        xMin = (x5[i] < xMin) ? x5[i] : xMin;
+        xMax = (x5[i] > xMax) ? x5[i] : xMax;
+    }
+    double width = (xMax - xMin) / 10;
+    double indexCoefficients[POLYFIT_MAX_COEFFICIENTS];
+    long pointCount = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time_lpt);
+    for (int q = 0; q < INDEX_QUERIES; q++)
+    {
+        double low = xMin + (xMax - xMin - width) * q / (INDEX_QUERIES - 1);
+        rVal = polyfit_index_fit(pIndex, low, low + width, cc5, indexCoefficients, &pointCount);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end_time_lpt);
+    elapsed_time = (end_time_lpt.tv_sec - start_time_lpt.tv_sec) +
+                   (end_time_lpt.tv_nsec - start_time_lpt.tv_nsec) / 1e9;
+    printf("Execution time of %d index range fits: %f seconds, last of %ld points\n",
+           INDEX_QUERIES, elapsed_time, pointCount);
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time_lpt);
+    for (int q = 0; q < INDEX_QUERIES; q++)
+    {
+        double low = xMin + (xMax - xMin - width) * q / (INDEX_QUERIES - 1);
+        int count = 0;
+        for (int i = 0; i < pc5; i++)
+        {
+            if ((x5[i] >= low) && (x5[i] <= low + width))
+            {
+                indexX[count] = x5[i];
+                indexY[count] = y5[i];
+                count++;
+            }
+        }
+        rVal = polyfit(count, indexX, indexY, cc5, cr5);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end_time_lpt);
+    elapsed_time = (end_time_lpt.tv_sec - start_time_lpt.tv_sec) +
+                   (end_time_lpt.tv_nsec - start_time_lpt.tv_nsec) / 1e9;
+    printf("Execution time of %d scan and polyfit() range fits: %f seconds\n", INDEX_QUERIES, elapsed_time);
+
+    if (0 == rVal)
+    {
+        polyToString(polyStringBf, POLY_STRING_BF_SZ, cc5, cr5);
+    }
+    else
+    {
+        snprintf(polyStringBf, POLY_STRING_BF_SZ, "error = %d", rVal);
+    }
+    printf("last range polyfit() produced %s\n", polyStringBf);
+    polyToString(polyStringBf, POLY_STRING_BF_SZ, cc5, indexCoefficients);
+    printf("last range index produced %s\n", polyStringBf);
+}
+polyfit_index_destroy(pIndex);
+free(indexX);
+free(indexY);
+
 //---------------------SUMMARY--------------------------- 
   return( -failedCount );
 }